@@ -101,7 +101,7 @@ function inputPressed(inputs)
 				let entity = engine.spawnEntity();
 				let meshComp = entity.addComponent("mesh");
 				meshComp.IsVisible = true;
-				meshComp.MeshData.Name = "box2";
+				meshComp.Mesh = "box2";
 				meshComp.MaterialData = {
 					Shader: "singleColor",
 					Parameters: [
@@ -119,9 +119,7 @@ function inputPressed(inputs)
 				let newPos = pos;
 				newPos = newPos.sub(fwd.mult(1.5));
 
-				transformComp.Position[0] = newPos.x;
-				transformComp.Position[1] = newPos.y;
-				transformComp.Position[2] = newPos.z;
+				transformComp.Position = newPos.arr();
 
 				transformComp.Scale = [0.25, 0.25, 0.25];
 
@@ -147,9 +145,7 @@ function inputPressed(inputs)
 
 	if(moved == true)
 	{
-		transform.Position[0] = pos.x;
-		transform.Position[1] = pos.y;
-		transform.Position[2] = pos.z;
+		transform.Position = pos.arr();
 	}
 }
 
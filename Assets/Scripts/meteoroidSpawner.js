@@ -28,7 +28,7 @@ function spawnMeteoroid()
     let entity = engine.spawnEntity();
     let meshComp = entity.addComponent("mesh");
     meshComp.IsVisible = true;
-    meshComp.MeshData.Name = "ball";
+    meshComp.Mesh = "ball";
     meshComp.MaterialData = {
         Shader: "phong",
         Parameters: [
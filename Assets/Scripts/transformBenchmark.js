@@ -0,0 +1,16 @@
+// Used by the script benchmark scene. Moves its entity up and down by writing the transform every tick.
+var transform;
+var time = 0;
+
+function beginPlay()
+{
+    transform = getComponent("transform");
+}
+
+function tick()
+{
+    time += engine.deltaTime;
+    let position = transform.Position;
+    position[1] = Math.sin(time + entityID * 0.1);
+    transform.Position = position;
+}
@@ -19,6 +19,8 @@ mac {
 # windows
 win32 {
     INCLUDEPATH += $(OPENAL_HOME)\\include\\AL
+    # GetProcessMemoryInfo for the script benchmark
+    LIBS *= -lpsapi
 
     # 32 bits windows compiler
     contains(QT_ARCH, i386) {
@@ -73,12 +75,21 @@ HEADERS += \
     Widgets/spotlightwidget.h \
     Widgets/transformwidget.h \
     app.h \
+    behavioursystem.h \
     camerasystem.h \
     componentdata.h \
+    componentproxy.h \
+    cookedmesh.h \
     entitymanager.h \
+    entitysnapshot.h \
     inputhandler.h \
     inputsystem.h \
+    lightclustergrid.h \
     mainwindow.h \
+    meshoptimizer.h \
+    meshsimplifier.h \
+    nativebehaviour.h \
+    objparser.h \
     constants.h \
     gltypes.h \
     GSL/matrix2x2.h \
@@ -97,14 +108,24 @@ HEADERS += \
     particlesystem.h \
     physicssystem.h \
     postprocessor.h \
+    projectilebehaviour.h \
     qentity.h \
     renderer.h \
+    resourceid.h \
     resourcemanager.h \
+    resourcemap.h \
+    resourcepool.h \
     scene.h \
+    scenebinary.h \
+    sceneloader.h \
+    scriptquery.h \
     scriptsystem.h \
     soundlistener.h \
     soundmanager.h \
     texture.h \
+    textureimage.h \
+    threadpool.h \
+    uploadmanager.h \
     wavfilehandler.h \
     world.h \
     meshdata.h
@@ -125,13 +146,21 @@ SOURCES += \
     Widgets/spotlightwidget.cpp \
     Widgets/transformwidget.cpp \
     app.cpp \
+    behavioursystem.cpp \
     camerasystem.cpp \
     componentdata.cpp \
+    componentproxy.cpp \
+    cookedmesh.cpp \
     entitymanager.cpp \
+    entitysnapshot.cpp \
     inputhandler.cpp \
     inputsystem.cpp \
+    lightclustergrid.cpp \
     main.cpp \
     mainwindow.cpp \
+    meshoptimizer.cpp \
+    meshsimplifier.cpp \
+    objparser.cpp \
     GSL/matrix2x2.cpp \
     GSL/matrix3x3.cpp \
     GSL/matrix4x4.cpp \
@@ -145,14 +174,22 @@ SOURCES += \
     particlesystem.cpp \
     physicssystem.cpp \
     postprocessor.cpp \
+    projectilebehaviour.cpp \
     qentity.cpp \
     renderer.cpp \
+    resourceid.cpp \
     resourcemanager.cpp \
     scene.cpp \
+    scenebinary.cpp \
+    sceneloader.cpp \
+    scriptquery.cpp \
     scriptsystem.cpp \
     soundlistener.cpp \
     soundmanager.cpp \
     texture.cpp \
+    textureimage.cpp \
+    threadpool.cpp \
+    uploadmanager.cpp \
     wavfilehandler.cpp \
     world.cpp
 
@@ -176,7 +213,10 @@ DISTFILES += \
     Shaders/* \
     GSL/README.md \
     README.md \
+    Shaders/Deferred/clusteredlight.frag \
     Shaders/Deferred/directionallight.frag \
     Shaders/Deferred/gbuffer.frag \
     Shaders/Deferred/gbuffer.vert \
-    Shaders/Deferred/light.vert
+    Shaders/Deferred/light.vert \
+    Shaders/Deferred/lightstencil.frag \
+    Shaders/Deferred/lightvolume.vert
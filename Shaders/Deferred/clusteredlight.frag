@@ -0,0 +1,115 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform vec3 viewPos;
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+
+// Cluster grid
+uniform mat4 vMatrix;
+uniform vec2 screenSize;
+uniform uvec3 clusterDims;
+uniform float sliceScale;
+uniform float sliceBias;
+uniform int pointLightCount;
+
+// (offset, count) into lightIndices per cluster
+uniform usamplerBuffer clusters;
+uniform usamplerBuffer lightIndices;
+// 2 texels per light: (Position, Radius), (Color, Intensity)
+uniform samplerBuffer pointLights;
+// 4 texels per light: (Position, Range), (Color, unused), (Direction, cos CutOff), (cos OuterCutOff, constant, linear, quadratic)
+uniform samplerBuffer spotLights;
+
+float falloff(in float _distance, in float _radius)
+{
+    float a = 1.0 / (_distance * _distance);
+    float b = 1.0 / (_radius * _radius);
+    return max(a - b, 0.0);
+}
+
+vec3 pointLight(int index, vec3 FragPos, vec3 norm, vec3 viewDir, vec3 Diffuse, float Specular)
+{
+    vec4 posRadius = texelFetch(pointLights, index * 2);
+    vec4 colorIntensity = texelFetch(pointLights, index * 2 + 1);
+
+    float dist = length(posRadius.xyz - FragPos);
+    if(dist >= posRadius.w)
+        return vec3(0.0);
+
+    // diffuse
+    vec3 lightDir = normalize(posRadius.xyz - FragPos);
+    vec3 diffuse = max(dot(norm, lightDir), 0.0) * Diffuse * colorIntensity.rgb;
+    // specular
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 16);
+    vec3 specular = colorIntensity.rgb * spec * Specular;
+    // attenuation
+    float attenuation = falloff(dist, posRadius.w) * colorIntensity.a;
+    return (diffuse + specular) * attenuation;
+}
+
+vec3 spotLight(int index, vec3 FragPos, vec3 norm, vec3 viewDir, vec3 Diffuse, float Specular)
+{
+    vec4 posRange = texelFetch(spotLights, index * 4);
+    vec4 color = texelFetch(spotLights, index * 4 + 1);
+    vec4 dirCutOff = texelFetch(spotLights, index * 4 + 2);
+    vec4 params = texelFetch(spotLights, index * 4 + 3);
+
+    // diffuse
+    vec3 lightDir = normalize(posRange.xyz - FragPos);
+    vec3 diffuse = max(dot(norm, lightDir), 0.0) * Diffuse * color.rgb;
+
+    // specular
+    float spec = pow(max(dot(viewDir, norm), 0.0), 16.0);
+    vec3 specular = color.rgb * spec * Specular;
+
+    // Cutoff
+    float theta = dot(lightDir, normalize(-dirCutOff.xyz));
+    float epsilon = (dirCutOff.w - params.x);
+    float intensity = clamp((theta - params.x) / epsilon, 0.0, 1.0);
+
+    // Attenuation
+    float distance = length(posRange.xyz - FragPos);
+    float attenuation = 1.0 / (params.y + params.z * distance + params.w * (distance * distance));
+    vec3 ambient = (Diffuse * 0.1) * attenuation;
+
+    return ambient + (diffuse + specular) * intensity * attenuation;
+}
+
+void main()
+{
+    // retrieve data from gbuffer
+    vec3 FragPos = texture(gPosition, TexCoords).rgb;
+    vec3 Normal = texture(gNormal, TexCoords).rgb;
+    vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
+    float Specular = texture(gAlbedoSpec, TexCoords).a;
+
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 norm = normalize(Normal);
+
+    // Find the cluster this fragment belongs to
+    float depth = -(vMatrix * vec4(FragPos, 1.0)).z;
+    uvec2 tile = uvec2(clamp(gl_FragCoord.xy / screenSize, 0.0, 0.999) * vec2(clusterDims.xy));
+    int slice = int(floor(log(max(depth, 0.0001)) * sliceScale - sliceBias));
+    uint z = uint(clamp(slice, 0, int(clusterDims.z) - 1));
+    int cluster = int(tile.x + clusterDims.x * (tile.y + clusterDims.y * z));
+
+    uvec2 range = texelFetch(clusters, cluster).rg;
+
+    // Ambient once instead of once per light
+    vec3 lighting = pointLightCount > 0 ? Diffuse * 0.1 : vec3(0.0);
+    for(uint i = 0u; i < range.y; ++i)
+    {
+        int light = int(texelFetch(lightIndices, int(range.x + i)).r);
+        if(light < pointLightCount)
+            lighting += pointLight(light, FragPos, norm, viewDir, Diffuse, Specular);
+        else
+            lighting += spotLight(light - pointLightCount, FragPos, norm, viewDir, Diffuse, Specular);
+    }
+
+    FragColor = vec4(lighting, 1.0);
+}
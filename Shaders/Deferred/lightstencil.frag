@@ -0,0 +1,6 @@
+#version 330 core
+
+// Only used to mark the stencil buffer, so nothing is written.
+void main()
+{
+}
@@ -1,13 +1,11 @@
 #version 330 core
 out vec4 FragColor;
 
-in vec2 TexCoords;
-
 
 struct Light {
     vec3 Position;
     vec3 Direction;
-    float CutOff;
+    float CutOff;       // Cosines of the cutoff angles
     float OuterCutOff;
     vec3 Color;
 
@@ -17,6 +15,7 @@ struct Light {
 };
 
 uniform vec3 viewPos;
+uniform vec2 screenSize;
 uniform sampler2D gPosition;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedoSpec;
@@ -24,6 +23,9 @@ uniform Light light;
 
 void main()
 {
+    // Calculated from the fragment position so the shader works for both screen quads and light volumes
+    vec2 TexCoords = gl_FragCoord.xy / screenSize;
+
     // retrieve data from gbuffer
     vec3 FragPos = texture(gPosition, TexCoords).rgb;
     vec3 Normal = texture(gNormal, TexCoords).rgb;
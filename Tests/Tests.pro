@@ -0,0 +1,42 @@
+# Headless tests for the parts of the engine that don't need an OpenGL context or a window.
+# Build and run it on its own, the result is the exit code: 0 if every check passed.
+
+QT          = core gui
+
+TEMPLATE    = app
+CONFIG      += c++17 console
+CONFIG      -= app_bundle
+
+TARGET      = INNgine2019Tests
+
+INCLUDEPATH += ..
+INCLUDEPATH += ../GSL
+
+HEADERS += \
+    ../GSL/gsl_math.h \
+    ../GSL/matrix2x2.h \
+    ../GSL/matrix3x3.h \
+    ../GSL/matrix4x4.h \
+    ../GSL/quaternion.h \
+    ../GSL/vector2d.h \
+    ../GSL/vector3d.h \
+    ../GSL/vector4d.h \
+    ../lightclustergrid.h \
+    ../meshoptimizer.h \
+    ../meshsimplifier.h \
+    ../vertex.h
+
+SOURCES += \
+    ../GSL/gsl_math.cpp \
+    ../GSL/matrix2x2.cpp \
+    ../GSL/matrix3x3.cpp \
+    ../GSL/matrix4x4.cpp \
+    ../GSL/quaternion.cpp \
+    ../GSL/vector2d.cpp \
+    ../GSL/vector3d.cpp \
+    ../GSL/vector4d.cpp \
+    ../lightclustergrid.cpp \
+    ../meshoptimizer.cpp \
+    ../meshsimplifier.cpp \
+    ../vertex.cpp \
+    main.cpp
@@ -0,0 +1,241 @@
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "lightclustergrid.h"
+#include "meshoptimizer.h"
+#include "meshsimplifier.h"
+
+namespace
+{
+int failures{0};
+
+//! Reports a failed check, the test keeps going so every failure is listed.
+void check(bool condition, const char* what)
+{
+    if (condition)
+        return;
+    qDebug() << "FAILED:" << what;
+    ++failures;
+}
+
+bool clusterHasLight(const LightClusterGrid& grid, unsigned int x, unsigned int y, unsigned int z, unsigned int light)
+{
+    const auto lights = grid.lightsInCluster(x, y, z);
+    for (auto it = lights.first; it != lights.second; ++it)
+        if (*it == light)
+            return true;
+    return false;
+}
+
+//! The tile a view space position projects into, the same way the shader finds it.
+unsigned int tileOf(float position, float depth, float tanHalfFov, unsigned int tiles)
+{
+    const float ndc = position / (depth * tanHalfFov);
+    return static_cast<unsigned int>(std::floor((ndc * 0.5f + 0.5f) * tiles));
+}
+
+void testLightClusterGrid()
+{
+    LightClusterGrid grid;
+    const auto& settings = grid.settings();
+    const float tanHalfFovY = std::tan(0.5f * 45.f * 3.14159265f / 180.f);
+    const float tanHalfFovX = tanHalfFovY * 16.f / 9.f;
+    grid.setProjection(tanHalfFovX, tanHalfFovY, 0.1f, 100.f);
+
+    for (unsigned int slice{0}; slice < settings.slices; ++slice)
+        check(grid.sliceFromDepth(grid.depthFromSlice(slice) * 1.001f) == slice, "sliceFromDepth inverts depthFromSlice");
+    check(grid.sliceFromDepth(0.01f) == 0, "depths before the near plane go in the first slice");
+    check(grid.sliceFromDepth(1000.f) == settings.slices - 1, "depths past the far plane go in the last slice");
+
+    const std::vector<LightClusterGrid::LightBounds> lights{
+        {gsl::vec3{0.f, 0.f, -10.f}, 1.f},      // 0: in the middle of the view
+        {gsl::vec3{0.f, 0.f, 10.f}, 1.f},       // 1: behind the camera
+        {gsl::vec3{50.f, 0.f, -10.f}, 1.f},     // 2: far to the right of the frustum
+        {gsl::vec3{-4.5f, 2.f, -5.f}, 1.f},     // 3: partly outside the left edge
+        {gsl::vec3{0.f, 0.f, -5.f}, 1000.f}     // 4: covers everything
+    };
+    grid.build(lights);
+
+    // Cluster data is one contiguous (offset, count) range per cluster
+    const auto& data = grid.clusterData();
+    check(data.size() == grid.clusterCount() * 2, "one offset and count per cluster");
+    unsigned int offset{0};
+    bool contiguous{true};
+    for (unsigned int c{0}; c < grid.clusterCount(); ++c)
+    {
+        contiguous = contiguous && data[c * 2] == offset;
+        offset += data[c * 2 + 1];
+    }
+    check(contiguous, "cluster ranges follow each other");
+    check(offset == grid.lightIndices().size(), "cluster counts add up to the light index count");
+
+    std::vector<unsigned int> clustersPerLight(lights.size(), 0);
+    for (auto index : grid.lightIndices())
+        if (index < lights.size())
+            ++clustersPerLight[index];
+    check(clustersPerLight[1] == 0, "lights behind the camera aren't binned");
+    check(clustersPerLight[2] == 0, "lights outside the frustum aren't binned");
+    check(clustersPerLight[4] == grid.clusterCount(), "a light covering the frustum is in every cluster");
+
+    // The cluster containing a light's centre must always have the light
+    for (unsigned int i : {0u, 3u})
+    {
+        const auto& centre = lights[i].centre;
+        const float depth = -centre.z;
+        const auto x = tileOf(centre.x, depth, tanHalfFovX, settings.tilesX);
+        const auto y = tileOf(centre.y, depth, tanHalfFovY, settings.tilesY);
+        const auto z = grid.sliceFromDepth(depth);
+        if (x < settings.tilesX && y < settings.tilesY)
+            check(clusterHasLight(grid, x, y, z, i), "the cluster at a light's centre has the light");
+    }
+
+    // The tile ranges are clamped to the screen, a light hanging over the left edge still starts in the first tile
+    bool inFirstColumn{false};
+    for (unsigned int z{0}; z < settings.slices; ++z)
+        for (unsigned int y{0}; y < settings.tilesY; ++y)
+            inFirstColumn = inFirstColumn || clusterHasLight(grid, 0, y, z, 3);
+    check(inFirstColumn, "a light partly left of the view is in the first column of tiles");
+    check(clustersPerLight[3] > 0 && clustersPerLight[3] < grid.clusterCount(), "a partly visible light covers some of the clusters");
+
+    // Building again gives the same result, the reused buffers are reset
+    const auto indices = grid.lightIndices();
+    grid.build(lights);
+    check(grid.lightIndices() == indices, "building twice gives the same clusters");
+}
+
+//! A UV sphere written out with three unshared vertices per triangle, like the obj reader gives.
+MeshSimplifier::MeshBuffers unweldedSphere(int segments, int rings)
+{
+    MeshSimplifier::MeshBuffers mesh;
+    auto point = [&](int segment, int ring) {
+        const float theta = 3.14159265f * ring / rings;
+        const float phi = 2.f * 3.14159265f * segment / segments;
+        return gsl::vec3{std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+    };
+
+    for (int ring{0}; ring < rings; ++ring)
+    {
+        for (int segment{0}; segment < segments; ++segment)
+        {
+            const auto a = point(segment, ring);
+            const auto b = point(segment + 1, ring);
+            const auto c = point(segment + 1, ring + 1);
+            const auto d = point(segment, ring + 1);
+            for (const auto& corner : {a, b, c, a, c, d})
+            {
+                mesh.second.push_back(static_cast<GLuint>(mesh.first.size()));
+                mesh.first.emplace_back(corner, corner, gsl::vec2{0.f, 0.f});
+            }
+        }
+    }
+    return mesh;
+}
+
+void testMeshSimplifier()
+{
+    const auto sphere = unweldedSphere(64, 32);
+    const auto sourceTriangles = sphere.second.size() / 3;
+
+    const auto welded = MeshOptimizer::weldVertices(sphere);
+    check(welded.second.size() == sphere.second.size(), "welding keeps every triangle");
+    check(welded.first.size() < sphere.first.size() / 4, "welding merges the shared corners");
+
+    for (float ratio : {0.5f, 0.25f, 0.1f})
+    {
+        const auto simplified = MeshSimplifier::simplify(sphere, ratio);
+        const auto triangles = simplified.second.size() / 3;
+        const auto target = static_cast<std::size_t>(sourceTriangles * ratio);
+
+        const auto failuresBefore = failures;
+        check(triangles <= target, "simplify doesn't keep more triangles than the ratio asks for");
+        check(triangles >= target * 9 / 10, "simplify gets close to the target triangle count");
+        if (failures != failuresBefore)
+            qDebug() << "  ratio" << ratio << "kept" << triangles << "of" << sourceTriangles << "triangles, target" << target;
+
+        bool indicesValid{true};
+        for (auto index : simplified.second)
+            indicesValid = indicesValid && index < simplified.first.size();
+        check(indicesValid, "simplified indices point at simplified vertices");
+
+        float maxDeviation{0.f};
+        for (const auto& vertex : simplified.first)
+            maxDeviation = std::max(maxDeviation, std::abs(vertex.get_xyz().length() - 1.f));
+        check(maxDeviation < 0.1f, "simplified vertices stay on the surface");
+    }
+
+    check(MeshSimplifier::simplify(sphere, 0.f).second.size() / 3 < sourceTriangles / 10, "a ratio of 0 removes nearly everything");
+}
+
+//! A flat grid in the xz plane, split in two uv islands down the middle at x = 0.5.
+MeshSimplifier::MeshBuffers seamedGrid(int quads)
+{
+    MeshSimplifier::MeshBuffers mesh;
+    auto corner = [&](int x, int z, bool rightIsland) {
+        const float px = static_cast<float>(x) / quads;
+        const float pz = static_cast<float>(z) / quads;
+        // The right island is placed next to the left one in the texture
+        const float u = rightIsland ? px + 0.5f : px;
+        return Vertex{gsl::vec3{px, 0.f, pz}, gsl::vec3{0.f, 1.f, 0.f}, gsl::vec2{u, pz}};
+    };
+
+    for (int z{0}; z < quads; ++z)
+    {
+        for (int x{0}; x < quads; ++x)
+        {
+            const bool rightIsland = x >= quads / 2;
+            const auto a = corner(x, z, rightIsland);
+            const auto b = corner(x, z + 1, rightIsland);
+            const auto c = corner(x + 1, z + 1, rightIsland);
+            const auto d = corner(x + 1, z, rightIsland);
+            for (const auto& vertex : {a, b, c, a, c, d})
+            {
+                mesh.second.push_back(static_cast<GLuint>(mesh.first.size()));
+                mesh.first.push_back(vertex);
+            }
+        }
+    }
+    return mesh;
+}
+
+void testMeshSimplifierSeams()
+{
+    const int quads{32};
+    const auto grid = seamedGrid(quads);
+    const auto simplified = MeshSimplifier::simplify(grid, 0.5f);
+    check(simplified.second.size() < grid.second.size(), "a grid with a uv seam is still simplified");
+
+    // Both sides of the seam have to keep their own uvs
+    unsigned int leftSide{0}, rightSide{0};
+    bool uvsMatchIsland{true};
+    for (const auto& vertex : simplified.first)
+    {
+        const auto position = vertex.get_xyz();
+        const auto uv = vertex.get_uv();
+        if (position.x == 0.5f && uv.x == 0.5f)
+            ++leftSide;
+        else if (position.x == 0.5f && uv.x == 1.f)
+            ++rightSide;
+
+        // The right island's uvs start at 1
+        const bool rightIsland = uv.x >= 1.f;
+        uvsMatchIsland = uvsMatchIsland && (rightIsland ? position.x >= 0.5f : position.x <= 0.5f);
+    }
+    check(leftSide == quads + 1 && rightSide == quads + 1, "every vertex on the uv seam is kept on both sides");
+    check(uvsMatchIsland, "vertices keep the uvs of their own island");
+}
+}
+
+int main()
+{
+    testLightClusterGrid();
+    testMeshSimplifier();
+    testMeshSimplifierSeams();
+
+    if (failures)
+        qDebug() << failures << "checks failed";
+    else
+        qDebug() << "All checks passed";
+    // The number of failed checks, so 0 when everything passed
+    return failures;
+}
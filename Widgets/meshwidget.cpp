@@ -34,15 +34,21 @@ MeshWidget::MeshWidget(MainWindow *mainWindow, QWidget* parent)
     for(auto& name : ResourceManager::instance().getAllTextureNames())
     {
         ui->comboBox_Textures->addItem(QString::fromStdString(name));
+
+        // Show how much memory the texture uses on hover
+        const auto bytes = ResourceManager::instance().getTextureMemoryUsage(name);
+        ui->comboBox_Textures->setItemData(ui->comboBox_Textures->count() - 1,
+                                           bytes ? QString{"%1 KB"}.arg(static_cast<double>(bytes) / 1024.0, 0, 'f', 1) : QString{"Loading"},
+                                           Qt::ToolTipRole);
     }
 
     if(auto comp = getRenderComponent())
     {
-        auto name = comp->meshData.mName;
+        auto name = comp->mesh ? comp->mesh->mName : std::string{};
         if(name.size())
         {
             ui->label_Name->setText(QString::fromStdString(name));
-            ui->comboBox_Meshes->setCurrentText(QString::fromStdString(comp->meshData.mName));
+            ui->comboBox_Meshes->setCurrentText(QString::fromStdString(name));
         }
         else
         {
@@ -79,7 +85,7 @@ void MeshWidget::on_button_ChangeMesh_clicked()
                 {
                     if(name == ui->comboBox_Meshes->itemText(0))
                     {
-                        render->meshData = *ResourceManager::instance().getMesh(name.toStdString());
+                        render->mesh = ResourceManager::instance().getMesh(name.toStdString());
                         found = true;
                         break;
                     }
@@ -87,10 +93,10 @@ void MeshWidget::on_button_ChangeMesh_clicked()
 
                 if(!found)
                 {
-                    render->meshData = *ResourceManager::instance().addMesh(name.toStdString(), last.toStdString());
+                    render->mesh = ResourceManager::instance().addMesh(name.toStdString(), last.toStdString());
                 }
 
-                if(render->meshData.mVAOs[0])
+                if(render->mesh && render->mesh->mVAOs[0])
                 {
                     render->isVisible = true;
                     ui->checkBox_Visible->setCheckState(Qt::CheckState::Checked);
@@ -449,7 +455,7 @@ void MeshWidget::on_pushButton_ChangeMeshDropdown_clicked()
 
     if(auto render = getRenderComponent())
     {
-        render->meshData = *ResourceManager::instance().getMesh(name.toStdString());
+        render->mesh = ResourceManager::instance().getMesh(name.toStdString());
         render->isVisible = true;
         ui->checkBox_Visible->setCheckState(Qt::CheckState::Checked);
         ui->checkBox_Wireframe->setCheckState(Qt::CheckState::Unchecked);
@@ -480,8 +486,8 @@ void MeshWidget::on_pushButton_ChangeTextureDropdown_clicked()
 
     if(auto render = getRenderComponent())
     {
-        auto texture = ResourceManager::instance().getTexture(name.toStdString());
-        render->mMaterial.mTextures.push_back({texture->id(), texture->mType});
+        if(auto texture = ResourceManager::instance().getTexture(name.toStdString()))
+            render->mMaterial.mTextures.push_back({texture->id(), texture->mType, texture});
     }
 }
 
@@ -5,6 +5,7 @@
 #include <QFileDialog>
 #include "constants.h"
 #include "scriptsystem.h"
+#include "behavioursystem.h"
 #include <QDesktopServices>
 
 ScriptWidget::ScriptWidget(MainWindow* mainWindow, QWidget *parent) :
@@ -12,13 +13,23 @@ ScriptWidget::ScriptWidget(MainWindow* mainWindow, QWidget *parent) :
 {
     ui->setupUi(this);
 
+    ui->comboBox_Native->addItem("None");
+    for(const auto& name : BehaviourSystem::get()->getNames())
+        ui->comboBox_Native->addItem(QString::fromStdString(name));
+
     auto entity = mMainWindow->currentEntitySelected;
     if(entity)
     {
         if(auto comp = World::getWorld().getEntityManager()->getComponent<ScriptComponent>(entity->entityId))
         {
             auto filePath = comp->filePath;
-            if(filePath.size())
+            if(comp->native)
+            {
+                ui->lineEdit->setText(filePath.c_str());
+                ui->comboBox_Native->setCurrentText(filePath.c_str());
+                ui->button_NewFile->setEnabled(false);
+            }
+            else if(filePath.size())
             {
                 QString temp = filePath.c_str();
                 temp.replace(".js", "");
@@ -68,6 +79,8 @@ void ScriptWidget::on_toolButton_clicked()
             auto name = QString::fromStdString(gsl::scriptsFilePath) + info.baseName() + ".js";
             ui->lineEdit->setText(info.baseName() + ".js");
             ScriptSystem::get()->load(*comp, info.baseName().toStdString() + ".js");
+            ui->comboBox_Native->setCurrentIndex(0);
+            ui->button_NewFile->setEnabled(true);
         }
     }
 }
@@ -193,3 +206,29 @@ void ScriptWidget::on_button_NewFile_clicked()
         }
     }
 }
+
+void ScriptWidget::on_comboBox_Native_activated(int index)
+{
+    auto entity = mMainWindow->currentEntitySelected;
+    if(entity)
+    {
+        if(auto comp = World::getWorld().getEntityManager()->getComponent<ScriptComponent>(entity->entityId))
+        {
+            // Native behaviours are loaded like scripts, by name instead of by file
+            if(index)
+            {
+                auto name = ui->comboBox_Native->itemText(index);
+                ScriptSystem::get()->load(*comp, name.toStdString());
+                ui->lineEdit->setText(name);
+                ui->button_NewFile->setText("Create file");
+                ui->button_NewFile->setEnabled(false);
+            }
+            else if(comp->native)
+            {
+                comp->reset();
+                ui->lineEdit->setText("None");
+                ui->button_NewFile->setEnabled(true);
+            }
+        }
+    }
+}
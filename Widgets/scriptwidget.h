@@ -28,6 +28,8 @@ private slots:
 
     void on_button_NewFile_clicked();
 
+    void on_comboBox_Native_activated(int index);
+
 private:
     Ui::ScriptWidget *ui;
 
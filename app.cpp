@@ -10,6 +10,7 @@
 #include "inputsystem.h"
 #include "physicssystem.h"
 #include "scriptsystem.h"
+#include "behavioursystem.h"
 
 #include "Instrumentor.h"
 
@@ -49,9 +50,28 @@ void App::initTheRest()
 {
     PROFILE_FUNCTION();
     mResourceManager = std::unique_ptr<ResourceManager>(new ResourceManager{});
+    // Mesh components share the meshdata, but their bounds are calculated from it.
+    mResourceManager->meshLoaded = [this](const std::shared_ptr<MeshData>& mesh){
+        if (!mWorld)
+            return;
+
+        for (auto& render : mWorld->getEntityManager()->getMeshComponents())
+        {
+            if (render.valid && render.mesh.get() == mesh.get())
+            {
+                render.currentLOD = 0;
+                if (auto transform = mWorld->getEntityManager()->getComponent<TransformComponent>(render.entityId))
+                    transform->meshBoundsOutdated = true;
+            }
+        }
+    };
 
     mWorld = std::unique_ptr<World>(new World{});
     connect(mMainWindow.get(), &MainWindow::newScene, this, &App::newScene);
+    connect(mMainWindow.get(), &MainWindow::newLightBenchmarkScene, this, &App::newLightBenchmarkScene);
+    connect(mMainWindow.get(), &MainWindow::newScriptBenchmarkScene, this, &App::newScriptBenchmarkScene);
+    connect(mMainWindow.get(), &MainWindow::changeLightingMode, mRenderer, &Renderer::setLightingMode);
+    connect(mRenderer, &Renderer::lightingModeChanged, mMainWindow.get(), &MainWindow::setLightingMode);
     connect(mMainWindow.get(), &MainWindow::saveScene, this, &App::saveScene);
     connect(mMainWindow.get(), &MainWindow::loadScene, this, &App::loadScene);
     connect(mWorld->getEntityManager().get(), &EntityManager::updateUI, mMainWindow.get(), &MainWindow::updateUI);
@@ -73,22 +93,26 @@ void App::initTheRest()
 
     // Send skybox data to renderer
 
+    // The renderer outlives the resource manager, so it doesn't hold counted references. The resources are pinned instead.
     auto skyboxMesh = ResourceManager::instance().getMesh("skybox");
+    ResourceManager::instance().pinMesh("skybox");
     auto skyboxMaterial = std::make_shared<Material>();
     auto skyShader = ResourceManager::instance().getShader("skybox");
     skyboxMaterial->mShader = skyShader;
     auto texture = ResourceManager::instance().getTexture("skybox");
+    ResourceManager::instance().pinTexture("skybox");
     skyboxMaterial->mTextures.push_back({texture->id(), texture->mType});
-    mRenderer->mSkyboxMesh = skyboxMesh;
+    mRenderer->mSkyboxMesh = skyboxMesh.shared();
     mRenderer->mSkyboxMaterial = skyboxMaterial;
 
     // Send axis data to renderer
 
     auto axisMesh = ResourceManager::instance().getMesh("axis");
+    ResourceManager::instance().pinMesh("axis");
     axisMesh->mRenderType = GL_LINES;
     auto axisMaterial = std::make_shared<Material>();
     axisMaterial->mShader = ResourceManager::instance().getShader("axis");
-    mRenderer->mAxisMesh = axisMesh;
+    mRenderer->mAxisMesh = axisMesh.shared();
     mRenderer->mAxisMaterial = axisMaterial;
 
 
@@ -234,26 +258,21 @@ void App::update()
         PROFILE_SCOPE("Scripting");
         auto& scripts = mWorld->getEntityManager()->getScriptComponents();
 
-        ScriptSystem::get()->updateJSComponents(scripts);
-
         auto& inputs = mWorld->getEntityManager()->getInputComponents();
         ScriptSystem::get()->update(scripts, inputs, mEventHandler->inputPressedStrings,
                                     mEventHandler->inputReleasedStrings, mEventHandler->MouseOffset,
                                     hitInfos, mDeltaTime);
+        BehaviourSystem::get()->update(scripts, inputs, mEventHandler->inputPressedStrings,
+                                       mEventHandler->inputReleasedStrings, mEventHandler->MouseOffset,
+                                       hitInfos, mDeltaTime);
 
-        ScriptSystem::get()->updateCPPComponents(scripts);
+        ScriptSystem::get()->addDeferredComponents();
 
         mEventHandler->inputReleasedStrings.clear();
 
         mWorld->getEntityManager()->removeEntitiesMarked();
 
-        static unsigned int garbageCounter{0};
-        garbageCounter++;
-        if (garbageCounter - 1 > ScriptSystem::get()->garbageCollectionFrequency)
-        {
-            garbageCounter = 0;
-            ScriptSystem::get()->takeOutTheTrash(scripts);
-        }
+        ScriptSystem::get()->collectGarbage(scripts);
     }
 
     currentlyUpdating = false;
@@ -270,7 +289,8 @@ void App::updatePerspective()
 {
     PROFILE_FUNCTION();
     CameraSystem::updateCameraProjMatrices(mWorld->getEntityManager()->getCameraComponents(),
-                                           FOV, static_cast<float>(mRenderer->width()) / mRenderer->height(), 0.1f, 100.f);
+                                           FOV, static_cast<float>(mRenderer->width()) / mRenderer->height(), NEAR_PLANE, FAR_PLANE);
+    mRenderer->setClipPlanes(NEAR_PLANE, FAR_PLANE);
 }
 
 // Called when play action is pressed while not playing in UI
@@ -306,6 +326,7 @@ void App::onStop()
 
     auto& scripts = mWorld->getEntityManager()->getScriptComponents();
     ScriptSystem::get()->endPlay(scripts);
+    BehaviourSystem::get()->endPlay(scripts);
 
     auto sounds = mWorld->getEntityManager()->getSoundComponents();
     mSoundManager->stop(sounds);
@@ -318,8 +339,6 @@ void App::onStop()
         mesh->isVisible = true;
     }
 
-    ScriptSystem::get()->initGarbageCollection();
-
     // Reset JS states.
     for(auto& comp : mWorld->getEntityManager()->getScriptComponents())
     {
@@ -399,12 +418,28 @@ void App::saveSession()
 void App::newScene()
 {
     mWorld->newScene();
+    mResourceManager->unloadUnused();
+    updatePerspective();
+}
+
+void App::newLightBenchmarkScene()
+{
+    mWorld->newLightBenchmarkScene();
+    mResourceManager->unloadUnused();
+    updatePerspective();
+}
+
+void App::newScriptBenchmarkScene()
+{
+    mWorld->newScriptBenchmarkScene();
+    mResourceManager->unloadUnused();
     updatePerspective();
 }
 
 void App::loadScene(const std::string& path)
 {
     mWorld->loadScene(path);
+    mResourceManager->unloadUnused();
     updatePerspective();
 }
 
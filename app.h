@@ -29,6 +29,8 @@ class App : public QObject
 private:
     // Settings
     float FOV = 45.f;
+    float NEAR_PLANE = 0.1f;
+    float FAR_PLANE = 100.f;
 
 public:
     App();
@@ -84,6 +86,14 @@ private slots:
      * @brief Creates a new base scene with only a game camera and some lights.
      */
     void newScene();
+    /**
+     * @brief Replaces the current scene with the light benchmark scene.
+     */
+    void newLightBenchmarkScene();
+    /**
+     * @brief Replaces the current scene with the script benchmark scene.
+     */
+    void newScriptBenchmarkScene();
     /**
      * @brief Loads the scene at the given path.
      */
@@ -121,8 +131,9 @@ private:
 
     // Handles input events in Renderer
     std::shared_ptr<InputHandler> mEventHandler;
-    std::unique_ptr<World> mWorld;
+    // Before the world, so the components' resource references are released while the resource manager is still alive
     std::unique_ptr<ResourceManager> mResourceManager;
+    std::unique_ptr<World> mWorld;
 
     void loadSession(const std::string& path);
 
@@ -0,0 +1,89 @@
+#include "behavioursystem.h"
+#include "projectilebehaviour.h"
+
+#include "Instrumentor.h"
+
+BehaviourSystem::BehaviourSystem()
+{
+    registerBehaviour<ProjectileBehaviour>("Projectile");
+}
+
+std::vector<std::string> BehaviourSystem::getNames() const
+{
+    std::vector<std::string> names;
+    names.reserve(mPools.size());
+    for (const auto& pool : mPools)
+        names.push_back(pool.first);
+    return names;
+}
+
+void BehaviourSystem::update(std::vector<ScriptComponent> &scripts, const std::vector<InputComponent> &inputs,
+                             const std::vector<QString> &pressed, const std::vector<QString> &released, const QPoint &point,
+                             const std::vector<HitInfo> &hitInfos, float deltaTime)
+{
+    if (mPools.empty())
+        return;
+    PROFILE_FUNCTION();
+
+    // New components first. Spawned entities have the highest ids, so they're usually appended to their pools.
+    std::vector<std::pair<PoolBase*, unsigned int>> started;
+    std::size_t running{0};
+    for (auto& script : scripts)
+    {
+        if (!script.valid || !script.native)
+            continue;
+
+        if (!script.beginplayRun)
+        {
+            auto pool = mPools.find(script.filePath);
+            if (pool == mPools.end())
+                continue;
+            pool->second->add(script.entityId);
+            started.emplace_back(pool->second.get(), script.entityId);
+            script.beginplayRun = true;
+        }
+        ++running;
+    }
+
+    // More behaviours than running components means some components were removed or changed behaviour
+    std::size_t behaviours{0};
+    for (const auto& pool : mPools)
+        behaviours += pool.second->size();
+    if (behaviours != running)
+    {
+        for (auto& pool : mPools)
+        {
+            const auto& name = pool.first;
+            pool.second->prune([&](unsigned int entity){
+                auto it = std::lower_bound(scripts.begin(), scripts.end(), entity,
+                                           [](const ScriptComponent& comp, unsigned int id){ return comp.entityId < id; });
+                return it != scripts.end() && it->entityId == entity && it->valid && it->native &&
+                       it->beginplayRun && it->filePath == name;
+            });
+        }
+    }
+
+    // Started after all are added, as beginPlay may add components and move the script components
+    for (auto& start : started)
+        start.first->beginPlay(start.second);
+
+    for (auto& pool : mPools)
+        pool.second->tick(deltaTime);
+
+    for (auto& pool : mPools)
+        pool.second->runInputEvents(inputs, pressed, released, point);
+
+    for (const auto& hitInfo : hitInfos)
+        for (auto& pool : mPools)
+            pool.second->onHit(hitInfo);
+}
+
+void BehaviourSystem::endPlay(std::vector<ScriptComponent> &scripts)
+{
+    for (auto& pool : mPools)
+        pool.second->endPlay();
+
+    for (auto& script : scripts)
+        if (script.native)
+            script.beginplayRun = false;
+}
@@ -0,0 +1,191 @@
+#ifndef BEHAVIOURSYSTEM_H
+#define BEHAVIOURSYSTEM_H
+
+#include <QString>
+#include <QPoint>
+#include <memory>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include "componentdata.h"
+#include "nativebehaviour.h"
+#include "physicssystem.h"
+
+/** Runs the native behaviours of the script components, the C++ counterpart to the ScriptSystem.
+ * A script component runs a native behaviour when its file path is the name of a registered behaviour
+ * instead of a .js file, so they're chosen, saved and loaded just like scripts.
+ * The behaviours are kept in one vector per class, sorted by entity id, and every event is
+ * run as one loop per class. Classes that don't have a hook aren't looped over for it at all.
+ * @brief Runs the native behaviours of the script components.
+ */
+class BehaviourSystem
+{
+public:
+    static BehaviourSystem* get()
+    {
+        static BehaviourSystem instance;
+        return &instance;
+    }
+
+    /**
+     * @brief Makes T selectable by name for script components. T must derive from NativeBehaviour.
+     */
+    template<class T>
+    void registerBehaviour(const std::string& name)
+    {
+        static_assert(std::is_base_of<NativeBehaviour, T>::value, "Behaviours must derive from NativeBehaviour");
+        mPools[name] = std::make_unique<Pool<T>>();
+    }
+
+    //! Whether name is the name of a registered behaviour.
+    bool isRegistered(const std::string& name) const { return mPools.find(name) != mPools.end(); }
+
+    //! The names of all registered behaviours, sorted.
+    std::vector<std::string> getNames() const;
+
+    /**
+     * @brief Starts the behaviours of new script components, runs the events on all of them and drops the ones
+     * whose component is gone. Only called while playing.
+     */
+    void update(std::vector<ScriptComponent>& scripts, const std::vector<InputComponent>& inputs,
+                const std::vector<QString>& pressed, const std::vector<QString>& released, const QPoint& point,
+                const std::vector<HitInfo>& hitInfos, float deltaTime);
+
+    /**
+     * @brief Calls endPlay on all behaviours and destroys them. Called when the stop button is pressed.
+     */
+    void endPlay(std::vector<ScriptComponent>& scripts);
+
+private:
+    BehaviourSystem();
+
+    //! The behaviours of one class.
+    class PoolBase
+    {
+    public:
+        virtual ~PoolBase() = default;
+        //! Creates the behaviour for entity, replacing the one it has if any.
+        virtual void add(unsigned int entity) = 0;
+        //! Removes the behaviours of the entities isRunning returns false for.
+        virtual void prune(const std::function<bool(unsigned int entity)>& isRunning) = 0;
+        virtual std::size_t size() const = 0;
+        virtual void beginPlay(unsigned int entity) = 0;
+        virtual void tick(float deltaTime) = 0;
+        virtual void runInputEvents(const std::vector<InputComponent>& inputs, const std::vector<QString>& pressed,
+                                    const std::vector<QString>& released, const QPoint& point) = 0;
+        virtual void onHit(const HitInfo& hitInfo) = 0;
+        //! Calls endPlay on all behaviours and destroys them.
+        virtual void endPlay() = 0;
+    };
+
+    template<class T>
+    class Pool : public PoolBase
+    {
+        // A hook is defined by T if taking its address doesn't give the empty one in NativeBehaviour
+        static constexpr bool hasTick = !std::is_same<decltype(&T::tick), decltype(&NativeBehaviour::tick)>::value;
+        static constexpr bool hasHit = !std::is_same<decltype(&T::onHit), decltype(&NativeBehaviour::onHit)>::value;
+        static constexpr bool hasPressed = !std::is_same<decltype(&T::inputPressed), decltype(&NativeBehaviour::inputPressed)>::value;
+        static constexpr bool hasReleased = !std::is_same<decltype(&T::inputReleased), decltype(&NativeBehaviour::inputReleased)>::value;
+        static constexpr bool hasMouse = !std::is_same<decltype(&T::mouseMoved), decltype(&NativeBehaviour::mouseMoved)>::value;
+
+        std::vector<T> mBehaviours;
+
+        typename std::vector<T>::iterator find(unsigned int entity)
+        {
+            return std::lower_bound(mBehaviours.begin(), mBehaviours.end(), entity,
+                                    [](const T& behaviour, unsigned int id){ return behaviour.entityId < id; });
+        }
+
+    public:
+        void add(unsigned int entity) override
+        {
+            auto it = find(entity);
+            if (it == mBehaviours.end() || it->entityId != entity)
+                it = mBehaviours.insert(it, T{});
+            else
+                *it = T{};
+            it->entityId = entity;
+        }
+
+        void prune(const std::function<bool(unsigned int)>& isRunning) override
+        {
+            mBehaviours.erase(std::remove_if(mBehaviours.begin(), mBehaviours.end(),
+                                             [&](const T& behaviour){ return !isRunning(behaviour.entityId); }),
+                              mBehaviours.end());
+        }
+
+        std::size_t size() const override { return mBehaviours.size(); }
+
+        void beginPlay(unsigned int entity) override
+        {
+            auto it = find(entity);
+            if (it != mBehaviours.end() && it->entityId == entity)
+                it->beginPlay();
+        }
+
+        void tick(float deltaTime) override
+        {
+            if constexpr (hasTick)
+                for (auto& behaviour : mBehaviours)
+                    behaviour.tick(deltaTime);
+        }
+
+        void runInputEvents(const std::vector<InputComponent>& inputs, const std::vector<QString>& pressed,
+                            const std::vector<QString>& released, const QPoint& point) override
+        {
+            if constexpr (hasPressed || hasReleased || hasMouse)
+            {
+                const bool mouseMoved = !point.isNull();
+                if (!(pressed.size() || released.size() || mouseMoved))
+                    return;
+
+                // Both are sorted by entity id
+                auto inputIt = inputs.begin();
+                for (auto& behaviour : mBehaviours)
+                {
+                    inputIt = std::lower_bound(inputIt, inputs.end(), behaviour.entityId,
+                                               [](const InputComponent& comp, unsigned int id){ return comp.entityId < id; });
+                    if (inputIt == inputs.end())
+                        break;
+                    if (inputIt->entityId != behaviour.entityId || !inputIt->valid || !inputIt->controlledWhilePlaying)
+                        continue;
+
+                    if constexpr (hasPressed)
+                        if (pressed.size())
+                            behaviour.inputPressed(pressed);
+                    if constexpr (hasReleased)
+                        if (released.size())
+                            behaviour.inputReleased(released);
+                    if constexpr (hasMouse)
+                        if (mouseMoved)
+                            behaviour.mouseMoved(point);
+                }
+            }
+        }
+
+        void onHit(const HitInfo& hitInfo) override
+        {
+            if constexpr (hasHit)
+            {
+                auto it = find(hitInfo.eID);
+                if (it != mBehaviours.end() && it->entityId == hitInfo.eID)
+                    it->onHit(hitInfo);
+            }
+        }
+
+        void endPlay() override
+        {
+            for (auto& behaviour : mBehaviours)
+                behaviour.endPlay();
+            mBehaviours.clear();
+        }
+    };
+
+    //! One pool per registered behaviour, by name.
+    std::map<std::string, std::unique_ptr<PoolBase>> mPools;
+};
+
+#endif // BEHAVIOURSYSTEM_H
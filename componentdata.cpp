@@ -125,32 +125,44 @@ void TransformComponent::fromJSON(QJsonObject object)
 
 ScriptComponent::ScriptComponent(unsigned int _eID, bool _valid)
     : Component(_eID, _valid, ComponentType::Script),
-    filePath(""), JSEntity{nullptr}, beginplayRun{false}
+    filePath(""), JSEntity{nullptr}, beginplayRun{false}, ownsEngine{false}, native{false}
 {
-    engine = new QJSEngine();
-    engine->installExtensions(QJSEngine::ConsoleExtension);
-    engine->globalObject().setProperty("engine", engine->newQObject(new QScriptSystemPointer{}));
 }
 
 ScriptComponent::ScriptComponent(ScriptComponent &&rhs)
-    : Component{rhs}, engine{rhs.engine}, filePath{std::move(rhs.filePath)}, JSEntity{rhs.JSEntity}, beginplayRun{rhs.beginplayRun}
+    : Component{rhs}, engine{rhs.engine}, scope{std::move(rhs.scope)}, callbacks{std::move(rhs.callbacks)},
+      accessedComponents{std::move(rhs.accessedComponents)}, filePath{std::move(rhs.filePath)},
+      JSEntity{rhs.JSEntity}, beginplayRun{rhs.beginplayRun}, ownsEngine{rhs.ownsEngine}, native{rhs.native}
 {
     rhs.engine = nullptr;
+    rhs.scope = QJSValue{};
+    rhs.callbacks = Callbacks{};
+    rhs.accessedComponents.clear();
     rhs.JSEntity = nullptr;
+    rhs.ownsEngine = false;
 }
 
 ScriptComponent &ScriptComponent::operator=(ScriptComponent &&rhs)
 {
+    if (this == &rhs)
+        return *this;
+
     entityId = rhs.entityId;
     valid = rhs.valid;
 
-    engine = rhs.engine;
-    rhs.engine = nullptr;
-    JSEntity = rhs.JSEntity;
-    rhs.JSEntity = nullptr;
+    // Hand the old engine over to rhs so it's deleted with it instead of leaking
+    std::swap(engine, rhs.engine);
+    std::swap(scope, rhs.scope);
+    std::swap(callbacks, rhs.callbacks);
+    std::swap(accessedComponents, rhs.accessedComponents);
+    std::swap(JSEntity, rhs.JSEntity);
+    bool rhsOwnsEngine = rhs.ownsEngine;
+    rhs.ownsEngine = ownsEngine;
+    ownsEngine = rhsOwnsEngine;
 
     filePath = std::move(rhs.filePath);
     beginplayRun = rhs.beginplayRun;
+    native = rhs.native;
 
     return *this;
 }
@@ -159,21 +171,29 @@ void ScriptComponent::reset()
 {
     delete JSEntity;
     JSEntity = nullptr;
-    delete engine;
+
+    // Values must be released before their engine is deleted
+    scope = QJSValue{};
+    callbacks = Callbacks{};
+    accessedComponents.clear();
+    if (ownsEngine)
+        delete engine;
     engine = nullptr;
+    ownsEngine = false;
 
     filePath = "";
     beginplayRun = false;
-
-    engine = new QJSEngine();
-    engine->installExtensions(QJSEngine::ConsoleExtension);
-    engine->globalObject().setProperty("engine", engine->newQObject(new QScriptSystemPointer{}));
+    native = false;
 }
 
 ScriptComponent::~ScriptComponent()
 {
     delete JSEntity;
-    delete engine;
+    scope = QJSValue{};
+    callbacks = Callbacks{};
+    accessedComponents.clear();
+    if (ownsEngine)
+        delete engine;
 }
 
 QJsonObject ScriptComponent::toJSON()
@@ -192,7 +212,6 @@ void ScriptComponent::fromJSON(QJsonObject object)
     auto file = object["FilePath"].toString();
     if(file.size())
     {
-        engine->globalObject().setProperty("entityID", entityId);
         ScriptSystem::get()->load(*this, file.toStdString());
     }
 }
@@ -286,7 +305,8 @@ QJsonObject MeshComponent::toJSON()
     auto parentObj = Component::toJSON();
 
     parentObj.insert("IsVisible", QJsonValue(isVisible));
-    parentObj.insert("MeshData", meshData.toJSON());
+    if (mesh)
+        parentObj.insert("MeshData", mesh->toJSON());
     parentObj.insert("MaterialData", mMaterial.toJSON());
     parentObj.insert("RenderWireframe", QJsonValue(renderWireframe));
 
@@ -306,13 +326,29 @@ void MeshComponent::fromJSON(QJsonObject object)
     auto meshName = meshDataObj["Name"].toString().toStdString();
     if(meshName.size() && meshName != "None")
     {
-        meshData = *ResourceManager::instance().getMesh(meshName);
-        meshData.mRenderType = static_cast<GLenum>(meshDataObj["RenderType"].toInt(GL_TRIANGLES));
+        // The render type belongs to the mesh now, it's only kept in the JSON for older versions
+        mesh = ResourceManager::instance().getMesh(meshName);
     }
 
     // Material data
 
-    auto materialObj = object["MaterialData"].toObject();
+    materialFromJSON(object["MaterialData"].toObject());
+
+    for(auto textureRef : object["Textures"].toArray())
+    {
+        auto textureObj = textureRef.toObject();
+        auto texture = ResourceManager::instance().getTextureById(static_cast<unsigned>(textureObj["ID"].toInt()));
+        mMaterial.mTextures.push_back({static_cast<unsigned>(textureObj["ID"].toInt()),
+                                       static_cast<GLenum>(textureObj["Type"].toInt()),
+                                       std::move(texture)});
+    }
+
+
+    renderWireframe = object["RenderWireframe"].toBool();
+}
+
+void MeshComponent::materialFromJSON(const QJsonObject &materialObj)
+{
     auto shaderName = materialObj["Shader"].toString();
     if(shaderName.size() && shaderName != "None")
     {
@@ -375,19 +411,6 @@ void MeshComponent::fromJSON(QJsonObject object)
             }
         }
     }
-
-    for(auto textureRef : object["Textures"].toArray())
-    {
-        auto textureObj = textureRef.toObject();
-        mMaterial.mTextures.push_back(
-                    std::make_pair(
-                        static_cast<unsigned>(textureObj["ID"].toInt()),
-                        static_cast<GLenum>(textureObj["Type"].toInt()))
-                );
-    }
-
-
-    renderWireframe = object["RenderWireframe"].toBool();
 }
 
 QJsonObject CameraComponent::toJSON()
@@ -555,6 +578,24 @@ QJsonObject ColliderComponent::toJSON()
     auto parentObj = Component::toJSON();
 
     parentObj.insert("CollisionType", static_cast<int>(collisionType));
+    auto ext = extentsToJSON();
+    if (!ext.isNull())
+        parentObj.insert("Extents", ext);
+
+    return parentObj;
+}
+
+void ColliderComponent::fromJSON(QJsonObject object)
+{
+    Component::fromJSON(object);
+
+    collisionType = static_cast<ColliderComponent::Type>(object["CollisionType"].toInt(0));
+
+    extentsFromJSON(object["Extents"]);
+}
+
+QJsonValue ColliderComponent::extentsToJSON() const
+{
     switch (collisionType)
     {
         case ColliderComponent::AABB:
@@ -565,38 +606,30 @@ QJsonObject ColliderComponent::toJSON()
             arr.insert(0, (ext != nullptr) ? static_cast<double>(ext->x) : 1.0);
             arr.insert(1, (ext != nullptr) ? static_cast<double>(ext->y) : 1.0);
             arr.insert(2, (ext != nullptr) ? static_cast<double>(ext->z) : 1.0);
-            parentObj.insert("Extents", arr);
+            return arr;
         }
-        break;
         case ColliderComponent::SPHERE:
         {
             auto ext = std::get_if<float>(&extents);
-            parentObj.insert("Extents", static_cast<double>((ext != nullptr) ? *ext : 1.f));
+            return static_cast<double>((ext != nullptr) ? *ext : 1.f);
         }
-        break;
         case ColliderComponent::CAPSULE:
         {
             auto ext = std::get_if<std::pair<float, float>>(&extents);
             QJsonObject obj;
             obj.insert("Radius", (ext != nullptr) ? static_cast<double>(ext->first) : 1.0);
             obj.insert("Half-height", (ext != nullptr) ? static_cast<double>(ext->second) : 1.0);
-            parentObj.insert("Extents", obj);
+            return obj;
         }
-        break;
         default:
         break;
     }
 
-    return parentObj;
+    return QJsonValue{};
 }
 
-void ColliderComponent::fromJSON(QJsonObject object)
+void ColliderComponent::extentsFromJSON(const QJsonValue &obj)
 {
-    Component::fromJSON(object);
-
-    collisionType = static_cast<ColliderComponent::Type>(object["CollisionType"].toInt(0));
-
-    auto obj = object["Extents"];
     switch (collisionType)
     {
         case ColliderComponent::AABB:
@@ -3,10 +3,15 @@
 
 #include "meshdata.h"
 #include <QtMath> // temp for qDegreesRadians in spot light component
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
 
 // For ScriptComponent
 #include <QFile>
 #include <QJSEngine>
+#include <QPointer>
 
 #include "qentity.h"
 
@@ -163,7 +168,8 @@ struct PhysicsComponent : public Component
 struct MeshComponent : public Component
 {
     bool isVisible : 1;
-    MeshData meshData{};
+    //! Counted reference to the mesh in the resource manager. Null if the mesh has been removed.
+    MeshRef mesh{};
     Material mMaterial{};
     bool renderWireframe : 1;
 
@@ -174,19 +180,31 @@ struct MeshComponent : public Component
      */
     MeshData::Bounds bounds{};
 
+    /* LOD used last time the mesh was rendered.
+     * Needed for the LOD hysteresis and reused
+     * by mouse picking.
+     */
+    unsigned int currentLOD{0};
+
     MeshComponent(unsigned int _eID = 0, bool _valid = false,
-                  const MeshData& _meshData = MeshData{}, const Material& _material = Material{}, bool _visible = false, bool _renderWireframe = false)
-        : Component (_eID, _valid, ComponentType::Mesh), isVisible{_visible}, meshData{_meshData}, mMaterial{_material}, renderWireframe{_renderWireframe}
+                  const MeshRef& _mesh = MeshRef{}, const Material& _material = Material{}, bool _visible = false, bool _renderWireframe = false)
+        : Component (_eID, _valid, ComponentType::Mesh), isVisible{_visible}, mesh{_mesh}, mMaterial{_material}, renderWireframe{_renderWireframe}
     {}
 
     virtual void reset() override
     {
         isVisible = true;
-        meshData = MeshData{};
+        mesh.reset();
         mMaterial = Material{};
         renderWireframe = false;
+        currentLOD = 0;
     }
 
+    /**
+     * @brief Sets the shader and shader parameters from the "MaterialData" part of the component's JSON.
+     */
+    void materialFromJSON(const QJsonObject& materialObj);
+
     virtual QJsonObject toJSON() override;
     virtual void fromJSON(QJsonObject object) override;
 };
@@ -361,6 +379,18 @@ struct SpotLightComponent : public Component
         constant = 1.f;
     }
 
+    /**
+     * @brief Distance at which the attenuation has faded the light to less than 5/256 of it's brightness.
+     */
+    float calculateRange() const
+    {
+        float brightness = std::max(std::max(color.x, color.y), color.z);
+        if (quadratic <= 0.f)
+            return (linear <= 0.f) ? std::numeric_limits<float>::max() : ((256.0f / 5.0f) * brightness - constant) / linear;
+        return (-linear + std::sqrt(linear * linear - 4 * quadratic * (constant - (256.0f / 5.0f) * brightness)))
+                / (2.0f * quadratic);
+    }
+
     virtual QJsonObject toJSON() override;
     virtual void fromJSON(QJsonObject object) override;
 };
@@ -402,10 +432,36 @@ struct DirectionalLightComponent : public Component
  */
 struct ScriptComponent : public Component
 {
+    /** Engine the script runs in. Created when the script is loaded.
+     * Owned by the component, unless the ScriptSystem shares one engine between all components running the same file.
+     */
     QJSEngine* engine{nullptr};
+    /** Object the script's functions and variables are found through.
+     * The global object of the engine if the component owns it, else the component's own context object in the shared engine.
+     */
+    QJSValue scope;
+    /** Functions looked up once when the script is loaded, so they're not searched for by name every call.
+     * Undefined if the script doesn't define them.
+     */
+    struct Callbacks
+    {
+        QJSValue beginPlay, tick, endPlay, onHit, inputPressed, inputReleased, mouseMoved;
+    } callbacks;
+    /** Weak handles to the component proxies given to the script, by entity and component type, so they're reused.
+     * The proxies are owned by the engine and deleted once the script no longer refers to them.
+     */
+    std::unordered_map<std::uint64_t, QPointer<QObject>> accessedComponents;
+    static std::uint64_t proxyKey(unsigned int entity, ComponentType type)
+    {
+        return (static_cast<std::uint64_t>(entity) << 8) | static_cast<std::uint8_t>(type);
+    }
+    //! The .js file the component runs, or the name of a native behaviour. See BehaviourSystem.
     std::string filePath;
     QEntity* JSEntity{};
     bool beginplayRun : 1;
+    bool ownsEngine : 1;
+    //! Whether filePath names a native behaviour run by the BehaviourSystem instead of a script.
+    bool native : 1;
 
     ScriptComponent(unsigned int _eID = 0, bool _valid = false);
     ScriptComponent(const ScriptComponent& rhs) = delete;
@@ -490,6 +546,10 @@ struct ColliderComponent : public Component
         std::pair<gsl::vec3, gsl::vec3> minMax() const;
     } bounds;
 
+    //! Extents in the format used by the "Extents" JSON field. Null if the collider has no type.
+    QJsonValue extentsToJSON() const;
+    //! Sets the extents from the "Extents" JSON field, interpreted according to the collision type.
+    void extentsFromJSON(const QJsonValue& obj);
 
     virtual QJsonObject toJSON() override;
     virtual void fromJSON(QJsonObject object) override;
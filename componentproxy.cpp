@@ -0,0 +1,690 @@
+#include "componentproxy.h"
+#include "entitymanager.h"
+#include "scriptsystem.h"
+#include "soundmanager.h"
+#include "world.h"
+#include <QJsonDocument>
+
+namespace
+{
+QVariantList toList(const gsl::vec3& vector)
+{
+    return {vector.x, vector.y, vector.z};
+}
+
+//! Missing elements are taken from fallback.
+gsl::vec3 toVec3(const QVariantList& list, const gsl::vec3& fallback = gsl::vec3{})
+{
+    gsl::vec3 vector{fallback};
+    for (int i{0}; i < 3 && i < list.size(); ++i)
+        vector[i] = list[i].toFloat();
+    return vector;
+}
+}
+
+bool ComponentProxy::onScriptThread()
+{
+    return ScriptSystem::isScriptThread();
+}
+
+void ComponentProxy::queueWrite(std::function<void ()> write)
+{
+    ScriptSystem::get()->defer(std::move(write));
+}
+
+unsigned int ComponentProxy::resolveEntity(unsigned int entity)
+{
+    return ScriptSystem::get()->resolveEntity(entity);
+}
+
+template<class T>
+T* ComponentProxy::component() const
+{
+    if (auto comp = World::getWorld().getEntityManager()->getComponent<T>(mEntity))
+        return comp;
+    return static_cast<T*>(ScriptSystem::get()->getDeferredComponent(mEntity, mType));
+}
+
+ComponentProxy *ComponentProxy::create(unsigned int entity, ComponentType type)
+{
+    switch (type)
+    {
+    case ComponentType::Transform:
+        return new TransformProxy{entity};
+    case ComponentType::Physics:
+        return new PhysicsProxy{entity};
+    case ComponentType::Mesh:
+        return new MeshProxy{entity};
+    case ComponentType::Camera:
+        return new CameraProxy{entity};
+    case ComponentType::Input:
+        return new InputProxy{entity};
+    case ComponentType::Sound:
+        return new SoundProxy{entity};
+    case ComponentType::LightPoint:
+        return new PointLightProxy{entity};
+    case ComponentType::LightSpot:
+        return new SpotLightProxy{entity};
+    case ComponentType::LightDirectional:
+        return new DirectionalLightProxy{entity};
+    case ComponentType::Script:
+        return new ScriptProxy{entity};
+    case ComponentType::Collider:
+        return new ColliderProxy{entity};
+    default:
+        return nullptr;
+    }
+}
+
+// ------------------------------ Transform -----------------------------
+
+QVariantList TransformProxy::position() const
+{
+    auto comp = component<TransformComponent>();
+    return toList(comp ? comp->position : gsl::vec3{});
+}
+
+void TransformProxy::setPosition(const QVariantList &position)
+{
+    if (deferWrite(&TransformProxy::setPosition, position))
+        return;
+
+    auto entityManager = World::getWorld().getEntityManager();
+    if (auto comp = entityManager->getComponent<TransformComponent>(mEntity))
+        entityManager->setTransformPos(mEntity, toVec3(position, comp->position));
+    else if (auto deferred = component<TransformComponent>())
+        deferred->setPosition(toVec3(position, deferred->position));
+}
+
+QVariantList TransformProxy::rotation() const
+{
+    auto comp = component<TransformComponent>();
+    auto rotation = comp ? comp->rotation : gsl::quat{};
+    return {rotation.s, rotation.i, rotation.j, rotation.k};
+}
+
+void TransformProxy::setRotation(const QVariantList &rotation)
+{
+    if (deferWrite(&TransformProxy::setRotation, rotation))
+        return;
+
+    if (rotation.size() < 4)
+        return;
+
+    gsl::quat quat{rotation[0].toFloat(), rotation[1].toFloat(), rotation[2].toFloat(), rotation[3].toFloat()};
+    auto entityManager = World::getWorld().getEntityManager();
+    if (entityManager->getComponent<TransformComponent>(mEntity))
+        entityManager->setTransformRot(mEntity, quat);
+    else if (auto deferred = component<TransformComponent>())
+        deferred->setRotation(quat);
+}
+
+QVariantList TransformProxy::scale() const
+{
+    auto comp = component<TransformComponent>();
+    return toList(comp ? comp->scale : gsl::vec3{1.f});
+}
+
+void TransformProxy::setScale(const QVariantList &scale)
+{
+    if (deferWrite(&TransformProxy::setScale, scale))
+        return;
+
+    auto entityManager = World::getWorld().getEntityManager();
+    if (auto comp = entityManager->getComponent<TransformComponent>(mEntity))
+        entityManager->setTransformScale(mEntity, toVec3(scale, comp->scale));
+    else if (auto deferred = component<TransformComponent>())
+        deferred->setScale(toVec3(scale, deferred->scale));
+}
+
+QVariantList TransformProxy::children() const
+{
+    QVariantList list;
+    if (auto comp = component<TransformComponent>())
+        for (auto child : comp->children)
+            list.push_back(child);
+    return list;
+}
+
+// ------------------------------ Physics -----------------------------
+
+QVariantList PhysicsProxy::velocity() const
+{
+    auto comp = component<PhysicsComponent>();
+    return toList(comp ? comp->velocity : gsl::vec3{});
+}
+
+void PhysicsProxy::setVelocity(const QVariantList &velocity)
+{
+    if (deferWrite(&PhysicsProxy::setVelocity, velocity))
+        return;
+
+    if (auto comp = component<PhysicsComponent>())
+        comp->velocity = toVec3(velocity, comp->velocity);
+}
+
+QVariantList PhysicsProxy::acceleration() const
+{
+    auto comp = component<PhysicsComponent>();
+    return toList(comp ? comp->acceleration : gsl::vec3{});
+}
+
+void PhysicsProxy::setAcceleration(const QVariantList &acceleration)
+{
+    if (deferWrite(&PhysicsProxy::setAcceleration, acceleration))
+        return;
+
+    if (auto comp = component<PhysicsComponent>())
+        comp->acceleration = toVec3(acceleration, comp->acceleration);
+}
+
+float PhysicsProxy::mass() const
+{
+    auto comp = component<PhysicsComponent>();
+    return comp ? comp->mass : 1.f;
+}
+
+void PhysicsProxy::setMass(float mass)
+{
+    if (deferWrite(&PhysicsProxy::setMass, mass))
+        return;
+
+    if (auto comp = component<PhysicsComponent>())
+        comp->mass = mass;
+}
+
+// ------------------------------ Mesh -----------------------------
+
+bool MeshProxy::isVisible() const
+{
+    auto comp = component<MeshComponent>();
+    return comp && comp->isVisible;
+}
+
+void MeshProxy::setVisible(bool visible)
+{
+    if (deferWrite(&MeshProxy::setVisible, visible))
+        return;
+
+    if (auto comp = component<MeshComponent>())
+        comp->isVisible = visible;
+}
+
+QString MeshProxy::mesh() const
+{
+    auto comp = component<MeshComponent>();
+    return (comp && comp->mesh) ? QString::fromStdString(comp->mesh->mName) : QString{};
+}
+
+void MeshProxy::setMesh(const QString &name)
+{
+    if (deferWrite(&MeshProxy::setMesh, name))
+        return;
+
+    auto comp = component<MeshComponent>();
+    if (!comp)
+        return;
+
+    if (name.size() && name != "None")
+        comp->mesh = ResourceManager::instance().getMesh(name.toStdString());
+    else
+        comp->mesh.reset();
+}
+
+QVariantMap MeshProxy::meshData() const
+{
+    auto comp = component<MeshComponent>();
+    return (comp && comp->mesh) ? comp->mesh->toJSON().toVariantMap() : QVariantMap{};
+}
+
+void MeshProxy::setMeshData(const QVariantMap &meshData)
+{
+    if (deferWrite(&MeshProxy::setMeshData, meshData))
+        return;
+
+    setMesh(meshData.value("Name").toString());
+}
+
+QVariantMap MeshProxy::materialData() const
+{
+    auto comp = component<MeshComponent>();
+    return comp ? comp->mMaterial.toJSON().toVariantMap() : QVariantMap{};
+}
+
+void MeshProxy::setMaterialData(const QVariantMap &materialData)
+{
+    if (deferWrite(&MeshProxy::setMaterialData, materialData))
+        return;
+
+    if (auto comp = component<MeshComponent>())
+        comp->materialFromJSON(QJsonObject::fromVariantMap(materialData));
+}
+
+bool MeshProxy::renderWireframe() const
+{
+    auto comp = component<MeshComponent>();
+    return comp && comp->renderWireframe;
+}
+
+void MeshProxy::setRenderWireframe(bool wireframe)
+{
+    if (deferWrite(&MeshProxy::setRenderWireframe, wireframe))
+        return;
+
+    if (auto comp = component<MeshComponent>())
+        comp->renderWireframe = wireframe;
+}
+
+// ------------------------------ Camera -----------------------------
+
+bool CameraProxy::isEditorCamera() const
+{
+    auto comp = component<CameraComponent>();
+    return comp && comp->isEditorCamera;
+}
+
+float CameraProxy::pitch() const
+{
+    auto comp = component<CameraComponent>();
+    return comp ? comp->pitch : 0.f;
+}
+
+void CameraProxy::setPitch(float pitch)
+{
+    if (deferWrite(&CameraProxy::setPitch, pitch))
+        return;
+
+    if (auto comp = component<CameraComponent>())
+        comp->pitch = pitch;
+}
+
+float CameraProxy::yaw() const
+{
+    auto comp = component<CameraComponent>();
+    return comp ? comp->yaw : 0.f;
+}
+
+void CameraProxy::setYaw(float yaw)
+{
+    if (deferWrite(&CameraProxy::setYaw, yaw))
+        return;
+
+    if (auto comp = component<CameraComponent>())
+        comp->yaw = yaw;
+}
+
+// ------------------------------ Input -----------------------------
+
+bool InputProxy::controlledWhilePlaying() const
+{
+    auto comp = component<InputComponent>();
+    return comp && comp->controlledWhilePlaying;
+}
+
+void InputProxy::setControlledWhilePlaying(bool controlled)
+{
+    if (deferWrite(&InputProxy::setControlledWhilePlaying, controlled))
+        return;
+
+    if (auto comp = component<InputComponent>())
+        comp->controlledWhilePlaying = controlled;
+}
+
+// ------------------------------ Sound -----------------------------
+
+bool SoundProxy::isLooping() const
+{
+    auto comp = component<SoundComponent>();
+    return comp && comp->isLooping;
+}
+
+void SoundProxy::setLooping(bool looping)
+{
+    if (deferWrite(&SoundProxy::setLooping, looping))
+        return;
+
+    if (auto comp = component<SoundComponent>())
+        comp->isLooping = looping;
+}
+
+bool SoundProxy::isMuted() const
+{
+    auto comp = component<SoundComponent>();
+    return comp && comp->isMuted;
+}
+
+void SoundProxy::setMuted(bool muted)
+{
+    if (deferWrite(&SoundProxy::setMuted, muted))
+        return;
+
+    if (auto comp = component<SoundComponent>())
+        comp->isMuted = muted;
+}
+
+bool SoundProxy::autoplay() const
+{
+    auto comp = component<SoundComponent>();
+    return comp && comp->autoplay;
+}
+
+void SoundProxy::setAutoplay(bool autoplay)
+{
+    if (deferWrite(&SoundProxy::setAutoplay, autoplay))
+        return;
+
+    if (auto comp = component<SoundComponent>())
+        comp->autoplay = autoplay;
+}
+
+QString SoundProxy::name() const
+{
+    auto comp = component<SoundComponent>();
+    return comp ? QString::fromStdString(comp->name) : QString{};
+}
+
+void SoundProxy::setName(const QString &name)
+{
+    if (deferWrite(&SoundProxy::setName, name))
+        return;
+
+    auto comp = component<SoundComponent>();
+    if (!comp)
+        return;
+
+    comp->name = name.toStdString();
+    if (comp->name.size())
+        SoundManager::get().createSource(comp, comp->name);
+}
+
+float SoundProxy::pitch() const
+{
+    auto comp = component<SoundComponent>();
+    return comp ? comp->pitch : 1.f;
+}
+
+void SoundProxy::setPitch(float pitch)
+{
+    if (deferWrite(&SoundProxy::setPitch, pitch))
+        return;
+
+    if (auto comp = component<SoundComponent>())
+        comp->pitch = pitch;
+}
+
+float SoundProxy::gain() const
+{
+    auto comp = component<SoundComponent>();
+    return comp ? comp->gain : 0.f;
+}
+
+void SoundProxy::setGain(float gain)
+{
+    if (deferWrite(&SoundProxy::setGain, gain))
+        return;
+
+    if (auto comp = component<SoundComponent>())
+        comp->gain = gain;
+}
+
+// ------------------------------ Point light -----------------------------
+
+QVariantList PointLightProxy::color() const
+{
+    auto comp = component<PointLightComponent>();
+    return toList(comp ? comp->color : gsl::vec3{1.f});
+}
+
+void PointLightProxy::setColor(const QVariantList &color)
+{
+    if (deferWrite(&PointLightProxy::setColor, color))
+        return;
+
+    if (auto comp = component<PointLightComponent>())
+        comp->color = toVec3(color, comp->color);
+}
+
+float PointLightProxy::intensity() const
+{
+    auto comp = component<PointLightComponent>();
+    return comp ? comp->intensity : 0.f;
+}
+
+void PointLightProxy::setIntensity(float intensity)
+{
+    if (deferWrite(&PointLightProxy::setIntensity, intensity))
+        return;
+
+    if (auto comp = component<PointLightComponent>())
+        comp->intensity = intensity;
+}
+
+float PointLightProxy::radius() const
+{
+    auto comp = component<PointLightComponent>();
+    return comp ? comp->radius : 0.f;
+}
+
+void PointLightProxy::setRadius(float radius)
+{
+    if (deferWrite(&PointLightProxy::setRadius, radius))
+        return;
+
+    if (auto comp = component<PointLightComponent>())
+        comp->radius = radius;
+}
+
+float PointLightProxy::maxBrightness() const
+{
+    auto comp = component<PointLightComponent>();
+    return comp ? comp->maxBrightness : 0.f;
+}
+
+void PointLightProxy::setMaxBrightness(float maxBrightness)
+{
+    if (deferWrite(&PointLightProxy::setMaxBrightness, maxBrightness))
+        return;
+
+    if (auto comp = component<PointLightComponent>())
+        comp->maxBrightness = maxBrightness;
+}
+
+// ------------------------------ Spot light -----------------------------
+
+QVariantList SpotLightProxy::color() const
+{
+    auto comp = component<SpotLightComponent>();
+    return toList(comp ? comp->color : gsl::vec3{1.f});
+}
+
+void SpotLightProxy::setColor(const QVariantList &color)
+{
+    if (deferWrite(&SpotLightProxy::setColor, color))
+        return;
+
+    if (auto comp = component<SpotLightComponent>())
+        comp->color = toVec3(color, comp->color);
+}
+
+float SpotLightProxy::intensity() const
+{
+    auto comp = component<SpotLightComponent>();
+    return comp ? comp->intensity : 0.f;
+}
+
+void SpotLightProxy::setIntensity(float intensity)
+{
+    if (deferWrite(&SpotLightProxy::setIntensity, intensity))
+        return;
+
+    if (auto comp = component<SpotLightComponent>())
+        comp->intensity = intensity;
+}
+
+float SpotLightProxy::cutOff() const
+{
+    auto comp = component<SpotLightComponent>();
+    return comp ? comp->cutOff : 0.f;
+}
+
+void SpotLightProxy::setCutOff(float cutOff)
+{
+    if (deferWrite(&SpotLightProxy::setCutOff, cutOff))
+        return;
+
+    if (auto comp = component<SpotLightComponent>())
+        comp->cutOff = cutOff;
+}
+
+float SpotLightProxy::outerCutOff() const
+{
+    auto comp = component<SpotLightComponent>();
+    return comp ? comp->outerCutOff : 0.f;
+}
+
+void SpotLightProxy::setOuterCutOff(float outerCutOff)
+{
+    if (deferWrite(&SpotLightProxy::setOuterCutOff, outerCutOff))
+        return;
+
+    if (auto comp = component<SpotLightComponent>())
+        comp->outerCutOff = outerCutOff;
+}
+
+float SpotLightProxy::linear() const
+{
+    auto comp = component<SpotLightComponent>();
+    return comp ? comp->linear : 0.f;
+}
+
+void SpotLightProxy::setLinear(float linear)
+{
+    if (deferWrite(&SpotLightProxy::setLinear, linear))
+        return;
+
+    if (auto comp = component<SpotLightComponent>())
+        comp->linear = linear;
+}
+
+float SpotLightProxy::quadratic() const
+{
+    auto comp = component<SpotLightComponent>();
+    return comp ? comp->quadratic : 0.f;
+}
+
+void SpotLightProxy::setQuadratic(float quadratic)
+{
+    if (deferWrite(&SpotLightProxy::setQuadratic, quadratic))
+        return;
+
+    if (auto comp = component<SpotLightComponent>())
+        comp->quadratic = quadratic;
+}
+
+float SpotLightProxy::constant() const
+{
+    auto comp = component<SpotLightComponent>();
+    return comp ? comp->constant : 0.f;
+}
+
+void SpotLightProxy::setConstant(float constant)
+{
+    if (deferWrite(&SpotLightProxy::setConstant, constant))
+        return;
+
+    if (auto comp = component<SpotLightComponent>())
+        comp->constant = constant;
+}
+
+// ------------------------------ Directional light -----------------------------
+
+QVariantList DirectionalLightProxy::color() const
+{
+    auto comp = component<DirectionalLightComponent>();
+    return toList(comp ? comp->color : gsl::vec3{1.f});
+}
+
+void DirectionalLightProxy::setColor(const QVariantList &color)
+{
+    if (deferWrite(&DirectionalLightProxy::setColor, color))
+        return;
+
+    if (auto comp = component<DirectionalLightComponent>())
+        comp->color = toVec3(color, comp->color);
+}
+
+float DirectionalLightProxy::intensity() const
+{
+    auto comp = component<DirectionalLightComponent>();
+    return comp ? comp->intensity : 0.f;
+}
+
+void DirectionalLightProxy::setIntensity(float intensity)
+{
+    if (deferWrite(&DirectionalLightProxy::setIntensity, intensity))
+        return;
+
+    if (auto comp = component<DirectionalLightComponent>())
+        comp->intensity = intensity;
+}
+
+// ------------------------------ Script -----------------------------
+
+QString ScriptProxy::filePath() const
+{
+    auto comp = component<ScriptComponent>();
+    return comp ? QString::fromStdString(comp->filePath) : QString{};
+}
+
+void ScriptProxy::setFilePath(const QString &filePath)
+{
+    if (deferWrite(&ScriptProxy::setFilePath, filePath))
+        return;
+
+    auto comp = component<ScriptComponent>();
+    if (!comp || comp->filePath == filePath.toStdString())
+        return;
+
+    comp->filePath = filePath.toStdString();
+    comp->beginplayRun = false;
+    // Decided again when it's loaded, as it may name a native behaviour
+    comp->native = false;
+}
+
+// ------------------------------ Collider -----------------------------
+
+int ColliderProxy::collisionType() const
+{
+    auto comp = component<ColliderComponent>();
+    return comp ? static_cast<int>(comp->collisionType) : 0;
+}
+
+void ColliderProxy::setCollisionType(int type)
+{
+    if (deferWrite(&ColliderProxy::setCollisionType, type))
+        return;
+
+    auto comp = component<ColliderComponent>();
+    if (!comp)
+        return;
+
+    // Reinterpret the extents for the new type, like loading them from JSON would
+    auto extents = comp->extentsToJSON();
+    comp->collisionType = static_cast<ColliderComponent::Type>(type);
+    comp->extentsFromJSON(extents);
+}
+
+QVariant ColliderProxy::extents() const
+{
+    auto comp = component<ColliderComponent>();
+    return comp ? comp->extentsToJSON().toVariant() : QVariant{};
+}
+
+void ColliderProxy::setExtents(const QVariant &extents)
+{
+    if (deferWrite(&ColliderProxy::setExtents, extents))
+        return;
+
+    if (auto comp = component<ColliderComponent>())
+        comp->extentsFromJSON(QJsonValue::fromVariant(extents));
+}
@@ -0,0 +1,291 @@
+#ifndef COMPONENTPROXY_H
+#define COMPONENTPROXY_H
+
+#include <QObject>
+#include <QVariant>
+#include <functional>
+#include "componentdata.h"
+
+/** Component as seen from JS.
+ * Properties read and write the component in the entity manager directly, looking it up by
+ * entity id on every access so the proxy stays valid when the component vectors move.
+ * Components added from JS are deferred until the scripts are done for the frame, and until then
+ * the proxy works on the deferred component held by the ScriptSystem.
+ * If the component is removed the properties read as defaults and writes are ignored.
+ *
+ * Writes made from a script worker thread are queued and applied on the main thread once the scripts are done,
+ * so they're not seen when read back before the next frame.
+ *
+ * Vector properties are returned as new arrays, so assign the whole array to change them.
+ * Example: transform.Position = [1, 2, 3];
+ * @brief Base class of the JS component proxies.
+ */
+class ComponentProxy : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(unsigned int ID READ id CONSTANT)
+    Q_PROPERTY(int ComponentType READ componentType CONSTANT)
+
+public:
+    /**
+     * @brief Creates the proxy matching the component type. Returns nullptr for types that can't be used from JS.
+     */
+    static ComponentProxy* create(unsigned int entity, ComponentType type);
+
+    unsigned int id() const { return mEntity; }
+    //! Points the proxy at another entity. Used when a spawned entity gets its real id.
+    void setId(unsigned int entity) { mEntity = entity; }
+    int componentType() const { return static_cast<int>(mType); }
+
+protected:
+    ComponentProxy(unsigned int entity, ComponentType type) : mEntity{entity}, mType{type} {}
+
+    //! The live component, or the deferred one if it hasn't been added yet. nullptr if neither exists.
+    template<class T>
+    T* component() const;
+
+    /**
+     * @brief Queues a call to setter with value on a new proxy for the entity if called from a script worker thread,
+     * as the other threads may be reading the components. Returns true if it was queued.
+     * Example: if (deferWrite(&TransformProxy::setPosition, position)) return;
+     */
+    template<class Proxy, class Arg, class Value>
+    bool deferWrite(void (Proxy::*setter)(Arg), const Value& value) const
+    {
+        if (!onScriptThread())
+            return false;
+
+        queueWrite([entity = mEntity, setter, value](){
+            Proxy proxy{resolveEntity(entity)};
+            (proxy.*setter)(value);
+        });
+        return true;
+    }
+    static bool onScriptThread();
+    static void queueWrite(std::function<void()> write);
+    //! The real id of an entity spawned on a script thread. See ScriptSystem::resolveEntity.
+    static unsigned int resolveEntity(unsigned int entity);
+
+    unsigned int mEntity;
+    ComponentType mType;
+};
+
+class TransformProxy : public ComponentProxy
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariantList Position READ position WRITE setPosition)
+    Q_PROPERTY(QVariantList Rotation READ rotation WRITE setRotation)
+    Q_PROPERTY(QVariantList Scale READ scale WRITE setScale)
+    Q_PROPERTY(QVariantList Children READ children)
+
+public:
+    TransformProxy(unsigned int entity) : ComponentProxy{entity, ComponentType::Transform} {}
+
+    QVariantList position() const;
+    void setPosition(const QVariantList& position);
+    //! [s, i, j, k]
+    QVariantList rotation() const;
+    void setRotation(const QVariantList& rotation);
+    QVariantList scale() const;
+    void setScale(const QVariantList& scale);
+    QVariantList children() const;
+};
+
+class PhysicsProxy : public ComponentProxy
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariantList Velocity READ velocity WRITE setVelocity)
+    Q_PROPERTY(QVariantList Acceleration READ acceleration WRITE setAcceleration)
+    Q_PROPERTY(float Mass READ mass WRITE setMass)
+
+public:
+    PhysicsProxy(unsigned int entity) : ComponentProxy{entity, ComponentType::Physics} {}
+
+    QVariantList velocity() const;
+    void setVelocity(const QVariantList& velocity);
+    QVariantList acceleration() const;
+    void setAcceleration(const QVariantList& acceleration);
+    float mass() const;
+    void setMass(float mass);
+};
+
+class MeshProxy : public ComponentProxy
+{
+    Q_OBJECT
+    Q_PROPERTY(bool IsVisible READ isVisible WRITE setVisible)
+    Q_PROPERTY(QString Mesh READ mesh WRITE setMesh)
+    Q_PROPERTY(QVariantMap MeshData READ meshData WRITE setMeshData)
+    Q_PROPERTY(QVariantMap MaterialData READ materialData WRITE setMaterialData)
+    Q_PROPERTY(bool RenderWireframe READ renderWireframe WRITE setRenderWireframe)
+
+public:
+    MeshProxy(unsigned int entity) : ComponentProxy{entity, ComponentType::Mesh} {}
+
+    bool isVisible() const;
+    void setVisible(bool visible);
+    //! Name of the mesh in the resource manager.
+    QString mesh() const;
+    void setMesh(const QString& name);
+    //! Only the "Name" field is used when set.
+    QVariantMap meshData() const;
+    void setMeshData(const QVariantMap& meshData);
+    //! Same format as the "MaterialData" JSON field.
+    QVariantMap materialData() const;
+    void setMaterialData(const QVariantMap& materialData);
+    bool renderWireframe() const;
+    void setRenderWireframe(bool wireframe);
+};
+
+class CameraProxy : public ComponentProxy
+{
+    Q_OBJECT
+    Q_PROPERTY(bool EditorCam READ isEditorCamera)
+    Q_PROPERTY(float Pitch READ pitch WRITE setPitch)
+    Q_PROPERTY(float Yaw READ yaw WRITE setYaw)
+
+public:
+    CameraProxy(unsigned int entity) : ComponentProxy{entity, ComponentType::Camera} {}
+
+    bool isEditorCamera() const;
+    float pitch() const;
+    void setPitch(float pitch);
+    float yaw() const;
+    void setYaw(float yaw);
+};
+
+class InputProxy : public ComponentProxy
+{
+    Q_OBJECT
+    Q_PROPERTY(bool ControlledWhilePlaying READ controlledWhilePlaying WRITE setControlledWhilePlaying)
+
+public:
+    InputProxy(unsigned int entity) : ComponentProxy{entity, ComponentType::Input} {}
+
+    bool controlledWhilePlaying() const;
+    void setControlledWhilePlaying(bool controlled);
+};
+
+class SoundProxy : public ComponentProxy
+{
+    Q_OBJECT
+    Q_PROPERTY(bool Looping READ isLooping WRITE setLooping)
+    Q_PROPERTY(bool Muted READ isMuted WRITE setMuted)
+    Q_PROPERTY(bool Autoplay READ autoplay WRITE setAutoplay)
+    Q_PROPERTY(QString Name READ name WRITE setName)
+    Q_PROPERTY(float Pitch READ pitch WRITE setPitch)
+    Q_PROPERTY(float Gain READ gain WRITE setGain)
+
+public:
+    SoundProxy(unsigned int entity) : ComponentProxy{entity, ComponentType::Sound} {}
+
+    bool isLooping() const;
+    void setLooping(bool looping);
+    bool isMuted() const;
+    void setMuted(bool muted);
+    bool autoplay() const;
+    void setAutoplay(bool autoplay);
+    QString name() const;
+    //! Creates a sound source for the wav file.
+    void setName(const QString& name);
+    float pitch() const;
+    void setPitch(float pitch);
+    float gain() const;
+    void setGain(float gain);
+};
+
+class PointLightProxy : public ComponentProxy
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariantList Color READ color WRITE setColor)
+    Q_PROPERTY(float Intensity READ intensity WRITE setIntensity)
+    Q_PROPERTY(float Radius READ radius WRITE setRadius)
+    Q_PROPERTY(float MaxBrightness READ maxBrightness WRITE setMaxBrightness)
+
+public:
+    PointLightProxy(unsigned int entity) : ComponentProxy{entity, ComponentType::LightPoint} {}
+
+    QVariantList color() const;
+    void setColor(const QVariantList& color);
+    float intensity() const;
+    void setIntensity(float intensity);
+    float radius() const;
+    void setRadius(float radius);
+    float maxBrightness() const;
+    void setMaxBrightness(float maxBrightness);
+};
+
+class SpotLightProxy : public ComponentProxy
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariantList Color READ color WRITE setColor)
+    Q_PROPERTY(float Intensity READ intensity WRITE setIntensity)
+    Q_PROPERTY(float CutOff READ cutOff WRITE setCutOff)
+    Q_PROPERTY(float OuterCutOff READ outerCutOff WRITE setOuterCutOff)
+    Q_PROPERTY(float Linear READ linear WRITE setLinear)
+    Q_PROPERTY(float Quadratic READ quadratic WRITE setQuadratic)
+    Q_PROPERTY(float Constant READ constant WRITE setConstant)
+
+public:
+    SpotLightProxy(unsigned int entity) : ComponentProxy{entity, ComponentType::LightSpot} {}
+
+    QVariantList color() const;
+    void setColor(const QVariantList& color);
+    float intensity() const;
+    void setIntensity(float intensity);
+    float cutOff() const;
+    void setCutOff(float cutOff);
+    float outerCutOff() const;
+    void setOuterCutOff(float outerCutOff);
+    float linear() const;
+    void setLinear(float linear);
+    float quadratic() const;
+    void setQuadratic(float quadratic);
+    float constant() const;
+    void setConstant(float constant);
+};
+
+class DirectionalLightProxy : public ComponentProxy
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariantList Color READ color WRITE setColor)
+    Q_PROPERTY(float Intensity READ intensity WRITE setIntensity)
+
+public:
+    DirectionalLightProxy(unsigned int entity) : ComponentProxy{entity, ComponentType::LightDirectional} {}
+
+    QVariantList color() const;
+    void setColor(const QVariantList& color);
+    float intensity() const;
+    void setIntensity(float intensity);
+};
+
+class ScriptProxy : public ComponentProxy
+{
+    Q_OBJECT
+    Q_PROPERTY(QString FilePath READ filePath WRITE setFilePath)
+
+public:
+    ScriptProxy(unsigned int entity) : ComponentProxy{entity, ComponentType::Script} {}
+
+    QString filePath() const;
+    //! The script is loaded and its beginPlay run on the next update.
+    void setFilePath(const QString& filePath);
+};
+
+class ColliderProxy : public ComponentProxy
+{
+    Q_OBJECT
+    Q_PROPERTY(int CollisionType READ collisionType WRITE setCollisionType)
+    Q_PROPERTY(QVariant Extents READ extents WRITE setExtents)
+
+public:
+    ColliderProxy(unsigned int entity) : ComponentProxy{entity, ComponentType::Collider} {}
+
+    int collisionType() const;
+    void setCollisionType(int type);
+    //! Same format as the "Extents" JSON field, which depends on the collision type.
+    QVariant extents() const;
+    void setExtents(const QVariant& extents);
+};
+
+#endif // COMPONENTPROXY_H
@@ -0,0 +1,171 @@
+#include "cookedmesh.h"
+#include <QDebug>
+#include <fstream>
+#include <cstring>
+
+namespace
+{
+const char fileMagic[4] = {'I', 'N', 'N', 'M'};
+const std::uint32_t fileVersion{1};
+const std::uint64_t blobAlignment{16};
+
+struct FileHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::int64_t sourceModified;
+    std::int64_t sourceSize;
+    std::uint64_t settingsHash;
+    std::uint32_t vertexSize;
+    std::uint32_t renderType;
+    std::uint32_t LODCount;
+    float boundsCentre[3];
+    float boundsRadius;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(FileHeader) == 64, "Cooked mesh header layout changed");
+
+struct LODEntry
+{
+    std::uint64_t vertexOffset;
+    std::uint64_t indexOffset;
+    std::uint32_t vertexCount;
+    std::uint32_t indexCount;
+};
+static_assert(sizeof(LODEntry) == 24, "Cooked mesh LOD entry layout changed");
+
+inline std::uint64_t align(std::uint64_t offset)
+{
+    return (offset + blobAlignment - 1) & ~(blobAlignment - 1);
+}
+
+// True if the blob is aligned and lies between dataStart and the end of the file. Written so a huge offset or count can't overflow.
+inline bool blobInFile(std::uint64_t offset, std::uint64_t count, std::uint64_t elementSize, std::uint64_t dataStart, std::uint64_t fileSize)
+{
+    return offset % blobAlignment == 0 && offset >= dataStart && offset <= fileSize
+            && count <= (fileSize - offset) / elementSize;
+}
+}
+
+CookedMesh::~CookedMesh()
+{
+    if (mData)
+        mFile.unmap(const_cast<uchar*>(mData));
+}
+
+bool CookedMesh::open(const std::string &path, const Key &key)
+{
+    mFile.setFileName(QString::fromStdString(path));
+    if (!mFile.open(QIODevice::ReadOnly))
+        return false;
+
+    const auto size = static_cast<std::uint64_t>(mFile.size());
+    if (size < sizeof(FileHeader))
+        return false;
+
+    mData = mFile.map(0, mFile.size());
+    if (!mData)
+        return false;
+
+    const auto header = reinterpret_cast<const FileHeader*>(mData);
+    if (std::memcmp(header->magic, fileMagic, sizeof(fileMagic)) != 0 || header->version != fileVersion
+        || header->vertexSize != sizeof(Vertex) || header->sourceModified != key.sourceModified
+        || header->sourceSize != key.sourceSize || header->settingsHash != key.settingsHash
+        || sizeof(FileHeader) + header->LODCount * sizeof(LODEntry) > size)
+        return false;
+
+    const auto entries = reinterpret_cast<const LODEntry*>(mData + sizeof(FileHeader));
+    const std::uint64_t dataStart{sizeof(FileHeader) + header->LODCount * sizeof(LODEntry)};
+    mLODs.resize(header->LODCount);
+    for (unsigned int i{0}; i < header->LODCount; ++i)
+    {
+        const auto& entry = entries[i];
+        if (!blobInFile(entry.vertexOffset, entry.vertexCount, sizeof(Vertex), dataStart, size)
+            || !blobInFile(entry.indexOffset, entry.indexCount, sizeof(GLuint), dataStart, size))
+        {
+            qDebug() << "CookedMesh: Broken LOD table, cooking the mesh again:" << QString::fromStdString(path);
+            mLODs.clear();
+            return false;
+        }
+
+        mLODs[i].vertices = reinterpret_cast<const Vertex*>(mData + entry.vertexOffset);
+        mLODs[i].vertexCount = entry.vertexCount;
+        mLODs[i].indices = reinterpret_cast<const GLuint*>(mData + entry.indexOffset);
+        mLODs[i].indexCount = entry.indexCount;
+    }
+
+    return !mLODs.empty();
+}
+
+GLenum CookedMesh::renderType() const
+{
+    return reinterpret_cast<const FileHeader*>(mData)->renderType;
+}
+
+MeshData::Bounds CookedMesh::bounds() const
+{
+    const auto header = reinterpret_cast<const FileHeader*>(mData);
+    MeshData::Bounds bounds;
+    bounds.centre = gsl::vec3{header->boundsCentre[0], header->boundsCentre[1], header->boundsCentre[2]};
+    bounds.radius = header->boundsRadius;
+    return bounds;
+}
+
+bool CookedMesh::write(const std::string &path, const Key &key, GLenum renderType, const MeshData::Bounds &bounds, const std::vector<MeshBuffers> &levels)
+{
+    FileHeader header{};
+    std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+    header.version = fileVersion;
+    header.sourceModified = key.sourceModified;
+    header.sourceSize = key.sourceSize;
+    header.settingsHash = key.settingsHash;
+    header.vertexSize = sizeof(Vertex);
+    header.renderType = renderType;
+    header.LODCount = static_cast<std::uint32_t>(levels.size());
+    header.boundsCentre[0] = bounds.centre.x;
+    header.boundsCentre[1] = bounds.centre.y;
+    header.boundsCentre[2] = bounds.centre.z;
+    header.boundsRadius = bounds.radius;
+
+    std::vector<LODEntry> entries(levels.size());
+    std::uint64_t offset{sizeof(FileHeader) + levels.size() * sizeof(LODEntry)};
+    for (unsigned int i{0}; i < levels.size(); ++i)
+    {
+        entries[i].vertexCount = static_cast<std::uint32_t>(levels[i].first.size());
+        entries[i].indexCount = static_cast<std::uint32_t>(levels[i].second.size());
+        entries[i].vertexOffset = offset = align(offset);
+        offset += entries[i].vertexCount * sizeof(Vertex);
+        entries[i].indexOffset = offset = align(offset);
+        offset += entries[i].indexCount * sizeof(GLuint);
+    }
+
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    if (!file)
+        return false;
+
+    const char padding[blobAlignment]{};
+    std::uint64_t written{0};
+    const auto writeAt = [&](std::uint64_t position, const void* data, std::uint64_t bytes){
+        file.write(padding, static_cast<std::streamsize>(position - written));
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        written = position + bytes;
+    };
+
+    writeAt(0, &header, sizeof(header));
+    writeAt(written, entries.data(), entries.size() * sizeof(LODEntry));
+    for (unsigned int i{0}; i < levels.size(); ++i)
+    {
+        writeAt(entries[i].vertexOffset, levels[i].first.data(), entries[i].vertexCount * sizeof(Vertex));
+        writeAt(entries[i].indexOffset, levels[i].second.data(), entries[i].indexCount * sizeof(GLuint));
+    }
+
+    return static_cast<bool>(file);
+}
+
+std::uint64_t CookedMesh::hash(const void *data, std::size_t size, std::uint64_t seed)
+{
+    auto bytes = reinterpret_cast<const unsigned char*>(data);
+    for (std::size_t i{0}; i < size; ++i)
+        seed = (seed ^ bytes[i]) * 1099511628211ull;
+    return seed;
+}
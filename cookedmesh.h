@@ -0,0 +1,77 @@
+#ifndef COOKEDMESH_H
+#define COOKEDMESH_H
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <cstdint>
+#include <QFile>
+#include "vertex.h"
+#include "gltypes.h"
+#include "meshdata.h"
+
+/** Binary mesh format that can be uploaded straight from disk.
+ * Layout: a fixed size header, a table with one entry per LOD, followed by
+ * the vertex and index blobs of each LOD, each aligned to 16 bytes.
+ * The header stores the source file's modification time and size plus a hash
+ * of the import settings, so a cooked file is only used while it's up to date.
+ * Opening a cooked file memory maps it; the blobs can be handed directly to glBufferData.
+ * @brief Binary mesh format that can be uploaded straight from disk.
+ */
+class CookedMesh
+{
+public:
+    using MeshBuffers = std::pair<std::vector<Vertex>, std::vector<GLuint>>;
+
+    /** What the cooked file was made from. Compared as a whole when opening.
+     * @brief What the cooked file was made from.
+     */
+    struct Key
+    {
+        std::int64_t sourceModified{0};
+        std::int64_t sourceSize{0};
+        std::uint64_t settingsHash{0};
+    };
+
+    struct LOD
+    {
+        const Vertex* vertices{nullptr};
+        unsigned int vertexCount{0};
+        const GLuint* indices{nullptr};
+        unsigned int indexCount{0};
+    };
+
+    CookedMesh() = default;
+    ~CookedMesh();
+    CookedMesh(const CookedMesh&) = delete;
+    CookedMesh& operator= (const CookedMesh&) = delete;
+
+    /**
+     * @brief Maps the cooked file and checks that it matches the key. Returns false if it's missing, broken or out of date.
+     */
+    bool open(const std::string& path, const Key& key);
+
+    GLenum renderType() const;
+    MeshData::Bounds bounds() const;
+    unsigned int LODCount() const { return static_cast<unsigned int>(mLODs.size()); }
+    //! Pointers into the mapped file, valid as long as this object lives.
+    const LOD& lod(unsigned int level) const { return mLODs[level]; }
+
+    /**
+     * @brief Writes a cooked file with the given LOD levels, starting at LOD 0.
+     */
+    static bool write(const std::string& path, const Key& key, GLenum renderType, const MeshData::Bounds& bounds,
+                      const std::vector<MeshBuffers>& levels);
+
+    /**
+     * @brief FNV-1a, used to hash the import settings into the key.
+     */
+    static std::uint64_t hash(const void* data, std::size_t size, std::uint64_t seed = 14695981039346656037ull);
+
+private:
+    QFile mFile;
+    const uchar* mData{nullptr};
+    std::vector<LOD> mLODs;
+};
+
+#endif // COOKEDMESH_H
@@ -125,7 +125,8 @@ void EntityManager::UpdateBounds()
                 for (auto i{0}; i < 3; ++i)
                     biggestScale = (biggestScale < *(&transIt->scale.x + i)) ? *(&transIt->scale.x + i) : biggestScale;
 
-                meshIt->bounds = {meshIt->meshData.bounds.centre, meshIt->meshData.bounds.radius * biggestScale};
+                const auto localBounds = meshIt->mesh ? meshIt->mesh->bounds : MeshData::Bounds{};
+                meshIt->bounds = {localBounds.centre, localBounds.radius * biggestScale};
                 transIt->meshBoundsOutdated = false;
             }
         }
@@ -73,6 +73,7 @@ T& addComponents(unsigned int entity) \
 class EntityManager : public QObject
 {
     Q_OBJECT
+    friend class EntitySnapshot;
 
     REGISTER(TransformComponent)
     REGISTER(MeshComponent)
@@ -92,6 +93,8 @@ private:
     // ------------------------------ Member Variables -----------------------------
     std::vector<unsigned> entitiesToDestroy;
     unsigned int idCounter{0};
+    //! Nesting depth of beginBatch/endBatch.
+    unsigned int mBatchDepth{0};
 
     void removeEntity(unsigned entity)
     {
@@ -140,6 +143,50 @@ public:
         updateUI({});
     }
 
+    /** Starts adding entities in bulk, like when loading a scene.
+     * Invalid components are dropped from the pools so components for new entities can be appended
+     * without the sort addComponent normally does, and updateUI isn't emitted until endBatch.
+     * Batches can be nested.
+     * @brief Starts adding entities in bulk.
+     */
+    void beginBatch()
+    {
+        if (mBatchDepth++)
+            return;
+
+        forEachPool([](auto& list){
+            list.erase(std::remove_if(list.begin(), list.end(), [](const auto& comp){ return !comp.valid; }), list.end());
+        });
+    }
+
+    /**
+     * @brief Ends a batch started with beginBatch. Sorts the pools that need it, once, and updates the UI.
+     */
+    void endBatch()
+    {
+        if (!mBatchDepth || --mBatchDepth)
+            return;
+
+        forEachPool([](auto& list){
+            auto byId = [](const auto& a, const auto& b){ return a.entityId < b.entityId; };
+            if (!std::is_sorted(list.begin(), list.end(), byId))
+                std::stable_sort(list.begin(), list.end(), byId);
+        });
+        updateUI(mEntityInfos);
+    }
+
+    bool isBatching() const { return mBatchDepth; }
+
+    /**
+     * @brief Makes sure new entities get ids after lastId. Used when entities are loaded with the ids they were saved with.
+     */
+    void reserveEntityIds(unsigned int lastId)
+    {
+        idCounter = std::max(idCounter, lastId);
+    }
+
+    unsigned int lastEntityId() const { return idCounter; }
+
     /**
      * @brief Creates an object based on the index.
      * @param Index 0: Empty entity, index 1: Cube, index 2: Monkey.
@@ -172,7 +219,15 @@ public:
      */
     unsigned int createEntity(std::string name = "")
     {
-        auto id = ++idCounter;
+        return createReservedEntity(++idCounter, std::move(name));
+    }
+
+    /**
+     * @brief Sets up the entity with an id that's not in use and an optional name.
+     * Entities must be created in the order of their ids.
+     */
+    unsigned int createReservedEntity(unsigned int id, std::string name = "")
+    {
         EntityInfo entityInfo;
         entityInfo.entityId = id;
         entityInfo.valid = true;
@@ -182,7 +237,8 @@ public:
         }
         entityInfo.name = name;
         mEntityInfos.push_back(entityInfo);
-        updateUI(mEntityInfos);
+        if (!mBatchDepth)
+            updateUI(mEntityInfos);
         return id;
     }
 
@@ -196,7 +252,7 @@ public:
         auto render = getComponent<MeshComponent>(id);
         if(auto mesh = ResourceManager::instance().getMesh("box2"))
         {
-            render->meshData = *mesh;
+            render->mesh = mesh;
             render->isVisible = true;
         }
         return id;
@@ -212,7 +268,7 @@ public:
         auto render = getComponent<MeshComponent>(id);
         if(auto mesh = ResourceManager::instance().getMesh("suzanne"))
         {
-            render->meshData = *mesh;
+            render->mesh = mesh;
             render->isVisible = true;
         }
         return id;
@@ -601,6 +657,13 @@ public:
     {
         typedef typename T::value_type VT;
 
+        // New entities in a batch come in increasing order, so they can just be appended.
+        if (mBatchDepth && (list.empty() || list.back().entityId < entity))
+        {
+            list.emplace_back(entity, true);
+            return list.back();
+        }
+
         // Check if object already exist and if so just return that one instead.
         auto obj = find(list.begin(), list.end(), entity);
         if (obj != list.end())
@@ -640,6 +703,25 @@ public:
             });
     }
 
+    //! Calls f with every component vector.
+    template<class F>
+    void forEachPool(F f)
+    {
+        f(mTransformComponents);
+        f(mMeshComponents);
+        f(mPhysicsComponents);
+        f(mCameraComponents);
+        f(mInputComponents);
+        f(mSoundComponents);
+        f(mDirectionalLightComponents);
+        f(mSpotLightComponents);
+        f(mPointLightComponents);
+        f(mScriptComponents);
+        f(mColliderComponents);
+        f(mParticleComponents);
+        f(mEntityInfos);
+    }
+
     /** Removes a component from the specified component vector.
      * This function just marks the component as unvalid so that
      * the next addComponent call can use the spot instead of
@@ -0,0 +1,128 @@
+#include "entitysnapshot.h"
+#include "entitymanager.h"
+#include "scriptsystem.h"
+#include "soundmanager.h"
+
+EntitySnapshot::EntitySnapshot(EntityManager &entityManager)
+    : mLastEntityId{entityManager.idCounter},
+      mEntityInfos{entityManager.mEntityInfos},
+      mTransforms{entityManager.mTransformComponents},
+      mMeshes{entityManager.mMeshComponents},
+      mPhysics{entityManager.mPhysicsComponents},
+      mCameras{entityManager.mCameraComponents},
+      mInputs{entityManager.mInputComponents},
+      mDirectionalLights{entityManager.mDirectionalLightComponents},
+      mSpotLights{entityManager.mSpotLightComponents},
+      mPointLights{entityManager.mPointLightComponents},
+      mColliders{entityManager.mColliderComponents},
+      mParticles{entityManager.mParticleComponents}
+{
+    mSounds.reserve(entityManager.mSoundComponents.size());
+    for (const auto& sound : entityManager.mSoundComponents)
+        mSounds.push_back({sound.entityId, sound.valid, sound.isLooping, sound.isMuted, sound.autoplay, sound.pitch, sound.gain, sound.name});
+
+    mScripts.reserve(entityManager.mScriptComponents.size());
+    for (const auto& script : entityManager.mScriptComponents)
+        mScripts.push_back({script.entityId, script.valid, script.filePath});
+}
+
+void EntitySnapshot::restore(EntityManager &entityManager) const
+{
+    // Copy assignment reuses the elements and memory already in the pools
+    entityManager.mEntityInfos = mEntityInfos;
+    entityManager.mTransformComponents = mTransforms;
+    entityManager.mMeshComponents = mMeshes;
+    entityManager.mPhysicsComponents = mPhysics;
+    entityManager.mCameraComponents = mCameras;
+    entityManager.mInputComponents = mInputs;
+    entityManager.mDirectionalLightComponents = mDirectionalLights;
+    entityManager.mSpotLightComponents = mSpotLights;
+    entityManager.mPointLightComponents = mPointLights;
+    entityManager.mColliderComponents = mColliders;
+    entityManager.mParticleComponents = mParticles;
+    restoreSounds(entityManager.mSoundComponents);
+    entityManager.idCounter = mLastEntityId;
+    entityManager.entitiesToDestroy.clear();
+
+    // Both lists are sorted by entity id, so the live script components can be matched up in one pass.
+    auto& live = entityManager.mScriptComponents;
+    std::vector<ScriptComponent> scripts;
+    scripts.reserve(mScripts.size());
+    auto liveIt = live.begin();
+    for (const auto& state : mScripts)
+    {
+        while (liveIt != live.end() && liveIt->entityId < state.entityId)
+            ++liveIt;
+
+        if (liveIt != live.end() && liveIt->entityId == state.entityId)
+            scripts.push_back(std::move(*liveIt++));
+        else
+            scripts.emplace_back(state.entityId);
+
+        auto& script = scripts.back();
+        script.valid = state.valid;
+
+        // An engine that never ran a script is still clean and can be kept
+        if (state.filePath.empty() && script.filePath.empty() && !script.beginplayRun)
+            continue;
+
+        script.reset();
+        if (state.filePath.size())
+            ScriptSystem::get()->load(script, state.filePath);
+    }
+    live = std::move(scripts);
+
+    entityManager.updateUI(entityManager.mEntityInfos);
+}
+
+void EntitySnapshot::restoreSounds(std::vector<SoundComponent>& live) const
+{
+    auto release = [](SoundComponent& sound){
+        if (sound.mSource > -1)
+            SoundManager::get().cleanupSource(static_cast<unsigned>(sound.mSource));
+        sound.mSource = -1;
+    };
+
+    // Both lists are sorted by entity id
+    std::vector<SoundComponent> sounds;
+    sounds.reserve(mSounds.size());
+    auto liveIt = live.begin();
+    for (const auto& state : mSounds)
+    {
+        while (liveIt != live.end() && liveIt->entityId < state.entityId)
+            release(*liveIt++);
+
+        sounds.emplace_back(state.entityId, state.valid, state.isLooping, state.isMuted);
+        auto& sound = sounds.back();
+        sound.autoplay = state.autoplay;
+        sound.pitch = state.pitch;
+        sound.gain = state.gain;
+        sound.name = state.name;
+
+        SoundComponent* previous = (liveIt != live.end() && liveIt->entityId == state.entityId) ? &*liveIt++ : nullptr;
+        if (previous && previous->mSource > -1 && previous->name == state.name)
+        {
+            // Same sound, so the source is kept and put back to how it was set up
+            const auto source = static_cast<unsigned>(previous->mSource);
+            sound.mSource = previous->mSource;
+            previous->mSource = -1;
+            auto& soundManager = SoundManager::get();
+            soundManager.stop(source);
+            soundManager.setMute(source, sound.isMuted, sound.gain);
+            soundManager.changePitch(source, sound.pitch);
+            soundManager.setLooping(source, sound.isLooping);
+            continue;
+        }
+
+        if (previous)
+            release(*previous);
+        if (sound.name.size())
+            SoundManager::get().createSource(&sound, sound.name);
+    }
+
+    // Sounds added during play
+    while (liveIt != live.end())
+        release(*liveIt++);
+
+    live = std::move(sounds);
+}
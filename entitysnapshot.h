@@ -0,0 +1,71 @@
+#ifndef ENTITYSNAPSHOT_H
+#define ENTITYSNAPSHOT_H
+
+#include "componentdata.h"
+#include <vector>
+#include <string>
+
+class EntityManager;
+
+/** In-memory copy of every component pool in an entity manager, taken when play mode starts
+ * and restored when it stops, instead of saving and loading the scene from disk.
+ * Components are copied pool by pool, reusing the memory already allocated by the pools on restore.
+ * Meshes, shaders and textures are shared with the live components through their references, not copied.
+ * Script engines can't be copied, so only the script file is kept, and restore reuses the live
+ * script components, reloading only the ones that have a script.
+ * OpenAL sources belong to the live sound components, so only the sound settings are kept. Restore
+ * keeps the sources that still play the same sound and releases or creates the rest.
+ * @brief In-memory copy of all entities and components.
+ */
+class EntitySnapshot
+{
+public:
+    explicit EntitySnapshot(EntityManager& entityManager);
+
+    /**
+     * @brief Replaces all entities and components in the entity manager with the ones in the snapshot.
+     */
+    void restore(EntityManager& entityManager) const;
+
+    std::size_t entityCount() const { return mEntityInfos.size(); }
+
+private:
+    struct ScriptState
+    {
+        unsigned int entityId;
+        bool valid;
+        std::string filePath;
+    };
+
+    struct SoundState
+    {
+        unsigned int entityId;
+        bool valid;
+        bool isLooping;
+        bool isMuted;
+        bool autoplay;
+        float pitch;
+        float gain;
+        std::string name;
+    };
+
+    //! Replaces the live sound components with the snapshot's, reusing or releasing their sources.
+    void restoreSounds(std::vector<SoundComponent>& live) const;
+
+    unsigned int mLastEntityId{0};
+    std::vector<EntityInfo> mEntityInfos;
+    std::vector<TransformComponent> mTransforms;
+    std::vector<MeshComponent> mMeshes;
+    std::vector<PhysicsComponent> mPhysics;
+    std::vector<CameraComponent> mCameras;
+    std::vector<InputComponent> mInputs;
+    std::vector<SoundState> mSounds;
+    std::vector<DirectionalLightComponent> mDirectionalLights;
+    std::vector<SpotLightComponent> mSpotLights;
+    std::vector<PointLightComponent> mPointLights;
+    std::vector<ColliderComponent> mColliders;
+    std::vector<ParticleComponent> mParticles;
+    std::vector<ScriptState> mScripts;
+};
+
+#endif // ENTITYSNAPSHOT_H
@@ -0,0 +1,134 @@
+#include "lightclustergrid.h"
+#include <algorithm>
+#include <cmath>
+
+LightClusterGrid::LightClusterGrid()
+    : LightClusterGrid(Settings{})
+{
+}
+
+LightClusterGrid::LightClusterGrid(const Settings &settings)
+    : mSettings{settings}
+{
+    setProjection(mTanHalfFovX, mTanHalfFovY, mNear, mFar);
+}
+
+void LightClusterGrid::setProjection(float tanHalfFovX, float tanHalfFovY, float nearPlane, float farPlane)
+{
+    mTanHalfFovX = tanHalfFovX;
+    mTanHalfFovY = tanHalfFovY;
+    mNear = nearPlane;
+    mFar = farPlane;
+
+    // slice = log(depth / near) / log(far / near) * slices
+    //       = log(depth) * scale - bias
+    const float logRatio = std::log(mFar / mNear);
+    mSliceScale = static_cast<float>(mSettings.slices) / logRatio;
+    mSliceBias = static_cast<float>(mSettings.slices) * std::log(mNear) / logRatio;
+}
+
+unsigned int LightClusterGrid::sliceFromDepth(float depth) const
+{
+    if (depth <= mNear)
+        return 0;
+    const int slice = static_cast<int>(std::floor(std::log(depth) * mSliceScale - mSliceBias));
+    return static_cast<unsigned int>(std::clamp(slice, 0, static_cast<int>(mSettings.slices) - 1));
+}
+
+float LightClusterGrid::depthFromSlice(unsigned int slice) const
+{
+    return mNear * std::pow(mFar / mNear, static_cast<float>(slice) / static_cast<float>(mSettings.slices));
+}
+
+std::pair<int, int> LightClusterGrid::tileRange(float centre, float radius, float minDepth, float maxDepth, float tanHalfFov, unsigned int tiles) const
+{
+    // Conservative projection of [centre - radius, centre + radius] for any depth in [minDepth, maxDepth].
+    // Negative edges spread out the closer they are, positive edges the same way, so pick the depth
+    // that pushes each edge furthest out.
+    const float lo = centre - radius;
+    const float hi = centre + radius;
+    const float ndcLo = lo / ((lo < 0.f ? minDepth : maxDepth) * tanHalfFov);
+    const float ndcHi = hi / ((hi > 0.f ? minDepth : maxDepth) * tanHalfFov);
+
+    const int last = static_cast<int>(tiles) - 1;
+    const int first = static_cast<int>(std::floor((ndcLo * 0.5f + 0.5f) * tiles));
+    const int end = static_cast<int>(std::floor((ndcHi * 0.5f + 0.5f) * tiles));
+    return {std::clamp(first, 0, last + 1), std::clamp(end, -1, last)};
+}
+
+bool LightClusterGrid::intersects(const LightBounds &light, unsigned int x, unsigned int y, unsigned int z) const
+{
+    const float d0 = depthFromSlice(z);
+    const float d1 = depthFromSlice(z + 1);
+
+    // Tile edges in NDC
+    const float nx0 = 2.f * x / mSettings.tilesX - 1.f;
+    const float nx1 = 2.f * (x + 1) / mSettings.tilesX - 1.f;
+    const float ny0 = 2.f * y / mSettings.tilesY - 1.f;
+    const float ny1 = 2.f * (y + 1) / mSettings.tilesY - 1.f;
+
+    // View space AABB of the froxel
+    const float minX = std::min(nx0 * d0, nx0 * d1) * mTanHalfFovX;
+    const float maxX = std::max(nx1 * d0, nx1 * d1) * mTanHalfFovX;
+    const float minY = std::min(ny0 * d0, ny0 * d1) * mTanHalfFovY;
+    const float maxY = std::max(ny1 * d0, ny1 * d1) * mTanHalfFovY;
+    const float minZ = -d1;
+    const float maxZ = -d0;
+
+    const float dx = light.centre.x - std::clamp(light.centre.x, minX, maxX);
+    const float dy = light.centre.y - std::clamp(light.centre.y, minY, maxY);
+    const float dz = light.centre.z - std::clamp(light.centre.z, minZ, maxZ);
+    return dx * dx + dy * dy + dz * dz <= light.radius * light.radius;
+}
+
+void LightClusterGrid::build(const std::vector<LightBounds> &lights)
+{
+    const unsigned int count = clusterCount();
+    mPairs.clear();
+    mClusterData.assign(count * 2, 0);
+    mLightIndices.clear();
+
+    for (unsigned int i{0}; i < lights.size(); ++i)
+    {
+        const auto& light = lights[i];
+        const float depth = -light.centre.z;
+        const float minDepth = std::max(depth - light.radius, mNear);
+        const float maxDepth = std::min(depth + light.radius, mFar);
+        if (maxDepth < mNear || minDepth > mFar || minDepth > maxDepth)
+            continue;
+
+        const auto xRange = tileRange(light.centre.x, light.radius, minDepth, maxDepth, mTanHalfFovX, mSettings.tilesX);
+        const auto yRange = tileRange(light.centre.y, light.radius, minDepth, maxDepth, mTanHalfFovY, mSettings.tilesY);
+        const unsigned int zFirst = sliceFromDepth(minDepth);
+        const unsigned int zLast = sliceFromDepth(maxDepth);
+
+        for (unsigned int z{zFirst}; z <= zLast; ++z)
+            for (int y{yRange.first}; y <= yRange.second; ++y)
+                for (int x{xRange.first}; x <= xRange.second; ++x)
+                    if (intersects(light, static_cast<unsigned int>(x), static_cast<unsigned int>(y), z))
+                        mPairs.emplace_back(clusterIndex(static_cast<unsigned int>(x), static_cast<unsigned int>(y), z), i);
+    }
+
+    // Counting sort on cluster index so that every cluster gets a contiguous range of light indices.
+    for (const auto& pair : mPairs)
+        ++mClusterData[pair.first * 2 + 1];
+
+    unsigned int offset{0};
+    for (unsigned int c{0}; c < count; ++c)
+    {
+        mClusterData[c * 2] = offset;
+        offset += mClusterData[c * 2 + 1];
+    }
+
+    mLightIndices.resize(mPairs.size());
+    mCursor.assign(count, 0);
+    for (const auto& pair : mPairs)
+        mLightIndices[mClusterData[pair.first * 2] + mCursor[pair.first]++] = pair.second;
+}
+
+std::pair<const unsigned int *, const unsigned int *> LightClusterGrid::lightsInCluster(unsigned int x, unsigned int y, unsigned int z) const
+{
+    const unsigned int index = clusterIndex(x, y, z);
+    const unsigned int* begin = mLightIndices.data() + mClusterData[index * 2];
+    return {begin, begin + mClusterData[index * 2 + 1]};
+}
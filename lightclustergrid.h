@@ -0,0 +1,105 @@
+#ifndef LIGHTCLUSTERGRID_H
+#define LIGHTCLUSTERGRID_H
+
+#include <vector>
+#include <utility>
+#include "vector3d.h"
+
+/** CPU side light binning for clustered deferred shading.
+ * Splits the view frustum into a grid of froxels (tiles in screen space,
+ * exponential slices in depth) and figures out which lights touches which froxel.
+ * The result is a flat list of light indices together with an (offset, count)
+ * pair per cluster that can be uploaded directly to the GPU.
+ *
+ * Doesn't touch OpenGL at all, so it can be used and tested without a context.
+ * @brief CPU side light binning for clustered deferred shading.
+ */
+class LightClusterGrid
+{
+public:
+    /** Dimensions of the cluster grid.
+     * @brief Dimensions of the cluster grid.
+     */
+    struct Settings
+    {
+        unsigned int tilesX{16};
+        unsigned int tilesY{9};
+        unsigned int slices{24};
+    };
+
+    /** Bounding sphere of a light in view space.
+     * @brief Bounding sphere of a light in view space.
+     */
+    struct LightBounds
+    {
+        gsl::vec3 centre;
+        float radius;
+    };
+
+    LightClusterGrid();
+    explicit LightClusterGrid(const Settings& settings);
+
+    /**
+     * @brief Sets the frustum the grid is fitted to.
+     * @param tanHalfFovX - tangent of half the horizontal field of view
+     * @param tanHalfFovY - tangent of half the vertical field of view
+     */
+    void setProjection(float tanHalfFovX, float tanHalfFovY, float nearPlane, float farPlane);
+
+    /**
+     * @brief Bins all lights into the clusters. Lights are referenced by their index in the given list.
+     */
+    void build(const std::vector<LightBounds>& lights);
+
+    const Settings& settings() const { return mSettings; }
+    unsigned int clusterCount() const { return mSettings.tilesX * mSettings.tilesY * mSettings.slices; }
+    unsigned int clusterIndex(unsigned int x, unsigned int y, unsigned int z) const
+    { return x + mSettings.tilesX * (y + mSettings.tilesY * z); }
+
+    /**
+     * @brief Returns the depth slice a view space depth (distance along -z) belongs to.
+     */
+    unsigned int sliceFromDepth(float depth) const;
+    /**
+     * @brief Returns the view space depth where the given slice starts.
+     */
+    float depthFromSlice(unsigned int slice) const;
+
+    /** Scale and bias so that slice = log(depth) * scale - bias.
+     * Used by the shader to find the slice of a fragment.
+     */
+    float sliceScale() const { return mSliceScale; }
+    float sliceBias() const { return mSliceBias; }
+
+    /**
+     * @brief Interleaved (offset, count) pairs into lightIndices(), one pair per cluster.
+     */
+    const std::vector<unsigned int>& clusterData() const { return mClusterData; }
+    const std::vector<unsigned int>& lightIndices() const { return mLightIndices; }
+
+    /**
+     * @brief Returns the lights in the given cluster as a range into lightIndices().
+     */
+    std::pair<const unsigned int*, const unsigned int*> lightsInCluster(unsigned int x, unsigned int y, unsigned int z) const;
+
+private:
+    bool intersects(const LightBounds& light, unsigned int x, unsigned int y, unsigned int z) const;
+    std::pair<int, int> tileRange(float centre, float radius, float minDepth, float maxDepth, float tanHalfFov, unsigned int tiles) const;
+
+    Settings mSettings;
+
+    float mTanHalfFovX{0.414f};
+    float mTanHalfFovY{0.414f};
+    float mNear{0.1f};
+    float mFar{100.f};
+    float mSliceScale{0.f};
+    float mSliceBias{0.f};
+
+    std::vector<unsigned int> mClusterData;
+    std::vector<unsigned int> mLightIndices;
+    // (cluster, light) pairs found during binning. Kept as a member to reuse the allocation between frames.
+    std::vector<std::pair<unsigned int, unsigned int>> mPairs;
+    std::vector<unsigned int> mCursor;
+};
+
+#endif // LIGHTCLUSTERGRID_H
@@ -21,12 +21,14 @@
 #include "Widgets/scriptwidget.h"
 #include "Widgets/colliderwidget.h"
 #include "componentdata.h"
+#include "resourcemanager.h"
 
 #include <QSplitter>
 
 #include "constants.h"
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QActionGroup>
 #include <QJsonDocument>
 
 #include "postprocesseswindow.h"
@@ -65,6 +67,11 @@ MainWindow::MainWindow(QWidget *parent) :
     mPostProcessesWindow = new PostProcessesWindow(this);
     connect(mPostProcessesWindow, &PostProcessesWindow::onSaveClicked, this, &MainWindow::onPostprocessorSaved);
 
+    auto lightingModes = new QActionGroup(this);
+    lightingModes->addAction(ui->actionFullscreen_lights);
+    lightingModes->addAction(ui->actionVolume_lights);
+    lightingModes->addAction(ui->actionClustered_lights);
+
     show();
 }
 
@@ -619,6 +626,58 @@ void MainWindow::on_actionPost_Processes_triggered()
     mPostProcessesWindow->show();
 }
 
+void MainWindow::on_actionFullscreen_lights_triggered()
+{
+    changeLightingMode(LightingMode::FullscreenQuads);
+}
+
+void MainWindow::on_actionVolume_lights_triggered()
+{
+    changeLightingMode(LightingMode::Volumes);
+}
+
+void MainWindow::on_actionClustered_lights_triggered()
+{
+    changeLightingMode(LightingMode::Clustered);
+}
+
+void MainWindow::setLightingMode(LightingMode mode)
+{
+    switch (mode)
+    {
+    case LightingMode::FullscreenQuads: ui->actionFullscreen_lights->setChecked(true); break;
+    case LightingMode::Volumes: ui->actionVolume_lights->setChecked(true); break;
+    case LightingMode::Clustered: ui->actionClustered_lights->setChecked(true); break;
+    }
+}
+
+void MainWindow::on_actionLight_benchmark_scene_triggered()
+{
+    QMessageBox messageBox;
+    messageBox.setText("The benchmark scene will overwrite the current one");
+    messageBox.setInformativeText("Continue?");
+    messageBox.setStandardButtons(QMessageBox::Ok | QMessageBox::Cancel);
+    messageBox.setDefaultButton(QMessageBox::Cancel);
+    if (messageBox.exec() == QMessageBox::Ok)
+        newLightBenchmarkScene();
+}
+
+void MainWindow::on_actionScript_benchmark_scene_triggered()
+{
+    QMessageBox messageBox;
+    messageBox.setText("The benchmark scene will overwrite the current one");
+    messageBox.setInformativeText("Continue?");
+    messageBox.setStandardButtons(QMessageBox::Ok | QMessageBox::Cancel);
+    messageBox.setDefaultButton(QMessageBox::Cancel);
+    if (messageBox.exec() == QMessageBox::Ok)
+        newScriptBenchmarkScene();
+}
+
+void MainWindow::on_actionObj_parser_benchmark_triggered()
+{
+    ResourceManager::instance().benchmarkObjParsers();
+}
+
 void MainWindow::onPostprocessorSaved(const std::map<Postprocessor*, std::vector<Postprocessor::Setting>>& steps)
 {
     QFile file("../Inngine2019/Settings/postprocessorsettings.json");
@@ -18,6 +18,7 @@ class MainWindow;
 }
 
 enum class ComponentType;
+enum class LightingMode;
 
 class QTreeWidgetItem;
 class ComponentWidget;
@@ -63,6 +64,9 @@ signals:
     void saveScene(const std::string& filePath);
     void loadScene(const std::string& filePath);
     void newScene();
+    void newLightBenchmarkScene();
+    void newScriptBenchmarkScene();
+    void changeLightingMode(LightingMode mode);
     void quitting();
 public slots:
     /**
@@ -72,6 +76,8 @@ public slots:
     void onWidgetRemoved(ComponentWidget* widget);
     void refreshWidgets();
     void setSceneName(const std::string& name);
+    //! Checks the menu action of the lighting mode the renderer ended up using.
+    void setLightingMode(LightingMode mode);
 
 private slots:
     void on_actionEmpty_Object_triggered();
@@ -104,6 +110,18 @@ private slots:
 
     void on_actionPost_Processes_triggered();
 
+    void on_actionFullscreen_lights_triggered();
+
+    void on_actionVolume_lights_triggered();
+
+    void on_actionClustered_lights_triggered();
+
+    void on_actionLight_benchmark_scene_triggered();
+
+    void on_actionScript_benchmark_scene_triggered();
+
+    void on_actionObj_parser_benchmark_triggered();
+
     /**
      * @brief Connected to the onSaveClicked signal in PostprocessorWindow. Updates the postprocessorsettings.json.
      */
@@ -5,11 +5,23 @@
 #include "innpch.h"
 #include "gltypes.h"
 #include "texture.h"
+#include "resourcepool.h"
 #include <variant>
 
 #include <QJsonObject>
 #include <QJsonArray>
 
+/** A texture bound by a material. The reference keeps the texture loaded while the material uses it,
+ * it's empty for textures the resource manager keeps pinned.
+ * @brief A texture bound by a material.
+ */
+struct MaterialTexture
+{
+    uint id{0};
+    GLenum type{GL_TEXTURE_2D};
+    TextureRef texture{};
+};
+
 /** Information struct about how a mesh should look.
  * Defined by a shader, optional textures, and all parameters
  * that should be sent to the shader.
@@ -19,11 +31,11 @@ struct Material
 {
     std::shared_ptr<Shader> mShader{nullptr};
     std::map<std::string, ShaderParamType> mParameters;
-    std::vector<std::pair<uint, GLenum>> mTextures;
+    std::vector<MaterialTexture> mTextures;
 
     Material(std::shared_ptr<Shader> shader = std::shared_ptr<Shader>{},
              std::map<std::string, ShaderParamType> parameters = std::map<std::string, ShaderParamType>{},
-             std::vector<std::pair<uint, GLenum>> textures = std::vector<std::pair<uint, GLenum>>{})
+             std::vector<MaterialTexture> textures = std::vector<MaterialTexture>{})
         : mShader{shader}, mParameters{parameters}, mTextures{textures}
     {}
     Material(const Material& material) = default;
@@ -105,8 +117,8 @@ struct Material
         for(auto& texture : mTextures)
         {
             QJsonObject obj;
-            obj.insert("ID", QJsonValue(static_cast<int>(texture.first)));
-            obj.insert("Type", QJsonValue(static_cast<int>(texture.second)));
+            obj.insert("ID", QJsonValue(static_cast<int>(texture.id)));
+            obj.insert("Type", QJsonValue(static_cast<int>(texture.type)));
             textureArray.insert(i, obj);
             i++;
         }
@@ -127,16 +139,28 @@ struct Material
 };
 
 /** Information struct that describes information about a mesh.
- * Includes a index to the buffer describing the mesh and the 2 next LODs,
- * vertex counts, triangle index counts and mesh bounds.
+ * Includes a index to the buffer describing the mesh and all of it's LODs,
+ * vertex counts, triangle index counts, LOD switching sizes and mesh bounds.
+ * Index 0 is always the full detail mesh.
+ * Meshes share their VAO with other meshes, so they must be drawn from
+ * their base vertex and first index, see UploadManager.
  * @brief Information struct that describes information about a mesh.
  */
 struct MeshData
 {
     GLenum mRenderType{};
-    std::array<unsigned, 3> mVAOs{};
-    std::array<unsigned, 3> mVerticesCounts{};
-    std::array<unsigned, 3> mIndicesCounts{};
+    std::vector<unsigned> mVAOs;
+    std::vector<unsigned> mVerticesCounts;
+    std::vector<unsigned> mIndicesCounts;
+    //! Where each LOD starts in the shared vertex buffer. Passed to glDrawElementsBaseVertex, or as first to glDrawArrays.
+    std::vector<int> mBaseVertices;
+    //! Where each LOD starts in the shared index buffer.
+    std::vector<unsigned> mFirstIndices;
+    /** Projected screen size (bounding sphere radius / half screen height) a LOD
+     * is used at or below. mLODScreenSizes[0] is not used as LOD 0 is the fallback.
+     * @brief Screen size thresholds for each LOD level.
+     */
+    std::vector<float> mLODScreenSizes;
     std::string mName{};
     /** AABB describing the extents of the mesh in local space.
      * @brief AABB describing the extents of the mesh in local space.
@@ -148,7 +172,40 @@ struct MeshData
     } bounds;
 
     MeshData(const std::string& name = "", GLenum renderType = GL_TRIANGLES)
-        : mRenderType(renderType), mName(name) {}
+        : mRenderType(renderType), mVAOs(1, 0), mVerticesCounts(1, 0), mIndicesCounts(1, 0),
+          mBaseVertices(1, 0), mFirstIndices(1, 0), mLODScreenSizes(1, 1.f), mName(name) {}
+
+    unsigned int LODCount() const { return static_cast<unsigned int>(mVAOs.size()); }
+
+    /**
+     * @brief Default screen size threshold for a LOD level. Every level switches at a third of the size of the previous one.
+     */
+    static float defaultLODScreenSize(unsigned int level)
+    {
+        return level == 0 ? 1.f : 0.15f * std::pow(1.f / 3.f, static_cast<float>(level - 1));
+    }
+
+    /**
+     * @brief Sets the buffers for the given LOD level. Any levels between the current last and the given level are filled with the previous level.
+     */
+    void setLOD(unsigned int level, unsigned vao, unsigned verticesCount, unsigned indicesCount, int baseVertex = 0, unsigned firstIndex = 0)
+    {
+        while (LODCount() <= level)
+        {
+            const auto last = LODCount() - 1;
+            mVAOs.push_back(mVAOs[last]);
+            mVerticesCounts.push_back(mVerticesCounts[last]);
+            mIndicesCounts.push_back(mIndicesCounts[last]);
+            mBaseVertices.push_back(mBaseVertices[last]);
+            mFirstIndices.push_back(mFirstIndices[last]);
+            mLODScreenSizes.push_back(defaultLODScreenSize(last + 1));
+        }
+        mVAOs[level] = vao;
+        mVerticesCounts[level] = verticesCount;
+        mIndicesCounts[level] = indicesCount;
+        mBaseVertices[level] = baseVertex;
+        mFirstIndices[level] = firstIndex;
+    }
 
     QJsonObject toJSON()
     {
@@ -171,4 +228,6 @@ struct MeshData
     }
 };
 
+using MeshRef = ResourceRef<MeshData>;
+
 #endif // MESHDATA_H
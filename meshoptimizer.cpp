@@ -0,0 +1,215 @@
+#include "meshoptimizer.h"
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+
+namespace
+{
+// Hashes and compares the raw bytes of a vertex, identical data means identical vertex.
+struct VertexHash
+{
+    std::size_t operator() (const Vertex& vertex) const
+    {
+        std::uint32_t words[sizeof(Vertex) / sizeof(std::uint32_t)];
+        std::memcpy(words, &vertex, sizeof(Vertex));
+
+        // FNV-1a over the words
+        std::size_t hash{2166136261u};
+        for (auto word : words)
+            hash = (hash ^ word) * 16777619u;
+        return hash;
+    }
+};
+
+struct VertexEqual
+{
+    bool operator() (const Vertex& lhs, const Vertex& rhs) const
+    {
+        return std::memcmp(&lhs, &rhs, sizeof(Vertex)) == 0;
+    }
+};
+}
+
+MeshOptimizer::Stats MeshOptimizer::optimize(MeshBuffers &mesh, unsigned int cacheSize)
+{
+    Stats stats;
+    stats.verticesBefore = static_cast<unsigned int>(mesh.first.size());
+    stats.ACMRBefore = ACMR(mesh.second, stats.verticesBefore, cacheSize);
+
+    mesh = weldVertices(mesh);
+    optimizeVertexCache(mesh.second, static_cast<unsigned int>(mesh.first.size()), cacheSize);
+    optimizeVertexFetch(mesh);
+
+    stats.verticesAfter = static_cast<unsigned int>(mesh.first.size());
+    stats.ACMRAfter = ACMR(mesh.second, stats.verticesAfter, cacheSize);
+    return stats;
+}
+
+MeshOptimizer::MeshBuffers MeshOptimizer::weldVertices(const MeshBuffers &mesh)
+{
+    MeshBuffers result;
+    result.first.reserve(mesh.first.size());
+    result.second.reserve(mesh.second.size());
+
+    std::unordered_map<Vertex, GLuint, VertexHash, VertexEqual> lookup;
+    lookup.reserve(mesh.first.size());
+
+    std::vector<GLuint> remap(mesh.first.size());
+    for (unsigned int i{0}; i < mesh.first.size(); ++i)
+    {
+        const auto inserted = lookup.emplace(mesh.first[i], static_cast<GLuint>(result.first.size()));
+        if (inserted.second)
+            result.first.push_back(mesh.first[i]);
+        remap[i] = inserted.first->second;
+    }
+
+    for (auto index : mesh.second)
+        result.second.push_back(remap[index]);
+
+    return result;
+}
+
+// Tipsify, written from the pseudocode in "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+// by Pedro V. Sander, Diego Nehab and Joshua Barczak, SIGGRAPH 2007. No code is taken from other implementations.
+void MeshOptimizer::optimizeVertexCache(std::vector<GLuint> &indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+    const auto triangleCount = static_cast<unsigned int>(indices.size() / 3);
+    if (!triangleCount || !vertexCount)
+        return;
+
+    // Vertex -> triangles adjacency, packed
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (unsigned int i{0}; i < triangleCount * 3; ++i)
+        ++liveTriangles[indices[i]];
+
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (unsigned int v{0}; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + liveTriangles[v];
+
+    std::vector<unsigned int> adjacency(offsets[vertexCount]);
+    std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+    for (unsigned int t{0}; t < triangleCount; ++t)
+        for (unsigned int j{0}; j < 3; ++j)
+            adjacency[cursor[indices[t * 3 + j]]++] = t;
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<GLuint> output;
+    output.reserve(triangleCount * 3);
+
+    unsigned int time{cacheSize + 1};
+    unsigned int nextVertex{0};
+
+    // Finds a vertex with live triangles when the fanning vertex runs out of candidates
+    const auto skipDeadEnd = [&]() -> int {
+        while (!deadEnd.empty())
+        {
+            const auto v = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[v] > 0)
+                return static_cast<int>(v);
+        }
+        while (nextVertex < vertexCount)
+        {
+            if (liveTriangles[nextVertex] > 0)
+                return static_cast<int>(nextVertex++);
+            ++nextVertex;
+        }
+        return -1;
+    };
+
+    int fanning = skipDeadEnd();
+    while (fanning >= 0)
+    {
+        candidates.clear();
+
+        // Emit all the remaining triangles around the fanning vertex
+        const auto f = static_cast<unsigned int>(fanning);
+        for (unsigned int a{offsets[f]}; a < offsets[f + 1]; ++a)
+        {
+            const auto t = adjacency[a];
+            if (emitted[t])
+                continue;
+
+            for (unsigned int j{0}; j < 3; ++j)
+            {
+                const auto v = indices[t * 3 + j];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+                if (time - cacheTime[v] > cacheSize)
+                    cacheTime[v] = time++;
+            }
+            emitted[t] = true;
+        }
+
+        // Next fanning vertex is the one that will stay in the cache the longest
+        int best{-1};
+        int bestPriority{-1};
+        for (auto v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+                continue;
+
+            int priority{0};
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+                priority = static_cast<int>(time - cacheTime[v]);
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                best = static_cast<int>(v);
+            }
+        }
+
+        fanning = (best >= 0) ? best : skipDeadEnd();
+    }
+
+    // Keep any trailing indices that didn't make a full triangle
+    output.insert(output.end(), indices.begin() + triangleCount * 3, indices.end());
+    indices = std::move(output);
+}
+
+void MeshOptimizer::optimizeVertexFetch(MeshBuffers &mesh)
+{
+    const GLuint unused{~0u};
+    std::vector<GLuint> remap(mesh.first.size(), unused);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.first.size());
+
+    for (auto& index : mesh.second)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = static_cast<GLuint>(vertices.size());
+            vertices.push_back(mesh.first[index]);
+        }
+        index = remap[index];
+    }
+
+    mesh.first = std::move(vertices);
+}
+
+float MeshOptimizer::ACMR(const std::vector<GLuint> &indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+    const auto triangleCount = indices.size() / 3;
+    if (!triangleCount)
+        return 0.f;
+
+    // FIFO cache: a vertex is in the cache if it was inserted less than cacheSize misses ago
+    std::vector<unsigned int> insertedAt(vertexCount, 0);
+    unsigned int misses{0};
+    for (unsigned int i{0}; i < triangleCount * 3; ++i)
+    {
+        const auto v = indices[i];
+        if (!insertedAt[v] || misses - insertedAt[v] >= cacheSize)
+        {
+            ++misses;
+            insertedAt[v] = misses;
+        }
+    }
+
+    return static_cast<float>(misses) / static_cast<float>(triangleCount);
+}
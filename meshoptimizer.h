@@ -0,0 +1,60 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <vector>
+#include <utility>
+#include "vertex.h"
+#include "gltypes.h"
+
+/** Import post processing for indexed triangle meshes.
+ * Welds duplicate vertices, reorders triangles for the post transform
+ * vertex cache (Tipsify, Sander et al. 2007) and reorders vertices so
+ * they're fetched in the order they're used.
+ * Pure CPU work, doesn't need an OpenGL context.
+ * @brief Vertex cache and vertex fetch optimization for meshes.
+ */
+class MeshOptimizer
+{
+public:
+    using MeshBuffers = std::pair<std::vector<Vertex>, std::vector<GLuint>>;
+
+    //! Size of the FIFO vertex cache that's optimized for and simulated.
+    static constexpr unsigned int defaultCacheSize{16};
+
+    struct Stats
+    {
+        unsigned int verticesBefore{0};
+        unsigned int verticesAfter{0};
+        float ACMRBefore{0.f};
+        float ACMRAfter{0.f};
+    };
+
+    /**
+     * @brief Runs all the steps on a triangle list: weld, triangle reorder and vertex reorder.
+     * @return Vertex counts and average cache miss ratio before and after.
+     */
+    static Stats optimize(MeshBuffers& mesh, unsigned int cacheSize = defaultCacheSize);
+
+    /**
+     * @brief Merges vertices that are identical in position, normal and uv.
+     */
+    static MeshBuffers weldVertices(const MeshBuffers& mesh);
+
+    /**
+     * @brief Reorders the triangles for vertex cache locality using Tipsify.
+     */
+    static void optimizeVertexCache(std::vector<GLuint>& indices, unsigned int vertexCount, unsigned int cacheSize = defaultCacheSize);
+
+    /**
+     * @brief Reorders the vertices in the order they're first used by the indices. Unused vertices are removed.
+     */
+    static void optimizeVertexFetch(MeshBuffers& mesh);
+
+    /**
+     * @brief Average cache miss ratio, transformed vertices per triangle, using a simulated FIFO cache.
+     * 3 is the worst possible, 0.5 is about the best a regular grid can get.
+     */
+    static float ACMR(const std::vector<GLuint>& indices, unsigned int vertexCount, unsigned int cacheSize = defaultCacheSize);
+};
+
+#endif // MESHOPTIMIZER_H
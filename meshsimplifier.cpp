@@ -0,0 +1,569 @@
+/* The quadric simplification below is a port of Fast Quadric Mesh Simplification by Sven Forstmann,
+ * https://github.com/sp4cerat/Fast-Quadric-Mesh-Simplification, used under the MIT license:
+ *
+ * Copyright (c) 2014 Sven Forstmann
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "meshsimplifier.h"
+#include "meshoptimizer.h"
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+// Quadrics are accumulated in double precision, floats loose too much when summing many planes.
+struct Vec3d
+{
+    double x{0.0}, y{0.0}, z{0.0};
+
+    Vec3d() = default;
+    Vec3d(double _x, double _y, double _z) : x{_x}, y{_y}, z{_z} {}
+    Vec3d(const gsl::vec3& v) : x{v.x}, y{v.y}, z{v.z} {}
+
+    Vec3d operator+ (const Vec3d& rhs) const { return {x + rhs.x, y + rhs.y, z + rhs.z}; }
+    Vec3d operator- (const Vec3d& rhs) const { return {x - rhs.x, y - rhs.y, z - rhs.z}; }
+    Vec3d operator* (double f) const { return {x * f, y * f, z * f}; }
+    bool operator== (const Vec3d& rhs) const { return x == rhs.x && y == rhs.y && z == rhs.z; }
+    double dot(const Vec3d& rhs) const { return x * rhs.x + y * rhs.y + z * rhs.z; }
+    Vec3d cross(const Vec3d& rhs) const { return {y * rhs.z - z * rhs.y, z * rhs.x - x * rhs.z, x * rhs.y - y * rhs.x}; }
+    double length() const { return std::sqrt(dot(*this)); }
+    Vec3d normalized() const { const double l = length(); return (l > 0.0) ? *this * (1.0 / l) : *this; }
+};
+
+/** Symmetric 4x4 matrix, stored as the 10 unique elements.
+ * @brief Quadric of a plane, or a sum of planes.
+ */
+struct SymmetricMatrix
+{
+    double m[10];
+
+    explicit SymmetricMatrix(double c = 0.0) { std::fill(std::begin(m), std::end(m), c); }
+
+    // Quadric of the plane ax + by + cz + d = 0
+    SymmetricMatrix(double a, double b, double c, double d)
+    {
+        m[0] = a * a; m[1] = a * b; m[2] = a * c; m[3] = a * d;
+                      m[4] = b * b; m[5] = b * c; m[6] = b * d;
+                                    m[7] = c * c; m[8] = c * d;
+                                                  m[9] = d * d;
+    }
+
+    double operator[] (int i) const { return m[i]; }
+
+    double det(int a11, int a12, int a13,
+               int a21, int a22, int a23,
+               int a31, int a32, int a33) const
+    {
+        return m[a11] * m[a22] * m[a33] + m[a13] * m[a21] * m[a32] + m[a12] * m[a23] * m[a31]
+             - m[a13] * m[a22] * m[a31] - m[a11] * m[a23] * m[a32] - m[a12] * m[a21] * m[a33];
+    }
+
+    SymmetricMatrix operator+ (const SymmetricMatrix& rhs) const
+    {
+        SymmetricMatrix result;
+        for (int i{0}; i < 10; ++i)
+            result.m[i] = m[i] + rhs.m[i];
+        return result;
+    }
+};
+
+struct Triangle
+{
+    int v[3];
+    double err[4];
+    bool deleted{false};
+    bool dirty{false};
+    Vec3d n;
+};
+
+struct SimplifyVertex
+{
+    Vec3d p;
+    Vertex data;
+    int tstart{0};
+    int tcount{0};
+    SymmetricMatrix q;
+    bool border{false};
+};
+
+// Which triangle, and which corner of it, that uses a vertex
+struct Ref
+{
+    int tid;
+    int tvertex;
+};
+
+/** Implementation of the fast quadric mesh simplification by Sven Forstmann.
+ * Instead of a priority queue every edge below a growing error threshold is collapsed each iteration,
+ * which is a lot faster and gives close to the same result.
+ */
+class QuadricSimplification
+{
+public:
+    std::vector<Triangle> triangles;
+    std::vector<SimplifyVertex> vertices;
+    std::vector<Ref> refs;
+
+    void simplify(unsigned int targetCount, double aggressiveness)
+    {
+        for (auto& t : triangles)
+            t.deleted = false;
+
+        unsigned int deletedTriangles{0};
+        std::vector<int> deleted0, deleted1;
+        const auto triangleCount = static_cast<unsigned int>(triangles.size());
+
+        for (int iteration{0}; iteration < 100; ++iteration)
+        {
+            if (triangleCount - deletedTriangles <= targetCount)
+                break;
+
+            // Update mesh once in a while
+            if (iteration % 5 == 0)
+                updateMesh(iteration);
+
+            for (auto& t : triangles)
+                t.dirty = false;
+
+            // All triangles with edges below the threshold will be removed
+            const double threshold = 0.000000001 * std::pow(static_cast<double>(iteration + 3), aggressiveness);
+
+            for (auto& t : triangles)
+            {
+                if (t.err[3] > threshold || t.deleted || t.dirty)
+                    continue;
+
+                for (int j{0}; j < 3; ++j)
+                {
+                    if (t.err[j] > threshold)
+                        continue;
+
+                    const int i0 = t.v[j];
+                    const int i1 = t.v[(j + 1) % 3];
+                    auto& v0 = vertices[static_cast<unsigned int>(i0)];
+                    auto& v1 = vertices[static_cast<unsigned int>(i1)];
+
+                    // Border edges are kept so the silhouette of open meshes doesn't shrink
+                    if (v0.border || v1.border)
+                        continue;
+
+                    Vec3d p;
+                    calculateError(i0, i1, p);
+
+                    deleted0.resize(static_cast<unsigned int>(v0.tcount));
+                    deleted1.resize(static_cast<unsigned int>(v1.tcount));
+
+                    if (flipped(p, i1, v0, deleted0) || flipped(p, i0, v1, deleted1))
+                        continue;
+
+                    v0.p = p;
+                    v0.q = v1.q + v0.q;
+                    const int tstart = static_cast<int>(refs.size());
+
+                    updateTriangles(i0, v0, deleted0, deletedTriangles);
+                    updateTriangles(i0, v1, deleted1, deletedTriangles);
+
+                    const int tcount = static_cast<int>(refs.size()) - tstart;
+                    if (tcount <= v0.tcount)
+                    {
+                        // Reuse the old ref range
+                        if (tcount)
+                            std::memcpy(&refs[static_cast<unsigned int>(v0.tstart)], &refs[static_cast<unsigned int>(tstart)], static_cast<unsigned int>(tcount) * sizeof(Ref));
+                    }
+                    else
+                    {
+                        v0.tstart = tstart;
+                    }
+                    v0.tcount = tcount;
+                    break;
+                }
+
+                if (triangleCount - deletedTriangles <= targetCount)
+                    break;
+            }
+        }
+
+        compactMesh();
+    }
+
+private:
+    double vertexError(const SymmetricMatrix& q, double x, double y, double z) const
+    {
+        return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x + q[4] * y * y
+             + 2 * q[5] * y * z + 2 * q[6] * y + q[7] * z * z + 2 * q[8] * z + q[9];
+    }
+
+    // Error of collapsing the edge (id0, id1), result is the optimal position for the new vertex
+    double calculateError(int id0, int id1, Vec3d& result) const
+    {
+        const auto& v0 = vertices[static_cast<unsigned int>(id0)];
+        const auto& v1 = vertices[static_cast<unsigned int>(id1)];
+        const SymmetricMatrix q = v0.q + v1.q;
+        const bool border = v0.border && v1.border;
+
+        const double det = q.det(0, 1, 2, 1, 4, 5, 2, 5, 7);
+        if (det != 0.0 && !border)
+        {
+            // q_delta is invertible
+            result.x = -1.0 / det * q.det(1, 2, 3, 4, 5, 6, 5, 7, 8);
+            result.y =  1.0 / det * q.det(0, 2, 3, 1, 5, 6, 2, 7, 8);
+            result.z = -1.0 / det * q.det(0, 1, 3, 1, 4, 6, 2, 5, 8);
+            return vertexError(q, result.x, result.y, result.z);
+        }
+
+        // Not invertible, pick the best of the end points and the midpoint
+        const Vec3d p3 = (v0.p + v1.p) * 0.5;
+        const double error1 = vertexError(q, v0.p.x, v0.p.y, v0.p.z);
+        const double error2 = vertexError(q, v1.p.x, v1.p.y, v1.p.z);
+        const double error3 = vertexError(q, p3.x, p3.y, p3.z);
+        const double error = std::min(error1, std::min(error2, error3));
+        if (error1 == error) result = v0.p;
+        if (error2 == error) result = v1.p;
+        if (error3 == error) result = p3;
+        return error;
+    }
+
+    // Checks if moving the vertex to p would flip any of the triangles around it
+    bool flipped(const Vec3d& p, int i1, const SimplifyVertex& v0, std::vector<int>& deleted) const
+    {
+        for (int k{0}; k < v0.tcount; ++k)
+        {
+            const auto& r = refs[static_cast<unsigned int>(v0.tstart + k)];
+            const auto& t = triangles[static_cast<unsigned int>(r.tid)];
+            if (t.deleted)
+                continue;
+
+            const int s = r.tvertex;
+            const int id1 = t.v[(s + 1) % 3];
+            const int id2 = t.v[(s + 2) % 3];
+
+            if (id1 == i1 || id2 == i1)
+            {
+                // This triangle is removed by the collapse
+                deleted[static_cast<unsigned int>(k)] = 1;
+                continue;
+            }
+
+            const Vec3d d1 = (vertices[static_cast<unsigned int>(id1)].p - p).normalized();
+            const Vec3d d2 = (vertices[static_cast<unsigned int>(id2)].p - p).normalized();
+            if (std::abs(d1.dot(d2)) > 0.999)
+                return true;
+
+            const Vec3d n = d1.cross(d2).normalized();
+            deleted[static_cast<unsigned int>(k)] = 0;
+            if (n.dot(t.n) < 0.2)
+                return true;
+        }
+        return false;
+    }
+
+    // Moves the triangles of v over to i0, removing the ones that collapsed
+    void updateTriangles(int i0, const SimplifyVertex& v, const std::vector<int>& deleted, unsigned int& deletedTriangles)
+    {
+        Vec3d p;
+        for (int k{0}; k < v.tcount; ++k)
+        {
+            // Copy, refs might reallocate on push_back
+            const Ref r = refs[static_cast<unsigned int>(v.tstart + k)];
+            auto& t = triangles[static_cast<unsigned int>(r.tid)];
+            if (t.deleted)
+                continue;
+
+            if (deleted[static_cast<unsigned int>(k)])
+            {
+                t.deleted = true;
+                ++deletedTriangles;
+                continue;
+            }
+
+            t.v[r.tvertex] = i0;
+            t.dirty = true;
+            t.err[0] = calculateError(t.v[0], t.v[1], p);
+            t.err[1] = calculateError(t.v[1], t.v[2], p);
+            t.err[2] = calculateError(t.v[2], t.v[0], p);
+            t.err[3] = std::min(t.err[0], std::min(t.err[1], t.err[2]));
+            refs.push_back(r);
+        }
+    }
+
+    void updateMesh(int iteration)
+    {
+        if (iteration > 0)
+        {
+            // Compact triangles
+            unsigned int dst{0};
+            for (const auto& t : triangles)
+                if (!t.deleted)
+                    triangles[dst++] = t;
+            triangles.resize(dst);
+        }
+
+        buildRefs();
+
+        // Identify boundary vertices, and initialize quadrics and errors the first time around
+        if (iteration == 0)
+        {
+            std::vector<int> vcount, vids;
+
+            for (auto& v : vertices)
+                v.border = false;
+
+            for (const auto& v : vertices)
+            {
+                vcount.clear();
+                vids.clear();
+                for (int j{0}; j < v.tcount; ++j)
+                {
+                    const auto& t = triangles[static_cast<unsigned int>(refs[static_cast<unsigned int>(v.tstart + j)].tid)];
+                    for (int k{0}; k < 3; ++k)
+                    {
+                        unsigned int ofs{0};
+                        const int id = t.v[k];
+                        while (ofs < vcount.size())
+                        {
+                            if (vids[ofs] == id)
+                                break;
+                            ++ofs;
+                        }
+                        if (ofs == vcount.size())
+                        {
+                            vcount.push_back(1);
+                            vids.push_back(id);
+                        }
+                        else
+                        {
+                            ++vcount[ofs];
+                        }
+                    }
+                }
+
+                // An edge used by only one triangle is a border
+                for (unsigned int j{0}; j < vcount.size(); ++j)
+                    if (vcount[j] == 1)
+                        vertices[static_cast<unsigned int>(vids[j])].border = true;
+            }
+
+            for (auto& v : vertices)
+                v.q = SymmetricMatrix{0.0};
+
+            for (auto& t : triangles)
+            {
+                const Vec3d p[3] = {
+                    vertices[static_cast<unsigned int>(t.v[0])].p,
+                    vertices[static_cast<unsigned int>(t.v[1])].p,
+                    vertices[static_cast<unsigned int>(t.v[2])].p
+                };
+                const Vec3d n = (p[1] - p[0]).cross(p[2] - p[0]).normalized();
+                t.n = n;
+                for (int j{0}; j < 3; ++j)
+                {
+                    auto& q = vertices[static_cast<unsigned int>(t.v[j])].q;
+                    q = q + SymmetricMatrix{n.x, n.y, n.z, -n.dot(p[0])};
+                }
+            }
+
+            Vec3d p;
+            for (auto& t : triangles)
+            {
+                for (int j{0}; j < 3; ++j)
+                    t.err[j] = calculateError(t.v[j], t.v[(j + 1) % 3], p);
+                t.err[3] = std::min(t.err[0], std::min(t.err[1], t.err[2]));
+            }
+        }
+    }
+
+    void buildRefs()
+    {
+        for (auto& v : vertices)
+        {
+            v.tstart = 0;
+            v.tcount = 0;
+        }
+        for (const auto& t : triangles)
+            for (int j{0}; j < 3; ++j)
+                ++vertices[static_cast<unsigned int>(t.v[j])].tcount;
+
+        int tstart{0};
+        for (auto& v : vertices)
+        {
+            v.tstart = tstart;
+            tstart += v.tcount;
+            v.tcount = 0;
+        }
+
+        refs.resize(triangles.size() * 3);
+        for (unsigned int i{0}; i < triangles.size(); ++i)
+        {
+            const auto& t = triangles[i];
+            for (int j{0}; j < 3; ++j)
+            {
+                auto& v = vertices[static_cast<unsigned int>(t.v[j])];
+                refs[static_cast<unsigned int>(v.tstart + v.tcount)] = Ref{static_cast<int>(i), j};
+                ++v.tcount;
+            }
+        }
+    }
+
+    // Removes deleted triangles and unused vertices
+    void compactMesh()
+    {
+        unsigned int dst{0};
+        for (auto& v : vertices)
+            v.tcount = 0;
+
+        for (const auto& t : triangles)
+        {
+            if (t.deleted)
+                continue;
+            triangles[dst++] = t;
+            for (int j{0}; j < 3; ++j)
+                vertices[static_cast<unsigned int>(t.v[j])].tcount = 1;
+        }
+        triangles.resize(dst);
+
+        dst = 0;
+        for (auto& v : vertices)
+        {
+            if (v.tcount)
+            {
+                v.tstart = static_cast<int>(dst);
+                vertices[dst].p = v.p;
+                vertices[dst].data = v.data;
+                ++dst;
+            }
+        }
+        for (auto& t : triangles)
+            for (int j{0}; j < 3; ++j)
+                t.v[j] = vertices[static_cast<unsigned int>(t.v[j])].tstart;
+        vertices.resize(dst);
+    }
+};
+
+// Position and normal of a vertex, vertices split only by their uv share the recalculated normal
+struct SmoothingKey
+{
+    std::uint32_t bits[6];
+
+    bool operator== (const SmoothingKey& rhs) const
+    {
+        return std::equal(std::begin(bits), std::end(bits), std::begin(rhs.bits));
+    }
+};
+
+struct SmoothingKeyHash
+{
+    std::size_t operator() (const SmoothingKey& key) const
+    {
+        return (key.bits[0] * 73856093u) ^ (key.bits[1] * 19349663u) ^ (key.bits[2] * 83492791u)
+             ^ (key.bits[3] * 2654435761u) ^ (key.bits[4] * 40503u) ^ key.bits[5];
+    }
+};
+
+SmoothingKey makeKey(const gsl::vec3& position, const gsl::vec3& normal)
+{
+    SmoothingKey key;
+    // Normalize -0 to 0 so they're treated as the same
+    const float values[6] = {position.x + 0.f, position.y + 0.f, position.z + 0.f, normal.x + 0.f, normal.y + 0.f, normal.z + 0.f};
+    std::memcpy(key.bits, values, sizeof(key.bits));
+    return key;
+}
+}
+
+MeshSimplifier::MeshBuffers MeshSimplifier::simplify(const MeshBuffers &mesh, float ratio, double aggressiveness)
+{
+    // Welding on the full vertex keeps uv and normal seams split. The seam edges then become borders,
+    // which the simplification never collapses, so textures don't smear across the seams.
+    const auto welded = MeshOptimizer::weldVertices(mesh);
+
+    QuadricSimplification simplification;
+    simplification.vertices.resize(welded.first.size());
+    for (unsigned int i{0}; i < welded.first.size(); ++i)
+    {
+        simplification.vertices[i].p = Vec3d{welded.first[i].get_xyz()};
+        simplification.vertices[i].data = welded.first[i];
+    }
+
+    simplification.triangles.reserve(welded.second.size() / 3);
+    for (unsigned int i{0}; i + 2 < welded.second.size(); i += 3)
+    {
+        // Triangles that already are degenerate after welding only confuse the quadrics.
+        // Corners split by a seam can still share a position, like the pole of a uv sphere.
+        const auto a = welded.second[i], b = welded.second[i + 1], c = welded.second[i + 2];
+        if (a == b || b == c || c == a)
+            continue;
+        const auto& pa = simplification.vertices[a].p;
+        const auto& pb = simplification.vertices[b].p;
+        const auto& pc = simplification.vertices[c].p;
+        if (pa == pb || pb == pc || pc == pa)
+            continue;
+
+        Triangle t;
+        t.v[0] = static_cast<int>(a);
+        t.v[1] = static_cast<int>(b);
+        t.v[2] = static_cast<int>(c);
+        simplification.triangles.push_back(t);
+    }
+
+    const auto targetCount = static_cast<unsigned int>(simplification.triangles.size() * std::clamp(ratio, 0.f, 1.f));
+    simplification.simplify(targetCount, aggressiveness);
+
+    MeshBuffers result;
+    result.first.reserve(simplification.vertices.size());
+    std::unordered_map<SmoothingKey, unsigned int, SmoothingKeyHash> smoothingLookup;
+    std::vector<unsigned int> smoothingGroup;
+    smoothingGroup.reserve(simplification.vertices.size());
+    for (const auto& v : simplification.vertices)
+    {
+        Vertex vertex{v.data};
+        vertex.set_xyz(static_cast<float>(v.p.x), static_cast<float>(v.p.y), static_cast<float>(v.p.z));
+        const auto key = makeKey(vertex.get_xyz(), v.data.get_normal());
+        smoothingGroup.push_back(smoothingLookup.emplace(key, static_cast<unsigned int>(smoothingLookup.size())).first->second);
+        vertex.set_normal(0.f, 0.f, 0.f);
+        result.first.push_back(vertex);
+    }
+
+    // Area weighted normals, the cross product isn't normalized
+    std::vector<Vec3d> normals(smoothingLookup.size());
+    result.second.reserve(simplification.triangles.size() * 3);
+    for (const auto& t : simplification.triangles)
+    {
+        const auto& p0 = simplification.vertices[static_cast<unsigned int>(t.v[0])].p;
+        const auto& p1 = simplification.vertices[static_cast<unsigned int>(t.v[1])].p;
+        const auto& p2 = simplification.vertices[static_cast<unsigned int>(t.v[2])].p;
+        const Vec3d n = (p1 - p0).cross(p2 - p0);
+        for (int j{0}; j < 3; ++j)
+        {
+            const auto group = smoothingGroup[static_cast<unsigned int>(t.v[j])];
+            normals[group] = normals[group] + n;
+            result.second.push_back(static_cast<GLuint>(t.v[j]));
+        }
+    }
+
+    for (unsigned int i{0}; i < result.first.size(); ++i)
+    {
+        const auto n = normals[smoothingGroup[i]].normalized();
+        result.first[i].set_normal(static_cast<float>(n.x), static_cast<float>(n.y), static_cast<float>(n.z));
+    }
+
+    return result;
+}
@@ -0,0 +1,32 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <vector>
+#include <utility>
+#include "vertex.h"
+#include "gltypes.h"
+
+/** Mesh simplification using quadric error metrics (Garland & Heckbert).
+ * Collapses the edges that changes the surface the least until the
+ * target triangle count is reached. Used to generate LODs for meshes
+ * that doesn't come with hand made ones.
+ * Pure CPU work, doesn't need an OpenGL context.
+ * @brief Mesh simplification using quadric error metrics.
+ */
+class MeshSimplifier
+{
+public:
+    using MeshBuffers = std::pair<std::vector<Vertex>, std::vector<GLuint>>;
+
+    /**
+     * @brief Simplifies an indexed triangle mesh.
+     * @param mesh - vertices and triangle indices
+     * @param ratio - the fraction of triangles to keep, between 0 and 1
+     * @param aggressiveness - how fast the error threshold grows each iteration. Lower is slower but better quality.
+     * @return The simplified mesh. Normals are recalculated, uvs are kept from the surviving vertices.
+     * Uv and normal seams are kept as they are, so meshes with many seams can end up above the ratio.
+     */
+    static MeshBuffers simplify(const MeshBuffers& mesh, float ratio, double aggressiveness = 7.0);
+};
+
+#endif // MESHSIMPLIFIER_H
@@ -0,0 +1,58 @@
+#ifndef NATIVEBEHAVIOUR_H
+#define NATIVEBEHAVIOUR_H
+
+#include <QString>
+#include <QPoint>
+#include <vector>
+#include "world.h"
+#include "entitymanager.h"
+
+struct HitInfo;
+
+/** Base class for behaviours written in C++ instead of JS.
+ * A behaviour is registered by name in the BehaviourSystem and chosen for a script component
+ * instead of a script file. The hooks mirror the JS callbacks, and are found at compile time
+ * rather than virtual, so the behaviours of a class are updated in one loop without calling through
+ * the JS bridge. Hide the hooks you need in the derived class, the rest are skipped entirely.
+ *
+ * Behaviours are created when play starts or when the component is added while playing, and are
+ * destroyed when play stops. They are stored by value and moved around, so don't hold on to pointers to them.
+ * Example:
+ * struct Spinner : public NativeBehaviour
+ * {
+ *     void tick(float deltaTime) { ... }
+ * };
+ * BehaviourSystem::get()->registerBehaviour<Spinner>("Spinner");
+ * @brief Base class for behaviours written in C++.
+ */
+class NativeBehaviour
+{
+public:
+    //! The entity the behaviour belongs to.
+    unsigned int entityId{0};
+
+    //! Called once when the behaviour starts.
+    void beginPlay() {}
+    //! Called every frame.
+    void tick(float) {}
+    //! Called when play stops.
+    void endPlay() {}
+    //! Called when the entity collides with another entity.
+    void onHit(const HitInfo&) {}
+    //! Called with the inputs pressed this frame, if the entity has an input component controlled while playing.
+    void inputPressed(const std::vector<QString>&) {}
+    //! Called with the inputs released this frame, if the entity has an input component controlled while playing.
+    void inputReleased(const std::vector<QString>&) {}
+    //! Called with the mouse offset when the mouse has moved, if the entity has an input component controlled while playing.
+    void mouseMoved(const QPoint&) {}
+
+protected:
+    //! A component of the behaviour's entity, or nullptr if it doesn't have one.
+    template<class T>
+    T* getComponent() const
+    {
+        return World::getWorld().getEntityManager()->getComponent<T>(entityId);
+    }
+};
+
+#endif // NATIVEBEHAVIOUR_H
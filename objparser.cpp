@@ -0,0 +1,407 @@
+#include "objparser.h"
+#include <QFile>
+#include <QDebug>
+#include <charconv>
+#include <thread>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+struct Chunk
+{
+    const char* begin{nullptr};
+    const char* end{nullptr};
+
+    // Counts in this chunk
+    unsigned int positions{0};
+    unsigned int uvs{0};
+    unsigned int normals{0};
+    unsigned int triangles{0};
+
+    // Where this chunk starts in the combined arrays
+    unsigned int positionStart{0};
+    unsigned int uvStart{0};
+    unsigned int normalStart{0};
+    unsigned int triangleStart{0};
+};
+
+// Position, uv and normal index of a face corner, -1 if missing
+struct Corner
+{
+    int position{-1};
+    int uv{-1};
+    int normal{-1};
+};
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+inline bool isLineEnd(char c)
+{
+    return c == '\n' || c == '\r';
+}
+
+inline const char* skipSpaces(const char* p, const char* end)
+{
+    while (p < end && isSpace(*p))
+        ++p;
+    return p;
+}
+
+inline const char* skipLine(const char* p, const char* end)
+{
+    while (p < end && *p != '\n')
+        ++p;
+    return (p < end) ? p + 1 : end;
+}
+
+inline const char* skipToken(const char* p, const char* end)
+{
+    while (p < end && !isSpace(*p) && !isLineEnd(*p))
+        ++p;
+    return p;
+}
+
+const char* parseFloat(const char* p, const char* end, float& value)
+{
+    p = skipSpaces(p, end);
+    if (p < end && *p == '+')
+        ++p;
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc{})
+    {
+        value = 0.f;
+        return skipToken(p, end);
+    }
+    return result.ptr;
+#else
+    // Standard libraries without floating point from_chars
+    bool negative{false};
+    if (p < end && *p == '-')
+    {
+        negative = true;
+        ++p;
+    }
+
+    double number{0.0};
+    while (p < end && *p >= '0' && *p <= '9')
+        number = number * 10.0 + (*p++ - '0');
+
+    if (p < end && *p == '.')
+    {
+        ++p;
+        double scale{0.1};
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            number += (*p++ - '0') * scale;
+            scale *= 0.1;
+        }
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        int exponent{0};
+        bool negativeExponent{false};
+        if (p < end && (*p == '-' || *p == '+'))
+            negativeExponent = (*p++ == '-');
+        while (p < end && *p >= '0' && *p <= '9')
+            exponent = exponent * 10 + (*p++ - '0');
+        number *= std::pow(10.0, negativeExponent ? -exponent : exponent);
+    }
+
+    value = static_cast<float>(negative ? -number : number);
+    return p;
+#endif
+}
+
+inline const char* parseInt(const char* p, const char* end, int& value)
+{
+    bool negative{false};
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+        value = value * 10 + (*p++ - '0');
+
+    if (negative)
+        value = -value;
+    return p;
+}
+
+// Converts a 1 based or negative relative index to a 0 based one, -1 if missing or out of range
+inline int resolveIndex(int index, unsigned int countSoFar, unsigned int total)
+{
+    if (index > 0)
+        --index;
+    else if (index < 0)
+        index += static_cast<int>(countSoFar);
+    else
+        return -1;
+
+    return (index >= 0 && static_cast<unsigned int>(index) < total) ? index : -1;
+}
+
+enum class LineType { Position, UV, Normal, Face, Other };
+
+// Reads the keyword of the line and moves p past it
+inline LineType lineType(const char*& p, const char* end)
+{
+    p = skipSpaces(p, end);
+    if (end - p < 2)
+        return LineType::Other;
+
+    if (p[0] == 'v')
+    {
+        if (isSpace(p[1]))
+        {
+            p += 1;
+            return LineType::Position;
+        }
+        if (end - p >= 3 && isSpace(p[2]))
+        {
+            if (p[1] == 't')
+            {
+                p += 2;
+                return LineType::UV;
+            }
+            if (p[1] == 'n')
+            {
+                p += 2;
+                return LineType::Normal;
+            }
+        }
+    }
+    else if (p[0] == 'f' && isSpace(p[1]))
+    {
+        p += 1;
+        return LineType::Face;
+    }
+    return LineType::Other;
+}
+
+// Reads the next corner of a face line, returns false at the end of the line
+inline bool nextCorner(const char*& p, const char* end, int& position, int& uv, int& normal)
+{
+    p = skipSpaces(p, end);
+    if (p >= end || isLineEnd(*p) || *p == '#')
+        return false;
+
+    position = uv = normal = 0;
+    p = parseInt(p, end, position);
+    if (p < end && *p == '/')
+    {
+        ++p;
+        if (p < end && *p != '/')
+            p = parseInt(p, end, uv);
+        if (p < end && *p == '/')
+            p = parseInt(p + 1, end, normal);
+    }
+    p = skipToken(p, end);
+    return true;
+}
+
+void countChunk(Chunk& chunk)
+{
+    int position, uv, normal;
+    for (const char* p{chunk.begin}; p < chunk.end; p = skipLine(p, chunk.end))
+    {
+        switch (lineType(p, chunk.end))
+        {
+        case LineType::Position: ++chunk.positions; break;
+        case LineType::UV: ++chunk.uvs; break;
+        case LineType::Normal: ++chunk.normals; break;
+        case LineType::Face:
+        {
+            unsigned int corners{0};
+            while (nextCorner(p, chunk.end, position, uv, normal))
+                ++corners;
+            if (corners >= 3)
+                chunk.triangles += corners - 2;
+            break;
+        }
+        case LineType::Other: break;
+        }
+    }
+}
+
+void parseChunk(const Chunk& chunk, const Chunk& totals, std::vector<gsl::vec3>& positions, std::vector<gsl::vec2>& uvs,
+                std::vector<gsl::vec3>& normals, std::vector<Corner>& corners)
+{
+    unsigned int positionCount{chunk.positionStart};
+    unsigned int uvCount{chunk.uvStart};
+    unsigned int normalCount{chunk.normalStart};
+    unsigned int cornerCount{chunk.triangleStart * 3};
+
+    int position, uv, normal;
+    for (const char* p{chunk.begin}; p < chunk.end; p = skipLine(p, chunk.end))
+    {
+        switch (lineType(p, chunk.end))
+        {
+        case LineType::Position:
+        {
+            auto& v = positions[positionCount++];
+            p = parseFloat(p, chunk.end, v.x);
+            p = parseFloat(p, chunk.end, v.y);
+            p = parseFloat(p, chunk.end, v.z);
+            break;
+        }
+        case LineType::UV:
+        {
+            auto& v = uvs[uvCount++];
+            p = parseFloat(p, chunk.end, v.x);
+            p = parseFloat(p, chunk.end, v.y);
+            break;
+        }
+        case LineType::Normal:
+        {
+            auto& v = normals[normalCount++];
+            p = parseFloat(p, chunk.end, v.x);
+            p = parseFloat(p, chunk.end, v.y);
+            p = parseFloat(p, chunk.end, v.z);
+            break;
+        }
+        case LineType::Face:
+        {
+            // Fan triangulation: (0, 1, 2), (0, 2, 3), ...
+            Corner first, previous;
+            unsigned int i{0};
+            while (nextCorner(p, chunk.end, position, uv, normal))
+            {
+                Corner corner;
+                corner.position = resolveIndex(position, positionCount, totals.positions);
+                corner.uv = resolveIndex(uv, uvCount, totals.uvs);
+                corner.normal = resolveIndex(normal, normalCount, totals.normals);
+
+                if (i == 0)
+                    first = corner;
+                else if (i >= 2)
+                {
+                    corners[cornerCount++] = first;
+                    corners[cornerCount++] = previous;
+                    corners[cornerCount++] = corner;
+                }
+                previous = corner;
+                ++i;
+            }
+            break;
+        }
+        case LineType::Other: break;
+        }
+    }
+}
+
+// Runs func(i) for i in [0, count), the first on the calling thread
+template<typename Func>
+void runParallel(unsigned int count, Func func)
+{
+    std::vector<std::thread> threads;
+    threads.reserve(count);
+    for (unsigned int i{1}; i < count; ++i)
+        threads.emplace_back(func, i);
+    func(0u);
+    for (auto& thread : threads)
+        thread.join();
+}
+}
+
+ObjParser::MeshBuffers ObjParser::parseFile(const std::string &filePath, unsigned int threadCount)
+{
+    QFile file{QString::fromStdString(filePath)};
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug() << "Error ObjParser: Could not open file for reading: " << QString::fromStdString(filePath);
+        return {};
+    }
+
+    const auto size = file.size();
+    if (size <= 0)
+        return {};
+
+    if (auto data = file.map(0, size))
+    {
+        const auto begin = reinterpret_cast<const char*>(data);
+        auto result = parse(begin, begin + size, threadCount);
+        file.unmap(data);
+        return result;
+    }
+
+    // Mapping isn't supported everywhere, fall back to reading it all
+    const auto bytes = file.readAll();
+    return parse(bytes.constData(), bytes.constData() + bytes.size(), threadCount);
+}
+
+ObjParser::MeshBuffers ObjParser::parse(const char *begin, const char *end, unsigned int threadCount)
+{
+    if (!threadCount)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    const auto size = static_cast<std::size_t>(end - begin);
+    const auto chunkCount = static_cast<unsigned int>(std::clamp<std::size_t>(size / minChunkSize, 1, threadCount));
+
+    // Split at line boundaries
+    std::vector<Chunk> chunks(chunkCount);
+    const char* chunkBegin{begin};
+    for (unsigned int i{0}; i < chunkCount; ++i)
+    {
+        const char* chunkEnd = (i + 1 == chunkCount) ? end : skipLine(std::max(chunkBegin, begin + size * (i + 1) / chunkCount), end);
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    runParallel(chunkCount, [&chunks](unsigned int i){ countChunk(chunks[i]); });
+
+    Chunk totals;
+    for (auto& chunk : chunks)
+    {
+        chunk.positionStart = totals.positions;
+        chunk.uvStart = totals.uvs;
+        chunk.normalStart = totals.normals;
+        chunk.triangleStart = totals.triangles;
+        totals.positions += chunk.positions;
+        totals.uvs += chunk.uvs;
+        totals.normals += chunk.normals;
+        totals.triangles += chunk.triangles;
+    }
+
+    std::vector<gsl::vec3> positions(totals.positions);
+    std::vector<gsl::vec2> uvs(totals.uvs);
+    std::vector<gsl::vec3> normals(totals.normals);
+    std::vector<Corner> corners(totals.triangles * 3);
+
+    runParallel(chunkCount, [&](unsigned int i){ parseChunk(chunks[i], totals, positions, uvs, normals, corners); });
+
+    MeshBuffers result;
+    result.first.resize(corners.size());
+    result.second.resize(corners.size());
+    std::iota(result.second.begin(), result.second.end(), 0u);
+
+    runParallel(chunkCount, [&](unsigned int i){
+        const auto cornerEnd = (i + 1 == chunkCount) ? totals.triangles * 3 : chunks[i + 1].triangleStart * 3;
+        for (unsigned int c{chunks[i].triangleStart * 3}; c < cornerEnd; ++c)
+        {
+            const auto& corner = corners[c];
+            auto& vertex = result.first[c];
+            if (corner.position >= 0)
+                vertex.set_xyz(positions[static_cast<unsigned int>(corner.position)]);
+            if (corner.normal >= 0)
+                vertex.set_normal(normals[static_cast<unsigned int>(corner.normal)]);
+            else
+                vertex.set_normal(0.f, 1.f, 0.f);
+            if (corner.uv >= 0)
+                vertex.set_uv(uvs[static_cast<unsigned int>(corner.uv)].x, uvs[static_cast<unsigned int>(corner.uv)].y);
+            else
+                vertex.set_uv(0.f, 0.f);
+        }
+    });
+
+    return result;
+}
@@ -0,0 +1,40 @@
+#ifndef OBJPARSER_H
+#define OBJPARSER_H
+
+#include <vector>
+#include <string>
+#include <utility>
+#include "vertex.h"
+#include "gltypes.h"
+
+/** Wavefront .obj reader.
+ * The file is memory mapped and scanned in place without any per line allocations.
+ * A first pass counts the elements so every array is allocated once, and a second
+ * pass fills them in. Big files are split in chunks at line boundaries that are
+ * parsed on separate threads.
+ * Polygons with more than 3 corners are fan triangulated and negative (relative) indices are supported.
+ * @brief Fast Wavefront .obj reader.
+ */
+class ObjParser
+{
+public:
+    using MeshBuffers = std::pair<std::vector<Vertex>, std::vector<GLuint>>;
+
+    /**
+     * @brief Reads an .obj file. Like the old reader, every face corner is a separate vertex and the indices go from 0 to n-1.
+     * @param filePath - full path to the file
+     * @param threadCount - max number of threads. 0 uses the number of hardware threads.
+     * @return Empty buffers if the file couldn't be read.
+     */
+    static MeshBuffers parseFile(const std::string& filePath, unsigned int threadCount = 0);
+
+    /**
+     * @brief Parses .obj data already in memory. The data doesn't need to be null terminated.
+     */
+    static MeshBuffers parse(const char* begin, const char* end, unsigned int threadCount = 0);
+
+    //! Files smaller than this per thread isn't worth splitting.
+    static constexpr std::size_t minChunkSize{1 << 20};
+};
+
+#endif // OBJPARSER_H
@@ -0,0 +1,24 @@
+#include "projectilebehaviour.h"
+#include "physicssystem.h"
+
+void ProjectileBehaviour::beginPlay()
+{
+    auto entityManager = World::getWorld().getEntityManager();
+    auto collider = static_cast<ColliderComponent*>(entityManager->addComponent(entityId, ComponentType::Collider));
+    if (collider)
+        collider->collisionType = ColliderComponent::AABB;
+}
+
+void ProjectileBehaviour::tick(float deltaTime)
+{
+    time += deltaTime;
+    if (time >= lifeTime)
+        World::getWorld().getEntityManager()->removeEntityLater(entityId);
+}
+
+void ProjectileBehaviour::onHit(const HitInfo &hitInfo)
+{
+    auto entityManager = World::getWorld().getEntityManager();
+    entityManager->removeEntityLater(hitInfo.collidingEID);
+    entityManager->removeEntityLater(entityId);
+}
@@ -0,0 +1,21 @@
+#ifndef PROJECTILEBEHAVIOUR_H
+#define PROJECTILEBEHAVIOUR_H
+
+#include "nativebehaviour.h"
+
+/** Native version of projectile.js.
+ * Gives the entity an AABB collider, destroys it after lifeTime seconds
+ * and destroys both it and whatever it hits on collision.
+ * @brief Native version of projectile.js.
+ */
+struct ProjectileBehaviour : public NativeBehaviour
+{
+    float lifeTime{2.f};
+    float time{0.f};
+
+    void beginPlay();
+    void tick(float deltaTime);
+    void onHit(const HitInfo& hitInfo);
+};
+
+#endif // PROJECTILEBEHAVIOUR_H
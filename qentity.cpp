@@ -15,27 +15,27 @@ QJSValue QEntity::getComponent(const QString &name)
     QJSValue value;
 
     if(name == "transform")
-        value = ScriptSystem::get()->getComponent<TransformComponent>(mID);
+        value = ScriptSystem::get()->getComponent(mID, ComponentType::Transform);
     else if(name == "mesh")
-        value = ScriptSystem::get()->getComponent<MeshComponent>(mID);
+        value = ScriptSystem::get()->getComponent(mID, ComponentType::Mesh);
     else if(name == "physics")
-        value = ScriptSystem::get()->getComponent<PhysicsComponent>(mID);
+        value = ScriptSystem::get()->getComponent(mID, ComponentType::Physics);
     else if(name == "camera")
-        value = ScriptSystem::get()->getComponent<CameraComponent>(mID);
+        value = ScriptSystem::get()->getComponent(mID, ComponentType::Camera);
     else if(name == "input")
-        value = ScriptSystem::get()->getComponent<InputComponent>(mID);
+        value = ScriptSystem::get()->getComponent(mID, ComponentType::Input);
     else if(name == "sound")
-        value = ScriptSystem::get()->getComponent<SoundComponent>(mID);
+        value = ScriptSystem::get()->getComponent(mID, ComponentType::Sound);
     else if(name == "pointLight")
-        value = ScriptSystem::get()->getComponent<PointLightComponent>(mID);
+        value = ScriptSystem::get()->getComponent(mID, ComponentType::LightPoint);
     else if(name == "directionalLight")
-        value = ScriptSystem::get()->getComponent<DirectionalLightComponent>(mID);
+        value = ScriptSystem::get()->getComponent(mID, ComponentType::LightDirectional);
     else if(name == "spotLight")
-        value = ScriptSystem::get()->getComponent<SpotLightComponent>(mID);
+        value = ScriptSystem::get()->getComponent(mID, ComponentType::LightSpot);
     else if(name == "script")
-        value = ScriptSystem::get()->getComponent<ScriptComponent>(mID);
+        value = ScriptSystem::get()->getComponent(mID, ComponentType::Script);
     else if(name == "collider")
-        value = ScriptSystem::get()->getComponent<ColliderComponent>(mID);
+        value = ScriptSystem::get()->getComponent(mID, ComponentType::Collider);
 
     return value;
 }
@@ -45,33 +45,36 @@ QJSValue QEntity::addComponent(const QString &name)
     QJSValue value;
 
     if(name == "transform")
-        value = ScriptSystem::get()->addComponent<TransformComponent>(mID);
+        value = ScriptSystem::get()->addComponent(mID, ComponentType::Transform);
     else if(name == "mesh")
-        value = ScriptSystem::get()->addComponent<MeshComponent>(mID);
+        value = ScriptSystem::get()->addComponent(mID, ComponentType::Mesh);
     else if(name == "physics")
-        value = ScriptSystem::get()->addComponent<PhysicsComponent>(mID);
+        value = ScriptSystem::get()->addComponent(mID, ComponentType::Physics);
     else if(name == "camera")
-        value = ScriptSystem::get()->addComponent<CameraComponent>(mID);
+        value = ScriptSystem::get()->addComponent(mID, ComponentType::Camera);
     else if(name == "input")
-        value = ScriptSystem::get()->addComponent<InputComponent>(mID);
+        value = ScriptSystem::get()->addComponent(mID, ComponentType::Input);
     else if(name == "sound")
-        value = ScriptSystem::get()->addComponent<SoundComponent>(mID);
+        value = ScriptSystem::get()->addComponent(mID, ComponentType::Sound);
     else if(name == "pointLight")
-        value = ScriptSystem::get()->addComponent<PointLightComponent>(mID);
+        value = ScriptSystem::get()->addComponent(mID, ComponentType::LightPoint);
     else if(name == "directionalLight")
-        value = ScriptSystem::get()->addComponent<DirectionalLightComponent>(mID);
+        value = ScriptSystem::get()->addComponent(mID, ComponentType::LightDirectional);
     else if(name == "spotLight")
-        value = ScriptSystem::get()->addComponent<SpotLightComponent>(mID);
+        value = ScriptSystem::get()->addComponent(mID, ComponentType::LightSpot);
     else if(name == "script")
-        value = ScriptSystem::get()->addComponent<ScriptComponent>(mID);
+        value = ScriptSystem::get()->addComponent(mID, ComponentType::Script);
     else if(name == "collider")
-        value = ScriptSystem::get()->addComponent<ColliderComponent>(mID);
+        value = ScriptSystem::get()->addComponent(mID, ComponentType::Collider);
 
     return value;
 }
 
 void QEntity::playSound()
 {
+    if(ScriptSystem::get()->defer([entity = mID](){ QEntity{ScriptSystem::get()->resolveEntity(entity)}.playSound(); }))
+        return;
+
     if(auto soundComp = World::getWorld().getEntityManager()->getComponent<SoundComponent>(mID))
     {
         auto source = soundComp->mSource;
@@ -73,6 +73,12 @@ void Renderer::init()
     // Setup deferred shading textures
     initGBuffer();
 
+    // Setup buffers used by the clustered lighting pass
+    initLightClusters();
+
+    // Setup proxy meshes used by the light volume pass
+    initLightVolumes();
+
     // Create renderquad
     float quadVertices[] = {
         //    positions   texture Coords
@@ -204,12 +210,98 @@ void Renderer::initGBuffer()
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void Renderer::initLightClusters()
+{
+    PROFILE_FUNCTION();
+    glGenBuffers(4, mClusterBuffers);
+    glGenTextures(4, mClusterTextures);
+
+    // clusters, light indices, pointlights, spotlights
+    const GLenum formats[4] = {GL_RG32UI, GL_R32UI, GL_RGBA32F, GL_RGBA32F};
+    for (unsigned int i{0}; i < 4; ++i)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, mClusterBuffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, mClusterTextures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], mClusterBuffers[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void Renderer::initLightVolumes()
+{
+    PROFILE_FUNCTION();
+    // Flips triangles so that they all are counter clockwise seen from the outside
+    auto addTriangle = [](std::vector<gsl::vec3>& out, const gsl::vec3& inside, gsl::vec3 a, gsl::vec3 b, gsl::vec3 c) {
+        auto normal = (b - a) ^ (c - a);
+        if (normal.length() < 0.000001f)
+            return;
+        if (normal * (a - inside) < 0.f)
+            std::swap(b, c);
+        out.insert(out.end(), {a, b, c});
+    };
+
+    auto upload = [this](GLuint& vao, const std::vector<gsl::vec3>& vertices) {
+        GLuint vbo;
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.size() * sizeof(gsl::vec3)), vertices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(gsl::vec3), nullptr);
+        glBindVertexArray(0);
+    };
+
+    const unsigned int stacks{8}, slices{12};
+    const float pi = gsl::PI;
+
+    // UV sphere. Scaled up so that the flat faces still enclose the unit sphere.
+    std::vector<gsl::vec3> sphere;
+    const float sphereScale = 1.f / (std::cos(pi / stacks) * std::cos(pi / slices));
+    auto spherePoint = [&](unsigned int stack, unsigned int slice) {
+        const float theta = pi * stack / stacks;
+        const float phi = 2.f * pi * slice / slices;
+        return gsl::vec3{std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)} * sphereScale;
+    };
+    for (unsigned int i{0}; i < stacks; ++i)
+    {
+        for (unsigned int j{0}; j < slices; ++j)
+        {
+            addTriangle(sphere, gsl::vec3{}, spherePoint(i, j), spherePoint(i + 1, j), spherePoint(i + 1, j + 1));
+            addTriangle(sphere, gsl::vec3{}, spherePoint(i, j), spherePoint(i + 1, j + 1), spherePoint(i, j + 1));
+        }
+    }
+    upload(mSphereVolumeVAO, sphere);
+    mSphereVolumeVertexCount = static_cast<GLsizei>(sphere.size());
+
+    // Cone pointing down positive z
+    std::vector<gsl::vec3> cone;
+    const float coneScale = 1.f / std::cos(pi / slices);
+    const gsl::vec3 tip{0.f, 0.f, 0.f}, baseCentre{0.f, 0.f, 1.f}, inside{0.f, 0.f, 0.5f};
+    auto basePoint = [&](unsigned int slice) {
+        const float phi = 2.f * pi * slice / slices;
+        return gsl::vec3{std::cos(phi) * coneScale, std::sin(phi) * coneScale, 1.f};
+    };
+    for (unsigned int j{0}; j < slices; ++j)
+    {
+        addTriangle(cone, inside, tip, basePoint(j), basePoint(j + 1));
+        addTriangle(cone, inside, baseCentre, basePoint(j + 1), basePoint(j));
+    }
+    upload(mConeVolumeVAO, cone);
+    mConeVolumeVertexCount = static_cast<GLsizei>(cone.size());
+}
+
 void Renderer::render(std::vector<MeshComponent>& renders, const std::vector<TransformComponent>& transforms, const CameraComponent& camera,
                       const std::vector<DirectionalLightComponent>& dirLights, const std::vector<SpotLightComponent>& spotLights,
                       const std::vector<PointLightComponent>& pointLights, const std::vector<ParticleComponent>& particles)
 {
     if(isExposed() && mContext->makeCurrent(this))
     {
+        // Upload assets that has finished loading in the background
+        ResourceManager::instance().processUploads(assetUploadBudget);
+
         renderReset();
 
         if (mGlobalWireframe)
@@ -276,6 +368,16 @@ void Renderer::renderDeferred(std::vector<MeshComponent>& renders, const std::ve
     glEnable(GL_BLEND);
     glBlendFunc(GL_ONE, GL_ONE);
 
+    // copy content of geometry's depth buffer to default framebuffer's depth buffer
+    // Done before the lighting so the light volumes can be depth tested against the scene.
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, mGBuffer);
+
+    // blit to postprocessor framebuffer
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mPostprocessor->input());
+    glBlitFramebuffer(0, 0, scrSize.x, scrSize.y, 0, 0, scrSize.x, scrSize.y, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, mPostprocessor->input());
+
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, mGPosition);
     glActiveTexture(GL_TEXTURE1);
@@ -288,15 +390,6 @@ void Renderer::renderDeferred(std::vector<MeshComponent>& renders, const std::ve
     glEnable(GL_DEPTH_TEST);
     glDisable(GL_BLEND);
 
-    // copy content of geometry's depth buffer to default framebuffer's depth buffer
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, mGBuffer);
-
-    // blit to postprocessor framebuffer
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mPostprocessor->input());
-    glBlitFramebuffer(0, 0, scrSize.x, scrSize.y, 0, 0, scrSize.x, scrSize.y, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, mPostprocessor->input());
-
 
 
     // ** Forward shading ** //
@@ -329,6 +422,8 @@ int Renderer::geometryPass(std::vector<MeshComponent>& renders, const std::vecto
 
     bool _{true};
 
+    const float projectionScaleSq = camera.projectionMatrix.at(1, 1) * camera.projectionMatrix.at(1, 1);
+
     GLuint currentlySelectedEID = (EditorCurrentEntitySelected != nullptr) ? EditorCurrentEntitySelected->entityId : 0;
 
     // ** Geometry pass ** //
@@ -396,20 +491,18 @@ int Renderer::geometryPass(std::vector<MeshComponent>& renders, const std::vecto
                 material = overrideMaterial.value();
             }
 
-            float distance = (camPos - transIt->position).length();
-
-            unsigned index = 0;
-            if(distance > 70.f)
+            // Mesh might have been removed
+            if(!renderIt->mesh)
             {
-                index = 2;
-            }
-            else if(distance > 20.f)
-            {
-                index = 1;
+                ++transIt;
+                ++renderIt;
+                continue;
             }
 
+            unsigned index = selectLOD(*renderIt, *transIt, camPos, projectionScaleSq);
+
             // Mesh data available
-            auto& meshData = renderIt->meshData;
+            const auto& meshData = *renderIt->mesh;
             if(!meshData.mVerticesCounts[index])
             {
                 // Increment all
@@ -431,8 +524,8 @@ int Renderer::geometryPass(std::vector<MeshComponent>& renders, const std::vecto
                 for(unsigned i = 0; i < material.mTextures.size(); ++i)
                 {
                     glActiveTexture(GL_TEXTURE0 + i);
-                    glBindTexture(material.mTextures[i].second, material.mTextures[i].first);
-                    glUniform1i(glGetUniformLocation(material.mShader->getProgram(), "textureSampler"), static_cast<int>(material.mTextures[i].first));
+                    glBindTexture(material.mTextures[i].type, material.mTextures[i].id);
+                    glUniform1i(glGetUniformLocation(material.mShader->getProgram(), "textureSampler"), static_cast<int>(material.mTextures[i].id));
                 }
             }
 
@@ -449,11 +542,12 @@ int Renderer::geometryPass(std::vector<MeshComponent>& renders, const std::vecto
 
             if(meshData.mIndicesCounts[index] > 0)
             {
-                glDrawElements(meshData.mRenderType, static_cast<GLsizei>(meshData.mIndicesCounts[index]), GL_UNSIGNED_INT, nullptr);
+                glDrawElementsBaseVertex(meshData.mRenderType, static_cast<GLsizei>(meshData.mIndicesCounts[index]), GL_UNSIGNED_INT,
+                                         reinterpret_cast<GLvoid*>(meshData.mFirstIndices[index] * sizeof(GLuint)), meshData.mBaseVertices[index]);
             }
             else
             {
-                glDrawArrays(meshData.mRenderType, 0, static_cast<GLsizei>(meshData.mVerticesCounts[index]));
+                glDrawArrays(meshData.mRenderType, meshData.mBaseVertices[index], static_cast<GLsizei>(meshData.mVerticesCounts[index]));
             }
 
             // Remember to change back so others won't get changed.
@@ -484,6 +578,34 @@ void Renderer::deferredLightningPass(const std::vector<TransformComponent> &tran
         directionalLightPass(transforms, camera, dirLights);
     }
 
+    if(mLightingMode == LightingMode::Clustered && mClusteredLightShader == nullptr)
+    {
+        mClusteredLightShader = ResourceManager::instance().getShader("clusteredLight");
+        if(mClusteredLightShader == nullptr)
+        {
+            qDebug() << "The clustered light shader is missing. Falling back to fullscreen quads.";
+            setLightingMode(LightingMode::FullscreenQuads);
+        }
+    }
+
+    if(mLightingMode == LightingMode::Clustered)
+    {
+        if(spotLights.size() || pointLights.size())
+        {
+            clusteredLightPass(transforms, camera, spotLights, pointLights);
+        }
+        return;
+    }
+
+    if(mLightingMode == LightingMode::Volumes)
+    {
+        if(mLightStencilShader == nullptr)
+        {
+            mLightStencilShader = ResourceManager::instance().getShader("lightStencil");
+            mPointLightVolumeShader = ResourceManager::instance().getShader("pointLightVolume");
+            mSpotLightVolumeShader = ResourceManager::instance().getShader("spotLightVolume");
+        }
+    }
 
     if(spotLights.size())
     {
@@ -563,15 +685,30 @@ void Renderer::directionalLightPass(const std::vector<TransformComponent> &trans
 void Renderer::pointLightPass(const std::vector<TransformComponent> &transforms,const CameraComponent& camera, const std::vector<PointLightComponent> &pointLights)
 {
     PROFILE_FUNCTION();
+    const bool useVolumes = mLightingMode == LightingMode::Volumes;
     auto v = camera.viewMatrix;
     v.inverse();
     auto pos = gsl::vec3(v.at(0, 3), v.at(1, 3), v.at(2, 3));
-    auto location = mPointLightShader->getProgram();
+    auto location = (useVolumes ? mPointLightVolumeShader : mPointLightShader)->getProgram();
     glUseProgram(location);
     glUniform1i(glGetUniformLocation(location, "gPosition"),   0);
     glUniform1i(glGetUniformLocation(location, "gNormal"),     1);
     glUniform1i(glGetUniformLocation(location, "gAlbedoSpec"), 2);
     glUniform3fv(glGetUniformLocation(location, "viewPos"), 1, pos.xP());
+    glUniform2f(glGetUniformLocation(location, "screenSize"), static_cast<float>(width() * devicePixelRatio()), static_cast<float>(height() * devicePixelRatio()));
+
+    std::array<gsl::vec4, 6> frustum;
+    if (useVolumes)
+    {
+        frustum = calcFrustumPlanes(camera);
+        for (auto program : {location, mLightStencilShader->getProgram()})
+        {
+            glUseProgram(program);
+            glUniformMatrix4fv(glGetUniformLocation(program, "vMatrix"), 1, true, camera.viewMatrix.constData());
+            glUniformMatrix4fv(glGetUniformLocation(program, "pMatrix"), 1, true, camera.projectionMatrix.constData());
+        }
+        glUseProgram(location);
+    }
 
     auto transIt = transforms.begin();
     auto lightIt = pointLights.begin();
@@ -605,11 +742,23 @@ void Renderer::pointLightPass(const std::vector<TransformComponent> &transforms,
         }
         else
         {
+            if (useVolumes && !sphereInsideFrustum(frustum, transIt->position, lightIt->radius))
+            {
+                // Increment all
+                ++transIt;
+                ++lightIt;
+                continue;
+            }
+
             glUniform3fv(glGetUniformLocation(location, "light.Color"), 1, lightIt->color.xP());
             glUniform3fv(glGetUniformLocation(location, "light.Position"), 1, transIt->position.xP());
             glUniform1f(glGetUniformLocation(location, "light.Radius"), lightIt->radius);
             glUniform1f(glGetUniformLocation(location, "light.Intensity"), lightIt->intensity);
-            renderQuad();
+            if (useVolumes)
+                renderLightVolume(mSphereVolumeVAO, mSphereVolumeVertexCount,
+                                  gsl::mat4::modelMatrix(transIt->position, gsl::quat{}, gsl::vec3{lightIt->radius, lightIt->radius, lightIt->radius}), location);
+            else
+                renderQuad();
 
             // Increment all
             ++transIt;
@@ -621,15 +770,30 @@ void Renderer::pointLightPass(const std::vector<TransformComponent> &transforms,
 void Renderer::spotLightPass(const std::vector<TransformComponent> &transforms, const CameraComponent& camera, const std::vector<SpotLightComponent> &spotLights)
 {
     PROFILE_FUNCTION();
+    const bool useVolumes = mLightingMode == LightingMode::Volumes;
     auto v = camera.viewMatrix;
     v.inverse();
     auto pos = gsl::vec3(v.at(0, 3), v.at(1, 3), v.at(2, 3));
-    auto location = mSpotLightShader->getProgram();
+    auto location = (useVolumes ? mSpotLightVolumeShader : mSpotLightShader)->getProgram();
     glUseProgram(location);
     glUniform1i(glGetUniformLocation(location, "gPosition"),   0);
     glUniform1i(glGetUniformLocation(location, "gNormal"),     1);
     glUniform1i(glGetUniformLocation(location, "gAlbedoSpec"), 2);
     glUniform3fv(glGetUniformLocation(location, "viewPos"), 1, pos.xP());
+    glUniform2f(glGetUniformLocation(location, "screenSize"), static_cast<float>(width() * devicePixelRatio()), static_cast<float>(height() * devicePixelRatio()));
+
+    std::array<gsl::vec4, 6> frustum;
+    if (useVolumes)
+    {
+        frustum = calcFrustumPlanes(camera);
+        for (auto program : {location, mLightStencilShader->getProgram()})
+        {
+            glUseProgram(program);
+            glUniformMatrix4fv(glGetUniformLocation(program, "vMatrix"), 1, true, camera.viewMatrix.constData());
+            glUniformMatrix4fv(glGetUniformLocation(program, "pMatrix"), 1, true, camera.projectionMatrix.constData());
+        }
+        glUseProgram(location);
+    }
 
     auto transIt = transforms.begin();
     auto lightIt = spotLights.begin();
@@ -663,15 +827,42 @@ void Renderer::spotLightPass(const std::vector<TransformComponent> &transforms,
         }
         else
         {
+            const float range = useVolumes ? std::min(lightIt->calculateRange(), mFarPlane) : 0.f;
+            if (useVolumes && !sphereInsideFrustum(frustum, transIt->position, range))
+            {
+                // Increment all
+                ++transIt;
+                ++lightIt;
+                continue;
+            }
+
             glUniform3fv(glGetUniformLocation(location, "light.Color"), 1, lightIt->color.xP());
             glUniform3fv(glGetUniformLocation(location, "light.Position"), 1, transIt->position.xP());
             glUniform3fv(glGetUniformLocation(location, "light.Direction"), 1, transIt->rotation.forwardVector().xP());
-            glUniform1f(glGetUniformLocation(location, "light.CutOff"), lightIt->cutOff);
-            glUniform1f(glGetUniformLocation(location, "light.OuterCutOff"), lightIt->outerCutOff);
+            // The components store the cutoffs as angles, the shader compares against their cosines
+            glUniform1f(glGetUniformLocation(location, "light.CutOff"), std::cos(lightIt->cutOff));
+            glUniform1f(glGetUniformLocation(location, "light.OuterCutOff"), std::cos(lightIt->outerCutOff));
             glUniform1f(glGetUniformLocation(location, "light.constant"), lightIt->constant);
             glUniform1f(glGetUniformLocation(location, "light.linear"), lightIt->linear);
             glUniform1f(glGetUniformLocation(location, "light.quadratic"), lightIt->quadratic);
-            renderQuad();
+            if (useVolumes)
+            {
+                // The outer cutoff is the cone's half angle
+                if (std::cos(lightIt->outerCutOff) > 0.1f)
+                {
+                    const float baseRadius = range * std::tan(lightIt->outerCutOff);
+                    renderLightVolume(mConeVolumeVAO, mConeVolumeVertexCount,
+                                      gsl::mat4::modelMatrix(transIt->position, transIt->rotation, gsl::vec3{baseRadius, baseRadius, range}), location);
+                }
+                else
+                {
+                    // Cone is too wide to be worth it, just use a sphere
+                    renderLightVolume(mSphereVolumeVAO, mSphereVolumeVertexCount,
+                                      gsl::mat4::modelMatrix(transIt->position, gsl::quat{}, gsl::vec3{range, range, range}), location);
+                }
+            }
+            else
+                renderQuad();
 
             // Increment all
             ++transIt;
@@ -680,6 +871,204 @@ void Renderer::spotLightPass(const std::vector<TransformComponent> &transforms,
     }
 }
 
+void Renderer::renderLightVolume(GLuint vao, GLsizei vertexCount, const gsl::mat4 &mMatrix, GLuint lightProgram)
+{
+    const auto stencilProgram = mLightStencilShader->getProgram();
+    glBindVertexArray(vao);
+
+    // 1. Stencil pass. Flips the light bit for every face that is behind the scene geometry.
+    // With a convex volume the bit ends up set only where the geometry is inside the volume,
+    // also when the camera itself is inside it.
+    glUseProgram(stencilProgram);
+    glUniformMatrix4fv(glGetUniformLocation(stencilProgram, "mMatrix"), 1, true, mMatrix.constData());
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_CULL_FACE);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    // Use the highest bit so the editor outline stencil is left alone
+    glStencilMask(0x80);
+    glStencilFunc(GL_ALWAYS, 0, 0);
+    glStencilOp(GL_KEEP, GL_INVERT, GL_KEEP);
+    glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+
+    // 2. Light pass. Shades the marked pixels and clears the bit again for the next light.
+    // Back faces are drawn so it still works when the camera is inside the volume.
+    glUseProgram(lightProgram);
+    glUniformMatrix4fv(glGetUniformLocation(lightProgram, "mMatrix"), 1, true, mMatrix.constData());
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glStencilFunc(GL_EQUAL, 0x80, 0x80);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+    glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+
+    // Reset
+    glCullFace(GL_BACK);
+    glDepthMask(GL_TRUE);
+    glStencilMask(0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    glStencilFunc(GL_ALWAYS, 1, 0xFF);
+    glBindVertexArray(0);
+}
+
+std::array<gsl::vec4, 6> Renderer::calcFrustumPlanes(const CameraComponent &camera) const
+{
+    // Gribb/Hartmann: planes are sums and differences of the rows of the view projection matrix.
+    const auto vp = camera.projectionMatrix * camera.viewMatrix;
+    auto row = [&vp](unsigned int r) { return gsl::vec4{vp.at(r, 0), vp.at(r, 1), vp.at(r, 2), vp.at(r, 3)}; };
+    const auto r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+    std::array<gsl::vec4, 6> planes{
+        r3 + r0, r3 - r0,
+        r3 + r1, r3 - r1,
+        r3 + r2, r3 - r2
+    };
+    for (auto& plane : planes)
+    {
+        const float length = gsl::vec3{plane.x, plane.y, plane.z}.length();
+        plane = plane * (1.f / length);
+    }
+    return planes;
+}
+
+bool Renderer::sphereInsideFrustum(const std::array<gsl::vec4, 6> &planes, const gsl::vec3 &centre, float radius)
+{
+    for (const auto& plane : planes)
+        if (plane.x * centre.x + plane.y * centre.y + plane.z * centre.z + plane.w < -radius)
+            return false;
+    return true;
+}
+
+void Renderer::clusteredLightPass(const std::vector<TransformComponent> &transforms, const CameraComponent &camera,
+                                  const std::vector<SpotLightComponent> &spotLights, const std::vector<PointLightComponent> &pointLights)
+{
+    PROFILE_FUNCTION();
+    const auto& view = camera.viewMatrix;
+    auto toViewSpace = [&view](const gsl::vec3& p) {
+        return gsl::vec3{view.at(0, 0) * p.x + view.at(0, 1) * p.y + view.at(0, 2) * p.z + view.at(0, 3),
+                         view.at(1, 0) * p.x + view.at(1, 1) * p.y + view.at(1, 2) * p.z + view.at(1, 3),
+                         view.at(2, 0) * p.x + view.at(2, 1) * p.y + view.at(2, 2) * p.z + view.at(2, 3)};
+    };
+
+    mClusterLightBounds.clear();
+    mClusterPointLightData.clear();
+    mClusterSpotLightData.clear();
+
+    {
+        PROFILE_SCOPE("Gather lights");
+        // Pointlights first, so that every index below the pointlight count is a pointlight.
+        auto transIt = transforms.begin();
+        auto pointIt = pointLights.begin();
+        while (transIt != transforms.end() && pointIt != pointLights.end())
+        {
+            if (!transIt->valid || transIt->entityId < pointIt->entityId)
+                ++transIt;
+            else if (!pointIt->valid || pointIt->entityId < transIt->entityId)
+                ++pointIt;
+            else
+            {
+                const auto& p = transIt->position;
+                mClusterLightBounds.push_back({toViewSpace(p), pointIt->radius});
+                mClusterPointLightData.insert(mClusterPointLightData.end(), {
+                    p.x, p.y, p.z, pointIt->radius,
+                    pointIt->color.x, pointIt->color.y, pointIt->color.z, pointIt->intensity
+                });
+                ++transIt;
+                ++pointIt;
+            }
+        }
+
+        transIt = transforms.begin();
+        auto spotIt = spotLights.begin();
+        while (transIt != transforms.end() && spotIt != spotLights.end())
+        {
+            if (!transIt->valid || transIt->entityId < spotIt->entityId)
+                ++transIt;
+            else if (!spotIt->valid || spotIt->entityId < transIt->entityId)
+                ++spotIt;
+            else
+            {
+                const auto& p = transIt->position;
+                const auto dir = transIt->rotation.forwardVector();
+                const float range = std::min(spotIt->calculateRange(), mFarPlane);
+                mClusterLightBounds.push_back({toViewSpace(p), range});
+                mClusterSpotLightData.insert(mClusterSpotLightData.end(), {
+                    p.x, p.y, p.z, range,
+                    spotIt->color.x, spotIt->color.y, spotIt->color.z, spotIt->intensity,
+                    dir.x, dir.y, dir.z, std::cos(spotIt->cutOff),
+                    std::cos(spotIt->outerCutOff), spotIt->constant, spotIt->linear, spotIt->quadratic
+                });
+                ++transIt;
+                ++spotIt;
+            }
+        }
+    }
+
+    {
+        PROFILE_SCOPE("Bin lights");
+        mLightClusterGrid.setProjection(1.f / camera.projectionMatrix.at(0, 0), 1.f / camera.projectionMatrix.at(1, 1), mNearPlane, mFarPlane);
+        mLightClusterGrid.build(mClusterLightBounds);
+    }
+
+    {
+        PROFILE_SCOPE("Upload lights");
+        // Texture buffers can't be empty, so always upload at least one element.
+        auto upload = [this](GLuint buffer, const void* data, std::size_t bytes) {
+            static const float dummy[4]{};
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            // Orphan the old storage so we don't stall on last frames draw
+            glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(std::max<std::size_t>(bytes, sizeof(dummy))), nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, static_cast<GLsizeiptr>(bytes ? bytes : sizeof(dummy)), bytes ? data : dummy);
+        };
+        const auto& clusters = mLightClusterGrid.clusterData();
+        const auto& indices = mLightClusterGrid.lightIndices();
+        upload(mClusterBuffers[0], clusters.data(), clusters.size() * sizeof(unsigned int));
+        upload(mClusterBuffers[1], indices.data(), indices.size() * sizeof(unsigned int));
+        upload(mClusterBuffers[2], mClusterPointLightData.data(), mClusterPointLightData.size() * sizeof(float));
+        upload(mClusterBuffers[3], mClusterSpotLightData.data(), mClusterSpotLightData.size() * sizeof(float));
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    auto v = camera.viewMatrix;
+    v.inverse();
+    auto pos = gsl::vec3(v.at(0, 3), v.at(1, 3), v.at(2, 3));
+    const auto& settings = mLightClusterGrid.settings();
+    gsl::vec2 screenSize{static_cast<float>(width() * devicePixelRatio()), static_cast<float>(height() * devicePixelRatio())};
+
+    auto location = mClusteredLightShader->getProgram();
+    glUseProgram(location);
+    glUniform1i(glGetUniformLocation(location, "gPosition"),   0);
+    glUniform1i(glGetUniformLocation(location, "gNormal"),     1);
+    glUniform1i(glGetUniformLocation(location, "gAlbedoSpec"), 2);
+    glUniform1i(glGetUniformLocation(location, "clusters"),     3);
+    glUniform1i(glGetUniformLocation(location, "lightIndices"), 4);
+    glUniform1i(glGetUniformLocation(location, "pointLights"),  5);
+    glUniform1i(glGetUniformLocation(location, "spotLights"),   6);
+    glUniform3fv(glGetUniformLocation(location, "viewPos"), 1, pos.xP());
+    glUniformMatrix4fv(glGetUniformLocation(location, "vMatrix"), 1, true, camera.viewMatrix.constData());
+    glUniform2f(glGetUniformLocation(location, "screenSize"), screenSize.x, screenSize.y);
+    glUniform3ui(glGetUniformLocation(location, "clusterDims"), settings.tilesX, settings.tilesY, settings.slices);
+    glUniform1f(glGetUniformLocation(location, "sliceScale"), mLightClusterGrid.sliceScale());
+    glUniform1f(glGetUniformLocation(location, "sliceBias"), mLightClusterGrid.sliceBias());
+    glUniform1i(glGetUniformLocation(location, "pointLightCount"), static_cast<int>(mClusterPointLightData.size() / 8));
+
+    for (unsigned int i{0}; i < 4; ++i)
+    {
+        glActiveTexture(GL_TEXTURE3 + i);
+        glBindTexture(GL_TEXTURE_BUFFER, mClusterTextures[i]);
+    }
+
+    renderQuad();
+
+    for (unsigned int i{0}; i < 4; ++i)
+    {
+        glActiveTexture(GL_TEXTURE3 + i);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
 void Renderer::renderPostprocessing()
 {
     PROFILE_FUNCTION();
@@ -735,6 +1124,34 @@ bool Renderer::insideViewingArea(const MeshComponent &render, const TransformCom
 
 }
 
+unsigned int Renderer::selectLOD(MeshComponent &render, const TransformComponent &transform, const gsl::vec3 &camPos, float projectionScaleSq) const
+{
+    const auto& meshData = *render.mesh;
+    const unsigned int count = meshData.LODCount();
+    if (count < 2)
+        return render.currentLOD = 0;
+
+    // Screen size is radius / (distance * tan(fov/2)). Everything is compared squared to avoid the sqrt.
+    float scale = std::max(std::max(transform.scale.x, transform.scale.y), transform.scale.z);
+    float radius = meshData.bounds.radius * scale;
+    const auto toCamera = camPos - transform.position;
+    const float distanceSq = toCamera * toCamera;
+    const float sizeSq = radius * radius * projectionScaleSq;
+
+    // screenSize < threshold  <=>  sizeSq < threshold^2 * distanceSq
+    auto smallerThan = [&](float threshold) { return sizeSq < threshold * threshold * distanceSq; };
+
+    unsigned int lod = std::min(render.currentLOD, count - 1);
+    // Has to shrink a bit past the threshold before dropping detail...
+    while (lod + 1 < count && smallerThan(meshData.mLODScreenSizes[lod + 1] * (1.f - LODHysteresis)))
+        ++lod;
+    // ...and grow a bit past it before adding it back.
+    while (0 < lod && !smallerThan(meshData.mLODScreenSizes[lod] * (1.f + LODHysteresis)))
+        --lod;
+
+    return render.currentLOD = lod;
+}
+
 float Renderer::distanceFromCamera(const CameraComponent& camera, const TransformComponent& transform)
 {
     PROFILE_FUNCTION();
@@ -803,20 +1220,18 @@ unsigned int Renderer::getMouseHoverObject(gsl::ivec2 mouseScreenPos, const std:
                     continue;
                 }
 
-                auto camPos = camera.viewMatrix.getPosition();
-                auto distance = std::abs((camPos - transIt->position).length());
-                unsigned index = 0;
-                if(distance > 10.f)
-                {
-                    index = 1;
-                }
-                else if(distance > 20.f)
+                // Mesh data available
+                if(!renderIt->mesh)
                 {
-                    index = 2;
+                    ++transIt;
+                    ++renderIt;
+                    continue;
                 }
 
-                // Mesh data available
-                auto meshData = renderIt->meshData;
+                // Use the same LOD as the last render so the picking matches what's on screen
+                const auto& meshData = *renderIt->mesh;
+                unsigned index = std::min(renderIt->currentLOD, meshData.LODCount() - 1);
+
                 if(!meshData.mVerticesCounts[index])
                 {
                     // Increment all
@@ -844,11 +1259,12 @@ unsigned int Renderer::getMouseHoverObject(gsl::ivec2 mouseScreenPos, const std:
 
                 if(meshData.mIndicesCounts[index] > 0)
                 {
-                    glDrawElements(meshData.mRenderType, static_cast<GLsizei>(meshData.mIndicesCounts[index]), GL_UNSIGNED_INT, nullptr);
+                    glDrawElementsBaseVertex(meshData.mRenderType, static_cast<GLsizei>(meshData.mIndicesCounts[index]), GL_UNSIGNED_INT,
+                                             reinterpret_cast<GLvoid*>(meshData.mFirstIndices[index] * sizeof(GLuint)), meshData.mBaseVertices[index]);
                 }
                 else
                 {
-                    glDrawArrays(meshData.mRenderType, 0, static_cast<GLsizei>(meshData.mVerticesCounts[index]));
+                    glDrawArrays(meshData.mRenderType, meshData.mBaseVertices[index], static_cast<GLsizei>(meshData.mVerticesCounts[index]));
                 }
 
                 // Increment all
@@ -951,7 +1367,7 @@ void Renderer::renderSkybox(const CameraComponent &camera)
     glUseProgram(shader->getProgram());
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(mSkyboxMaterial->mTextures[0].second, static_cast<unsigned int>(mSkyboxMaterial->mTextures[0].first));
+    glBindTexture(mSkyboxMaterial->mTextures[0].type, mSkyboxMaterial->mTextures[0].id);
 
     glUniformMatrix4fv(glGetUniformLocation(shader->getProgram(), "vMatrix"), 1, true, camera.viewMatrix.constData());
     glUniformMatrix4fv(glGetUniformLocation(shader->getProgram(), "pMatrix"), 1, true, camera.projectionMatrix.constData());
@@ -968,7 +1384,7 @@ void Renderer::renderSkybox(const CameraComponent &camera)
         glUniform2iv(uniform, 1, &res.x);
     }
 
-    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(mSkyboxMesh->mVerticesCounts[0]));
+    glDrawArrays(GL_TRIANGLES, mSkyboxMesh->mBaseVertices[0], static_cast<GLsizei>(mSkyboxMesh->mVerticesCounts[0]));
     glDepthFunc(GL_LESS);
 
     checkForGLerrors();
@@ -986,7 +1402,7 @@ void Renderer::renderAxis(const CameraComponent& camera)
     glUniformMatrix4fv(glGetUniformLocation(shader->getProgram(), "mMatrix"), 1, true, mMatrix.constData());
     glUniformMatrix4fv(glGetUniformLocation(shader->getProgram(), "vMatrix"), 1, true, camera.viewMatrix.constData());
     glUniformMatrix4fv(glGetUniformLocation(shader->getProgram(), "pMatrix"), 1, true, camera.projectionMatrix.constData());
-    glDrawArrays(mAxisMesh->mRenderType, 0, static_cast<GLsizei>(mAxisMesh->mVerticesCounts[0]));
+    glDrawArrays(mAxisMesh->mRenderType, mAxisMesh->mBaseVertices[0], static_cast<GLsizei>(mAxisMesh->mVerticesCounts[0]));
 }
 
 void Renderer::drawEditorOutline()
@@ -1042,6 +1458,23 @@ void Renderer::toggleWireframe(bool value)
     mGlobalWireframe = value;
 }
 
+void Renderer::setLightingMode(LightingMode mode)
+{
+    if (mode == LightingMode::Volumes && !mDepthStencilAttachmentSupported)
+    {
+        qDebug() << "Light volumes needs a stencil buffer, which is not supported. Falling back to fullscreen quads.";
+        mode = LightingMode::FullscreenQuads;
+    }
+    mLightingMode = mode;
+    emit lightingModeChanged(mode);
+}
+
+void Renderer::setClipPlanes(float nearPlane, float farPlane)
+{
+    mNearPlane = nearPlane;
+    mFarPlane = farPlane;
+}
+
 /// Uses QOpenGLDebugLogger if this is present
 /// Reverts to glGetError() if not
 void Renderer::checkForGLerrors()
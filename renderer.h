@@ -9,13 +9,28 @@
 #include "camerasystem.h"
 #include "componentdata.h"
 #include "postprocessor.h"
+#include "lightclustergrid.h"
 #include <optional>
+#include <array>
 
 class QOpenGLContext;
 class Shader;
 class QTime;
 class ParticleSystem;
 
+/**
+ * @brief How the deferred lighting pass accumulates light.
+ * FullscreenQuads renders one screen quad per light,
+ * Volumes renders a sphere or cone per light and uses the stencil buffer to only shade the pixels inside it,
+ * Clustered bins all point- and spotlights into a froxel grid and shades them in a single pass.
+ */
+enum class LightingMode
+{
+    FullscreenQuads,
+    Volumes,
+    Clustered
+};
+
 /**
  * @brief The render system. Holds onto the context and renders everything when needed.
  */
@@ -40,6 +55,14 @@ public:
 
     void exposeEvent(QExposeEvent *) override;
     void toggleWireframe(bool value);
+    //! Sets the lighting mode, or the closest one that's supported. Emits lightingModeChanged with the one used.
+    void setLightingMode(LightingMode mode);
+    LightingMode getLightingMode() const { return mLightingMode; }
+
+    /**
+     * @brief Near and far plane used by the cameras. Needed to fit the light cluster grid to the view frustum.
+     */
+    void setClipPlanes(float nearPlane, float farPlane);
 
     void checkForGLerrors();
 
@@ -57,6 +80,14 @@ public:
 
     int getNumberOfVerticesDrawn() { return mNumberOfVerticesDrawn; }
 
+    /** How far past a LOD threshold the screen size has to be before switching LOD, as a fraction of the threshold.
+     * Stops meshes right on the threshold from popping back and forth.
+     */
+    float LODHysteresis{0.1f};
+
+    //! Milliseconds per frame spent uploading assets that finished loading in the background.
+    double assetUploadBudget{2.0};
+
     void evaluateParams(Material& material);
 
 private:
@@ -90,22 +121,43 @@ private:
     void directionalLightPass(const std::vector<TransformComponent>& transforms, const CameraComponent &camera, const std::vector<DirectionalLightComponent>& dirLights);
     /**
      * @brief Part of the lighting pass of the deferred pipeline.
+     * In LightingMode::Volumes each light is drawn as a sphere scaled by it's radius.
      */
     void pointLightPass(const std::vector<TransformComponent>& transforms,const CameraComponent &camera, const std::vector<PointLightComponent>& pointLights);
     /**
      * @brief Part of the lighting pass of the deferred pipeline.
+     * In LightingMode::Volumes each light is drawn as a cone reaching as far as it's attenuation.
      */
     void spotLightPass(const std::vector<TransformComponent>& transforms, const CameraComponent &camera, const std::vector<SpotLightComponent>& spotLights);
+    /**
+     * @brief Part of the lighting pass of the deferred pipeline.
+     * Bins all point- and spotlights into mLightClusterGrid and shades them with a single screen quad.
+     */
+    void clusteredLightPass(const std::vector<TransformComponent>& transforms, const CameraComponent &camera,
+                            const std::vector<SpotLightComponent>& spotLights, const std::vector<PointLightComponent>& pointLights);
     /**
      * @brief Last part of the deferred pipeline. Renders a quad on top based on the post processors.
      */
     void renderPostprocessing();
 
+    /**
+     * @brief Renders a light volume in two steps. First marks the pixels where the scene geometry is inside the volume in the stencil buffer,
+     * then shades those pixels with the given light shader.
+     */
+    void renderLightVolume(GLuint vao, GLsizei vertexCount, const gsl::mat4& mMatrix, GLuint lightProgram);
+
+    /**
+     * @brief Returns the 6 planes (normal, distance) of the cameras view frustum in world space. The normals point inwards.
+     */
+    std::array<gsl::vec4, 6> calcFrustumPlanes(const CameraComponent& camera) const;
+    static bool sphereInsideFrustum(const std::array<gsl::vec4, 6>& planes, const gsl::vec3& centre, float radius);
+
     std::vector<gsl::vec4> calcViewFrustum(const CameraComponent &camera, const TransformComponent &trans);
     bool insideViewingArea(const MeshComponent& render, const TransformComponent& trans, const CameraComponent& camera);
 signals:
     void initDone();
     void windowUpdated();
+    void lightingModeChanged(LightingMode mode);
 
 private:
     QOpenGLContext *mContext{nullptr};
@@ -128,6 +180,27 @@ private:
     std::shared_ptr<Shader> mDirectionalLightShader;
     std::shared_ptr<Shader> mPointLightShader;
     std::shared_ptr<Shader> mSpotLightShader;
+    std::shared_ptr<Shader> mClusteredLightShader;
+    std::shared_ptr<Shader> mPointLightVolumeShader;
+    std::shared_ptr<Shader> mSpotLightVolumeShader;
+    std::shared_ptr<Shader> mLightStencilShader;
+
+    // Proxy meshes used in LightingMode::Volumes.
+    // The sphere has radius 1, the cone has it's tip in origo and a base with radius 1 at z = 1.
+    GLuint mSphereVolumeVAO{}, mConeVolumeVAO{};
+    GLsizei mSphereVolumeVertexCount{}, mConeVolumeVertexCount{};
+
+    LightingMode mLightingMode{LightingMode::FullscreenQuads};
+    LightClusterGrid mLightClusterGrid;
+    float mNearPlane{0.1f};
+    float mFarPlane{100.f};
+    // Per frame light data, kept around to reuse the allocations.
+    std::vector<LightClusterGrid::LightBounds> mClusterLightBounds;
+    std::vector<float> mClusterPointLightData;
+    std::vector<float> mClusterSpotLightData;
+    // Buffers and buffer textures for clusters, light indices, pointlights and spotlights.
+    GLuint mClusterBuffers[4]{};
+    GLuint mClusterTextures[4]{};
 
     bool mGlobalWireframe{false};
     bool isInitialized{false};
@@ -138,6 +211,11 @@ private:
     class QOpenGLDebugLogger *mOpenGLDebugLogger{nullptr};
 
     float distanceFromCamera(const CameraComponent& camera, const TransformComponent& transform);
+    /**
+     * @brief Picks the LOD for the mesh based on how big it's bounds are on screen and stores it in render.currentLOD.
+     * @param projectionScaleSq - squared vertical scale of the projection matrix, 1 / tan(fov/2)^2
+     */
+    unsigned int selectLOD(MeshComponent& render, const TransformComponent& transform, const gsl::vec3& camPos, float projectionScaleSq) const;
     void resizeGBuffer(double retinaScale = 1.0);
     void renderQuad();
     void renderSkybox(const CameraComponent& camera);
@@ -146,6 +224,8 @@ private:
 
     void startOpenGLDebugger();
     void initGBuffer();
+    void initLightClusters();
+    void initLightVolumes();
 };
 
 #endif // RENDERER_H
@@ -0,0 +1,52 @@
+#include "resourceid.h"
+#include "resourcemap.h"
+#include <deque>
+#include <mutex>
+#include <QDebug>
+
+namespace
+{
+// Interned names. The deque keeps the strings in place when the map grows.
+struct StringTable
+{
+    std::mutex mutex;
+    std::deque<std::string> strings;
+    ResourceMap<const std::string*> names;
+};
+
+StringTable& stringTable()
+{
+    static StringTable table;
+    return table;
+}
+}
+
+ResourceId ResourceId::intern(const std::string &name)
+{
+    const ResourceId id{name};
+
+    auto& table = stringTable();
+    std::lock_guard<std::mutex> lock{table.mutex};
+    auto& interned = table.names[id];
+    if (!interned)
+    {
+        table.strings.push_back(name);
+        interned = &table.strings.back();
+    }
+    else if (*interned != name)
+    {
+        qDebug() << "ResourceId: Both" << QString::fromStdString(*interned) << "and" << QString::fromStdString(name)
+                 << "hash to" << id.value() << ", rename one of them";
+    }
+    return id;
+}
+
+const std::string &ResourceId::name() const
+{
+    static const std::string none{};
+
+    auto& table = stringTable();
+    std::lock_guard<std::mutex> lock{table.mutex};
+    auto interned = table.names.find(*this);
+    return interned ? **interned : none;
+}
@@ -0,0 +1,72 @@
+#ifndef RESOURCEID_H
+#define RESOURCEID_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/** 32 bit hash of a resource name, used to look resources up without comparing or allocating strings.
+ * Ids made from string literals are hashed at compile time, so getMesh("box2") costs a hash map lookup only.
+ * Names added to the resource manager are interned, so the name of an id can be found again with name(),
+ * and two names hashing to the same id are reported.
+ * @brief Hashed resource name.
+ */
+class ResourceId
+{
+public:
+    constexpr ResourceId() = default;
+    constexpr ResourceId(const char* name) : mValue{hash(name, length(name))} {}
+    constexpr ResourceId(std::string_view name) : mValue{hash(name.data(), name.size())} {}
+    ResourceId(const std::string& name) : mValue{hash(name.data(), name.size())} {}
+
+    //! The id of name, remembering the name. Warns if another name has the same id.
+    static ResourceId intern(const std::string& name);
+    //! The interned name of the id, empty if it hasn't been interned.
+    const std::string& name() const;
+
+    static constexpr ResourceId fromValue(std::uint32_t value)
+    {
+        ResourceId id;
+        id.mValue = value;
+        return id;
+    }
+
+    constexpr std::uint32_t value() const { return mValue; }
+    constexpr bool isValid() const { return mValue != 0; }
+    constexpr bool operator== (ResourceId other) const { return mValue == other.mValue; }
+    constexpr bool operator!= (ResourceId other) const { return mValue != other.mValue; }
+
+    /**
+     * @brief FNV-1a followed by a finalizer that spreads the bits, since the hash maps only use the low ones.
+     * Never returns 0, which is the invalid id.
+     */
+    static constexpr std::uint32_t hash(const char* data, std::size_t size)
+    {
+        std::uint32_t h{2166136261u};
+        for (std::size_t i{0}; i < size; ++i)
+        {
+            h ^= static_cast<unsigned char>(data[i]);
+            h *= 16777619u;
+        }
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return h ? h : 1;
+    }
+
+private:
+    static constexpr std::size_t length(const char* name)
+    {
+        std::size_t size{0};
+        while (name[size])
+            ++size;
+        return size;
+    }
+
+    std::uint32_t mValue{0};
+};
+
+#endif // RESOURCEID_H
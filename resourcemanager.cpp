@@ -1,6 +1,19 @@
 #include "resourcemanager.h"
 #include "innpch.h"
 #include <QDirIterator>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QRegularExpression>
+#include "meshsimplifier.h"
+#include "meshoptimizer.h"
+#include "objparser.h"
+#include "cookedmesh.h"
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <iterator>
+#include <chrono>
+#include <thread>
 #include "constants.h"
 #include "wavfilehandler.h"
 #include <QDebug>
@@ -8,10 +21,12 @@
 
 ResourceManager::~ResourceManager()
 {
+    // Stop the loading threads before anything they use is destroyed
+    mLoadingPool.reset();
     inst = nullptr;
 }
 
-void ResourceManager::LoadAssetFiles()
+void ResourceManager::LoadAssetFiles(bool async)
 {
     QDirIterator dirIt(QString::fromStdString(gsl::assetFilePath), QDirIterator::Subdirectories);
     while (dirIt.hasNext())
@@ -24,15 +39,24 @@ void ResourceManager::LoadAssetFiles()
             auto fileName = fileInfo.fileName().toStdString();
             if (fileInfo.suffix() == "txt" || fileInfo.suffix() == "obj")
             {
-                addMesh(baseName, fileName);
+                if (async)
+                    addMeshAsync(baseName, fileName);
+                else
+                    addMesh(baseName, fileName);
             }
-            else if(fileInfo.suffix() == "bmp")
+            else if(fileInfo.suffix() == "bmp" || fileInfo.suffix() == "png" || fileInfo.suffix() == "tga" || fileInfo.suffix() == "jpg")
             {
-                addTexture(baseName, fileName);
+                if (async)
+                    addTextureAsync(baseName, fileName);
+                else
+                    addTexture(baseName, fileName);
             }
             else if(fileInfo.suffix() == "wav")
             {
-                loadWav(baseName, fileInfo.absoluteFilePath().toStdString());
+                if (async)
+                    loadWavAsync(baseName, fileInfo.absoluteFilePath().toStdString());
+                else
+                    loadWav(baseName, fileInfo.absoluteFilePath().toStdString());
             }
         }
     }
@@ -40,26 +64,22 @@ void ResourceManager::LoadAssetFiles()
 
 void ResourceManager::addShader(const std::string &name, std::shared_ptr<Shader> shader)
 {
-    if(shader && mShaders.find(name) == mShaders.end())
+    if(shader && !mShaders.contains(name))
     {
         shader->mName = name;
-        mShaders[name] = shader;
+        mShaders[ResourceId::intern(name)] = shader;
     }
 }
 
-std::shared_ptr<Shader> ResourceManager::getShader(const std::string &name)
+std::shared_ptr<Shader> ResourceManager::getShader(ResourceId id)
 {
-    if(mShaders.find(name) != mShaders.end())
-    {
-        return mShaders[name];
-    }
-
-    return nullptr;
+    auto shader = mShaders.find(id);
+    return shader ? *shader : nullptr;
 }
 
 void ResourceManager::addTexture(const std::string &name, const std::string &path, GLenum type)
 {
-    if(mTextures.find(name) == mTextures.end())
+    if(!mTextures.find(name).isValid())
     {
         if(!mIsInitialized)
         {
@@ -67,25 +87,86 @@ void ResourceManager::addTexture(const std::string &name, const std::string &pat
             mIsInitialized = true;
         }
 
-        mTextures[name] = std::make_shared<Texture>(path, type);
+        mTextureSources[ResourceId::intern(name)] = {path, type};
+        mTextures.add(name, std::make_shared<Texture>(path, type, 0, textureSettings));
     }
 }
 
-std::shared_ptr<Texture> ResourceManager::getTexture(const std::string &name)
+TextureRef ResourceManager::addTextureAsync(const std::string &name, const std::string &path, GLenum type)
 {
-    if(mTextures.find(name) != mTextures.end())
+    auto handle = mTextures.find(name);
+    if(handle.isValid())
+    {
+        return {&mTextures, handle};
+    }
+
+    if(!mIsInitialized)
     {
-        return mTextures[name];
+        initializeOpenGLFunctions();
+        mIsInitialized = true;
     }
 
-    return nullptr;
+    auto texture = Texture::placeholder(type);
+    mTextureSources[ResourceId::intern(name)] = {path, type};
+    handle = mTextures.add(name, texture);
+
+    submitLoad(name, [this, texture, path, settings = textureSettings]() -> std::function<void()> {
+        if (!texture->loadImage(path, settings))
+            return {};
+        return [this, texture](){ texture->upload(0, &uploadManager()); };
+    });
+
+    return {&mTextures, handle};
+}
+
+std::size_t ResourceManager::getTextureMemoryUsage(ResourceId id)
+{
+    auto texture = mTextures.get(mTextures.find(id));
+    return texture ? texture->memoryUsage() : 0;
+}
+
+TextureRef ResourceManager::getTexture(ResourceId id)
+{
+    auto handle = mTextures.find(id);
+    if(handle.isValid())
+    {
+        return {&mTextures, handle};
+    }
+
+    // Unloaded, load it again
+    if(auto source = mTextureSources.find(id))
+    {
+        return addTextureAsync(id.name(), source->path, source->type);
+    }
+
+    return {};
+}
+
+TextureRef ResourceManager::getTextureById(GLuint id)
+{
+    if(!id)
+        return {};
+
+    ResourceId found;
+    mTextures.forEach([id, &found](ResourceId textureId, const Texture& texture){
+        if (texture.id() == id)
+            found = textureId;
+    });
+
+    return found.isValid() ? TextureRef{&mTextures, mTextures.find(found)} : TextureRef{};
+}
+
+void ResourceManager::pinTexture(ResourceId id)
+{
+    mTextures.setPinned(mTextures.find(id));
 }
 
-std::shared_ptr<MeshData> ResourceManager::addMesh(const std::string& name, const std::string& path, GLenum renderType)
+MeshRef ResourceManager::addMesh(const std::string& name, const std::string& path, GLenum renderType)
 {
-    if(mMeshes.find(name) != mMeshes.end())
+    auto handle = mMeshes.find(name);
+    if(handle.isValid())
     {
-        return mMeshes[name];
+        return {&mMeshes, handle};
     }
 
     if(!mIsInitialized)
@@ -94,183 +175,295 @@ std::shared_ptr<MeshData> ResourceManager::addMesh(const std::string& name, cons
         mIsInitialized = true;
     }
 
-    if(QString::fromStdString(path).contains(".obj"))
+    auto loadedMesh = readMesh(name, path, renderType, importSettings(name, 0));
+    if (!loadedMesh)
+        return {};
+
+    mMeshSources[ResourceId::intern(name)] = {path, renderType};
+    return {&mMeshes, uploadMesh(*loadedMesh)};
+}
+
+MeshRef ResourceManager::addMeshAsync(const std::string &name, const std::string &path, GLenum renderType)
+{
+    auto handle = mMeshes.find(name);
+    if(handle.isValid())
     {
-        auto verticesIndicesPair = readObjFile(path);
-        if(!verticesIndicesPair.first.size()) return nullptr;
-        auto mesh = initializeMeshData(name, renderType, verticesIndicesPair);
-        auto [LOD1, LOD2] = initializeLODs(name, path, renderType);
-        setupLODs(mesh, LOD1, LOD2);
-        return mesh;
+        return {&mMeshes, handle};
     }
-    else
-    {
-        auto verticesIndicesPair = readTxtFile(path);
-        if(!verticesIndicesPair.first.size()) return nullptr;
-        auto mesh = initializeMeshData(name, renderType, verticesIndicesPair);
-        setupLODs(mesh);
-        return mesh;
 
+    if(!mIsInitialized)
+    {
+        initializeOpenGLFunctions();
+        mIsInitialized = true;
     }
 
-    return nullptr;
+    auto mesh = std::make_shared<MeshData>(placeholderMesh());
+    mesh->mName = name;
+    mMeshSources[ResourceId::intern(name)] = {path, renderType};
+    handle = mMeshes.add(name, mesh);
+
+    // The settings are copied so they can be changed while the mesh loads.
+    // The loading threads are already busy with other meshes, so don't split the parse too.
+    submitLoad(name, [this, name, path, renderType, settings = importSettings(name, 1)]() -> std::function<void()> {
+        auto loadedMesh = readMesh(name, path, renderType, settings);
+        return [this, name, loadedMesh](){
+            if (loadedMesh)
+            {
+                uploadMesh(*loadedMesh);
+            }
+            else
+            {
+                // Only the placeholder cube's buffers, nothing to free
+                mMeshes.remove(mMeshes.find(name));
+                mMeshSources.erase(name);
+            }
+        };
+    });
+
+    return {&mMeshes, handle};
 }
 
-std::pair<std::shared_ptr<MeshData>, std::shared_ptr<MeshData>> ResourceManager::initializeLODs(const std::string& name, const std::string& path, GLenum renderType)
+void ResourceManager::pinMesh(ResourceId id)
 {
-    auto split = QString::fromStdString(path).split(".");
-    auto firstSplit = split[0].toStdString();
+    mMeshes.setPinned(mMeshes.find(id));
+}
 
-    std::shared_ptr<MeshData> LOD1{nullptr};
-    std::shared_ptr<MeshData> LOD2{nullptr};
+std::shared_ptr<ResourceManager::LoadedMesh> ResourceManager::readMesh(const std::string &name, const std::string &path, GLenum renderType, const MeshImportSettings& settings)
+{
+    auto loadedMesh = std::make_shared<LoadedMesh>();
+    loadedMesh->name = name;
+    loadedMesh->renderType = renderType;
 
-    // LOD1
-    auto LOD1Name = name + "_L01.obj";
-    auto verticesIndicesPair = readObjFile(LOD1Name);
-    if(verticesIndicesPair.first.size())
+    const auto cookedPath = gsl::assetFilePath + "Meshes/" + path + ".cooked";
+    const auto key = cookedMeshKey(name, path, renderType, settings);
+    if (settings.cook)
     {
-        LOD1 = initializeMeshData(LOD1Name, renderType, verticesIndicesPair);
-
-        // LOD2
-        auto LOD2Name = name + "_L02.obj";
-        verticesIndicesPair = readObjFile(LOD2Name);
-        if(verticesIndicesPair.first.size())
+        auto cooked = std::make_unique<CookedMesh>();
+        if (cooked->open(cookedPath, key))
         {
-            LOD2 = initializeMeshData(LOD2Name, renderType, verticesIndicesPair);
+            loadedMesh->renderType = cooked->renderType();
+            loadedMesh->bounds = cooked->bounds();
+            loadedMesh->cooked = std::move(cooked);
+            return loadedMesh;
         }
     }
 
-    return {LOD1, LOD2};
+    auto& levels = loadedMesh->levels;
+    if(QString::fromStdString(path).contains(".obj"))
+    {
+        levels.push_back(readObjFile(path, true, settings.parseThreads));
+        if(!levels.front().first.size()) return nullptr;
+        optimizeMesh(name, renderType, levels.front(), settings);
+        readLODs(name, renderType, levels, settings);
+        if (levels.size() == 1 && settings.autoGenerateLODs)
+            generateLODs(name, renderType, levels, settings);
+    }
+    else
+    {
+        levels.push_back(readTxtFile(path));
+        if(!levels.front().first.size()) return nullptr;
+    }
+
+    loadedMesh->bounds = CalculateBounds(levels.front().first);
+    if (settings.cook && !CookedMesh::write(cookedPath, key, renderType, loadedMesh->bounds, levels))
+        qDebug() << "ResourceManager: Failed to write cooked mesh" << QString::fromStdString(cookedPath);
+
+    return loadedMesh;
 }
 
-void ResourceManager::setupLODs(std::shared_ptr<MeshData> baseMeshData, std::shared_ptr<MeshData> LOD1, std::shared_ptr<MeshData> LOD2)
+ResourceHandle ResourceManager::uploadMesh(const LoadedMesh &loadedMesh)
 {
-    if(LOD1)
-    {
-        baseMeshData->mVAOs[1]              = LOD1->mVAOs[0];
-        baseMeshData->mVerticesCounts[1]    = LOD1->mVerticesCounts[0];
-        baseMeshData->mIndicesCounts[1]     = LOD1->mIndicesCounts[0];
+    MeshData meshData{loadedMesh.name, loadedMesh.renderType};
+    meshData.bounds = loadedMesh.bounds;
 
-        if(LOD2)
+    if (loadedMesh.cooked)
+    {
+        for (unsigned int level{0}; level < loadedMesh.cooked->LODCount(); ++level)
         {
-            baseMeshData->mVAOs[2]              = LOD2->mVAOs[0];
-            baseMeshData->mVerticesCounts[2]    = LOD2->mVerticesCounts[0];
-            baseMeshData->mIndicesCounts[2]     = LOD2->mIndicesCounts[0];
-            mMeshes.erase(LOD2->mName);
+            const auto& lod = loadedMesh.cooked->lod(level);
+            const auto allocation = uploadManager().uploadMesh(lod.vertices, lod.vertexCount, lod.indices, lod.indexCount);
+            meshData.setLOD(level, allocation.vao, lod.vertexCount, lod.indexCount, allocation.baseVertex, allocation.firstIndex);
         }
-        else
+    }
+    else
+    {
+        for (unsigned int level{0}; level < loadedMesh.levels.size(); ++level)
         {
-            baseMeshData->mVAOs[2]              = LOD1->mVAOs[0];
-            baseMeshData->mVerticesCounts[2]    = LOD1->mVerticesCounts[0];
-            baseMeshData->mIndicesCounts[2]     = LOD1->mIndicesCounts[0];
+            const auto& data = loadedMesh.levels[level];
+            const auto vertexCount = static_cast<unsigned>(data.first.size());
+            const auto indexCount = static_cast<unsigned>(data.second.size());
+            const auto allocation = uploadManager().uploadMesh(data.first.data(), vertexCount, data.second.data(), indexCount);
+            meshData.setLOD(level, allocation.vao, vertexCount, indexCount, allocation.baseVertex, allocation.firstIndex);
         }
-
-        mMeshes.erase(LOD1->mName);
     }
-    else
+
+    applyLODScreenSizes(meshData);
+
+    // Replace the placeholder in place, so everyone holding on to it gets the real mesh
+    auto handle = mMeshes.find(loadedMesh.name);
+    if (auto mesh = mMeshes.getShared(handle))
     {
-        baseMeshData->mVAOs[1]              = baseMeshData->mVAOs[0];
-        baseMeshData->mVerticesCounts[1]    = baseMeshData->mVerticesCounts[0];
-        baseMeshData->mIndicesCounts[1]     = baseMeshData->mIndicesCounts[0];
-        baseMeshData->mVAOs[2]              = baseMeshData->mVAOs[0];
-        baseMeshData->mVerticesCounts[2]    = baseMeshData->mVerticesCounts[0];
-        baseMeshData->mIndicesCounts[2]     = baseMeshData->mIndicesCounts[0];
+        *mesh = std::move(meshData);
+        if (meshLoaded)
+            meshLoaded(mesh);
+        return handle;
     }
+
+    return mMeshes.add(loadedMesh.name, std::make_shared<MeshData>(std::move(meshData)));
 }
 
-void ResourceManager::setupLOD(std::shared_ptr<MeshData> baseMesh, std::shared_ptr<MeshData> LOD, unsigned int level)
+ResourceManager::MeshImportSettings ResourceManager::importSettings(const std::string &name, unsigned int parseThreads) const
 {
-    const auto findMesh = [](std::map<std::string, std::shared_ptr<MeshData>>& map, std::shared_ptr<MeshData> mesh){
-        for (auto it = map.begin(); it != map.end(); ++it)
-            if (it->second == mesh)
-                return it;
+    MeshImportSettings settings;
+    settings.cook = cookMeshes;
+    settings.optimize = optimizeImportedMeshes;
+    settings.autoGenerateLODs = autoGenerateLODs;
+    settings.minTrianglesForLODs = minTrianglesForLODs;
+    auto ratioIt = mLODRatios.find(name);
+    settings.LODRatios = (ratioIt != mLODRatios.end()) ? ratioIt->second : mDefaultLODRatios;
+    settings.parseThreads = parseThreads;
+    return settings;
+}
 
-        return map.end();
-    };
+CookedMesh::Key ResourceManager::cookedMeshKey(const std::string &name, const std::string &path, GLenum renderType, const MeshImportSettings& settings)
+{
+    const QFileInfo source{QString::fromStdString(gsl::assetFilePath + "Meshes/" + path)};
+
+    CookedMesh::Key key;
+    key.sourceModified = source.lastModified().toMSecsSinceEpoch();
+    key.sourceSize = source.size();
+
+    // Everything else that changes the result of an import
+    auto& hash = key.settingsHash;
+    hash = CookedMesh::hash(&renderType, sizeof(renderType));
+    hash = CookedMesh::hash(&settings.optimize, sizeof(settings.optimize), hash);
+    hash = CookedMesh::hash(&settings.autoGenerateLODs, sizeof(settings.autoGenerateLODs), hash);
+    hash = CookedMesh::hash(&settings.minTrianglesForLODs, sizeof(settings.minTrianglesForLODs), hash);
+    hash = CookedMesh::hash(settings.LODRatios.data(), settings.LODRatios.size() * sizeof(float), hash);
 
-    if (baseMesh && LOD)
+    for (unsigned int level{1}; ; ++level)
     {
-        if (level == 0)
-        {
-            // If adding a lod to the base lod, just swap the meshes.
+        const QFileInfo LODFile{QString::fromStdString(gsl::assetFilePath + "Meshes/" + LODFileName(name, level))};
+        if (!LODFile.exists())
+            break;
+        const std::int64_t stamp[2] = {LODFile.lastModified().toMSecsSinceEpoch(), LODFile.size()};
+        hash = CookedMesh::hash(stamp, sizeof(stamp), hash);
+    }
 
-            auto first = findMesh(mMeshes, baseMesh);
-            auto second = findMesh(mMeshes, LOD);
+    return key;
+}
 
-            if (first == mMeshes.end() || second == mMeshes.end())
-                return;
+std::string ResourceManager::LODFileName(const std::string &name, unsigned int level)
+{
+    return QString{"%1_L%2.obj"}.arg(QString::fromStdString(name)).arg(level, 2, 10, QChar{'0'}).toStdString();
+}
 
-            first->second = std::move(second->second);
-            mMeshes.erase(second);
-        }
-        else if (0 < level && level < 3)
-        {
-            baseMesh->mVAOs[level]              = LOD->mVAOs[0];
-            baseMesh->mVerticesCounts[level]    = LOD->mVerticesCounts[0];
-            baseMesh->mIndicesCounts[level]     = LOD->mIndicesCounts[0];
+void ResourceManager::readLODs(const std::string& name, GLenum renderType, std::vector<MeshBuffers>& levels, const MeshImportSettings& settings)
+{
+    for (unsigned int level{1}; ; ++level)
+    {
+        auto LODName = LODFileName(name, level);
+        if (!QFileInfo::exists(QString::fromStdString(gsl::assetFilePath + "Meshes/" + LODName)))
+            break;
 
-            if (level == 1 && baseMesh->mVerticesCounts[1] < baseMesh->mVerticesCounts[2])
-            {
-                baseMesh->mVAOs[2]              = LOD->mVAOs[0];
-                baseMesh->mVerticesCounts[2]    = LOD->mVerticesCounts[0];
-                baseMesh->mIndicesCounts[2]     = LOD->mIndicesCounts[0];
-            }
+        auto verticesIndicesPair = readObjFile(LODName, true, settings.parseThreads);
+        if(!verticesIndicesPair.first.size())
+            break;
+        optimizeMesh(LODName, renderType, verticesIndicesPair, settings);
 
-            auto lodIt = findMesh(mMeshes, LOD);
-            if (lodIt != mMeshes.end())
-                mMeshes.erase(lodIt);
-        }
+        levels.push_back(std::move(verticesIndicesPair));
     }
 }
 
-std::shared_ptr<MeshData> ResourceManager::initializeMeshData(const std::string& name, GLenum renderType, std::pair<std::vector<Vertex>, std::vector<GLuint>> data)
+void ResourceManager::generateLODs(const std::string &name, GLenum renderType, std::vector<MeshBuffers>& levels, const MeshImportSettings& settings)
 {
-    MeshData meshData;
+    const auto& baseMesh = levels.front();
 
-    meshData.mName = name;
-    meshData.mRenderType = renderType;
+    // Only triangle lists can be simplified, and hand made LOD files shouldn't get LODs of their own
+    if (renderType != GL_TRIANGLES || baseMesh.second.size() / 3 < settings.minTrianglesForLODs
+        || QString::fromStdString(name).contains(QRegularExpression{"_L\\d+$"}))
+        return;
 
-    //Vertex Array Object - VAO
-    glGenVertexArrays( 1, &meshData.mVAOs[0] );
-    glBindVertexArray(meshData.mVAOs[0]);
+    const auto& ratios = settings.LODRatios;
+    for (unsigned int i{0}; i < ratios.size(); ++i)
+    {
+        auto verticesIndicesPair = MeshSimplifier::simplify(levels.front(), ratios[i]);
+        if (verticesIndicesPair.second.empty())
+            break;
 
-    //Vertex Buffer Object to hold vertices - VBO
-    GLuint vbo;
-    glGenBuffers( 1, &vbo );
-    glBindBuffer( GL_ARRAY_BUFFER, vbo );
+        optimizeMesh(QString{"%1_L%2"}.arg(QString::fromStdString(name)).arg(i + 1, 2, 10, QChar{'0'}).toStdString(), renderType, verticesIndicesPair, settings);
+        levels.push_back(std::move(verticesIndicesPair));
+    }
+}
 
-    glBufferData( GL_ARRAY_BUFFER, static_cast<GLsizei>(data.first.size() * sizeof(Vertex)), data.first.data(), GL_STATIC_DRAW );
+void ResourceManager::setupLOD(const MeshRef& baseMesh, const MeshRef& LOD, unsigned int level)
+{
+    if (!baseMesh || !LOD || baseMesh == LOD)
+        return;
 
-    // 1rst attribute buffer : vertices
-    glVertexAttribPointer(0, 3, GL_FLOAT,GL_FALSE, sizeof(Vertex), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
+    const auto baseName = baseMesh->mName;
+    if (level == 0)
+    {
+        // If adding a lod to the base lod, just swap the meshes.
+        auto LODMesh = LOD.shared();
+        LODMesh->mName = baseName;
+        if (auto oldMesh = mMeshes.getShared(baseMesh.handle()))
+            mUnloadedMeshes.push_back(std::move(oldMesh));
+        mMeshes.add(baseName, std::move(LODMesh));
+    }
+    else
+    {
+        baseMesh->setLOD(level, LOD->mVAOs[0], LOD->mVerticesCounts[0], LOD->mIndicesCounts[0], LOD->mBaseVertices[0], LOD->mFirstIndices[0]);
+    }
 
-    // 2nd attribute buffer : colors
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,  sizeof(Vertex),  (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
+    // The LOD's buffers belong to the base mesh now
+    mMeshSources.erase(mMeshes.id(LOD.handle()));
+    mMeshes.remove(LOD.handle());
 
-    // 3rd attribute buffer : uvs
-    glVertexAttribPointer(2, 2,  GL_FLOAT, GL_FALSE, sizeof( Vertex ), (GLvoid*)(6 * sizeof(GLfloat )));
-    glEnableVertexAttribArray(2);
+    mMeshSources.erase(baseName);
+    mMeshes.setPinned(baseMesh.handle());
 
-    meshData.mVerticesCounts[0] = static_cast<unsigned>(data.first.size());
-    meshData.mIndicesCounts[0] = static_cast<unsigned>(data.second.size());
-    meshData.bounds = CalculateBounds(data.first);
+    if (auto mesh = getMesh(baseName))
+        applyLODScreenSizes(*mesh);
+}
 
-    if(meshData.mIndicesCounts[0])
-    {
-        //Second buffer - holds the indices (Element Array Buffer - EAB):
-        GLuint eab;
-        glGenBuffers(1, &eab);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eab);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshData.mIndicesCounts[0] * sizeof(GLuint), data.second.data(), GL_STATIC_DRAW);
-    }
+void ResourceManager::setLODScreenSizes(const std::string &name, const std::vector<float> &sizes)
+{
+    mLODScreenSizes[name] = sizes;
 
-    auto mesh = std::make_shared<MeshData>(meshData);
-    mMeshes[name] = mesh;
-    glBindVertexArray(0);
+    // Placeholders only have one level, the sizes are applied again when the real mesh is uploaded
+    if (auto mesh = getMesh(name))
+        applyLODScreenSizes(*mesh);
+}
 
-    return mesh;
+void ResourceManager::applyLODScreenSizes(MeshData &mesh) const
+{
+    auto sizesIt = mLODScreenSizes.find(mesh.mName);
+    if (sizesIt == mLODScreenSizes.end())
+        return;
+
+    const auto& sizes = sizesIt->second;
+    for (unsigned int i{0}; i < sizes.size() && i + 1 < mesh.LODCount(); ++i)
+        mesh.mLODScreenSizes[i + 1] = sizes[i];
+}
+
+void ResourceManager::setLODRatios(const std::string &name, const std::vector<float> &ratios)
+{
+    if (mMeshes.find(name).isValid())
+        qDebug() << "ResourceManager: LOD ratios for" << QString::fromStdString(name) << "set after the mesh was added, they won't be used";
+
+    mLODRatios[name] = ratios;
+}
+
+void ResourceManager::optimizeMesh(const std::string &name, GLenum renderType, std::pair<std::vector<Vertex>, std::vector<GLuint>> &data,
+                                   const MeshImportSettings& settings)
+{
+    if (!settings.optimize || renderType != GL_TRIANGLES || data.second.empty())
+        return;
+
+    const auto stats = MeshOptimizer::optimize(data);
+    qDebug() << "ResourceManager:" << QString::fromStdString(name) << "vertices" << stats.verticesBefore << "->" << stats.verticesAfter
+             << ", ACMR" << stats.ACMRBefore << "->" << stats.ACMRAfter;
 }
 
 MeshData::Bounds ResourceManager::CalculateBounds(const std::vector<Vertex> &vertices)
@@ -298,38 +491,78 @@ MeshData::Bounds ResourceManager::CalculateBounds(const std::vector<Vertex> &ver
     return b;
 }
 
-std::shared_ptr<MeshData> ResourceManager::getMesh(const std::string& name)
+MeshRef ResourceManager::getMesh(ResourceId id)
 {
-    if(mMeshes.find(name) != mMeshes.end())
+    auto handle = mMeshes.find(id);
+    if(handle.isValid())
+    {
+        return {&mMeshes, handle};
+    }
+
+    // Unloaded, load it again in the background
+    if(auto source = mMeshSources.find(id))
     {
-        return mMeshes[name];
+        return addMeshAsync(id.name(), source->path, source->type);
     }
-    qDebug() << "Error ResourceManager: No mesh named " << QString::fromStdString(name) << " could be found";
-    return nullptr;
+
+    qDebug() << "Error ResourceManager: No mesh named " << QString::fromStdString(id.name()) << "(" << id.value() << ") could be found";
+    return {};
+}
+
+std::shared_ptr<wave_t> ResourceManager::makeWave()
+{
+    // WavFileHandler allocates the buffer with new[]
+    return std::shared_ptr<wave_t>(new wave_t(), [](wave_t* wave){
+        delete[] wave->buffer;
+        delete wave;
+    });
 }
 
 void ResourceManager::loadWav(const std::string& name, const std::string& path)
 {
-    auto waveData = new wave_t();
-    if (!WavFileHandler::loadWave(path, waveData))
+    auto waveData = makeWave();
+    if (!WavFileHandler::loadWave(path, waveData.get()))
     {
         qDebug() << "Error ResourceManager: Failed loading wave file " << QString::fromStdString(name) << "!";
         return;
     }
 
-    std::ostringstream i2s;
-    i2s << waveData->dataSize;
-    mWavFiles[name] = waveData;
+    mWavSources[ResourceId::intern(name)] = {path, 0};
+    mWavFiles.add(name, std::move(waveData));
 }
 
-wave_t* ResourceManager::getWav(const std::string& name)
+void ResourceManager::loadWavAsync(const std::string &name, const std::string &path)
 {
-    if(mWavFiles.find(name) != mWavFiles.end())
+    mWavSources[ResourceId::intern(name)] = {path, 0};
+    submitLoad(name, [this, name, path]() -> std::function<void()> {
+        auto waveData = makeWave();
+        if (!WavFileHandler::loadWave(path, waveData.get()))
+        {
+            qDebug() << "Error ResourceManager: Failed loading wave file " << QString::fromStdString(name) << "!";
+            return {};
+        }
+        return [this, name, waveData](){
+            if (!mWavFiles.find(name).isValid())
+                mWavFiles.add(name, waveData);
+        };
+    });
+}
+
+wave_t* ResourceManager::getWav(ResourceId id)
+{
+    auto handle = mWavFiles.find(id);
+    if(!handle.isValid())
     {
-        return mWavFiles[name];
+        // Unloaded, load it again
+        auto source = mWavSources.find(id);
+        if(!source || isLoading(id))
+            return nullptr;
+
+        loadWav(id.name(), source->path);
+        handle = mWavFiles.find(id);
     }
 
-    return nullptr;
+    return mWavFiles.get(handle);
 }
 
 int ResourceManager::getSourceBuffer(const std::string& name)
@@ -342,15 +575,64 @@ int ResourceManager::getSourceBuffer(const std::string& name)
     return -1;
 }
 
-std::vector<std::string> ResourceManager::getAllMeshNames()
+void ResourceManager::unloadUnused()
 {
-    std::vector<std::string> returnStrings;
+    // Anything still loading would just be added back when it's done
+    auto notLoading = [this](ResourceId id, const auto&){ return !isLoading(id); };
+
+    auto meshes = mMeshes.collect(notLoading);
+    auto textures = mTextures.collect(notLoading);
+    const auto wavCount = mWavFiles.collect(notLoading).size();
 
-    for(auto& mesh : mMeshes)
+    qDebug() << "ResourceManager: Unloading" << meshes.size() << "meshes," << textures.size() << "textures and" << wavCount << "sounds";
+
+    mUnloadedMeshes.insert(mUnloadedMeshes.end(), std::make_move_iterator(meshes.begin()), std::make_move_iterator(meshes.end()));
+    mUnloadedTextures.insert(mUnloadedTextures.end(), std::make_move_iterator(textures.begin()), std::make_move_iterator(textures.end()));
+}
+
+void ResourceManager::freeUnloaded()
+{
+    for (auto& mesh : mUnloadedMeshes)
     {
-        returnStrings.push_back(mesh.first);
+        for (unsigned int level{0}; level < mesh->LODCount(); ++level)
+        {
+            const auto vao = mesh->mVAOs[level];
+            const auto baseVertex = mesh->mBaseVertices[level];
+
+            // Placeholders share the placeholder cube's buffers
+            if (!vao || (vao == mPlaceholderMesh.mVAOs[0] && baseVertex == mPlaceholderMesh.mBaseVertices[0]))
+                continue;
+
+            // Missing LODs repeat the level before them
+            bool shared = false;
+            for (unsigned int previous{0}; previous < level && !shared; ++previous)
+                shared = mesh->mVAOs[previous] == vao && mesh->mBaseVertices[previous] == baseVertex;
+            if (shared)
+                continue;
+
+            uploadManager().releaseMesh({vao, baseVertex, mesh->mVerticesCounts[level], mesh->mFirstIndices[level], mesh->mIndicesCounts[level]});
+        }
     }
+    mUnloadedMeshes.clear();
+
+    for (auto& texture : mUnloadedTextures)
+        texture->destroy();
+    mUnloadedTextures.clear();
+}
+
+std::vector<std::string> ResourceManager::getAllMeshNames()
+{
+    std::vector<std::string> returnStrings;
+
+    mMeshes.forEach([&returnStrings](ResourceId id, const MeshData&){ returnStrings.push_back(id.name()); });
+
+    // Unloaded ones are loaded again when they're used
+    mMeshSources.forEach([this, &returnStrings](ResourceId id, const ResourceSource&){
+        if(!mMeshes.find(id).isValid())
+            returnStrings.push_back(id.name());
+    });
 
+    std::sort(returnStrings.begin(), returnStrings.end());
     return returnStrings;
 }
 
@@ -358,12 +640,12 @@ std::vector<std::string> ResourceManager::getAllShaderNames()
 {
     std::vector<std::string> returnStrings;
 
-    for(auto& shader : mShaders)
-    {
-        if(shader.second->mRenderingType == ShaderType::Forward || shader.second->mRenderingType == ShaderType::Deferred)
-            returnStrings.push_back(shader.first);
-    }
+    mShaders.forEach([&returnStrings](ResourceId, const std::shared_ptr<Shader>& shader){
+        if(shader->mRenderingType == ShaderType::Forward || shader->mRenderingType == ShaderType::Deferred)
+            returnStrings.push_back(shader->mName);
+    });
 
+    std::sort(returnStrings.begin(), returnStrings.end());
     return returnStrings;
 }
 
@@ -371,11 +653,14 @@ std::vector<std::string> ResourceManager::getAllTextureNames()
 {
     std::vector<std::string> returnStrings;
 
-    for(auto& texture : mTextures)
-    {
-        returnStrings.push_back(texture.first);
-    }
+    mTextures.forEach([&returnStrings](ResourceId id, const Texture&){ returnStrings.push_back(id.name()); });
+
+    mTextureSources.forEach([this, &returnStrings](ResourceId id, const ResourceSource&){
+        if(!mTextures.find(id).isValid())
+            returnStrings.push_back(id.name());
+    });
 
+    std::sort(returnStrings.begin(), returnStrings.end());
     return returnStrings;
 }
 
@@ -383,15 +668,23 @@ std::vector<std::string> ResourceManager::getAllWavFileNames()
 {
     std::vector<std::string> returnStrings;
 
-    for(auto& wav : mWavFiles)
-    {
-        returnStrings.push_back(wav.first);
-    }
+    mWavFiles.forEach([&returnStrings](ResourceId id, const wave_t&){ returnStrings.push_back(id.name()); });
+
+    mWavSources.forEach([this, &returnStrings](ResourceId id, const ResourceSource&){
+        if(!mWavFiles.find(id).isValid())
+            returnStrings.push_back(id.name());
+    });
 
+    std::sort(returnStrings.begin(), returnStrings.end());
     return returnStrings;
 }
 
-std::pair<std::vector<Vertex>, std::vector<GLuint>> ResourceManager::readObjFile(std::string filename, bool relative)
+std::pair<std::vector<Vertex>, std::vector<GLuint>> ResourceManager::readObjFile(std::string filename, bool relative, unsigned int threadCount)
+{
+    return ObjParser::parseFile(relative ? gsl::assetFilePath + "Meshes/" + filename : filename, threadCount);
+}
+
+std::pair<std::vector<Vertex>, std::vector<GLuint>> ResourceManager::readObjFileLegacy(std::string filename, bool relative)
 {
     std::vector<Vertex> mVertices;
     std::vector<GLuint> mIndices;
@@ -571,7 +864,7 @@ std::pair<std::vector<Vertex>, std::vector<GLuint>> ResourceManager::readObjFile
     //beeing a nice boy and closing the file after use
     fileIn.close();
 
-    return {mVertices, mIndices};
+    return {std::move(mVertices), std::move(mIndices)};
 }
 
 std::pair<std::vector<Vertex>, std::vector<GLuint>> ResourceManager::readTxtFile(std::string filename)
@@ -600,7 +893,138 @@ std::pair<std::vector<Vertex>, std::vector<GLuint>> ResourceManager::readTxtFile
         qDebug() << "Error ResourceManager: Could not open file for reading: " << QString::fromStdString(filename);
     }
 
-    return {mVertices, mIndices};
+    return {std::move(mVertices), std::move(mIndices)};
+}
+
+void ResourceManager::benchmarkObjParsers(unsigned int triangleCount)
+{
+    QTemporaryDir folder;
+    if (!folder.isValid())
+    {
+        qDebug() << "Error ResourceManager: Could not create a folder for the obj benchmark";
+        return;
+    }
+    const auto path = folder.filePath("benchmark.obj").toStdString();
+
+    // A wavy grid with positions, uvs and a shared normal
+    const auto side = static_cast<unsigned int>(std::sqrt(triangleCount / 2.0));
+    {
+        std::ofstream file{path};
+        for (unsigned int y{0}; y <= side; ++y)
+            for (unsigned int x{0}; x <= side; ++x)
+                file << "v " << x * 0.01f << " " << std::sin(x * 0.1f) * 0.5f << " " << y * 0.01f << "\n";
+        for (unsigned int y{0}; y <= side; ++y)
+            for (unsigned int x{0}; x <= side; ++x)
+                file << "vt " << x / static_cast<float>(side) << " " << y / static_cast<float>(side) << "\n";
+        file << "vn 0 1 0\n";
+        for (unsigned int y{0}; y < side; ++y)
+        {
+            for (unsigned int x{0}; x < side; ++x)
+            {
+                const auto a = y * (side + 1) + x + 1, b = a + 1, c = a + side + 1, d = c + 1;
+                file << "f " << a << "/" << a << "/1 " << b << "/" << b << "/1 " << d << "/" << d << "/1\n";
+                file << "f " << a << "/" << a << "/1 " << d << "/" << d << "/1 " << c << "/" << c << "/1\n";
+            }
+        }
+    }
+
+    const auto time = [](auto func){
+        const auto start = std::chrono::high_resolution_clock::now();
+        const auto triangles = func().first.size() / 3;
+        const auto end = std::chrono::high_resolution_clock::now();
+        return std::make_pair(triangles, std::chrono::duration<double, std::milli>(end - start).count());
+    };
+
+    const auto legacy = time([&](){ return readObjFileLegacy(path, false); });
+    const auto singleThreaded = time([&](){ return ObjParser::parseFile(path, 1); });
+    const auto multiThreaded = time([&](){ return ObjParser::parseFile(path); });
+
+    qDebug() << "Obj benchmark," << legacy.first << "triangles:";
+    qDebug() << "    stringstream reader:" << legacy.second << "ms";
+    qDebug() << "    ObjParser, 1 thread:" << singleThreaded.second << "ms";
+    qDebug() << "    ObjParser," << std::thread::hardware_concurrency() << "threads:" << multiThreaded.second << "ms";
+}
+
+void ResourceManager::submitLoad(const std::string &name, std::function<std::function<void()>()> job)
+{
+    if (!mLoadingPool)
+        mLoadingPool = std::make_unique<ThreadPool>();
+
+    mPendingLoads.push_back({ResourceId{name}, name, mLoadingPool->submit(std::move(job))});
+}
+
+void ResourceManager::processUploads(double budgetMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    freeUnloaded();
+
+    for (auto it = mPendingLoads.begin(); it != mPendingLoads.end();)
+    {
+        // Always do at least one so loading can't stall on a tiny budget
+        if (it != mPendingLoads.begin() && timer.nsecsElapsed() / 1000000.0 >= budgetMs)
+            break;
+
+        if (it->result.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+        {
+            ++it;
+            continue;
+        }
+
+        try
+        {
+            if (auto upload = it->result.get())
+                upload();
+        }
+        catch (const std::exception& e)
+        {
+            qDebug() << "Error ResourceManager: Loading" << QString::fromStdString(it->name) << "failed:" << e.what();
+        }
+        it = mPendingLoads.erase(it);
+    }
+
+    // Issue the copies of everything uploaded since last frame, both from here and from the synchronous loaders
+    uploadManager().flush();
+}
+
+UploadManager &ResourceManager::uploadManager()
+{
+    if (!mUploadManager)
+        mUploadManager = std::make_unique<UploadManager>();
+    return *mUploadManager;
+}
+
+bool ResourceManager::isLoading(ResourceId id) const
+{
+    return std::any_of(mPendingLoads.begin(), mPendingLoads.end(), [id](const PendingLoad& load){ return load.id == id; });
+}
+
+const MeshData &ResourceManager::placeholderMesh()
+{
+    if (!mPlaceholderMesh.mVAOs[0])
+    {
+        // Unit cube
+        std::vector<Vertex> vertices;
+        for (unsigned int i{0}; i < 8; ++i)
+        {
+            const gsl::vec3 corner{(i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f};
+            vertices.emplace_back(corner, corner.normalized(), gsl::vec2{0.f, 0.f});
+        }
+        const std::vector<GLuint> indices{
+            0, 2, 1, 1, 2, 3,   4, 5, 6, 5, 7, 6,
+            0, 1, 4, 1, 5, 4,   2, 6, 3, 3, 6, 7,
+            0, 4, 2, 2, 4, 6,   1, 3, 5, 3, 7, 5
+        };
+
+        const auto vertexCount = static_cast<unsigned>(vertices.size());
+        const auto indexCount = static_cast<unsigned>(indices.size());
+        const auto allocation = uploadManager().uploadMesh(vertices.data(), vertexCount, indices.data(), indexCount);
+        mPlaceholderMesh.mName = "placeholder";
+        mPlaceholderMesh.setLOD(0, allocation.vao, vertexCount, indexCount, allocation.baseVertex, allocation.firstIndex);
+        mPlaceholderMesh.bounds = CalculateBounds(vertices);
+    }
+    return mPlaceholderMesh;
 }
 
 ResourceManager* ResourceManager::inst{nullptr};
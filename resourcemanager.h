@@ -4,12 +4,15 @@
 #include <map>
 #include <string>
 #include <memory>
+#include <functional>
+#include <future>
 
 #include "texture.h"
 
 #include "vertex.h"
 
 #include "meshdata.h"
+#include "cookedmesh.h"
 
 #ifdef _WIN32
 #include <al.h>
@@ -20,10 +23,19 @@
 #endif
 
 #include "wavfilehandler.h"
+#include "threadpool.h"
+#include "uploadmanager.h"
+#include "resourcepool.h"
+#include "resourceid.h"
+#include "resourcemap.h"
 
 class SoundSource;
 
 /**
+ * Meshes, textures and sounds are kept in pools and handed out as counted references (MeshRef, TextureRef).
+ * Resources nobody refers to are unloaded by unloadUnused(), and loaded again from the file they came from
+ * the next time they're asked for. Lookups take a ResourceId, so string literals are hashed at compile time
+ * and don't allocate.
  * @brief The resource manager is responsible for handling all resources, making only a single copy whenever possible to keep memory usage low.
  */
 class ResourceManager : protected QOpenGLFunctions_4_1_Core
@@ -48,38 +60,120 @@ public:
     /**
      * @brief Helper function that iteratively goes through all folders in gsl::assetFilePath and loads the files.
      *  NOTE: Does not include shaders. Only meshes, textures and sounds.
+     * @param async - Load the files in the background, see addMeshAsync.
      */
-    void LoadAssetFiles();
+    void LoadAssetFiles(bool async = true);
 
     // Shaders
 
     void addShader(const std::string& name, std::shared_ptr<Shader> shader);
-    std::shared_ptr<Shader> getShader(const std::string& name);
+    std::shared_ptr<Shader> getShader(ResourceId id);
 
     // Textures
 
     void addTexture(const std::string& name, const std::string& path, GLenum type = GL_TEXTURE_2D);
-    std::shared_ptr<Texture> getTexture(const std::string& name);
+    TextureRef getTexture(ResourceId id);
+    //! The texture with the given OpenGL id, used by materials loaded from JSON.
+    TextureRef getTextureById(GLuint id);
+    /**
+     * @brief Reads the texture on a loading thread. Returns a placeholder right away, which gets the image when it's uploaded.
+     */
+    TextureRef addTextureAsync(const std::string& name, const std::string& path, GLenum type = GL_TEXTURE_2D);
+    //! Keeps the texture loaded even if nothing refers to it.
+    void pinTexture(ResourceId id);
+    //! Bytes the texture uses on the GPU, 0 if it's missing or still loading.
+    std::size_t getTextureMemoryUsage(ResourceId id);
+
+    //! Mipmapping, compression and caching of textures added after this is changed.
+    TextureImage::Settings textureSettings;
 
     // Meshes
 
-    std::shared_ptr<MeshData> addMesh(const std::string& name, const std::string& path, GLenum renderType = GL_TRIANGLES);
-    std::shared_ptr<MeshData> getMesh(const std::string& name);
+    MeshRef addMesh(const std::string& name, const std::string& path, GLenum renderType = GL_TRIANGLES);
+    /**
+     * @brief Returns the mesh, and starts loading it again in the background if it has been unloaded.
+     */
+    MeshRef getMesh(ResourceId id);
+    /**
+     * @brief Reads, parses and cooks the mesh on a loading thread. Returns a placeholder cube right away,
+     * which is replaced in place when the mesh is uploaded in processUploads, so references to it get the real mesh.
+     */
+    MeshRef addMeshAsync(const std::string& name, const std::string& path, GLenum renderType = GL_TRIANGLES);
+    //! Keeps the mesh loaded even if nothing refers to it.
+    void pinMesh(ResourceId id);
+
+    //! Called on the render thread when an async mesh has replaced its placeholder.
+    std::function<void(const std::shared_ptr<MeshData>&)> meshLoaded;
 
     /**
      * @brief Adds the LOD meshdata to the baseMesh meshdata at the given level and removes the LOD mesh from the mesharray.
+     * The base mesh can't be loaded from a single file any more, so it's pinned.
      * @param baseMesh - The receiver of the LOD
      * @param LOD - The meshdata of the LOD
-     * @param level - At what level the LOD shall be added; 0, 1 or 2. Defaults to 1. (0 is the basemesh)
+     * @param level - At what level the LOD shall be added. Defaults to 1. (0 is the basemesh)
      */
-    void setupLOD(std::shared_ptr<MeshData> baseMesh, std::shared_ptr<MeshData> LOD, unsigned int level = 1);
+    void setupLOD(const MeshRef& baseMesh, const MeshRef& LOD, unsigned int level = 1);
+
+    /**
+     * @brief Sets the projected screen sizes the LODs of a mesh switches at. Can be called before the mesh is added,
+     * the sizes are kept by name and applied every time the mesh is uploaded or gets a new LOD.
+     * @param sizes - One size per LOD level, starting at LOD 1. Should be decreasing. Levels without a size keep the default.
+     */
+    void setLODScreenSizes(const std::string& name, const std::vector<float>& sizes);
+
+    /**
+     * @brief Sets the triangle ratios the generated LODs of a mesh are simplified to. Must be called before the mesh is added.
+     * @param ratios - One ratio per LOD level, starting at LOD 1. An empty list disables generation for the mesh.
+     */
+    void setLODRatios(const std::string& name, const std::vector<float>& ratios);
+
+    //! Weld and reorder .obj meshes for the vertex cache on import, see MeshOptimizer.
+    bool optimizeImportedMeshes{true};
+
+    //! Generate LODs for .obj meshes that doesn't have hand made ones.
+    bool autoGenerateLODs{true};
+    //! Meshes with less triangles than this doesn't get generated LODs.
+    unsigned int minTrianglesForLODs{200};
+
+    //! Load meshes from, and write them to, a binary .cooked file next to the source. See CookedMesh.
+    bool cookMeshes{true};
 
     // Sound
 
     void loadWav(const std::string& name, const std::string& path);
-    wave_t* getWav(const std::string& name);
+    void loadWavAsync(const std::string& name, const std::string& path);
+    //! Loads the wav again if it has been unloaded.
+    wave_t* getWav(ResourceId id);
     int getSourceBuffer(const std::string& name);
 
+    // Lifetime
+
+    /**
+     * @brief Unloads every mesh, texture and sound that isn't referred to or pinned. Call after changing scenes.
+     * The OpenGL objects are deleted in the next processUploads, when the context is current.
+     */
+    void unloadUnused();
+
+    // Async loading
+
+    /**
+     * @brief Uploads assets that has finished loading in the background. Must be called with the context current.
+     * @param budgetMs - stops when this much time has been spent, but always uploads at least one asset.
+     */
+    void processUploads(double budgetMs);
+    bool isLoading(ResourceId id) const;
+    unsigned int pendingLoadCount() const { return static_cast<unsigned int>(mPendingLoads.size()); }
+
+    /**
+     * @brief All mesh data lives in the upload manager's shared buffers. Staged data is copied over in processUploads.
+     */
+    UploadManager& uploadManager();
+
+    /**
+     * @brief Writes a temporary .obj with roughly triangleCount triangles and prints how long the old and new readers use on it.
+     */
+    void benchmarkObjParsers(unsigned int triangleCount = 1000000);
+
     // Helper functions for UI
 
     std::vector<std::string> getAllMeshNames();
@@ -91,28 +185,99 @@ private:
 
     /**
      * @brief Reads an obj file at the specified fileName. Relative means gsl::assetFilePath/Meshes if true, working directory if false
+     * @param threadCount - max number of threads the parse is split over, see ObjParser::parseFile.
      */
-    std::pair<std::vector<Vertex>, std::vector<GLuint>> readObjFile(std::string filename, bool relative = true);
+    std::pair<std::vector<Vertex>, std::vector<GLuint>> readObjFile(std::string filename, bool relative = true, unsigned int threadCount = 0);
+
+    /**
+     * @brief The old stringstream based obj reader. Only kept to compare against in benchmarkObjParsers.
+     */
+    std::pair<std::vector<Vertex>, std::vector<GLuint>> readObjFileLegacy(std::string filename, bool relative = true);
 
     /**
      * @brief Reads a txt file written like the Vertex << overload is setup. Can only be read by the Vertex >> overload.
      */
     std::pair<std::vector<Vertex>, std::vector<GLuint>> readTxtFile(std::string filename);
 
+    using MeshBuffers = std::pair<std::vector<Vertex>, std::vector<GLuint>>;
+
+    //! The import settings a mesh is loaded with, copied when the load starts so the loading threads never read the live ones.
+    struct MeshImportSettings
+    {
+        bool cook{true};
+        bool optimize{true};
+        bool autoGenerateLODs{true};
+        unsigned int minTrianglesForLODs{200};
+        std::vector<float> LODRatios;
+        //! Max number of threads each .obj is parsed with. 1 on the loading threads, 0 uses all hardware threads.
+        unsigned int parseThreads{0};
+    };
+
+    //! Copies the current import settings for the mesh called name.
+    MeshImportSettings importSettings(const std::string& name, unsigned int parseThreads) const;
+
+    /**
+     * @brief Reads the hand made LODs of a .obj and appends them to levels. It looks for same name suffixed with '_L01', '_L02' and so on until a file is missing.
+     */
+    void readLODs(const std::string& name, GLenum renderType, std::vector<MeshBuffers>& levels, const MeshImportSettings& settings);
+
     /**
-     * @brief Sets up LOD meshes for a .obj. It looks for same name suffixed with '_L01/_L02'. Hardcoded to create 2 LODs
+     * @brief Generates LOD meshes by simplifying the base mesh, levels.front(), and appends them to levels.
      */
-    std::pair<std::shared_ptr<MeshData>, std::shared_ptr<MeshData> > initializeLODs(const std::string& name, const std::string& path, GLenum renderType);
+    void generateLODs(const std::string& name, GLenum renderType, std::vector<MeshBuffers>& levels, const MeshImportSettings& settings);
+
+    //! File name of a hand made LOD, name_L01.obj and so on.
+    static std::string LODFileName(const std::string& name, unsigned int level);
+
+    //! CPU side result of loading a mesh, either a mapped cooked file or the parsed LOD levels.
+    struct LoadedMesh
+    {
+        std::string name;
+        GLenum renderType{GL_TRIANGLES};
+        std::vector<MeshBuffers> levels;
+        MeshData::Bounds bounds{};
+        std::unique_ptr<CookedMesh> cooked;
+    };
 
     /**
-     * @brief Sets up the base mesh data vao, vertexcount and indexcount arrays with the provided values from LOD1 and LOD2 respectively.
+     * @brief The CPU part of loading a mesh: reads the cooked file if it's up to date, or parses, optimizes and cooks the source.
+     * Doesn't touch OpenGL, so it's safe to call from the loading threads. Returns nullptr if the mesh couldn't be read.
      */
-    void setupLODs(std::shared_ptr<MeshData> baseMeshData, std::shared_ptr<MeshData> LOD1 = nullptr, std::shared_ptr<MeshData> LOD2 = nullptr);
+    std::shared_ptr<LoadedMesh> readMesh(const std::string& name, const std::string& path, GLenum renderType, const MeshImportSettings& settings);
 
     /**
-     * @brief Creates the MeshData. Does the OpenGL initialization of buffers using the provided vertex and indices data.
+     * @brief The OpenGL part of loading a mesh. Replaces the placeholder if there is one.
      */
-    std::shared_ptr<MeshData> initializeMeshData(const std::string& name, GLenum renderType, std::pair<std::vector<Vertex>, std::vector<GLuint>> data);
+    ResourceHandle uploadMesh(const LoadedMesh& loadedMesh);
+
+    /**
+     * @brief Runs job on the loading threads. The function it returns is run by processUploads on the render thread.
+     */
+    void submitLoad(const std::string& name, std::function<std::function<void()>()> job);
+
+    //! Cube shown while a mesh is loading. Created on first use.
+    const MeshData& placeholderMesh();
+
+    //! Gives the buffers of unloaded meshes back to the upload manager and deletes unloaded textures.
+    void freeUnloaded();
+
+    //! A wave_t that frees its buffer.
+    static std::shared_ptr<wave_t> makeWave();
+
+    /**
+     * @brief The key a cooked mesh must match to be used: the source file's modification time and size,
+     * and a hash of the import settings and hand made LOD files.
+     */
+    static CookedMesh::Key cookedMeshKey(const std::string& name, const std::string& path, GLenum renderType, const MeshImportSettings& settings);
+
+    /**
+     * @brief Welds and reorders the vertices and indices for the vertex cache if enabled, and reports the change in ACMR.
+     */
+    static void optimizeMesh(const std::string& name, GLenum renderType, std::pair<std::vector<Vertex>, std::vector<GLuint>>& data,
+                             const MeshImportSettings& settings);
+
+    //! Sets the LOD screen sizes given to setLODScreenSizes for the mesh, if any.
+    void applyLODScreenSizes(MeshData& mesh) const;
 
     /**
      * @brief Calculates bounds for the mesh based on vertices
@@ -123,14 +288,45 @@ private:
 
     // Data
 
-    std::map<std::string, std::shared_ptr<Shader>> mShaders;
-    std::map<std::string, std::shared_ptr<Texture>> mTextures;
-    std::map<std::string, std::shared_ptr<MeshData>> mMeshes;
-    std::map<std::string, wave_t*> mWavFiles;
+    ResourceMap<std::shared_ptr<Shader>> mShaders;
+    ResourcePool<Texture> mTextures;
+    ResourcePool<MeshData> mMeshes;
+    ResourcePool<wave_t> mWavFiles;
+
+    //! Where a resource was loaded from, so it can be loaded again after being unloaded.
+    struct ResourceSource
+    {
+        std::string path;
+        GLenum type{0};
+    };
+    ResourceMap<ResourceSource> mMeshSources;
+    ResourceMap<ResourceSource> mTextureSources;
+    ResourceMap<ResourceSource> mWavSources;
+
+    // Unloaded, waiting for the context to be current
+    std::vector<std::shared_ptr<MeshData>> mUnloadedMeshes;
+    std::vector<std::shared_ptr<Texture>> mUnloadedTextures;
     std::map<std::string, unsigned int> mSourceBuffers;
+    std::map<std::string, std::vector<float>> mLODRatios;
+    std::map<std::string, std::vector<float>> mLODScreenSizes;
+    const std::vector<float> mDefaultLODRatios{0.5f, 0.25f};
+
+    struct PendingLoad
+    {
+        ResourceId id;
+        std::string name;
+        std::future<std::function<void()>> result;
+    };
+    std::vector<PendingLoad> mPendingLoads;
+    MeshData mPlaceholderMesh;
 
     // Used to check if it's needed to call initializeOpenGLFunctions().
     bool mIsInitialized = false;
+
+    std::unique_ptr<UploadManager> mUploadManager;
+
+    // Last, so the loading threads are stopped before the rest is destroyed
+    std::unique_ptr<ThreadPool> mLoadingPool;
 };
 
 #endif // RESOURCEMANAGER_H
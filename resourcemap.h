@@ -0,0 +1,144 @@
+#ifndef RESOURCEMAP_H
+#define RESOURCEMAP_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "resourceid.h"
+
+/** Open addressing hash map from ResourceId to Value, with linear probing.
+ * The ids are hashes already, so they're used as they are. Entries are kept in one flat array,
+ * and removal shifts the following entries back instead of leaving tombstones.
+ * Value must be default constructible.
+ * @brief Open addressing hash map keyed by ResourceId.
+ */
+template<class Value>
+class ResourceMap
+{
+public:
+    //! nullptr if there's no entry for the id.
+    Value* find(ResourceId id)
+    {
+        if (mEntries.empty() || !id.isValid())
+            return nullptr;
+
+        for (std::size_t i{slotOf(id)}; ; i = (i + 1) & mask())
+        {
+            auto& entry = mEntries[i];
+            if (entry.key == id.value())
+                return &entry.value;
+            if (!entry.key)
+                return nullptr;
+        }
+    }
+
+    const Value* find(ResourceId id) const { return const_cast<ResourceMap*>(this)->find(id); }
+
+    bool contains(ResourceId id) const { return find(id) != nullptr; }
+
+    //! Inserts a default value if there's no entry for the id.
+    Value& operator[] (ResourceId id)
+    {
+        if (auto value = find(id))
+            return *value;
+
+        if ((mSize + 1) * 4 > mEntries.size() * 3)
+            rehash(mEntries.empty() ? 16 : mEntries.size() * 2);
+
+        std::size_t i{slotOf(id)};
+        while (mEntries[i].key)
+            i = (i + 1) & mask();
+
+        ++mSize;
+        mEntries[i].key = id.value();
+        return mEntries[i].value;
+    }
+
+    bool erase(ResourceId id)
+    {
+        if (mEntries.empty() || !id.isValid())
+            return false;
+
+        std::size_t i{slotOf(id)};
+        while (mEntries[i].key != id.value())
+        {
+            if (!mEntries[i].key)
+                return false;
+            i = (i + 1) & mask();
+        }
+
+        // Move back every following entry that would be unreachable with a hole at i
+        for (std::size_t j{(i + 1) & mask()}; mEntries[j].key; j = (j + 1) & mask())
+        {
+            const auto home = slotOf(mEntries[j].key);
+            if (((j - home) & mask()) >= ((j - i) & mask()))
+            {
+                mEntries[i] = std::move(mEntries[j]);
+                i = j;
+            }
+        }
+
+        mEntries[i] = Entry{};
+        --mSize;
+        return true;
+    }
+
+    void clear()
+    {
+        mEntries.clear();
+        mSize = 0;
+    }
+
+    std::size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    //! Calls f(id, value) for every entry, in no particular order.
+    template<class F>
+    void forEach(F f) const
+    {
+        for (const auto& entry : mEntries)
+            if (entry.key)
+                f(ResourceId::fromValue(entry.key), entry.value);
+    }
+
+    template<class F>
+    void forEach(F f)
+    {
+        for (auto& entry : mEntries)
+            if (entry.key)
+                f(ResourceId::fromValue(entry.key), entry.value);
+    }
+
+private:
+    struct Entry
+    {
+        // 0 is never a valid id, so it marks empty entries
+        std::uint32_t key{0};
+        Value value{};
+    };
+
+    std::size_t mask() const { return mEntries.size() - 1; }
+    std::size_t slotOf(ResourceId id) const { return slotOf(id.value()); }
+    std::size_t slotOf(std::uint32_t key) const { return key & mask(); }
+
+    void rehash(std::size_t capacity)
+    {
+        std::vector<Entry> old(capacity);
+        old.swap(mEntries);
+        for (auto& entry : old)
+        {
+            if (!entry.key)
+                continue;
+
+            std::size_t i{slotOf(entry.key)};
+            while (mEntries[i].key)
+                i = (i + 1) & mask();
+            mEntries[i] = std::move(entry);
+        }
+    }
+
+    std::vector<Entry> mEntries;
+    std::size_t mSize{0};
+};
+
+#endif // RESOURCEMAP_H
@@ -0,0 +1,275 @@
+#ifndef RESOURCEPOOL_H
+#define RESOURCEPOOL_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "resourceid.h"
+#include "resourcemap.h"
+
+/** Refers to a resource in a ResourcePool. The generation is bumped every time a slot is freed,
+ * so a handle to a resource that has been unloaded is detected instead of reaching whatever took its slot.
+ * @brief Index and generation of a resource in a ResourcePool.
+ */
+struct ResourceHandle
+{
+    static constexpr std::uint32_t invalidIndex{0xffffffff};
+
+    std::uint32_t index{invalidIndex};
+    std::uint32_t generation{0};
+
+    bool isValid() const { return index != invalidIndex; }
+    bool operator== (const ResourceHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!= (const ResourceHandle& other) const { return !(*this == other); }
+};
+
+/** Named resources stored in slots that are reused when a resource is removed.
+ * Names are interned and looked up by their ResourceId.
+ * Every resource has a reference count, kept by ResourceRef, and resources nobody refers to
+ * can be removed with collect(). Pinned resources are never collected.
+ * @brief Named, reference counted resources addressed by handles.
+ */
+template<class T>
+class ResourcePool
+{
+public:
+    /**
+     * @brief Adds the resource under name, or replaces the resource if the name is already taken.
+     */
+    ResourceHandle add(const std::string& name, std::shared_ptr<T> resource)
+    {
+        const auto id = ResourceId::intern(name);
+        auto handle = find(id);
+        if (handle.isValid())
+        {
+            mSlots[handle.index].resource = std::move(resource);
+            return handle;
+        }
+
+        std::uint32_t index;
+        if (mFree.empty())
+        {
+            index = static_cast<std::uint32_t>(mSlots.size());
+            mSlots.emplace_back();
+        }
+        else
+        {
+            index = mFree.back();
+            mFree.pop_back();
+        }
+
+        auto& slot = mSlots[index];
+        slot.resource = std::move(resource);
+        slot.id = id;
+        slot.refCount = 0;
+        slot.pinned = false;
+        mIndices[id] = index;
+        return {index, slot.generation};
+    }
+
+    //! Invalid handle if there's no resource with that name.
+    ResourceHandle find(ResourceId id) const
+    {
+        auto index = mIndices.find(id);
+        if (!index)
+            return {};
+        return {*index, mSlots[*index].generation};
+    }
+
+    //! nullptr if the handle is stale.
+    T* get(ResourceHandle handle) const
+    {
+        auto s = slot(handle);
+        return s ? s->resource.get() : nullptr;
+    }
+
+    std::shared_ptr<T> getShared(ResourceHandle handle) const
+    {
+        auto s = slot(handle);
+        return s ? s->resource : nullptr;
+    }
+
+    ResourceId id(ResourceHandle handle) const
+    {
+        auto s = slot(handle);
+        return s ? s->id : ResourceId{};
+    }
+
+    /**
+     * @brief Removes the resource right away, whether it's referred to or not. Returns it so the caller can free it.
+     */
+    std::shared_ptr<T> remove(ResourceHandle handle)
+    {
+        auto s = slot(handle);
+        if (!s)
+            return nullptr;
+
+        auto resource = std::move(s->resource);
+        free(handle.index);
+        return resource;
+    }
+
+    void acquire(ResourceHandle handle)
+    {
+        if (auto s = slot(handle))
+            ++s->refCount;
+    }
+
+    void release(ResourceHandle handle)
+    {
+        auto s = slot(handle);
+        if (s && s->refCount)
+            --s->refCount;
+    }
+
+    unsigned int refCount(ResourceHandle handle) const
+    {
+        auto s = slot(handle);
+        return s ? s->refCount : 0;
+    }
+
+    //! Pinned resources are kept even if nobody refers to them.
+    void setPinned(ResourceHandle handle, bool pinned = true)
+    {
+        if (auto s = slot(handle))
+            s->pinned = pinned;
+    }
+
+    /**
+     * @brief Removes every unpinned resource with no references that canRemove(id, resource) agrees to,
+     * and returns them so the caller can free them.
+     */
+    template<class Predicate>
+    std::vector<std::shared_ptr<T>> collect(Predicate canRemove)
+    {
+        std::vector<std::shared_ptr<T>> removed;
+        for (std::uint32_t index{0}; index < mSlots.size(); ++index)
+        {
+            auto& s = mSlots[index];
+            if (!s.resource || s.refCount || s.pinned || !canRemove(s.id, *s.resource))
+                continue;
+
+            removed.push_back(std::move(s.resource));
+            free(index);
+        }
+        return removed;
+    }
+
+    //! Calls f(id, resource) for every resource, in no particular order.
+    template<class F>
+    void forEach(F f) const
+    {
+        for (const auto& s : mSlots)
+            if (s.resource)
+                f(s.id, *s.resource);
+    }
+
+    unsigned int size() const { return static_cast<unsigned int>(mIndices.size()); }
+
+private:
+    struct Slot
+    {
+        std::shared_ptr<T> resource;
+        ResourceId id;
+        std::uint32_t generation{0};
+        unsigned int refCount{0};
+        bool pinned{false};
+    };
+
+    Slot* slot(ResourceHandle handle) const
+    {
+        if (handle.index >= mSlots.size())
+            return nullptr;
+        auto& s = mSlots[handle.index];
+        return (s.generation == handle.generation && s.resource) ? const_cast<Slot*>(&s) : nullptr;
+    }
+
+    void free(std::uint32_t index)
+    {
+        auto& s = mSlots[index];
+        mIndices.erase(s.id);
+        s.resource.reset();
+        s.id = {};
+        s.refCount = 0;
+        s.pinned = false;
+        ++s.generation;
+        mFree.push_back(index);
+    }
+
+    std::vector<Slot> mSlots;
+    std::vector<std::uint32_t> mFree;
+    ResourceMap<std::uint32_t> mIndices;
+};
+
+/** Counted reference to a resource in a ResourcePool. Keeps the resource from being collected
+ * while it's alive, and turns into a null reference if the resource is removed anyway.
+ * Must not outlive the pool.
+ * @brief Counted reference to a resource in a ResourcePool.
+ */
+template<class T>
+class ResourceRef
+{
+public:
+    ResourceRef() = default;
+    ResourceRef(ResourcePool<T>* pool, ResourceHandle handle)
+        : mPool{pool}, mHandle{handle}
+    {
+        if (mPool)
+            mPool->acquire(mHandle);
+    }
+    ResourceRef(const ResourceRef& other) : ResourceRef(other.mPool, other.mHandle) {}
+    ResourceRef(ResourceRef&& other) noexcept
+        : mPool{other.mPool}, mHandle{other.mHandle}
+    {
+        other.mPool = nullptr;
+        other.mHandle = {};
+    }
+    ~ResourceRef() { reset(); }
+
+    ResourceRef& operator= (const ResourceRef& other)
+    {
+        if (this != &other)
+            *this = ResourceRef{other};
+        return *this;
+    }
+    ResourceRef& operator= (ResourceRef&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            mPool = other.mPool;
+            mHandle = other.mHandle;
+            other.mPool = nullptr;
+            other.mHandle = {};
+        }
+        return *this;
+    }
+
+    void reset()
+    {
+        if (mPool)
+            mPool->release(mHandle);
+        mPool = nullptr;
+        mHandle = {};
+    }
+
+    T* get() const { return mPool ? mPool->get(mHandle) : nullptr; }
+    T* operator-> () const { return get(); }
+    T& operator* () const { return *get(); }
+    explicit operator bool() const { return get() != nullptr; }
+
+    std::shared_ptr<T> shared() const { return mPool ? mPool->getShared(mHandle) : nullptr; }
+    ResourceHandle handle() const { return mHandle; }
+    //! Id of the resource's name, invalid for null references.
+    ResourceId id() const { return mPool ? mPool->id(mHandle) : ResourceId{}; }
+
+    bool operator== (const ResourceRef& other) const { return mPool == other.mPool && mHandle == other.mHandle; }
+    bool operator!= (const ResourceRef& other) const { return !(*this == other); }
+
+private:
+    ResourcePool<T>* mPool{nullptr};
+    ResourceHandle mHandle{};
+};
+
+#endif // RESOURCEPOOL_H
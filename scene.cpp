@@ -1,11 +1,47 @@
 #include "scene.h"
 #include "world.h"
+#include "scenebinary.h"
+#include "sceneloader.h"
+#include "scriptsystem.h"
 
 #include <QFileInfo>
 
 #include <QJsonDocument>
 #include <QJsonObject>
 
+#include <random>
+#include <chrono>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fstream>
+#include <unistd.h>
+#endif
+
+namespace
+{
+//! Memory used by the process in bytes, or 0 if it can't be found.
+std::size_t residentMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.WorkingSetSize;
+    return 0;
+#else
+    // The second field is the resident set size in pages
+    std::ifstream statm{"/proc/self/statm"};
+    std::size_t size{0}, resident{0};
+    if(!(statm >> size >> resident))
+        return 0;
+    return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+}
+
 Scene::Scene(World* world)
     : mWorld(world)
 {   
@@ -40,9 +76,9 @@ void Scene::initBlankScene()
     camera = entityManager->createEntity("GameCam");
     auto [gameTrans, gameCam, gameMesh] = entityManager->addComponent<TransformComponent, CameraComponent, MeshComponent>(camera);
     gameTrans.setPosition(gsl::vec3{0.f, 0.f, 5.f});
-    if(auto meshData = ResourceManager::instance().getMesh("camera"))
+    if(auto mesh = ResourceManager::instance().getMesh("camera"))
     {
-        gameMesh.meshData = *meshData;
+        gameMesh.mesh = mesh;
         gameMesh.isVisible = true;
     }
 
@@ -53,71 +89,27 @@ void Scene::initBlankScene()
 
 bool Scene::LoadFromFile(const std::string& path)
 {
-    QFile file(QString::fromStdString(path));
-    if(!file.open(QIODevice::ReadOnly))
-    {
-        qDebug() << "ERROR Scene.load(): Failed to open file at specified path!";
-        return false;
-    }
-
    QFileInfo info(QString::fromStdString(path));
    auto baseName = info.baseName();
    if(baseName.contains("temp"))
         baseName = baseName.replace("temp", "");
    name = baseName.toStdString();
 
-    QJsonDocument document = QJsonDocument::fromJson(file.readAll());
-    if(!document.isObject())
+    if(info.suffix() == SceneBinary::suffix)
     {
-        qDebug() << "Load Error: Wrong formatting";
-        return false;
+        if(!SceneBinary::read(path, *mWorld->getEntityManager()))
+            return false;
+
+        filePath = path;
+        return true;
     }
 
-    QJsonObject mainObject = document.object();
-    if(mainObject.isEmpty())
-    {
-        qDebug() << "Load Error: File is empty.";
+    SceneLoader loader{*mWorld->getEntityManager()};
+    if(!loader.open(path))
         return false;
-    }
 
     filePath = path;
-
-    mWorld->clearEntities();
-    auto entityManager = mWorld->getEntityManager();
-
-    // Iterate all entities
-    for(auto entityRef : mainObject["Entities"].toArray())
-    {
-        // Current entity
-        auto entityObj = entityRef.toObject();
-
-        // Create the entity
-        auto entity = entityManager->createEntity(entityObj["Name"].toString().toStdString());
-        auto shouldShowInEditor = entityObj["ShowInEditor"].toBool();
-        if(!shouldShowInEditor)
-        {
-            for(auto& info : entityManager->getEntityInfos())
-            {
-                if(info.entityId == entity)
-                {
-                    info.shouldShowInEditor = false;
-                }
-            }
-        }
-
-        // Iterate all components
-        for(auto compRef : entityObj["Components"].toArray())
-        {
-            // Current component
-            auto compObject = compRef.toObject();
-
-            // Add the component
-            auto comp = entityManager->addComponent(entity, static_cast<ComponentType>(compObject["ComponentType"].toInt()));
-
-            // Inititalize the component
-            comp->fromJSON(compObject);
-        }
-    }
+    loader.loadAll();
 
     return true;
 }
@@ -133,6 +125,12 @@ void Scene::SaveToFile(const std::string& path)
 
     filePath = path;
 
+    if(QFileInfo(file).suffix() == SceneBinary::suffix)
+    {
+        file.write(SceneBinary::serialize(*mWorld->getEntityManager()));
+        return;
+    }
+
     const auto& entityManager = mWorld->getEntityManager();
     const auto& entityInfos = entityManager->getEntityInfos();
 
@@ -180,11 +178,106 @@ void TestScene::initCustomObjects()
     {
         auto entity = entityManager->createEntity();
         auto [transform, render] = entityManager->addComponent<TransformComponent, MeshComponent>(entity);
-        if(auto meshData = ResourceManager::instance().getMesh("suzanne"))
+        if(auto mesh = ResourceManager::instance().getMesh("suzanne"))
         {
-            render.meshData = *meshData;
+            render.mesh = mesh;
             render.isVisible = true;
         }
         transform.setPosition(gsl::vec3(i*2.f, 0, 0));
     }
 }
+
+LightBenchmarkScene::LightBenchmarkScene(World *world)
+    : Scene(world)
+{
+    name = "Light benchmark";
+}
+
+void LightBenchmarkScene::initCustomObjects()
+{
+    auto entityManager = mWorld->getEntityManager();
+
+    // Floor
+    auto floor = entityManager->createEntity("floor");
+    auto [floorTrans, floorMesh] = entityManager->addComponent<TransformComponent, MeshComponent>(floor);
+    floorTrans.setPosition(gsl::vec3{0.f, -1.f, 0.f});
+    floorTrans.setScale(gsl::vec3{60.f, 0.2f, 60.f});
+    if(auto mesh = ResourceManager::instance().getMesh("box2"))
+    {
+        floorMesh.mesh = mesh;
+        floorMesh.isVisible = true;
+    }
+
+    // Something to light up
+    for(int x = -5; x < 5; ++x)
+    {
+        for(int z = -5; z < 5; ++z)
+        {
+            auto entity = entityManager->createEntity();
+            auto [transform, render] = entityManager->addComponent<TransformComponent, MeshComponent>(entity);
+            if(auto mesh = ResourceManager::instance().getMesh("suzanne"))
+            {
+                render.mesh = mesh;
+                render.isVisible = true;
+            }
+            transform.setPosition(gsl::vec3(x * 5.f + 2.5f, 0.f, z * 5.f + 2.5f));
+        }
+    }
+
+    // Lights spread out in a grid a bit above the floor
+    std::mt19937 generator{1337};
+    std::uniform_real_distribution<float> color{0.2f, 1.f};
+    std::uniform_real_distribution<float> radius{2.f, 5.f};
+    std::uniform_real_distribution<float> height{0.f, 2.f};
+
+    const auto side = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<float>(lightCount))));
+    const float spacing = 50.f / side;
+    for(unsigned int i = 0; i < lightCount; ++i)
+    {
+        auto entity = entityManager->createEntity();
+        auto [transform, light] = entityManager->addComponent<TransformComponent, PointLightComponent>(entity);
+        transform.setPosition(gsl::vec3{(i % side) * spacing - 25.f, height(generator), (i / side) * spacing - 25.f});
+        light.color = gsl::vec3{color(generator), color(generator), color(generator)};
+        light.radius = radius(generator);
+        light.intensity = 1.f;
+    }
+}
+
+ScriptBenchmarkScene::ScriptBenchmarkScene(World *world)
+    : Scene(world)
+{
+    name = "Script benchmark";
+}
+
+void ScriptBenchmarkScene::initCustomObjects()
+{
+    auto entityManager = mWorld->getEntityManager();
+
+    const auto side = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<float>(scriptCount))));
+    for(unsigned int i = 0; i < scriptCount; ++i)
+    {
+        auto entity = entityManager->createEntity();
+        auto [transform, render] = entityManager->addComponent<TransformComponent, MeshComponent>(entity);
+        transform.setPosition(gsl::vec3{(i % side) * 2.f - side, 0.f, (i / side) * 2.f - side});
+        transform.setScale(gsl::vec3{0.5f, 0.5f, 0.5f});
+        if(auto mesh = ResourceManager::instance().getMesh("box2"))
+        {
+            render.mesh = mesh;
+            render.isVisible = true;
+        }
+        entityManager->addComponent<ScriptComponent>(entity);
+    }
+
+    // The scripts are loaded on their own so the time and memory they take can be measured
+    const auto memoryBefore = residentMemory();
+    const auto start = std::chrono::steady_clock::now();
+    for(auto& script : entityManager->getScriptComponents())
+        if(script.valid)
+            ScriptSystem::get()->load(script, scriptFile);
+    const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    const auto memoryAfter = residentMemory();
+
+    qDebug() << "Script benchmark:" << scriptCount << "scripts loaded with" << (ScriptSystem::get()->shareEngines ? "shared" : "own")
+             << "engines in" << elapsed / 1000.0 << "ms," << elapsed / scriptCount << "us and"
+             << (memoryAfter > memoryBefore ? (memoryAfter - memoryBefore) / 1024.0 / scriptCount : 0.0) << "KiB per script";
+}
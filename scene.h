@@ -50,5 +50,37 @@ public:
     void initCustomObjects() override;
 };
 
+/** Scene used to benchmark the lighting passes.
+ * Spawns a floor with some meshes on it lit by a grid of 1000 colored pointlights.
+ * @brief Scene used to benchmark the lighting passes.
+ */
+class LightBenchmarkScene : public Scene
+{
+public:
+    LightBenchmarkScene(World* world);
+    void initCustomObjects() override;
+
+    unsigned int lightCount{1000};
+};
+
+/** Scene used to benchmark the script system.
+ * Spawns a grid of cubes, each running a script that writes its transform every tick.
+ * Press play and look at the Scripting scope in the profile to see the cost per frame.
+ * The time and memory it takes to load the scripts is printed when the scene is made,
+ * set ScriptSystem::shareEngines to compare shared engines with an engine per script.
+ * Starting and stopping play prints how long the play mode snapshot and restore take, raise scriptCount
+ * to 50000 to time them on a big scene.
+ * @brief Scene used to benchmark the script system.
+ */
+class ScriptBenchmarkScene : public Scene
+{
+public:
+    ScriptBenchmarkScene(World* world);
+    void initCustomObjects() override;
+
+    unsigned int scriptCount{1000};
+    std::string scriptFile{"transformBenchmark.js"};
+};
+
 
 #endif // SCENE_H
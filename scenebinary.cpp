@@ -0,0 +1,711 @@
+#include "scenebinary.h"
+#include "entitymanager.h"
+#include "resourcemanager.h"
+#include "soundmanager.h"
+#include "scriptsystem.h"
+#include <QFile>
+#include <QDebug>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <variant>
+
+namespace
+{
+const char fileMagic[4] = {'I', 'N', 'N', 'S'};
+const std::uint32_t fileVersion{1};
+// Block type used for the entity infos, after the component types
+const std::uint32_t entityBlock{static_cast<std::uint32_t>(ComponentType::Other)};
+
+struct FileHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t blockCount;
+    std::uint32_t lastEntityId;
+    std::uint64_t dataOffset;
+    std::uint64_t dataSize;
+};
+static_assert(sizeof(FileHeader) == 32, "Binary scene header layout changed");
+
+struct BlockHeader
+{
+    std::uint32_t type;
+    std::uint32_t count;
+    std::uint32_t recordSize;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(BlockHeader) == 16, "Binary scene block header layout changed");
+
+//! Part of the data section. Count is bytes for strings and elements for arrays.
+struct Span
+{
+    std::uint32_t offset;
+    std::uint32_t count;
+};
+
+struct EntityRecord
+{
+    std::uint32_t entityId;
+    std::uint32_t showInEditor;
+    Span name;
+};
+
+struct TransformRecord
+{
+    std::uint32_t entityId;
+    float position[3];
+    float rotation[4];
+    float scale[3];
+    Span children;
+};
+
+struct PhysicsRecord
+{
+    std::uint32_t entityId;
+    float velocity[3];
+    float acceleration[3];
+    float mass;
+};
+
+struct MeshRecord
+{
+    std::uint32_t entityId;
+    std::uint32_t flags;
+    Span mesh;
+    Span shader;
+    Span parameters;
+    Span textures;
+};
+
+struct ParameterRecord
+{
+    Span name;
+    //! Index in ShaderParamType
+    std::uint32_t kind;
+    float values[4];
+};
+
+struct TextureRecord
+{
+    Span name;
+    std::uint32_t id;
+    std::uint32_t type;
+};
+
+struct CameraRecord
+{
+    std::uint32_t entityId;
+    std::uint32_t isEditorCamera;
+    float pitch;
+    float yaw;
+};
+
+struct InputRecord
+{
+    std::uint32_t entityId;
+    std::uint32_t controlledWhilePlaying;
+};
+
+struct SoundRecord
+{
+    std::uint32_t entityId;
+    std::uint32_t flags;
+    float pitch;
+    float gain;
+    Span name;
+};
+
+struct PointLightRecord
+{
+    std::uint32_t entityId;
+    float color[3];
+    float intensity;
+    float radius;
+    float maxBrightness;
+};
+
+struct SpotLightRecord
+{
+    std::uint32_t entityId;
+    float color[3];
+    float intensity;
+    float cutOff;
+    float outerCutOff;
+    float linear;
+    float quadratic;
+    float constant;
+};
+
+struct DirectionalLightRecord
+{
+    std::uint32_t entityId;
+    float color[3];
+    float intensity;
+};
+
+struct ScriptRecord
+{
+    std::uint32_t entityId;
+    Span filePath;
+};
+
+struct ColliderRecord
+{
+    std::uint32_t entityId;
+    std::uint32_t collisionType;
+    //! Index in the extents variant
+    std::uint32_t extentsKind;
+    float extents[3];
+};
+
+//! Particle components have no settings yet, so the record only says which entities have one.
+struct ParticleRecord
+{
+    std::uint32_t entityId;
+};
+
+enum : std::uint32_t
+{
+    visibleFlag = 1, wireframeFlag = 2,
+    loopingFlag = 1, mutedFlag = 2, autoplayFlag = 4
+};
+
+inline void store(float* out, const gsl::vec3& v)
+{
+    out[0] = v.x;
+    out[1] = v.y;
+    out[2] = v.z;
+}
+
+inline gsl::vec3 load(const float* in)
+{
+    return {in[0], in[1], in[2]};
+}
+
+class Writer
+{
+public:
+    Span addData(const void* data, std::size_t size, std::uint32_t count)
+    {
+        const auto offset = static_cast<std::uint32_t>(mData.size());
+        mData.append(static_cast<const char*>(data), static_cast<int>(size));
+        // Keep everything in the data section 4 byte aligned
+        while (mData.size() % 4)
+            mData.append('\0');
+        return {offset, count};
+    }
+
+    Span addString(const std::string& string)
+    {
+        return addData(string.data(), string.size(), static_cast<std::uint32_t>(string.size()));
+    }
+
+    template<class T>
+    Span addArray(const std::vector<T>& array)
+    {
+        return addData(array.data(), array.size() * sizeof(T), static_cast<std::uint32_t>(array.size()));
+    }
+
+    template<class Record>
+    void addBlock(std::uint32_t type, const std::vector<Record>& records)
+    {
+        if (records.empty())
+            return;
+
+        const BlockHeader header{type, static_cast<std::uint32_t>(records.size()), sizeof(Record), 0};
+        mBlocks.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        mBlocks.append(reinterpret_cast<const char*>(records.data()), static_cast<int>(records.size() * sizeof(Record)));
+        ++mBlockCount;
+    }
+
+    QByteArray finish(std::uint32_t lastEntityId) const
+    {
+        FileHeader header{};
+        std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+        header.version = fileVersion;
+        header.blockCount = mBlockCount;
+        header.lastEntityId = lastEntityId;
+        header.dataOffset = sizeof(FileHeader) + static_cast<std::uint64_t>(mBlocks.size());
+        header.dataSize = static_cast<std::uint64_t>(mData.size());
+
+        QByteArray file;
+        file.reserve(static_cast<int>(header.dataOffset + header.dataSize));
+        file.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.append(mBlocks);
+        file.append(mData);
+        return file;
+    }
+
+private:
+    QByteArray mBlocks;
+    QByteArray mData;
+    std::uint32_t mBlockCount{0};
+};
+
+class Reader
+{
+public:
+    Reader(const char* data, std::uint64_t size) : mData{data}, mSize{size} {}
+
+    bool valid(Span span, std::size_t elementSize) const
+    {
+        return static_cast<std::uint64_t>(span.offset) + static_cast<std::uint64_t>(span.count) * elementSize <= mSize;
+    }
+
+    std::string string(Span span) const
+    {
+        return valid(span, 1) ? std::string{mData + span.offset, span.count} : std::string{};
+    }
+
+    template<class T>
+    std::vector<T> array(Span span) const
+    {
+        std::vector<T> result;
+        if (valid(span, sizeof(T)))
+        {
+            result.resize(span.count);
+            std::memcpy(result.data(), mData + span.offset, span.count * sizeof(T));
+        }
+        return result;
+    }
+
+private:
+    const char* mData;
+    std::uint64_t mSize;
+};
+
+struct Block
+{
+    BlockHeader header;
+    const char* records;
+};
+
+/** Copies the records out in one go and rebuilds the component vector from them.
+ * The records are written from the sorted component vectors, so no sorting is needed.
+ */
+template<class Record, class T, class Fill>
+void loadBlock(const Block& block, std::vector<T>& list, Fill fill)
+{
+    if (block.header.recordSize != sizeof(Record))
+        return;
+
+    std::vector<Record> records(block.header.count);
+    std::memcpy(records.data(), block.records, records.size() * sizeof(Record));
+
+    list.clear();
+    list.reserve(records.size());
+    for (const auto& record : records)
+    {
+        list.emplace_back(record.entityId, true);
+        fill(record, list.back());
+    }
+
+    if (!std::is_sorted(list.begin(), list.end(), [](const T& a, const T& b){ return a.entityId < b.entityId; }))
+        std::sort(list.begin(), list.end(), [](const T& a, const T& b){ return a.entityId < b.entityId; });
+}
+
+template<class T, class Record, class Make>
+std::vector<Record> makeRecords(const std::vector<T>& list, Make make)
+{
+    std::vector<Record> records;
+    records.reserve(list.size());
+    for (const auto& component : list)
+    {
+        if (!component.valid)
+            continue;
+
+        Record record{};
+        record.entityId = component.entityId;
+        make(component, record);
+        records.push_back(record);
+    }
+    return records;
+}
+}
+
+QByteArray SceneBinary::serialize(EntityManager &entityManager)
+{
+    Writer writer;
+
+    std::vector<EntityRecord> entities;
+    entities.reserve(entityManager.getEntityInfos().size());
+    for (const auto& info : entityManager.getEntityInfos())
+        entities.push_back({info.entityId, info.shouldShowInEditor, writer.addString(info.name)});
+    writer.addBlock(entityBlock, entities);
+
+    writer.addBlock(static_cast<std::uint32_t>(ComponentType::Transform),
+                    makeRecords<TransformComponent, TransformRecord>(entityManager.getTransformComponents(),
+                    [&writer](const TransformComponent& component, TransformRecord& record){
+        store(record.position, component.position);
+        record.rotation[0] = component.rotation.s;
+        record.rotation[1] = component.rotation.i;
+        record.rotation[2] = component.rotation.j;
+        record.rotation[3] = component.rotation.k;
+        store(record.scale, component.scale);
+        record.children = writer.addArray(component.children);
+    }));
+
+    writer.addBlock(static_cast<std::uint32_t>(ComponentType::Physics),
+                    makeRecords<PhysicsComponent, PhysicsRecord>(entityManager.getPhysicsComponents(),
+                    [](const PhysicsComponent& component, PhysicsRecord& record){
+        store(record.velocity, component.velocity);
+        store(record.acceleration, component.acceleration);
+        record.mass = component.mass;
+    }));
+
+    writer.addBlock(static_cast<std::uint32_t>(ComponentType::Mesh),
+                    makeRecords<MeshComponent, MeshRecord>(entityManager.getMeshComponents(),
+                    [&writer](const MeshComponent& component, MeshRecord& record){
+        record.flags = (component.isVisible ? visibleFlag : 0) | (component.renderWireframe ? wireframeFlag : 0);
+        record.mesh = writer.addString(component.mesh ? component.mesh->mName : std::string{});
+        const auto& material = component.mMaterial;
+        record.shader = writer.addString(material.mShader ? material.mShader->mName : std::string{});
+
+        std::vector<ParameterRecord> parameters;
+        for (const auto& parameter : material.mParameters)
+        {
+            ParameterRecord parameterRecord{};
+            parameterRecord.name = writer.addString(parameter.first);
+            parameterRecord.kind = static_cast<std::uint32_t>(parameter.second.index());
+            auto& values = parameterRecord.values;
+            std::visit([&values](const auto& value){
+                using V = std::decay_t<decltype(value)>;
+                if constexpr (std::is_same_v<V, gsl::vec2>)
+                {
+                    values[0] = value.x;
+                    values[1] = value.y;
+                }
+                else if constexpr (std::is_same_v<V, gsl::vec3>)
+                {
+                    store(values, value);
+                }
+                else if constexpr (std::is_same_v<V, gsl::vec4>)
+                {
+                    values[0] = value.x;
+                    values[1] = value.y;
+                    values[2] = value.z;
+                    values[3] = value.w;
+                }
+                else
+                {
+                    values[0] = static_cast<float>(value);
+                }
+            }, parameter.second);
+            parameters.push_back(parameterRecord);
+        }
+        record.parameters = writer.addArray(parameters);
+
+        std::vector<TextureRecord> textures;
+        for (const auto& texture : material.mTextures)
+            textures.push_back({writer.addString(texture.texture.id().name()), texture.id, texture.type});
+        record.textures = writer.addArray(textures);
+    }));
+
+    writer.addBlock(static_cast<std::uint32_t>(ComponentType::Camera),
+                    makeRecords<CameraComponent, CameraRecord>(entityManager.getCameraComponents(),
+                    [](const CameraComponent& component, CameraRecord& record){
+        record.isEditorCamera = component.isEditorCamera;
+        record.pitch = component.pitch;
+        record.yaw = component.yaw;
+    }));
+
+    writer.addBlock(static_cast<std::uint32_t>(ComponentType::Input),
+                    makeRecords<InputComponent, InputRecord>(entityManager.getInputComponents(),
+                    [](const InputComponent& component, InputRecord& record){
+        record.controlledWhilePlaying = component.controlledWhilePlaying;
+    }));
+
+    writer.addBlock(static_cast<std::uint32_t>(ComponentType::Sound),
+                    makeRecords<SoundComponent, SoundRecord>(entityManager.getSoundComponents(),
+                    [&writer](const SoundComponent& component, SoundRecord& record){
+        record.flags = (component.isLooping ? loopingFlag : 0) | (component.isMuted ? mutedFlag : 0) | (component.autoplay ? autoplayFlag : 0);
+        record.pitch = component.pitch;
+        record.gain = component.gain;
+        record.name = writer.addString(component.name);
+    }));
+
+    writer.addBlock(static_cast<std::uint32_t>(ComponentType::LightPoint),
+                    makeRecords<PointLightComponent, PointLightRecord>(entityManager.getPointLightComponents(),
+                    [](const PointLightComponent& component, PointLightRecord& record){
+        store(record.color, component.color);
+        record.intensity = component.intensity;
+        record.radius = component.radius;
+        record.maxBrightness = component.maxBrightness;
+    }));
+
+    writer.addBlock(static_cast<std::uint32_t>(ComponentType::LightSpot),
+                    makeRecords<SpotLightComponent, SpotLightRecord>(entityManager.getSpotLightComponents(),
+                    [](const SpotLightComponent& component, SpotLightRecord& record){
+        store(record.color, component.color);
+        record.intensity = component.intensity;
+        record.cutOff = component.cutOff;
+        record.outerCutOff = component.outerCutOff;
+        record.linear = component.linear;
+        record.quadratic = component.quadratic;
+        record.constant = component.constant;
+    }));
+
+    writer.addBlock(static_cast<std::uint32_t>(ComponentType::LightDirectional),
+                    makeRecords<DirectionalLightComponent, DirectionalLightRecord>(entityManager.getDirectionalLightComponents(),
+                    [](const DirectionalLightComponent& component, DirectionalLightRecord& record){
+        store(record.color, component.color);
+        record.intensity = component.intensity;
+    }));
+
+    writer.addBlock(static_cast<std::uint32_t>(ComponentType::Script),
+                    makeRecords<ScriptComponent, ScriptRecord>(entityManager.getScriptComponents(),
+                    [&writer](const ScriptComponent& component, ScriptRecord& record){
+        record.filePath = writer.addString(component.filePath);
+    }));
+
+    writer.addBlock(static_cast<std::uint32_t>(ComponentType::Collider),
+                    makeRecords<ColliderComponent, ColliderRecord>(entityManager.getColliderComponents(),
+                    [](const ColliderComponent& component, ColliderRecord& record){
+        record.collisionType = static_cast<std::uint32_t>(component.collisionType);
+        record.extentsKind = static_cast<std::uint32_t>(component.extents.index());
+        if (auto box = std::get_if<gsl::vec3>(&component.extents))
+            store(record.extents, *box);
+        else if (auto radius = std::get_if<float>(&component.extents))
+            record.extents[0] = *radius;
+        else if (auto capsule = std::get_if<std::pair<float, float>>(&component.extents))
+        {
+            record.extents[0] = capsule->first;
+            record.extents[1] = capsule->second;
+        }
+    }));
+
+    writer.addBlock(static_cast<std::uint32_t>(ComponentType::Particle),
+                    makeRecords<ParticleComponent, ParticleRecord>(entityManager.getParticleComponents(),
+                    [](const ParticleComponent&, ParticleRecord&){}));
+
+    return writer.finish(entityManager.lastEntityId());
+}
+
+bool SceneBinary::deserialize(const QByteArray &data, EntityManager &entityManager)
+{
+    const auto size = static_cast<std::uint64_t>(data.size());
+    if (size < sizeof(FileHeader))
+        return false;
+
+    FileHeader header;
+    std::memcpy(&header, data.constData(), sizeof(header));
+    if (std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 || header.version != fileVersion
+        || header.dataOffset > size || header.dataOffset + header.dataSize > size)
+    {
+        qDebug() << "SceneBinary: Not a binary scene of version" << fileVersion;
+        return false;
+    }
+
+    // Find all blocks before touching the entity manager
+    std::vector<Block> blocks;
+    std::uint64_t offset{sizeof(FileHeader)};
+    for (std::uint32_t i{0}; i < header.blockCount; ++i)
+    {
+        if (offset + sizeof(BlockHeader) > header.dataOffset)
+            return false;
+
+        Block block;
+        std::memcpy(&block.header, data.constData() + offset, sizeof(BlockHeader));
+        block.records = data.constData() + offset + sizeof(BlockHeader);
+        offset += sizeof(BlockHeader) + static_cast<std::uint64_t>(block.header.count) * block.header.recordSize;
+        if (offset > header.dataOffset)
+            return false;
+        blocks.push_back(block);
+    }
+
+    const Reader reader{data.constData() + header.dataOffset, header.dataSize};
+
+    entityManager.clear();
+
+    for (const auto& block : blocks)
+    {
+        if (block.header.type == entityBlock)
+        {
+            loadBlock<EntityRecord>(block, entityManager.getEntityInfos(), [&reader](const EntityRecord& record, EntityInfo& info){
+                info.name = reader.string(record.name);
+                info.shouldShowInEditor = record.showInEditor;
+            });
+            continue;
+        }
+
+        switch (static_cast<ComponentType>(block.header.type))
+        {
+        case ComponentType::Transform:
+            loadBlock<TransformRecord>(block, entityManager.getTransformComponents(), [&reader](const TransformRecord& record, TransformComponent& component){
+                component.position = load(record.position);
+                component.rotation = gsl::quat{record.rotation[0], record.rotation[1], record.rotation[2], record.rotation[3]};
+                component.scale = load(record.scale);
+                component.children = reader.array<unsigned int>(record.children);
+            });
+            break;
+        case ComponentType::Physics:
+            loadBlock<PhysicsRecord>(block, entityManager.getPhysicsComponents(), [](const PhysicsRecord& record, PhysicsComponent& component){
+                component.velocity = load(record.velocity);
+                component.acceleration = load(record.acceleration);
+                component.mass = record.mass;
+            });
+            break;
+        case ComponentType::Mesh:
+            loadBlock<MeshRecord>(block, entityManager.getMeshComponents(), [&reader](const MeshRecord& record, MeshComponent& component){
+                auto& resources = ResourceManager::instance();
+                component.isVisible = record.flags & visibleFlag;
+                component.renderWireframe = record.flags & wireframeFlag;
+
+                const auto meshName = reader.string(record.mesh);
+                if (meshName.size())
+                    component.mesh = resources.getMesh(meshName);
+
+                auto& material = component.mMaterial;
+                const auto shaderName = reader.string(record.shader);
+                if (shaderName.size())
+                    material.loadShaderWithParameters(resources.getShader(shaderName));
+
+                for (const auto& parameter : reader.array<ParameterRecord>(record.parameters))
+                {
+                    auto it = material.mParameters.find(reader.string(parameter.name));
+                    if (it == material.mParameters.end())
+                        continue;
+
+                    const auto& v = parameter.values;
+                    switch (parameter.kind)
+                    {
+                    case 0: it->second = v[0] != 0.f; break;
+                    case 1: it->second = static_cast<int>(v[0]); break;
+                    case 2: it->second = v[0]; break;
+                    case 3: it->second = gsl::vec2{v[0], v[1]}; break;
+                    case 4: it->second = gsl::vec3{v[0], v[1], v[2]}; break;
+                    case 5: it->second = gsl::vec4{v[0], v[1], v[2], v[3]}; break;
+                    default: break;
+                    }
+                }
+
+                for (const auto& texture : reader.array<TextureRecord>(record.textures))
+                {
+                    const auto name = reader.string(texture.name);
+                    auto ref = name.size() ? resources.getTexture(name) : resources.getTextureById(texture.id);
+                    const auto id = ref ? ref->id() : texture.id;
+                    material.mTextures.push_back({id, texture.type, std::move(ref)});
+                }
+            });
+            break;
+        case ComponentType::Camera:
+            loadBlock<CameraRecord>(block, entityManager.getCameraComponents(), [](const CameraRecord& record, CameraComponent& component){
+                component.isEditorCamera = record.isEditorCamera;
+                component.pitch = record.pitch;
+                component.yaw = record.yaw;
+            });
+            break;
+        case ComponentType::Input:
+            loadBlock<InputRecord>(block, entityManager.getInputComponents(), [](const InputRecord& record, InputComponent& component){
+                component.controlledWhilePlaying = record.controlledWhilePlaying;
+            });
+            break;
+        case ComponentType::Sound:
+            loadBlock<SoundRecord>(block, entityManager.getSoundComponents(), [&reader](const SoundRecord& record, SoundComponent& component){
+                component.isLooping = record.flags & loopingFlag;
+                component.isMuted = record.flags & mutedFlag;
+                component.autoplay = record.flags & autoplayFlag;
+                component.pitch = record.pitch;
+                component.gain = record.gain;
+                component.name = reader.string(record.name);
+            });
+            break;
+        case ComponentType::LightPoint:
+            loadBlock<PointLightRecord>(block, entityManager.getPointLightComponents(), [](const PointLightRecord& record, PointLightComponent& component){
+                component.color = load(record.color);
+                component.intensity = record.intensity;
+                component.radius = record.radius;
+                component.maxBrightness = record.maxBrightness;
+            });
+            break;
+        case ComponentType::LightSpot:
+            loadBlock<SpotLightRecord>(block, entityManager.getSpotLightComponents(), [](const SpotLightRecord& record, SpotLightComponent& component){
+                component.color = load(record.color);
+                component.intensity = record.intensity;
+                component.cutOff = record.cutOff;
+                component.outerCutOff = record.outerCutOff;
+                component.linear = record.linear;
+                component.quadratic = record.quadratic;
+                component.constant = record.constant;
+            });
+            break;
+        case ComponentType::LightDirectional:
+            loadBlock<DirectionalLightRecord>(block, entityManager.getDirectionalLightComponents(), [](const DirectionalLightRecord& record, DirectionalLightComponent& component){
+                component.color = load(record.color);
+                component.intensity = record.intensity;
+            });
+            break;
+        case ComponentType::Script:
+            loadBlock<ScriptRecord>(block, entityManager.getScriptComponents(), [&reader](const ScriptRecord& record, ScriptComponent& component){
+                component.filePath = reader.string(record.filePath);
+            });
+            break;
+        case ComponentType::Collider:
+            loadBlock<ColliderRecord>(block, entityManager.getColliderComponents(), [](const ColliderRecord& record, ColliderComponent& component){
+                component.collisionType = static_cast<ColliderComponent::Type>(record.collisionType);
+                switch (record.extentsKind)
+                {
+                case 0: component.extents = load(record.extents); break;
+                case 1: component.extents = record.extents[0]; break;
+                case 2: component.extents = std::make_pair(record.extents[0], record.extents[1]); break;
+                default: break;
+                }
+            });
+            break;
+        case ComponentType::Particle:
+            loadBlock<ParticleRecord>(block, entityManager.getParticleComponents(), [](const ParticleRecord&, ParticleComponent&){});
+            break;
+        default:
+            // Unknown blocks are skipped
+            break;
+        }
+    }
+
+    entityManager.reserveEntityIds(header.lastEntityId);
+
+    // Sounds and scripts are set up once every component is in place, so the vectors won't move under them
+    for (auto& sound : entityManager.getSoundComponents())
+        if (sound.name.size())
+            SoundManager::get().createSource(&sound, sound.name);
+
+    for (auto& script : entityManager.getScriptComponents())
+    {
+        if (script.filePath.empty())
+            continue;
+
+        const auto path = std::move(script.filePath);
+        script.filePath.clear();
+        ScriptSystem::get()->load(script, path);
+    }
+
+    emit entityManager.updateUI(entityManager.getEntityInfos());
+    return true;
+}
+
+bool SceneBinary::write(const std::string &path, EntityManager &entityManager)
+{
+    QFile file{QString::fromStdString(path)};
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "SceneBinary: Failed to open" << QString::fromStdString(path) << "for writing";
+        return false;
+    }
+
+    const auto data = serialize(entityManager);
+    return file.write(data) == data.size();
+}
+
+bool SceneBinary::read(const std::string &path, EntityManager &entityManager)
+{
+    QFile file{QString::fromStdString(path)};
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug() << "SceneBinary: Failed to open" << QString::fromStdString(path);
+        return false;
+    }
+
+    return deserialize(file.readAll(), entityManager);
+}
@@ -0,0 +1,35 @@
+#ifndef SCENEBINARY_H
+#define SCENEBINARY_H
+
+#include <string>
+#include <QByteArray>
+
+class EntityManager;
+
+/** Versioned binary scene format, used for the play mode snapshots. JSON is still used for saved scenes,
+ * since it can be diffed and merged.
+ * Layout: a fixed size header, then one block per component type, each a block header followed by
+ * one fixed size record per component, sorted by entity id like the component vectors. Strings, child
+ * lists and material parameters are stored in a data section at the end and referred to by offset.
+ * Loading a block fills the component vector in one pass, without the sort per insert addComponent does.
+ * Entities keep the ids they were saved with.
+ * @brief Versioned binary scene format.
+ */
+class SceneBinary
+{
+public:
+    //! File suffix of binary scenes. Scene::LoadFromFile and SaveToFile picks the format from it.
+    static constexpr const char* suffix{"scenebin"};
+
+    static QByteArray serialize(EntityManager& entityManager);
+    /**
+     * @brief Replaces all entities in the entity manager with the ones in data. Returns false if data isn't a valid scene
+     * of this version, in which case the entity manager is left untouched.
+     */
+    static bool deserialize(const QByteArray& data, EntityManager& entityManager);
+
+    static bool write(const std::string& path, EntityManager& entityManager);
+    static bool read(const std::string& path, EntityManager& entityManager);
+};
+
+#endif // SCENEBINARY_H
@@ -0,0 +1,100 @@
+#include "sceneloader.h"
+#include "entitymanager.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+SceneLoader::SceneLoader(EntityManager &entityManager, ProgressCallback progress)
+    : mEntityManager{entityManager}, mProgress{std::move(progress)}
+{
+
+}
+
+SceneLoader::~SceneLoader()
+{
+    finish();
+}
+
+bool SceneLoader::open(const std::string &path)
+{
+    QFile file(QString::fromStdString(path));
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        qDebug() << "ERROR Scene.load(): Failed to open file at specified path!";
+        return false;
+    }
+
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+    if(!document.isObject())
+    {
+        qDebug() << "Load Error: Wrong formatting";
+        return false;
+    }
+
+    QJsonObject mainObject = document.object();
+    if(mainObject.isEmpty())
+    {
+        qDebug() << "Load Error: File is empty.";
+        return false;
+    }
+
+    finish();
+    mEntities = mainObject["Entities"].toArray();
+    mNext = 0;
+
+    mEntityManager.clear();
+    mEntityManager.beginBatch();
+    mBatching = true;
+    return true;
+}
+
+bool SceneLoader::loadBatch(unsigned int batchSize)
+{
+    const auto end = std::min(mEntities.size(), mNext + static_cast<int>(batchSize));
+    for(; mNext < end; ++mNext)
+    {
+        // Current entity
+        auto entityObj = mEntities[mNext].toObject();
+
+        // Create the entity
+        auto entity = mEntityManager.createEntity(entityObj["Name"].toString().toStdString());
+        mEntityManager.getEntityInfos().back().shouldShowInEditor = entityObj["ShowInEditor"].toBool();
+
+        // Iterate all components
+        for(auto compRef : entityObj["Components"].toArray())
+        {
+            // Current component
+            auto compObject = compRef.toObject();
+
+            // Add the component and initialize it
+            auto comp = mEntityManager.addComponent(entity, static_cast<ComponentType>(compObject["ComponentType"].toInt()));
+            if(comp)
+                comp->fromJSON(compObject);
+        }
+    }
+
+    if(mProgress)
+        mProgress(loaded(), total());
+
+    if(isFinished())
+    {
+        finish();
+        return true;
+    }
+    return false;
+}
+
+void SceneLoader::loadAll()
+{
+    while(!loadBatch());
+}
+
+void SceneLoader::finish()
+{
+    if(mBatching)
+    {
+        mBatching = false;
+        mEntityManager.endBatch();
+    }
+}
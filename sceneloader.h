@@ -0,0 +1,57 @@
+#ifndef SCENELOADER_H
+#define SCENELOADER_H
+
+#include <string>
+#include <functional>
+#include <QJsonArray>
+
+class EntityManager;
+
+/** Loads the entities of a JSON scene a batch at a time.
+ * The file is parsed once when opened, and every call to loadBatch creates the next entities.
+ * The entity manager is kept in batch mode while loading, so components are appended to the pools
+ * without sorting and the UI is only updated once all entities are in.
+ * Load everything at once with loadAll, or call loadBatch once per frame to spread the work out.
+ * @brief Loads the entities of a JSON scene a batch at a time.
+ */
+class SceneLoader
+{
+public:
+    //! Called after every batch with the number of entities loaded so far and the total.
+    using ProgressCallback = std::function<void(unsigned int loaded, unsigned int total)>;
+
+    static constexpr unsigned int defaultBatchSize{1000};
+
+    SceneLoader(EntityManager& entityManager, ProgressCallback progress = ProgressCallback{});
+    SceneLoader(const SceneLoader&) = delete;
+    SceneLoader& operator= (const SceneLoader&) = delete;
+    //! Ends the batch if the loader is destroyed before it's done.
+    ~SceneLoader();
+
+    /**
+     * @brief Parses the scene at path and clears the entity manager. Returns false, leaving the
+     * entity manager untouched, if the file can't be read or isn't a scene.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Creates up to batchSize entities. Returns true when all entities have been loaded.
+     */
+    bool loadBatch(unsigned int batchSize = defaultBatchSize);
+    void loadAll();
+
+    bool isFinished() const { return mNext >= mEntities.size(); }
+    unsigned int loaded() const { return static_cast<unsigned int>(mNext); }
+    unsigned int total() const { return static_cast<unsigned int>(mEntities.size()); }
+
+private:
+    void finish();
+
+    EntityManager& mEntityManager;
+    ProgressCallback mProgress;
+    QJsonArray mEntities;
+    int mNext{0};
+    bool mBatching{false};
+};
+
+#endif // SCENELOADER_H
@@ -0,0 +1,214 @@
+#include "scriptquery.h"
+#include "entitymanager.h"
+#include "scriptsystem.h"
+#include "world.h"
+#include <QJSEngine>
+#include <QDebug>
+#include <cstring>
+
+namespace
+{
+//! A typed array of the given type (like "Float32Array") viewing a copy of data.
+QJSValue toTypedArray(QJSEngine& engine, const char* type, const QByteArray& data)
+{
+    return engine.globalObject().property(type).callAsConstructor(QJSValueList{} << engine.toScriptValue(data));
+}
+
+//! Copies the typed array back out. Returns an empty vector if it's missing or doesn't have count elements.
+template<class T>
+std::vector<T> fromTypedArray(const QJSValue& array, unsigned int count)
+{
+    auto data = array.property("buffer").toVariant().toByteArray();
+    if (static_cast<unsigned int>(data.size()) != count * sizeof(T))
+        return {};
+
+    std::vector<T> values(count);
+    std::memcpy(values.data(), data.constData(), data.size());
+    return values;
+}
+
+template<class T>
+QByteArray toBytes(const std::vector<T>& values)
+{
+    return QByteArray{reinterpret_cast<const char*>(values.data()), static_cast<int>(values.size() * sizeof(T))};
+}
+
+//! The values of a query, copied out of JS so they can be written from the main thread.
+struct QueryValues
+{
+    std::vector<unsigned int> ids;
+    std::vector<float> position, rotation, scale;
+    std::vector<float> velocity, acceleration, mass;
+};
+
+bool differs(const gsl::vec3& a, const gsl::vec3& b)
+{
+    return a.x != b.x || a.y != b.y || a.z != b.z;
+}
+
+void apply(const QueryValues& values)
+{
+    auto entityManager = World::getWorld().getEntityManager();
+    for (unsigned int i{0}; i < values.ids.size(); ++i)
+    {
+        const auto entity = values.ids[i];
+        if (values.position.size() || values.rotation.size() || values.scale.size())
+        {
+            if (auto comp = entityManager->getComponent<TransformComponent>(entity))
+            {
+                if (values.position.size())
+                {
+                    gsl::vec3 position{values.position[i * 3], values.position[i * 3 + 1], values.position[i * 3 + 2]};
+                    if (differs(position, comp->position))
+                        entityManager->setTransformPos(entity, position);
+                }
+                if (values.rotation.size())
+                {
+                    const auto& r = values.rotation;
+                    gsl::quat rotation{r[i * 4], r[i * 4 + 1], r[i * 4 + 2], r[i * 4 + 3]};
+                    if (rotation.s != comp->rotation.s || rotation.i != comp->rotation.i ||
+                        rotation.j != comp->rotation.j || rotation.k != comp->rotation.k)
+                        entityManager->setTransformRot(entity, rotation);
+                }
+                if (values.scale.size())
+                {
+                    gsl::vec3 scale{values.scale[i * 3], values.scale[i * 3 + 1], values.scale[i * 3 + 2]};
+                    if (differs(scale, comp->scale))
+                        entityManager->setTransformScale(entity, scale);
+                }
+            }
+        }
+
+        if (values.velocity.size() || values.acceleration.size() || values.mass.size())
+        {
+            if (auto comp = entityManager->getComponent<PhysicsComponent>(entity))
+            {
+                if (values.velocity.size())
+                    comp->velocity = gsl::vec3{values.velocity[i * 3], values.velocity[i * 3 + 1], values.velocity[i * 3 + 2]};
+                if (values.acceleration.size())
+                    comp->acceleration = gsl::vec3{values.acceleration[i * 3], values.acceleration[i * 3 + 1], values.acceleration[i * 3 + 2]};
+                if (values.mass.size())
+                    comp->mass = values.mass[i];
+            }
+        }
+    }
+}
+}
+
+QJSValue ScriptQuery::run(QJSEngine &engine, const QStringList &components)
+{
+    bool transforms{false}, physics{false};
+    for (const auto& name : components)
+    {
+        if (name == "transform")
+            transforms = true;
+        else if (name == "physics")
+            physics = true;
+        else
+            qDebug() << "engine.query: component" << name << "can't be queried";
+    }
+    if (!transforms && !physics)
+        return QJSValue{};
+
+    auto entityManager = World::getWorld().getEntityManager();
+    auto& transformComps = entityManager->getTransformComponents();
+    auto& physicsComps = entityManager->getPhysicsComponents();
+
+    // Both vectors are sorted by entity id, so the entities with all the components are found in one pass
+    std::vector<unsigned int> ids;
+    std::vector<const TransformComponent*> matchedTransforms;
+    std::vector<const PhysicsComponent*> matchedPhysics;
+    auto transformIt = transformComps.begin();
+    auto physicsIt = physicsComps.begin();
+    for (;;)
+    {
+        while (transforms && transformIt != transformComps.end() && !transformIt->valid)
+            ++transformIt;
+        while (physics && physicsIt != physicsComps.end() && !physicsIt->valid)
+            ++physicsIt;
+        if ((transforms && transformIt == transformComps.end()) || (physics && physicsIt == physicsComps.end()))
+            break;
+
+        if (transforms && physics && transformIt->entityId != physicsIt->entityId)
+        {
+            if (transformIt->entityId < physicsIt->entityId)
+                ++transformIt;
+            else
+                ++physicsIt;
+            continue;
+        }
+
+        ids.push_back(transforms ? transformIt->entityId : physicsIt->entityId);
+        if (transforms)
+            matchedTransforms.push_back(&*transformIt++);
+        if (physics)
+            matchedPhysics.push_back(&*physicsIt++);
+    }
+
+    const auto count = static_cast<unsigned int>(ids.size());
+    auto result = engine.newObject();
+    result.setProperty("count", count);
+    result.setProperty("ids", toTypedArray(engine, "Uint32Array", toBytes(ids)));
+
+    if (transforms)
+    {
+        std::vector<float> position, rotation, scale;
+        position.reserve(count * 3);
+        rotation.reserve(count * 4);
+        scale.reserve(count * 3);
+        for (auto comp : matchedTransforms)
+        {
+            position.insert(position.end(), {comp->position.x, comp->position.y, comp->position.z});
+            scale.insert(scale.end(), {comp->scale.x, comp->scale.y, comp->scale.z});
+            rotation.insert(rotation.end(), {comp->rotation.s, comp->rotation.i, comp->rotation.j, comp->rotation.k});
+        }
+        result.setProperty("position", toTypedArray(engine, "Float32Array", toBytes(position)));
+        result.setProperty("rotation", toTypedArray(engine, "Float32Array", toBytes(rotation)));
+        result.setProperty("scale", toTypedArray(engine, "Float32Array", toBytes(scale)));
+    }
+
+    if (physics)
+    {
+        std::vector<float> velocity, acceleration, mass;
+        velocity.reserve(count * 3);
+        acceleration.reserve(count * 3);
+        mass.reserve(count);
+        for (auto comp : matchedPhysics)
+        {
+            velocity.insert(velocity.end(), {comp->velocity.x, comp->velocity.y, comp->velocity.z});
+            acceleration.insert(acceleration.end(), {comp->acceleration.x, comp->acceleration.y, comp->acceleration.z});
+            mass.push_back(comp->mass);
+        }
+        result.setProperty("velocity", toTypedArray(engine, "Float32Array", toBytes(velocity)));
+        result.setProperty("acceleration", toTypedArray(engine, "Float32Array", toBytes(acceleration)));
+        result.setProperty("mass", toTypedArray(engine, "Float32Array", toBytes(mass)));
+    }
+
+    return result;
+}
+
+void ScriptQuery::commit(const QJSValue &result)
+{
+    if (!result.isObject())
+        return;
+
+    const auto count = result.property("count").toUInt();
+    QueryValues values;
+    values.ids = fromTypedArray<unsigned int>(result.property("ids"), count);
+    if (values.ids.size() != count)
+    {
+        qDebug() << "engine.commit: not a query result";
+        return;
+    }
+
+    values.position = fromTypedArray<float>(result.property("position"), count * 3);
+    values.rotation = fromTypedArray<float>(result.property("rotation"), count * 4);
+    values.scale = fromTypedArray<float>(result.property("scale"), count * 3);
+    values.velocity = fromTypedArray<float>(result.property("velocity"), count * 3);
+    values.acceleration = fromTypedArray<float>(result.property("acceleration"), count * 3);
+    values.mass = fromTypedArray<float>(result.property("mass"), count);
+
+    // Script threads can't write to the components while the other threads are running
+    if (!ScriptSystem::get()->defer([values](){ apply(values); }))
+        apply(values);
+}
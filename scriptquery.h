@@ -0,0 +1,41 @@
+#ifndef SCRIPTQUERY_H
+#define SCRIPTQUERY_H
+
+#include <QJSValue>
+#include <QStringList>
+
+class QJSEngine;
+
+/** Batch access to components from JS, for scripts working on many entities at once.
+ * A query returns the components of every entity that has all the given components, laid out
+ * as one typed array per property, instead of an entity wrapper and a proxy per entity.
+ * Changes to the arrays are written back to the components with engine.commit.
+ *
+ * Supported components and the arrays they add:
+ * - "transform": position (3 per entity), rotation (4 per entity, s i j k) and scale (3 per entity).
+ * - "physics": velocity (3 per entity), acceleration (3 per entity) and mass (1 per entity).
+ * All queries also have count and ids (Uint32Array).
+ *
+ * Example:
+ * let q = engine.query(["transform", "physics"]);
+ * for (let i = 0; i < q.count * 3; ++i)
+ *     q.position[i] += q.velocity[i] * engine.deltaTime;
+ * engine.commit(q);
+ * @brief Batch access to components from JS.
+ */
+class ScriptQuery
+{
+public:
+    /**
+     * @brief Returns the query result for the components, or undefined if none of them are supported.
+     */
+    static QJSValue run(QJSEngine& engine, const QStringList& components);
+
+    /**
+     * @brief Writes the arrays of a query result back to the components that still exist.
+     * Only the entities whose values have changed are written.
+     */
+    static void commit(const QJSValue& result);
+};
+
+#endif // SCRIPTQUERY_H
@@ -1,12 +1,16 @@
 #include "scriptsystem.h"
+#include "componentproxy.h"
+#include "scriptquery.h"
+#include "behavioursystem.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QTextStream>
 #include <QFileInfo>
 #include <QJsonDocument>
+#include <QRegularExpression>
 #include <QPoint>
 #include <cstring>
-#include <QJSValueIterator>
+#include <chrono>
 
 // For HitInfo struct
 #include "physicssystem.h"
@@ -15,396 +19,460 @@
 
 #include "Instrumentor.h"
 
+namespace
+{
+//! Which worker runs the script of an entity. Always the same, as the worker's engines hold the script's state.
+bool runsOn(unsigned int entity, unsigned int worker, unsigned int workerCount)
+{
+    return entity % workerCount == worker;
+}
+
+const QString helperFuncsFile{"../INNgine2019/JSHelperFuncs.js"};
+const QString mathFile{"../INNgine2019/JSMath.js"};
+}
+
+thread_local ScriptSystem::ScriptWorker* ScriptSystem::currentWorker{nullptr};
+thread_local ScriptComponent* ScriptSystem::currentComp{nullptr};
+thread_local QString ScriptSystem::currentFileName{};
 
 void ScriptSystem::update(std::vector<ScriptComponent> &scripts, std::vector<InputComponent> &inputs,
                           const std::vector<QString> &pressed, const std::vector<QString> &released,
                           const QPoint &point, std::vector<HitInfo> hitInfos, float deltaTime)
 {
     PROFILE_FUNCTION();
-    initializeHelperFuncs();
-    auto inpIt{inputs.begin()};
-
     mDeltaTime = deltaTime;
 
-    auto hitIt{hitInfos.begin()};
-    if (hitIt != hitInfos.end())
-    {
-        std::sort(hitIt, hitInfos.end());
-        hitIt = hitInfos.begin();
-    }
-
-    for (auto scriptIt{scripts.begin()}; scriptIt != scripts.end(); ++scriptIt)
+    // The scripts stay on the threads they were started on until play is stopped
+    if (!mPlaying)
     {
-        PROFILE_SCOPE("Scriptloop");
-        bool startedThisFrame = false;
-        if (!scriptIt->valid || scriptIt->engine == nullptr || !scriptIt->filePath.size())
-            continue;
-
-        auto functions = scriptIt->engine->newArray(10);
-        unsigned int i{0};
-        std::vector<QJSValue> funcObjs;
-        funcObjs.reserve(10);
-
-        // Beginplay
-        /* Note: This is called every frame, but only actually called on script components that this
-         * has not yet been done to. This is to catch script components spawned from scripts
-         * on runtime.
-         */
-        if (!scriptIt->beginplayRun)
+        while (mWorkers.size() < scriptThreads)
         {
-            PROFILE_SCOPE("Begin play");
-            // To catch changes to script during runtime
-            if(!load(*scriptIt, scriptIt->filePath))
-            {
-                qDebug() << "Failed to load" << scriptIt->filePath.c_str();
-                continue;
-            }
-
-            scriptIt->beginplayRun = true;
-            startedThisFrame = true;
-            funcObjs.push_back(scriptIt->engine->newObject());
-            funcObjs.back().setProperty("func", QJSValue{"beginPlay"});
-            funcObjs.back().setProperty("params", QJSValue{});
-            functions.setProperty(i, funcObjs.back());
-            ++i;
+            mWorkers.push_back(std::make_unique<ScriptWorker>());
+            mWorkers.back()->index = static_cast<unsigned int>(mWorkers.size() - 1);
         }
+        mActiveWorkers = scriptThreads;
+        mPlaying = true;
+
+        // Scripts loaded in the editor live in the main thread's engines, which the workers can't touch
+        if (mActiveWorkers)
+            for (auto& comp : scripts)
+                if (!comp.native)
+                    detach(comp);
+    }
 
-        if (!scriptIt->beginplayRun)
-            continue;
-
-        {
-            PROFILE_SCOPE("Tick");
-            // Tick
-            funcObjs.push_back(scriptIt->engine->newObject());
-            funcObjs.back().setProperty("func", QJSValue{"tick"});
-            funcObjs.back().setProperty("params", QJSValue{});
-            functions.setProperty(i, funcObjs.back());
-            ++i;
-        }
-
-        // Input functions
-        while (inpIt != inputs.end() && (!inpIt->valid || inpIt->entityId < scriptIt->entityId)) ++inpIt;
-
-        if (inpIt != inputs.end() && inpIt->entityId == scriptIt->entityId && inpIt->controlledWhilePlaying)
-        {
-
-            if(!scriptIt->JSEntity)
-            {
-                initializeJSEntity(*scriptIt);
-            }
-
-            // Pressed key event
-            if (pressed.size())
-            {
-                PROFILE_SCOPE("Pressed key");
-                auto array = scriptIt->engine->newArray(static_cast<unsigned>(pressed.size()));
-                for(unsigned i = 0; i < pressed.size(); ++i)
-                {
-                    array.setProperty(i, pressed[i]);
-                }
-                funcObjs.push_back(scriptIt->engine->newObject());
-                funcObjs.back().setProperty("func", QJSValue{"inputPressed"});
-                funcObjs.back().setProperty("params", array);
-                functions.setProperty(i, funcObjs.back());
-                ++i;
-            }
+    reloadChangedScripts(scripts);
 
-            // Released key event
-            if (released.size())
-            {
-                PROFILE_SCOPE("Released key");
-                auto array = scriptIt->engine->newArray(static_cast<unsigned>(released.size()));
-                for(unsigned i = 0; i < released.size(); ++i)
-                {
-                    array.setProperty(i, released[i]);
-                }
-                funcObjs.push_back(scriptIt->engine->newObject());
-                funcObjs.back().setProperty("func", QJSValue{"inputReleased"});
-                funcObjs.back().setProperty("params", array);
-                functions.setProperty(i, funcObjs.back());
-                ++i;
-            }
+    /* Note: This is called every frame, but only actually called on script components that this
+     * has not yet been done to. This is to catch script components spawned from scripts
+     * on runtime.
+     */
+    runOnWorkers([&](unsigned int worker, unsigned int workerCount){
+        beginPlay(scripts, worker, workerCount);
+    });
+
+    if (mSubscribersDirty)
+        updateSubscribers(scripts);
+
+    std::sort(hitInfos.begin(), hitInfos.end());
+    runOnWorkers([&](unsigned int worker, unsigned int workerCount){
+        tick(scripts, worker, workerCount);
+        runInputEvents(scripts, inputs, pressed, released, point, worker, workerCount);
+        runHitEvents(scripts, hitInfos, worker, workerCount);
+    });
+}
 
-            {
-                PROFILE_SCOPE("Mouse movement");
-                // Mouse movement event
-                auto array = scriptIt->engine->newArray(2);
-                array.setProperty(0, point.x());
-                array.setProperty(1, point.y());
-                funcObjs.push_back(scriptIt->engine->newObject());
-                funcObjs.back().setProperty("func", QJSValue{"mouseMoved"});
-                funcObjs.back().setProperty("params", array);
-                functions.setProperty(i, funcObjs.back());
-                ++i;
-            }
-        }
+void ScriptSystem::runOnWorkers(const std::function<void (unsigned int, unsigned int)> &job)
+{
+    if (!mActiveWorkers)
+    {
+        job(0, 1);
+        return;
+    }
 
+    PROFILE_FUNCTION();
+    const auto workerCount = mActiveWorkers;
+    std::vector<std::future<void>> done;
+    done.reserve(workerCount);
+    for (unsigned int i{0}; i < workerCount; ++i)
+    {
+        auto worker = mWorkers[i].get();
+        done.push_back(worker->pool.submit([worker, i, workerCount, &job](){
+            currentWorker = worker;
+            job(i, workerCount);
+            currentWorker = nullptr;
+        }));
+    }
+    for (auto& future : done)
+        future.get();
 
-        // Hit events
-        while (hitIt != hitInfos.end() && hitIt->eID < scriptIt->entityId) ++hitIt;
+    applyCommands();
+}
 
-        /* Note: Physics system only reacts to first thing that it collides with
-         * frame. A.k.a. one object can only collide with one other object each
-         * frame and get information about that collision.
-         * It would be easy to implement a workaround on this. Either by sending
-         * in multiple hit results as an array or by running the same function
-         * multiple times per hit function.
-         */
-        if (hitIt != hitInfos.end() && scriptIt->entityId == hitIt->eID)
+void ScriptSystem::applyCommands()
+{
+    PROFILE_FUNCTION();
+    // Spawned entities first, worker by worker, so their ids don't depend on which thread finished first
+    auto entityManager = World::getWorld().getEntityManager();
+    for (auto& worker : mWorkers)
+        for (unsigned int i{0}; i < worker->spawnCount; ++i)
         {
-            PROFILE_SCOPE("Hit events");
-            QJSValue val = scriptIt->engine->newObject();
-            val.setProperty("ID", static_cast<int>(hitIt->collidingEID));
-            auto arr = scriptIt->engine->newArray(3);
-            for (unsigned int i{0}; i < 3; ++i)
-                arr.setProperty(i, static_cast<double>(hitIt->hitPoint[i]));
-            val.setProperty("hitPoint", arr);
-            for (unsigned int i{0}; i < 3; ++i)
-                arr.setProperty(i, static_cast<double>(hitIt->velocity[i]));
-            val.setProperty("velocity", arr);
-            for (unsigned int i{0}; i < 3; ++i)
-                arr.setProperty(i, static_cast<double>(hitIt->collidingNormal[i]));
-            val.setProperty("collidingNormal", arr);
-
-            funcObjs.push_back(scriptIt->engine->newObject());
-            funcObjs.back().setProperty("func", QJSValue{"onHit"});
-            funcObjs.back().setProperty("params", val);
-            functions.setProperty(i, funcObjs.back());
-            ++i;
+            const auto entity = entityManager->createEntity();
+            if (!i)
+                worker->firstSpawnedId = entity;
         }
 
+    for (auto& component : mDeferredComponents)
+        component->entityId = resolveEntity(component->entityId);
+    for (auto& worker : mWorkers)
+    {
+        for (auto& wrapper : worker->spawnedWrappers)
+            if (wrapper)
+                wrapper->setProperty("ID", resolveEntity(wrapper->property("ID").toUInt()));
+        for (auto& proxy : worker->spawnedProxies)
+            if (proxy)
+                proxy->setId(resolveEntity(proxy->id()));
+    }
 
-        {
-            PROFILE_SCOPE("Javascript");
-            // Finally run functions from JavaScript:
-            QJSValueList list;
-            list << functions;
-            auto changedComps = call(*scriptIt, "updateLoop", list);
-
-            if (changedComps.isError())
-                continue;
+    // Worker by worker, so the result doesn't depend on which thread finished first
+    for (auto& worker : mWorkers)
+    {
+        for (auto& command : worker->commands)
+            command();
+        worker->commands.clear();
+        worker->spawnCount = 0;
+        worker->spawnedWrappers.clear();
+        worker->spawnedProxies.clear();
+    }
+}
 
-            // Remember to do this after all functions have run but before contructing objects
-            if (startedThisFrame)
-                cacheGlobalVariables(*scriptIt);
+bool ScriptSystem::defer(std::function<void ()> command)
+{
+    if (!currentWorker)
+        return false;
 
+    currentWorker->commands.push_back(std::move(command));
+    return true;
+}
 
-            // Update cpp comps
-            // updateCPPComponent(*scriptIt, changedComps);
-        }
-    }
+bool ScriptSystem::isScriptThread()
+{
+    return currentWorker != nullptr;
 }
 
-void ScriptSystem::beginPlay(std::vector<ScriptComponent>& comps)
+void ScriptSystem::beginPlay(std::vector<ScriptComponent>& comps, unsigned int worker, unsigned int workerCount)
 {
 
     PROFILE_FUNCTION();
-    // To catch changes to helper function script during runtime
-    initializeHelperFuncs();
-
     for (auto scriptIt = comps.begin(); scriptIt != comps.end(); ++scriptIt)
     {
-        if(scriptIt->filePath.size() && !scriptIt->beginplayRun)
+        if(scriptIt->valid && scriptIt->filePath.size() && !scriptIt->beginplayRun && !scriptIt->native &&
+           runsOn(scriptIt->entityId, worker, workerCount))
         {
-            // To catch changes to script during runtime
             if(!load(*scriptIt, scriptIt->filePath))
             {
                 qDebug() << "Failed to load" << scriptIt->filePath.c_str();
                 continue;
             }
+            // Native behaviours are started by the BehaviourSystem
+            if(scriptIt->native)
+                continue;
             scriptIt->beginplayRun = true;
-            call(*scriptIt, "beginPlay");
-            cacheGlobalVariables(*scriptIt);
+            callFunction(*scriptIt, scriptIt->callbacks.beginPlay);
         }
     }
 }
 
-void ScriptSystem::tick(float deltaTime, std::vector<ScriptComponent>& comps)
+void ScriptSystem::detach(ScriptComponent &comp)
 {
-    PROFILE_FUNCTION();
-    mDeltaTime = deltaTime;
-    for (auto scriptIt = comps.begin(); scriptIt != comps.end(); ++scriptIt)
-    {
-        if(scriptIt->filePath.size() && scriptIt->beginplayRun)
-        {
-            call(*scriptIt, "tick");
-        }
-    }
+    // Values must be released before their engine is deleted
+    comp.scope = QJSValue{};
+    comp.callbacks = ScriptComponent::Callbacks{};
+    comp.accessedComponents.clear();
+    delete comp.JSEntity;
+    comp.JSEntity = nullptr;
+    if (comp.ownsEngine)
+        delete comp.engine;
+    comp.engine = nullptr;
+    comp.ownsEngine = false;
+    comp.beginplayRun = false;
+    mSubscribersDirty = true;
 }
 
-void ScriptSystem::endPlay(std::vector<ScriptComponent>& comps)
+void ScriptSystem::updateSubscribers(const std::vector<ScriptComponent> &comps)
 {
-
-    for (auto scriptIt = comps.begin(); scriptIt != comps.end(); ++scriptIt)
+    PROFILE_FUNCTION();
+    mTickSubscribers.clear();
+    mInputSubscribers.clear();
+    for (const auto& comp : comps)
     {
-        if(scriptIt->filePath.size() && scriptIt->beginplayRun)
-        {
-            call(*scriptIt, "endPlay");
-            scriptIt->beginplayRun = false;
-        }
+        if (!comp.valid || !comp.beginplayRun)
+            continue;
+
+        const auto& callbacks = comp.callbacks;
+        if (callbacks.tick.isCallable())
+            mTickSubscribers.push_back(comp.entityId);
+        if (callbacks.inputPressed.isCallable() || callbacks.inputReleased.isCallable() || callbacks.mouseMoved.isCallable())
+            mInputSubscribers.push_back(comp.entityId);
     }
+    mSubscribersDirty = false;
 }
 
-void ScriptSystem::runKeyPressedEvent(std::vector<ScriptComponent>& scripts, std::vector<InputComponent>& inputs, const std::vector<QString>& keys)
+ScriptComponent* ScriptSystem::findScript(std::vector<ScriptComponent>::iterator& it, std::vector<ScriptComponent>::iterator end, unsigned int entity)
 {
+    it = std::lower_bound(it, end, entity, [](const ScriptComponent& comp, unsigned int id){ return comp.entityId < id; });
+    if (it == end || it->entityId != entity || !it->valid || !it->beginplayRun)
+        return nullptr;
+    return &*it;
+}
 
-    if(!keys.size())
-        return;
+void ScriptSystem::tick(std::vector<ScriptComponent>& comps, unsigned int worker, unsigned int workerCount)
+{
     PROFILE_FUNCTION();
-    for (auto inputIt = inputs.begin(); inputIt != inputs.end(); ++inputIt)
+    auto scriptIt = comps.begin();
+    for (auto entity : mTickSubscribers)
     {
-        if(!inputIt->controlledWhilePlaying)
+        if (!runsOn(entity, worker, workerCount))
             continue;
+        if (auto script = findScript(scriptIt, comps.end(), entity))
+            callFunction(*script, script->callbacks.tick);
+    }
+}
 
-        for (auto scriptIt = scripts.begin(); scriptIt != scripts.end(); ++scriptIt)
+void ScriptSystem::endPlay(std::vector<ScriptComponent>& comps)
+{
+
+    runOnWorkers([&](unsigned int worker, unsigned int workerCount){
+        for (auto scriptIt = comps.begin(); scriptIt != comps.end(); ++scriptIt)
         {
-            if(!scriptIt->filePath.size() || !scriptIt->beginplayRun)
+            if(scriptIt->native || !runsOn(scriptIt->entityId, worker, workerCount))
                 continue;
 
-            if(!scriptIt->JSEntity)
-            {
-                initializeJSEntity(*scriptIt);
-            }
-
-            QJSValueList list;
-            auto array = scriptIt->engine->newArray(static_cast<unsigned>(keys.size()));
-            for(unsigned i = 0; i < keys.size(); ++i)
+            if(scriptIt->filePath.size() && scriptIt->beginplayRun)
             {
-                array.setProperty(i, keys[i]);
+                call(*scriptIt, "endPlay");
+                scriptIt->beginplayRun = false;
             }
-            list << array;
-            call(*scriptIt, "inputPressed", list);
+            // Released on the worker's own thread, so its engines can be deleted
+            if(mActiveWorkers)
+                detach(*scriptIt);
         }
-    }
+    });
+    mPlaying = false;
+    // Scripts run on the main thread until play starts again, and the workers may be fewer after this
+    mActiveWorkers = 0;
+
+    while (scriptThreads < mWorkers.size())
+        mWorkers.pop_back();
 }
 
-void ScriptSystem::runKeyReleasedEvent(std::vector<ScriptComponent>& scripts, std::vector<InputComponent> &inputs, const std::vector<QString>& keys)
+void ScriptSystem::runInputEvents(std::vector<ScriptComponent>& scripts, std::vector<InputComponent>& inputs,
+                                  const std::vector<QString>& pressed, const std::vector<QString>& released, const QPoint& point,
+                                  unsigned int worker, unsigned int workerCount)
 {
-
-    if(!keys.size())
+    const bool mouseMoved = !point.isNull();
+    if (!mInputSubscribers.size() || !(pressed.size() || released.size() || mouseMoved))
         return;
     PROFILE_FUNCTION();
-    for (auto inputIt = inputs.begin(); inputIt != inputs.end(); ++inputIt)
-    {
-        if(!inputIt->controlledWhilePlaying)
-            continue;
 
-        for (auto scriptIt = scripts.begin(); scriptIt != scripts.end(); ++scriptIt)
+    // The input arrays are the same for every script, so they're only made once per engine
+    struct InputArgs
+    {
+        QJSValue pressed, released, mouse;
+    };
+    std::map<QJSEngine*, InputArgs> engineArgs;
+    auto getArgs = [&](QJSEngine* engine) -> InputArgs& {
+        auto& args = engineArgs[engine];
+        if (args.mouse.isUndefined())
         {
-            if(!scriptIt->filePath.size() || !scriptIt->beginplayRun)
-                continue;
-
-            if(!scriptIt->JSEntity)
-            {
-                initializeJSEntity(*scriptIt);
-            }
-
-            QJSValueList list;
-            auto array = scriptIt->engine->newArray(static_cast<unsigned>(keys.size()));
-            for(unsigned i = 0; i < keys.size(); ++i)
-            {
-                array.setProperty(i, keys[i]);
-            }
-            list << array;
-            call(*scriptIt, "inputReleased", list);
+            args.pressed = engine->newArray(static_cast<unsigned>(pressed.size()));
+            for(unsigned i = 0; i < pressed.size(); ++i)
+                args.pressed.setProperty(i, pressed[i]);
+            args.released = engine->newArray(static_cast<unsigned>(released.size()));
+            for(unsigned i = 0; i < released.size(); ++i)
+                args.released.setProperty(i, released[i]);
+            args.mouse = engine->newArray(2);
+            args.mouse.setProperty(0, point.x());
+            args.mouse.setProperty(1, point.y());
         }
-    }
-}
+        return args;
+    };
 
-void ScriptSystem::runMouseOffsetEvent(std::vector<ScriptComponent> &scripts, std::vector<InputComponent> &inputs, const QPoint& point)
-{
-    PROFILE_FUNCTION();
-    for (auto inputIt = inputs.begin(); inputIt != inputs.end(); ++inputIt)
+    auto scriptIt = scripts.begin();
+    auto inputIt = inputs.begin();
+    for (auto entity : mInputSubscribers)
     {
-        if(!inputIt->controlledWhilePlaying)
+        if (!runsOn(entity, worker, workerCount))
             continue;
 
-        for (auto scriptIt = scripts.begin(); scriptIt != scripts.end(); ++scriptIt)
-        {
-            if(!scriptIt->filePath.size() || !scriptIt->beginplayRun)
-                continue;
+        inputIt = std::lower_bound(inputIt, inputs.end(), entity, [](const InputComponent& comp, unsigned int id){ return comp.entityId < id; });
+        if (inputIt == inputs.end())
+            break;
+        if (inputIt->entityId != entity || !inputIt->valid || !inputIt->controlledWhilePlaying)
+            continue;
 
-            if(!scriptIt->JSEntity)
-            {
-                initializeJSEntity(*scriptIt);
-            }
+        auto script = findScript(scriptIt, scripts.end(), entity);
+        if (!script)
+            continue;
 
-            QJSValueList list;
-            auto array = scriptIt->engine->newArray(2);
-            array.setProperty(0, point.x());
-            array.setProperty(1, point.y());
-            list << array;
-            call(*scriptIt, "mouseMoved", list);
-        }
+        auto& callbacks = script->callbacks;
+        auto& args = getArgs(script->engine);
+        // Pressed key event
+        if (pressed.size())
+            callFunction(*script, callbacks.inputPressed, QJSValueList{} << args.pressed);
+        // Released key event
+        if (released.size())
+            callFunction(*script, callbacks.inputReleased, QJSValueList{} << args.released);
+        // Mouse movement event
+        if (mouseMoved)
+            callFunction(*script, callbacks.mouseMoved, QJSValueList{} << args.mouse);
     }
 }
 
-void ScriptSystem::runHitEvents(std::vector<ScriptComponent>& comps, std::vector<HitInfo> hitInfos)
+void ScriptSystem::runHitEvents(std::vector<ScriptComponent>& comps, const std::vector<HitInfo>& hitInfos,
+                                unsigned int worker, unsigned int workerCount)
 {
 
     if(!comps.size() || !hitInfos.size())
         return;
     PROFILE_FUNCTION();
 
+    /* Note: Physics system only reacts to first thing that it collides with
+     * frame. A.k.a. one object can only collide with one other object each
+     * frame and get information about that collision.
+     * It would be easy to implement a workaround on this. Either by sending
+     * in multiple hit results as an array or by running the same function
+     * multiple times per hit function.
+     */
+    auto scriptIt = comps.begin();
     for (auto it = hitInfos.begin(); it != hitInfos.end(); ++it)
     {
-        QJsonObject hitJSON;
-        hitJSON.insert("ID", static_cast<int>(it->collidingEID));
-        hitJSON.insert("hitPoint", it->hitPoint.toJSON());
-        hitJSON.insert("velocity", it->velocity.toJSON());
-        hitJSON.insert("collidingNormal", it->collidingNormal.toJSON());
-
-        QJSValueList list;
-        QJsonDocument doc(hitJSON);
-
-        for (auto scriptIt = comps.begin(); scriptIt != comps.end(); ++scriptIt)
-        {
-            if(!scriptIt->filePath.size() || !scriptIt->beginplayRun)
-                continue;
+        if (!runsOn(it->eID, worker, workerCount))
+            continue;
 
-            if(!scriptIt->JSEntity)
-            {
-                initializeJSEntity(*scriptIt);
-            }
+        auto script = findScript(scriptIt, comps.end(), it->eID);
+        if (!script || !script->callbacks.onHit.isCallable())
+            continue;
 
-            if(scriptIt->entityId == it->eID)
-            {
-                list << scriptIt->engine->toScriptValue(hitJSON);
-                call(*scriptIt, "onHit", list);
-            }
-        }
+        auto engine = script->engine;
+        auto toArray = [&](const gsl::vec3& vec){
+            auto arr = engine->newArray(3);
+            for (unsigned int i{0}; i < 3; ++i)
+                arr.setProperty(i, static_cast<double>(vec[i]));
+            return arr;
+        };
+        QJSValue val = engine->newObject();
+        val.setProperty("ID", static_cast<int>(it->collidingEID));
+        val.setProperty("hitPoint", toArray(it->hitPoint));
+        val.setProperty("velocity", toArray(it->velocity));
+        val.setProperty("collidingNormal", toArray(it->collidingNormal));
+
+        callFunction(*script, script->callbacks.onHit, QJSValueList{} << val);
     }
 }
 
-void ScriptSystem::updateJSComponents(std::vector<ScriptComponent>& comps)
+QJSValue ScriptSystem::addComponent(unsigned entity, ComponentType type)
 {
-    PROFILE_FUNCTION();
-    for (auto it = comps.begin(); it != comps.end(); ++it)
+    if(!currentComp)
+        return QJSValue();
+
+    std::unique_lock<std::mutex> lock{mMutex};
+    if(!World::getWorld().getEntityManager()->getComponent(entity, type) && !findDeferredComponent(entity, type))
     {
-        if(it->filePath.size())
+        std::unique_ptr<Component> component;
+        switch (type)
         {
-            updateJSComponent(*it);
+        case ComponentType::Transform: component = std::make_unique<TransformComponent>(entity, true); break;
+        case ComponentType::Physics: component = std::make_unique<PhysicsComponent>(entity, true); break;
+        case ComponentType::Mesh: component = std::make_unique<MeshComponent>(entity, true); break;
+        case ComponentType::Camera: component = std::make_unique<CameraComponent>(entity, true); break;
+        case ComponentType::Input: component = std::make_unique<InputComponent>(entity, true); break;
+        case ComponentType::Sound: component = std::make_unique<SoundComponent>(entity, true); break;
+        case ComponentType::LightPoint: component = std::make_unique<PointLightComponent>(entity, true); break;
+        case ComponentType::LightSpot: component = std::make_unique<SpotLightComponent>(entity, true); break;
+        case ComponentType::LightDirectional: component = std::make_unique<DirectionalLightComponent>(entity, true); break;
+        case ComponentType::Script: component = std::make_unique<ScriptComponent>(entity, true); break;
+        case ComponentType::Collider: component = std::make_unique<ColliderComponent>(entity, true); break;
+        default: return QJSValue();
         }
+        mDeferredComponents.push_back(std::move(component));
     }
+    lock.unlock();
+
+    return getComponentProxy(entity, type);
+}
+
+QJSValue ScriptSystem::getComponent(unsigned entity, ComponentType type)
+{
+    if(!currentComp)
+        return QJSValue();
+
+    if(!World::getWorld().getEntityManager()->getComponent(entity, type) && !getDeferredComponent(entity, type))
+        return QJSValue();
+
+    return getComponentProxy(entity, type);
+}
+
+Component* ScriptSystem::getDeferredComponent(unsigned entity, ComponentType type)
+{
+    std::lock_guard<std::mutex> lock{mMutex};
+    return findDeferredComponent(entity, type);
+}
+
+Component* ScriptSystem::findDeferredComponent(unsigned entity, ComponentType type)
+{
+    for(auto& component : mDeferredComponents)
+        if(component->entityId == entity && component->type == type)
+            return component.get();
+    return nullptr;
+}
+
+namespace
+{
+template<class T>
+void moveComponent(Component& from, Component& to)
+{
+    static_cast<T&>(to) = std::move(static_cast<T&>(from));
+}
 }
 
-void ScriptSystem::updateCPPComponents(std::vector<ScriptComponent> &comps)
+void ScriptSystem::addDeferredComponents()
 {
+    if(mDeferredComponents.empty())
+        return;
+
     PROFILE_FUNCTION();
-    std::vector<QJsonObject> deferredSpawning;
-    for(auto it{comps.begin()}; it != comps.end(); ++it)
+    auto deferred = std::move(mDeferredComponents);
+    mDeferredComponents.clear();
+
+    auto entityManager = World::getWorld().getEntityManager();
+    for(auto& component : deferred)
     {
-        if(it->valid && it->filePath.size())
+        auto live = entityManager->addComponent(component->entityId, component->type);
+        if(!live)
+            continue;
+
+        switch (component->type)
+        {
+        case ComponentType::Transform: moveComponent<TransformComponent>(*component, *live); break;
+        case ComponentType::Physics: moveComponent<PhysicsComponent>(*component, *live); break;
+        case ComponentType::Mesh: moveComponent<MeshComponent>(*component, *live); break;
+        case ComponentType::Camera: moveComponent<CameraComponent>(*component, *live); break;
+        case ComponentType::Input: moveComponent<InputComponent>(*component, *live); break;
+        case ComponentType::Sound: moveComponent<SoundComponent>(*component, *live); break;
+        case ComponentType::LightPoint: moveComponent<PointLightComponent>(*component, *live); break;
+        case ComponentType::LightSpot: moveComponent<SpotLightComponent>(*component, *live); break;
+        case ComponentType::LightDirectional: moveComponent<DirectionalLightComponent>(*component, *live); break;
+        case ComponentType::Collider: moveComponent<ColliderComponent>(*component, *live); break;
+        case ComponentType::Script:
         {
-            updateCPPComponent(*it, deferredSpawning);
+            // The script is loaded and started by the next update since beginplayRun is false
+            moveComponent<ScriptComponent>(*component, *live);
+            break;
         }
-    }
-
-    for(auto& object : deferredSpawning)
-    {
-        auto comp = World::getWorld().getEntityManager()->addComponent(object["ID"].toInt(), static_cast<ComponentType>(object["ComponentType"].toInt()));
-        comp->fromJSON(object);
-        comp->valid = true;
+        default:
+            break;
+        }
+        live->valid = true;
     }
 }
 
@@ -418,7 +486,7 @@ QString ScriptSystem::checkError(QJSValue value)
                   " : " +
                   valueString +
                   " in script " +
-                  currentFileName +
+                  (currentFileName.size() ? currentFileName : QString::fromStdString(currentComp->filePath)) +
                   ", entity " +
                   QString::number(currentComp->entityId));
     qDebug() << error;
@@ -427,235 +495,449 @@ QString ScriptSystem::checkError(QJSValue value)
 
 QEntity* ScriptSystem::getEntityWrapper(unsigned int entity)
 {
-    return new QEntity(entity, this);
+    if(!currentWorker)
+        return new QEntity(entity, this);
+
+    // Objects can't have a parent on another thread, so wrappers made on script threads are owned by JS
+    auto wrapper = new QEntity(entity);
+    if(entity & placeholderBit)
+        currentWorker->spawnedWrappers.push_back(wrapper);
+    return wrapper;
 }
 
-void ScriptSystem::takeOutTheTrash(std::vector<ScriptComponent> &comps)
+void ScriptSystem::collectGarbage(std::vector<ScriptComponent> &comps)
 {
     PROFILE_FUNCTION();
-    for (auto it = comps.begin(); it != comps.end(); ++it)
+    if (comps.empty())
+        return;
+
+    auto entityManager = World::getWorld().getEntityManager();
+    const auto start = std::chrono::steady_clock::now();
+    const std::chrono::microseconds budget{garbageCollectionBudget};
+    for (std::size_t visited{0}; visited < comps.size(); ++visited)
     {
-        if (!(it->valid && it->engine))
-            continue;
+        if (comps.size() <= mGarbageCursor)
+            mGarbageCursor = 0;
+        auto& proxies = comps[mGarbageCursor++].accessedComponents;
 
-        auto cachedComps = it->engine->globalObject().property("accessedComponents");
-        if (!cachedComps.isUndefined() && cachedComps.isArray())
+        for (auto it = proxies.begin(); it != proxies.end();)
         {
-            auto variables = globalVariables[it->entityId];
-            QJSValue variableArray = it->engine->newArray(static_cast<unsigned int>(variables.size()));
-            for (unsigned int i{0}; i < variables.size(); ++i)
-                variableArray.setProperty(i, variables[i]);
-
-            QJSValueList args;
-            args << variableArray;
-            call(*it, "deleteUnusedVariables", args);
+            const auto entity = static_cast<unsigned int>(it->first >> 8);
+            const auto type = static_cast<ComponentType>(it->first & 0xff);
+            if (it->second.isNull() || !(entityManager->getComponent(entity, type) || findDeferredComponent(entity, type)))
+                it = proxies.erase(it);
+            else
+                ++it;
         }
+
+        if (budget <= std::chrono::steady_clock::now() - start)
+            break;
     }
 }
 
-std::vector<QString> ScriptSystem::findGlobalsInFile(const std::string &file) const
+
+bool ScriptSystem::load(ScriptComponent& comp, const std::string& file)
 {
-    int scopeLevel{0};
-    std::vector<QString> variables{};
-    std::ifstream ifs{file, ifs.in};
-    if (!ifs)
+
+    PROFILE_FUNCTION();
+    CurrentScript current{comp};
+
+    if(!file.size())
     {
-        return {};
+        return false;
     }
 
-    std::string line;
-    while (std::getline(ifs, line))
+    if(BehaviourSystem::get()->isRegistered(file))
     {
-        for (unsigned int s{0}, i{0}; i < line.length(); ++i)
-        {
-            if (line[i] == ';')
-            {
-                // Loops through prefix words in a c-style string literal array
-                for (const auto& prefix : {"let", "var", "const"})
-                {
-                    // Finds the position of the first place where the prefix matches the string
-                    auto pos = line.find(prefix, s, i - s);
-                    if (pos != line.npos)
-                    {
-                        // Add characters to move to variable that is defined afterwards.
-                        pos += std::strlen(prefix) + 1;
+        // Values must be released before their engine is deleted
+        comp.callbacks = ScriptComponent::Callbacks{};
+        comp.accessedComponents.clear();
+        comp.scope = QJSValue{};
+        if(comp.ownsEngine)
+            delete comp.engine;
+        comp.engine = nullptr;
+        comp.ownsEngine = false;
+
+        // Started by the BehaviourSystem on the next update
+        comp.filePath = file;
+        comp.native = true;
+        comp.beginplayRun = false;
+        mSubscribersDirty = true;
+        return true;
+    }
+    if(comp.native)
+    {
+        comp.native = false;
+        comp.beginplayRun = false;
+    }
 
-                        // Find start and end
-                        auto start = line.find_first_not_of(" ", pos, i);
+    const auto path = QString::fromStdString(gsl::scriptsFilePath + file);
 
-                        auto end = line.find_first_of(" =;([{.,+-*/?%<>&^|~", pos, i + 1);
+    // Script threads always use their own shared engines, as engines can only run on the thread that made them
+    if(shareEngines || currentWorker)
+    {
+        auto& shared = getSharedScript(path);
+        if(shared.factory.isUndefined())
+            return false;
 
-                        variables.push_back(QString::fromStdString(line.substr(start, end)));
+        if(comp.ownsEngine)
+        {
+            comp.callbacks = ScriptComponent::Callbacks{};
+            comp.accessedComponents.clear();
+            comp.scope = QJSValue{};
+            delete comp.engine;
+        }
+        comp.engine = shared.engine.get();
+        comp.ownsEngine = false;
 
-                        break;
-                    }
-                }
+        // The context holds what the script sees as globals and is filled in with the script's functions
+        comp.scope = comp.engine->newObject();
+        comp.scope.setProperty("entityID", comp.entityId);
+        comp.scope.setProperty("state", comp.engine->newObject());
+        initializeJSEntity(comp);
 
-                s = i + 1;
-            }
-            else if (line[i] == '{' || line[i] == '}')
-            {
-                scopeLevel += (line[i] == '{') ? 1 : -1;
-                s = i + 1;
-            }
+        auto value = shared.factory.call(QJSValueList{} << comp.scope);
+        if(value.isError())
+        {
+            checkError(value);
+            return false;
         }
     }
+    else
+    {
+        QString contents;
+        if(!getSource(path, contents))
+            return false;
 
-    return variables;
-}
+        if(!comp.engine || !comp.ownsEngine)
+        {
+            comp.engine = createEngine();
+            comp.ownsEngine = true;
+            comp.scope = comp.engine->globalObject();
+            delete comp.JSEntity;
+            comp.JSEntity = nullptr;
+        }
 
-void ScriptSystem::cacheGlobalVariables(ScriptComponent &comp)
-{
-    PROFILE_FUNCTION();
-    if (comp.engine)
-    {
-        QJSValueIterator jsIt{comp.engine->globalObject()};
-        while (jsIt.hasNext())
+        comp.scope.setProperty("entityID", comp.entityId);
+        comp.scope.setProperty("state", comp.engine->newObject());
+        if(!comp.JSEntity)
         {
-            jsIt.next();
-            if (!jsIt.value().property("ComponentType").isUndefined() &&
-                jsIt.value().property("ComponentType").isNumber() &&
-                !jsIt.value().isCallable())
-            {
-                globalVariables[comp.entityId].push_back(jsIt.name());
-            }
+            initializeJSEntity(comp);
+        }
+
+        auto value = comp.engine->evaluate(mHelperFuncs + contents, path);
+        if(value.isError())
+        {
+            checkError(value);
+            return false;
         }
     }
+
+    comp.filePath = QFileInfo(path).baseName().toStdString() + ".js";
+    cacheCallbacks(comp);
+    return true;
 }
 
-void ScriptSystem::initGarbageCollection()
+bool ScriptSystem::reload(ScriptComponent &comp)
 {
+    CurrentScript current{comp};
+    const auto path = QString::fromStdString(gsl::scriptsFilePath + comp.filePath);
 
-    /* Remember to clear variablecache.
-     * Would'nt be a good garbage collector if it
-     * didn't clear it's own garbage would it?
-     */
-    if (!globalVariables.empty())
-        globalVariables.clear();
+    QJSValue value;
+    if(comp.ownsEngine)
+    {
+        QString contents;
+        if(!getSource(path, contents))
+            return false;
+        value = comp.engine->evaluate(mHelperFuncs + contents, path);
+    }
+    else
+    {
+        auto& shared = getSharedScript(path);
+        if(shared.factory.isUndefined())
+            return false;
+        // Same context, so the entity's state object carries over to the new functions
+        value = shared.factory.call(QJSValueList{} << comp.scope);
+    }
+
+    if(value.isError())
+    {
+        checkError(value);
+        return false;
+    }
+
+    cacheCallbacks(comp);
+    return true;
 }
 
-bool ScriptSystem::load(ScriptComponent& comp, const std::string& file)
+QJSEngine* ScriptSystem::createEngine()
 {
+    auto engine = new QJSEngine();
+    engine->installExtensions(QJSEngine::ConsoleExtension);
+    engine->globalObject().setProperty("engine", engine->newQObject(new QScriptSystemPointer{}));
+    return engine;
+}
 
-    PROFILE_FUNCTION();
-    currentComp = &comp;
+ScriptSystem::SharedScript& ScriptSystem::getSharedScript(const QString& path)
+{
+    auto& sharedScripts = currentWorker ? currentWorker->sharedScripts : mSharedScripts;
+    auto& shared = sharedScripts[path.toStdString()];
+    if(!shared.engine)
+        shared.engine.reset(createEngine());
 
-    if(!comp.JSEntity)
+    // The helpers are shared by all the components too, so there's one Vec3 class and so on per engine
+    if(!shared.helperFuncsLoaded)
     {
-        initializeJSEntity(comp);
+        auto value = shared.engine->evaluate(mSharedHelperFuncs, helperFuncsFile);
+        if(value.isError())
+            checkError(value);
+        shared.helperFuncsLoaded = true;
     }
 
-    if(!file.size())
+    // Compiled once, and again only after the script or helper functions change
+    if(!shared.factory.isUndefined())
+        return shared;
+
+    QString contents;
+    if(!getSource(path, contents))
+        return shared;
+
+    /* Wrap the script in a function taking the context object, so every component gets
+     * its own copy of the script's variables and functions. destringify is the only helper
+     * declared in the wrapper, as its eval has to see the script's own scope.
+     */
+    contents.prepend("(function(context) {\n"
+                     "var me = context.me;\n"
+                     "var entityID = context.entityID;\n"
+                     "var state = context.state;\n"
+                     "function destringify(obj) { return eval('(' + obj + ')'); }\n");
+    contents.append("\ncontext.lookup = function(name) { try { return eval(name); } catch (e) { return undefined; } };\n"
+                    "return context;\n"
+                    "})");
+
+    auto value = shared.engine->evaluate(contents, path);
+    if(value.isError())
     {
-        return false;
+        checkError(value);
+        return shared;
     }
 
-    QFileInfo info(QString::fromStdString(gsl::scriptsFilePath + file));
+    shared.factory = value;
+    return shared;
+}
+
+bool ScriptSystem::getSource(const QString &path, QString &contents)
+{
+    std::unique_lock<std::mutex> lock{mMutex};
+    auto it = mSources.find(path.toStdString());
+    if(it != mSources.end())
+    {
+        contents = it->second;
+        return true;
+    }
+    lock.unlock();
 
-    QFile scriptFile(info.filePath());
+    QFile scriptFile(path);
     if(!scriptFile.exists())
     {
-        qDebug() << "Script file (" + info.filePath() + ") does not exist!";
+        qDebug() << "Script file (" + path + ") does not exist!";
         return false;
     }
     if (!scriptFile.open(QIODevice::ReadOnly))
     {
-        qDebug() << "Failed to open script: " << info.filePath();
+        qDebug() << "Failed to open script: " << path;
         return false;
     }
     QTextStream stream(&scriptFile);
-    QString contents = stream.readAll();
-    contents.prepend(mHelperFuncs);
+    contents = stream.readAll();
     scriptFile.close();
-    auto value = comp.engine->evaluate(contents, info.filePath());
-    if(value.isError())
+
+    lock.lock();
+    mSources[path.toStdString()] = contents;
+    if(currentWorker)
     {
-        checkError(value);
-        return false;
+        mUnwatchedFiles.push_back(path);
+        return true;
     }
+    lock.unlock();
 
-    comp.filePath = info.baseName().toStdString() + ".js";
-    currentComp = nullptr;
-    currentFileName = "";
+    watch(path);
     return true;
 }
 
-void ScriptSystem::call(ScriptComponent& comp, const std::string& function)
+void ScriptSystem::watch(const QString &path)
 {
-    PROFILE_FUNCTION();
-    if(!comp.filePath.size() || !comp.beginplayRun)
-        return;
-
-    currentComp = &comp;
-    currentFileName = QString::fromStdString(comp.filePath);
-
-    if(!comp.JSEntity)
+    if(!mWatcher)
     {
-        initializeJSEntity(comp);
+        mWatcher = std::make_unique<QFileSystemWatcher>();
+        connect(mWatcher.get(), &QFileSystemWatcher::fileChanged, this, &ScriptSystem::fileChanged);
+        mWatcher->addPaths(QStringList{} << helperFuncsFile << mathFile);
     }
 
-    QJSValue value = comp.engine->evaluate(QString::fromStdString(function), QString::fromStdString(gsl::scriptsFilePath) + currentFileName);
-    if(value.isError())
+    if(!mWatcher->files().contains(path))
+        mWatcher->addPath(path);
+}
+
+void ScriptSystem::fileChanged(const QString &path)
+{
+    // Editors often save by replacing the file, which stops it from being watched
+    if(QFile::exists(path))
+        watch(path);
+
+    // Runs between frames, so the script threads aren't using the engines
+    const bool helperFuncs = path == helperFuncsFile || path == mathFile;
+    if(helperFuncs)
     {
-        checkError(value);
-        return;
+        initializeHelperFuncs();
+        mHelperFuncsChanged = true;
     }
-
-    value = value.call();
-    if(value.isError())
+    else
     {
-        checkError(value);
-        return;
+        std::lock_guard<std::mutex> lock{mMutex};
+        mSources.erase(path.toStdString());
+        mChangedFiles.insert(path.toStdString());
     }
 
-    currentComp = nullptr;
-    currentFileName = "";
-    return;
+    auto clear = [&](std::map<std::string, SharedScript>& sharedScripts){
+        for(auto& shared : sharedScripts)
+        {
+            if(helperFuncs)
+                shared.second.helperFuncsLoaded = false;
+            if(helperFuncs || shared.first == path.toStdString())
+                shared.second.factory = QJSValue{};
+        }
+    };
+    clear(mSharedScripts);
+    for(auto& worker : mWorkers)
+        clear(worker->sharedScripts);
 }
 
-QJSValue ScriptSystem::call(ScriptComponent &comp, const std::string& function, QJSValueList params)
+void ScriptSystem::reloadChangedScripts(std::vector<ScriptComponent> &comps)
 {
+    std::unique_lock<std::mutex> lock{mMutex};
+    auto unwatched = std::move(mUnwatchedFiles);
+    mUnwatchedFiles.clear();
+    lock.unlock();
+    for(const auto& path : unwatched)
+        watch(path);
+
+    if(mChangedFiles.empty() && !mHelperFuncsChanged)
+        return;
+
     PROFILE_FUNCTION();
-    if(!comp.filePath.size() || !comp.beginplayRun)
+    runOnWorkers([&](unsigned int worker, unsigned int workerCount){
+        for(auto& comp : comps)
+        {
+            if(!comp.valid || !comp.beginplayRun || comp.native || !comp.filePath.size() || !runsOn(comp.entityId, worker, workerCount))
+                continue;
+            if(!mHelperFuncsChanged && !mChangedFiles.count(gsl::scriptsFilePath + comp.filePath))
+                continue;
+
+            if(!reload(comp))
+                qDebug() << "Failed to reload" << comp.filePath.c_str();
+        }
+    });
+    mChangedFiles.clear();
+    mHelperFuncsChanged = false;
+}
+
+QJSValue ScriptSystem::getScriptValue(ScriptComponent &comp, const QString &name)
+{
+    if(comp.ownsEngine)
+        return comp.scope.property(name);
+
+    auto lookup = comp.scope.property("lookup");
+    return lookup.isCallable() ? lookup.call(QJSValueList{} << name) : QJSValue{};
+}
+
+QJSValue ScriptSystem::getFunction(ScriptComponent &comp, const std::string &name)
+{
+    auto& callbacks = comp.callbacks;
+    if(name == "beginPlay")
+        return callbacks.beginPlay;
+    else if(name == "tick")
+        return callbacks.tick;
+    else if(name == "endPlay")
+        return callbacks.endPlay;
+    else if(name == "onHit")
+        return callbacks.onHit;
+    else if(name == "inputPressed")
+        return callbacks.inputPressed;
+    else if(name == "inputReleased")
+        return callbacks.inputReleased;
+    else if(name == "mouseMoved")
+        return callbacks.mouseMoved;
+    else
+        return getScriptValue(comp, QString::fromStdString(name));
+}
+
+void ScriptSystem::cacheCallbacks(ScriptComponent &comp)
+{
+    auto find = [&](const QString& name){
+        auto value = getScriptValue(comp, name);
+        return value.isCallable() ? value : QJSValue{};
+    };
+
+    auto& callbacks = comp.callbacks;
+    callbacks.beginPlay = find("beginPlay");
+    callbacks.tick = find("tick");
+    callbacks.endPlay = find("endPlay");
+    callbacks.onHit = find("onHit");
+    callbacks.inputPressed = find("inputPressed");
+    callbacks.inputReleased = find("inputReleased");
+    callbacks.mouseMoved = find("mouseMoved");
+
+    mSubscribersDirty = true;
+}
+
+QJSValue ScriptSystem::callFunction(ScriptComponent &comp, QJSValue function, const QJSValueList& params)
+{
+    if(!function.isCallable())
         return QJSValue{};
 
-    currentComp = &comp;
-    currentFileName = QString::fromStdString(comp.filePath);
+    CurrentScript current{comp};
 
     if(!comp.JSEntity)
     {
         initializeJSEntity(comp);
     }
 
-    QJSValue value = comp.engine->evaluate(QString::fromStdString(function), QString::fromStdString(gsl::scriptsFilePath) + currentFileName);
+    auto value = function.call(params);
     if(value.isError())
     {
         checkError(value);
-        return value;
     }
 
-    value = value.call(params);
-    if(value.isError())
-    {
-        checkError(value);
-        return value;
-    }
-
-    currentComp = nullptr;
-    currentFileName = "";
     return value;
 }
 
+void ScriptSystem::call(ScriptComponent& comp, const std::string& function)
+{
+    PROFILE_FUNCTION();
+    if(!comp.filePath.size() || !comp.beginplayRun)
+        return;
+
+    callFunction(comp, getFunction(comp, function));
+}
+
+QJSValue ScriptSystem::call(ScriptComponent &comp, const std::string& function, QJSValueList params)
+{
+    PROFILE_FUNCTION();
+    if(!comp.filePath.size() || !comp.beginplayRun)
+        return QJSValue{};
+
+    return callFunction(comp, getFunction(comp, function), params);
+}
+
 QJSValue ScriptSystem::call(const std::string& function)
 {
     PROFILE_FUNCTION();
     if(currentComp && currentComp->JSEntity)
     {
-        QJSValue value = currentComp->engine->evaluate(QString::fromStdString(function), QString::fromStdString(gsl::scriptsFilePath) + currentFileName);
+        QJSValue value = getFunction(*currentComp, function);
         if(value.isError())
         {
             checkError(value);
-            currentComp->engine->globalObject().setProperty("accessedComponents", currentComp->engine->newArray());
             return false;
         }
 
@@ -676,7 +958,7 @@ QJSValue ScriptSystem::call(const std::string& function, QJSValueList params)
     PROFILE_FUNCTION();
     if(currentComp && currentComp->JSEntity)
     {
-        QJSValue value = currentComp->engine->evaluate(QString::fromStdString(function), QString::fromStdString(gsl::scriptsFilePath) + currentFileName);
+        QJSValue value = getFunction(*currentComp, function);
         if(value.isError())
         {
             checkError(value);
@@ -700,10 +982,19 @@ bool ScriptSystem::execute(ScriptComponent& comp, QString function, QString cont
     if(!function.size() || !contents.size() || !fileName.size())
         return false;
 
-    currentComp = &comp;
-    currentFileName = fileName;
+    CurrentScript current{comp, fileName};
 
-    if(!comp.JSEntity)
+    // Snippets are evaluated globally, so they get an engine of their own instead of polluting a shared one
+    if(!comp.ownsEngine)
+    {
+        comp.callbacks = ScriptComponent::Callbacks{};
+        comp.engine = createEngine();
+        comp.ownsEngine = true;
+        comp.scope = comp.engine->globalObject();
+        comp.scope.setProperty("entityID", comp.entityId);
+        initializeJSEntity(comp);
+    }
+    else if(!comp.JSEntity)
     {
         initializeJSEntity(comp);
     }
@@ -729,23 +1020,63 @@ bool ScriptSystem::execute(ScriptComponent& comp, QString function, QString cont
         return false;
     }
 
-    comp.engine->globalObject().setProperty("accessedComponents", comp.engine->newArray());
-    currentComp = nullptr;
-    currentFileName = "";
     return true;
 }
 
 QObject* ScriptSystem::spawnCube()
 {
-    auto entity =  World::getWorld().getEntityManager()->createCube();
+    if(!currentWorker)
+    {
+        auto entity =  World::getWorld().getEntityManager()->createCube();
+        return getEntityWrapper(entity);
+    }
+
+    // On a script thread the cube is built from deferred components, so its components can be used right away
+    auto entity = reserveEntity();
+    addComponent(entity, ComponentType::Transform);
+    addComponent(entity, ComponentType::Mesh);
+    defer([this, entity](){
+        if(auto render = static_cast<MeshComponent*>(getDeferredComponent(resolveEntity(entity), ComponentType::Mesh)))
+        {
+            if(auto mesh = ResourceManager::instance().getMesh("box2"))
+            {
+                render->mesh = mesh;
+                render->isVisible = true;
+            }
+        }
+    });
     return getEntityWrapper(entity);
 }
 
+QObject *ScriptSystem::currentEntity()
+{
+    return currentComp ? currentComp->JSEntity : nullptr;
+}
+
 QObject *ScriptSystem::spawnEntity()
 {
+    if(currentWorker)
+        return getEntityWrapper(reserveEntity());
+
     return getEntityWrapper(World::getWorld().getEntityManager()->createEntity());
 }
 
+unsigned int ScriptSystem::reserveEntity()
+{
+    return placeholderBit | (currentWorker->index << 24) | currentWorker->spawnCount++;
+}
+
+unsigned int ScriptSystem::resolveEntity(unsigned int entity) const
+{
+    if (!(entity & placeholderBit))
+        return entity;
+
+    const auto worker = (entity & ~placeholderBit) >> 24;
+    if (mWorkers.size() <= worker)
+        return entity;
+    return mWorkers[worker]->firstSpawnedId + (entity & 0xffffff);
+}
+
 QJSValue ScriptSystem::getAllEntityIDsByComponent(const QString& name)
 {
     if(!currentComp)
@@ -757,7 +1088,7 @@ QJSValue ScriptSystem::getAllEntityIDsByComponent(const QString& name)
 
     if(name == "transform")
     {
-        auto components = entityManager->getTransformComponents();
+        auto& components = entityManager->getTransformComponents();
         for(auto& comp : components)
         {
             IDs.emplace_back(comp.entityId);
@@ -765,7 +1096,7 @@ QJSValue ScriptSystem::getAllEntityIDsByComponent(const QString& name)
     }
     else if(name == "mesh")
     {
-        auto components = entityManager->getMeshComponents();
+        auto& components = entityManager->getMeshComponents();
         for(auto& comp : components)
         {
             IDs.emplace_back(comp.entityId);
@@ -773,7 +1104,7 @@ QJSValue ScriptSystem::getAllEntityIDsByComponent(const QString& name)
     }
     else if(name == "physics")
     {
-        auto components = entityManager->getPhysicsComponents();
+        auto& components = entityManager->getPhysicsComponents();
         for(auto& comp : components)
         {
             IDs.emplace_back(comp.entityId);
@@ -781,7 +1112,7 @@ QJSValue ScriptSystem::getAllEntityIDsByComponent(const QString& name)
     }
     else if(name == "camera")
     {
-        auto components = entityManager->getCameraComponents();
+        auto& components = entityManager->getCameraComponents();
         for(auto& comp : components)
         {
             IDs.emplace_back(comp.entityId);
@@ -789,7 +1120,7 @@ QJSValue ScriptSystem::getAllEntityIDsByComponent(const QString& name)
     }
     else if(name == "input")
     {
-        auto components = entityManager->getInputComponents();
+        auto& components = entityManager->getInputComponents();
         for(auto& comp : components)
         {
             IDs.emplace_back(comp.entityId);
@@ -797,7 +1128,7 @@ QJSValue ScriptSystem::getAllEntityIDsByComponent(const QString& name)
     }
     else if(name == "sound")
     {
-        auto components = entityManager->getSoundComponents();
+        auto& components = entityManager->getSoundComponents();
         for(auto& comp : components)
         {
             IDs.emplace_back(comp.entityId);
@@ -805,7 +1136,7 @@ QJSValue ScriptSystem::getAllEntityIDsByComponent(const QString& name)
     }
     else if(name == "pointLight")
     {
-        auto components = entityManager->getPointLightComponents();
+        auto& components = entityManager->getPointLightComponents();
         for(auto& comp : components)
         {
             IDs.emplace_back(comp.entityId);
@@ -813,7 +1144,7 @@ QJSValue ScriptSystem::getAllEntityIDsByComponent(const QString& name)
     }
     else if(name == "directionalLight")
     {
-        auto components = entityManager->getDirectionalLightComponents();
+        auto& components = entityManager->getDirectionalLightComponents();
         for(auto& comp : components)
         {
             IDs.emplace_back(comp.entityId);
@@ -821,7 +1152,7 @@ QJSValue ScriptSystem::getAllEntityIDsByComponent(const QString& name)
     }
     else if(name == "spotLight")
     {
-        auto components = entityManager->getSpotLightComponents();
+        auto& components = entityManager->getSpotLightComponents();
         for(auto& comp : components)
         {
             IDs.emplace_back(comp.entityId);
@@ -837,7 +1168,7 @@ QJSValue ScriptSystem::getAllEntityIDsByComponent(const QString& name)
     }
     else if(name == "collider")
     {
-        auto components = entityManager->getColliderComponents();
+        auto& components = entityManager->getColliderComponents();
         for(auto& comp : components)
         {
             IDs.emplace_back(comp.entityId);
@@ -855,13 +1186,26 @@ QJSValue ScriptSystem::getAllEntityIDs()
     auto entityManager = World::getWorld().getEntityManager();
 
     std::vector<int> IDs;
-    for(auto comp : entityManager->getEntityInfos())
+    for(const auto& comp : entityManager->getEntityInfos())
     {
         IDs.emplace_back(comp.entityId);
     }
     return currentComp->engine->toScriptValue(IDs);
 }
 
+QJSValue ScriptSystem::query(const QStringList &components)
+{
+    if(!currentComp)
+        return QJSValue{};
+
+    return ScriptQuery::run(*currentComp->engine, components);
+}
+
+void ScriptSystem::commit(const QJSValue &result)
+{
+    ScriptQuery::commit(result);
+}
+
 QObject* ScriptSystem::getEntity(unsigned int id)
 {
     if(!currentComp)
@@ -872,115 +1216,47 @@ QObject* ScriptSystem::getEntity(unsigned int id)
 
 void ScriptSystem::destroyEntity(unsigned entity)
 {
+    if(defer([entity](){ World::getWorld().getEntityManager()->removeEntityLater(ScriptSystem::get()->resolveEntity(entity)); }))
+        return;
 
     World::getWorld().getEntityManager()->removeEntityLater(entity);
 }
 
-void ScriptSystem::updateJSComponent(ScriptComponent& comp)
+QJSValue ScriptSystem::getComponentProxy(unsigned entity, ComponentType type)
 {
-    if(!comp.filePath.size())
-        return;
-    PROFILE_FUNCTION();
-    auto componentArray = comp.engine->globalObject().property("accessedComponents");
-    if(!componentArray.isUndefined() && !componentArray.isNull())
+    // A proxy still alive is reused, which gives back the JS object the script already has for it
+    auto& proxy = currentComp->accessedComponents[ScriptComponent::proxyKey(entity, type)];
+    if(!proxy)
     {
-        auto length = componentArray.property("length").toInt();
-        if(length > 0)
+        auto created = ComponentProxy::create(entity, type);
+        if(!created)
         {
-            for(unsigned i = 0; i < static_cast<unsigned>(length); ++i)
-            {
-                auto property = componentArray.property(i);
-                auto object = property.toVariant().toJsonObject();
-
-                if(object.isEmpty())
-                    continue;
-
-                // Get component that matches the type
-                auto ID = static_cast<unsigned>(object["ID"].toInt());
-                auto componentType = static_cast<ComponentType>(object["ComponentType"].toInt());
-                auto component = World::getWorld().getEntityManager()->getComponent(ID, componentType);
-
-                if(component)
-                {
-                    object.remove("ID");
-
-                    // If they are different this component was modified in C++
-                    // and we need to update the JS version
-                    auto newJson = component->toJSON();
-                    if(object != newJson)
-                    {
-                        auto updatedComp = comp.engine->toScriptValue(newJson);
-
-                        for (auto key : newJson.keys())
-                            property.setProperty(key, updatedComp.property(key));
-
-                        comp.engine->globalObject().property("accessedComponents").property(i) = property;
-                    }
-                }
-            }
+            currentComp->accessedComponents.erase(ScriptComponent::proxyKey(entity, type));
+            return QJSValue();
         }
+        if(currentWorker && (entity & placeholderBit))
+            currentWorker->spawnedProxies.push_back(created);
+        proxy = created;
     }
-}
-
-void ScriptSystem::updateCPPComponent(ScriptComponent &comp, std::vector<QJsonObject> &deferredSpawning)
-{
-    if(!comp.valid || !comp.filePath.size() || !comp.beginplayRun)
-        return;
 
-    PROFILE_FUNCTION();
-    auto componentArray = comp.engine->globalObject().property("accessedComponents");
-    if(!componentArray.isUndefined() && !componentArray.isNull())
-    {
-        auto length = componentArray.property("length").toInt();
-        if(length > 0)
-        {
-            for(unsigned i = 0; i < static_cast<unsigned>(length); ++i)
-            {
-                auto property = componentArray.property(i);
-                auto object = property.toVariant().toJsonObject();
-
-                if(object.isEmpty())
-                    continue;
-
-                auto entityManager = World::getWorld().getEntityManager();
-
-                // Get component that matches the type
-                auto ID = static_cast<unsigned>(object["ID"].toInt());
-                auto componentType = static_cast<ComponentType>(object["ComponentType"].toInt());
-                auto component = entityManager->getComponent(ID, componentType);
-
-                if(component)
-                {
-                    object.remove("ID");
-                    // If they are different this component was modified in JS
-                    // and we need to update the C++ version
-                    auto oldJson = component->toJSON();
-                    if(object != oldJson)
-                    {
-                        component->fromJSON(object);
-                    }
-                }
-                else
-                {
-                    // If the component does not exist it needs to be added. Deferred spawning.
-                    deferredSpawning.push_back(object);
-                }
-            }
-        }
-    }
+    // Owned by the engine, so it's deleted once JS no longer refers to it
+    return currentComp->engine->newQObject(proxy);
 }
 
 void ScriptSystem::initializeJSEntity(ScriptComponent& comp)
 {
-    comp.JSEntity = ScriptSystem::get()->getEntityWrapper(comp.entityId);
-    comp.engine->globalObject().setProperty("me", comp.engine->newQObject(comp.JSEntity));
-    comp.engine->globalObject().setProperty("accessedComponents", comp.engine->newArray());
+    if(!comp.JSEntity)
+        comp.JSEntity = ScriptSystem::get()->getEntityWrapper(comp.entityId);
+    // Deleted by the component, also when made on a script thread without a parent
+    QJSEngine::setObjectOwnership(comp.JSEntity, QJSEngine::CppOwnership);
+    comp.scope.setProperty("me", comp.engine->newQObject(comp.JSEntity));
+    comp.accessedComponents.clear();
 }
 
 void ScriptSystem::initializeHelperFuncs()
 {
     PROFILE_FUNCTION();
-    QFile file(QString::fromStdString("../INNgine2019/JSHelperFuncs.js"));
+    QFile file(helperFuncsFile);
     if(!file.open(QIODevice::ReadOnly))
     {
         qDebug() << "ERROR Script System: Failed to find JSHelperFuncs.js!";
@@ -990,7 +1266,7 @@ void ScriptSystem::initializeHelperFuncs()
     mHelperFuncs = file.readAll();
     file.close();
 
-    file.setFileName("../INNgine2019/JSMath.js");
+    file.setFileName(mathFile);
     if(!file.open(QIODevice::ReadOnly))
     {
         qDebug() << "ERROR Script System: Failed to find JSMath.js!";
@@ -999,4 +1275,18 @@ void ScriptSystem::initializeHelperFuncs()
 
     mHelperFuncs.prepend(file.readAll());
     file.close();
+
+    /* The helpers are declared in a function and copied to the global object, as the classes
+     * can't be declared in the global scope a second time when the helpers change.
+     * 'me' is given to the scripts by their context, so in the global scope it's the entity of the running script.
+     */
+    QString exports;
+    QRegularExpression declaration{"^(?:function|class)\\s+(\\w+)", QRegularExpression::MultilineOption};
+    for(auto it = declaration.globalMatch(mHelperFuncs); it.hasNext();)
+    {
+        const auto name = it.next().captured(1);
+        exports += "global." + name + " = " + name + ";\n";
+    }
+    mSharedHelperFuncs = "(function(global) {\n" + mHelperFuncs + "\n" + exports + "})(this);\n"
+                         "Object.defineProperty(this, 'me', { configurable: true, get: function() { return engine.currentEntity(); } });\n";
 }
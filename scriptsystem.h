@@ -3,18 +3,34 @@
 
 #include <QObject>
 #include <QJSValue>
+#include <QStringList>
+#include <QFileSystemWatcher>
 #include <memory>
 #include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <functional>
 #include "world.h"
 #include "qentity.h"
 #include "qjsengine.h"
 #include "componentdata.h"
+#include "componentproxy.h"
+#include "threadpool.h"
 
 class HitInfo;
 
 /**
  * @brief The singleton class responsible of handling all script functionality.
- * Note that this class does not have a QJSEngine, all script components have one each instead to help keep global spaces separated.
+ * Note that this class does not have a QJSEngine of its own. Script components running the same file share one engine,
+ * and each component gets its own context object holding the script's variables and functions, so global spaces are still separated.
+ * With shareEngines off every component gets an engine of its own instead.
+ * With scriptThreads set the scripts are split between worker threads, each with its own engines. Changes scripts make to
+ * the entities from a worker thread are queued up and applied on the main thread once all scripts are done.
+ * Script files are read once and watched for changes. When one changes, it's recompiled and the running scripts
+ * using it are reloaded between frames. They keep their context objects, and with them the 'state' object every
+ * script gets, so state kept there survives the reload while the rest of the script's variables start over.
  * The instance of this class is given to all QJSEngines as a global object under the name 'engine'.
  * This means that any public slots or Q_INVOKABLE public functions in this class are callable from JS.
  * Example JS code: let entity = engine.spawnCube();
@@ -30,61 +46,45 @@ public:
         return &instance;
     }
 
-    /** How often the script resource garbage collection
-     * should run, in frames. (10 is every tenth frame)
-     * @brief garbageCollectionFrequency
+    /** How long the script garbage collection may run each frame, in microseconds.
+     * @brief garbageCollectionBudget
      */
-    unsigned int garbageCollectionFrequency = 15;
+    unsigned int garbageCollectionBudget = 100;
 
-    /**
-     * @brief Update function for all scripts. Runs all functions necessary every frame.
+    /** Whether script components running the same file share an engine.
+     * Takes effect the next time a script is loaded.
+     * @brief shareEngines
      */
-    void update(std::vector<ScriptComponent>& scripts, std::vector<InputComponent>& inputs, const std::vector<QString>& pressed, const std::vector<QString> &released, const QPoint& point, std::vector<HitInfo> hitInfos, float deltaTime);
+    bool shareEngines = true;
 
-    /**
-     * @brief Calls the end play function on all scripts. Called when the stop button is pressed.
+    /** Number of worker threads the scripts are run on. 0 runs them on the main thread.
+     * Takes effect the next time play is started.
+     * @brief scriptThreads
      */
-    void endPlay(std::vector<ScriptComponent>& comps);
+    unsigned int scriptThreads = 0;
 
     /**
-     * @brief Propagate changes done in C++ back to JS
+     * @brief Update function for all scripts. Runs all functions necessary every frame.
      */
-    void updateJSComponents(std::vector<ScriptComponent>& comps);
+    void update(std::vector<ScriptComponent>& scripts, std::vector<InputComponent>& inputs, const std::vector<QString>& pressed, const std::vector<QString> &released, const QPoint& point, std::vector<HitInfo> hitInfos, float deltaTime);
 
     /**
-     * @brief Propagate changes done in JS back to C++
+     * @brief Calls the end play function on all scripts. Called when the stop button is pressed.
      */
-    void updateCPPComponents(std::vector<ScriptComponent>& comps);
+    void endPlay(std::vector<ScriptComponent>& comps);
 
     QString checkError(QJSValue value);
 
     QEntity* getEntityWrapper(unsigned int entity);
 
     /** Garbage collection
-     * Removes unwanted resources from the script engine.
+     * Component proxies given to JS are owned by the engines and deleted by their garbage collector once JS no longer
+     * refers to them. The script components only keep weak handles to reuse them, and this drops the handles to
+     * deleted proxies and to components that no longer exist. Goes through a few script components every frame,
+     * continuing where it left off, until garbageCollectionBudget is spent.
      * @brief Garbage collection
      */
-    void takeOutTheTrash(std::vector<ScriptComponent>& comps);
-
-    /** Find all the global variable names in a script file.
-     * @brief findGlobalsInFile
-     * @param file - file to search
-     * @return a list of all variable names in the file.
-     */
-    std::vector<QString> findGlobalsInFile(const std::string& file) const;
-
-    /** Saves the variable names from the script in com and
-     * adds them to globalVariables list.
-     * @param comp - script component
-     */
-    void cacheGlobalVariables(ScriptComponent& comp);
-
-    /** Clears garbage from last garbage collection run.
-     * Might seem a bit ironic that the garbage collection
-     * needs to run it's own garbage collection...
-     * @brief initGarbageCollection
-     */
-    void initGarbageCollection();
+    void collectGarbage(std::vector<ScriptComponent>& comps);
 
     /**
      * @brief Returns hardcoded functions provided in all scripts
@@ -93,6 +93,7 @@ public:
 
     /**
      * @brief Loads the js file given. Returns true if the file is successfully evaluated and set.
+     * The file is only read the first time it's loaded and after it changes on disk.
      */
     bool load(ScriptComponent& comp, const std::string& file);
 
@@ -119,74 +120,40 @@ public:
 
     /**
      * @brief Called from QEntity when a component is added through JS. Only adds one if it's not already added already.
-     * If a new component is added, it is deferred until the end of the update loop.
+     * If a new component is added, it is deferred until addDeferredComponents is called at the end of the update loop.
+     * Returns a proxy for the component.
      */
-    template<class Comp, typename std::enable_if<std::is_base_of<Component, Comp>::value>::type* = nullptr>
-    QJSValue addComponent(unsigned entity)
-    {
-        if(!currentComp)
-            return QJSValue();
-
-        Comp comp{};
-        QJsonObject object = comp.toJSON();
-
-        auto componentArray = currentComp->engine->globalObject().property("accessedComponents");
-        auto length = componentArray.property("length").toInt();
-        if(length > 0)
-        {
-            for(unsigned i = 0; i < static_cast<unsigned>(length); ++i)
-            {
-                auto property = componentArray.property(i);
-                auto jsObject = property.toVariant().toJsonObject();
-                if(jsObject["ID"].toInt() == static_cast<int>(entity) && jsObject["ComponentType"].toInt() == object["ComponentType"].toInt())
-                {
-                    return componentArray.property(i);
-                }
-            }
-        }
-
-        object.insert("ID", QJsonValue(static_cast<int>(entity)));
-        auto value = currentComp->engine->toScriptValue(object);
-        currentComp->engine->globalObject().property("accessedComponents").setProperty(static_cast<unsigned>(length), value);
-
-        return value;
-    }
+    QJSValue addComponent(unsigned entity, ComponentType type);
 
     /**
-     * @brief Called from QEntity when a component is retrieved through JS.
+     * @brief Called from QEntity when a component is retrieved through JS. Returns a proxy for the component, or undefined if
+     * the entity doesn't have one.
      */
-    template<class Comp, typename std::enable_if<std::is_base_of<Component, Comp>::value>::type* = nullptr>
-    QJSValue getComponent(unsigned entity)
-    {
-        if(!currentComp)
-            return QJSValue();
+    QJSValue getComponent(unsigned entity, ComponentType type);
 
-        auto comp = World::getWorld().getEntityManager()->getComponent<Comp>(entity);
-        if(!comp)
-            return QJSValue();
+    /**
+     * @brief A component added through JS this frame that hasn't been added to the entity manager yet. nullptr if there's none.
+     */
+    Component* getDeferredComponent(unsigned entity, ComponentType type);
 
-        auto object = comp->toJSON();
+    /**
+     * @brief Adds the components added through JS this frame to the entity manager. Called after the scripts have run.
+     */
+    void addDeferredComponents();
 
-        auto componentArray = currentComp->engine->globalObject().property("accessedComponents");
-        auto length = componentArray.property("length").toInt();
-        if(length > 0)
-        {
-            for(unsigned i = 0; i < static_cast<unsigned>(length); ++i)
-            {
-                auto jsObject = componentArray.property(i).toVariant().toJsonObject();
-
-                if(jsObject["ID"].toInt() == static_cast<int>(entity) && jsObject["ComponentType"].toInt() == object["ComponentType"].toInt())
-                {
-                    return componentArray.property(i);
-                }
-            }
-        }
+    /**
+     * @brief If called from a script worker thread, queues command to be run on the main thread once all scripts are done
+     * and returns true. Returns false without running command otherwise.
+     */
+    bool defer(std::function<void()> command);
+    //! Whether the calling thread is one of the script worker threads.
+    static bool isScriptThread();
 
-        object.insert("ID", QJsonValue(static_cast<int>(entity)));
-        auto value = currentComp->engine->toScriptValue(object);
-        currentComp->engine->globalObject().property("accessedComponents").setProperty(static_cast<unsigned>(length), value);
-        return value;
-    }
+    /** Entities spawned on a script worker get placeholder ids until the commands are applied, when they're given
+     * real ids worker by worker. Wrappers and proxies made for them are updated then, but ids copied in JS aren't.
+     * @brief Returns the real id of a placeholder entity id, or entity if it isn't one.
+     */
+    unsigned int resolveEntity(unsigned int entity) const;
 
     /**
      * @brief Executes one off raw js code from the mini editor. Returns true if successfull.
@@ -208,6 +175,12 @@ public slots:
      */
     QObject* spawnEntity();
 
+    /**
+     * @brief Returns the entity of the script currently running. The helper functions use this in shared engines,
+     * where only the script itself knows its 'me'.
+     */
+    QObject* currentEntity();
+
     /**
      * @brief Returns an array of all entity IDs that has the given component.
      * Example: let entityIDs = engine.getAllEntityIDsByComponent("mesh");
@@ -231,65 +204,216 @@ public slots:
      */
     void destroyEntity(unsigned entity);
 
+    /**
+     * @brief Returns the components of all entities having all of the given components, as typed arrays. See ScriptQuery.
+     * Example: let q = engine.query(["transform", "physics"]);
+     */
+    QJSValue query(const QStringList& components);
+
+    /**
+     * @brief Writes the changes to the arrays of a query result back to the components.
+     * Example: engine.commit(q);
+     */
+    void commit(const QJSValue& result);
+
 private:
-    ScriptSystem(){}
+    ScriptSystem(){ initializeHelperFuncs(); }
 
     /**
      * @brief Called on play or when a new script component is added to an entity on runtime.
      */
-    void beginPlay(std::vector<ScriptComponent>& comps);
+    void beginPlay(std::vector<ScriptComponent>& comps, unsigned int worker, unsigned int workerCount);
     /**
-     * @brief Called every frame.
+     * @brief Called every frame on the script components subscribed to tick.
      */
-    void tick(float deltaTime, std::vector<ScriptComponent>& comps);
+    void tick(std::vector<ScriptComponent>& comps, unsigned int worker, unsigned int workerCount);
 
     /**
-     * @brief Called on all script components with an input pressed function and if any input is registered as pressed.
+     * @brief Called on the script components subscribed to input events that are controlled while playing,
+     * if any input is registered as pressed or released this frame or the mouse has moved.
      */
-    void runKeyPressedEvent(std::vector<ScriptComponent>& scripts, std::vector<InputComponent>& inputs, const std::vector<QString>& keys);
+    void runInputEvents(std::vector<ScriptComponent>& scripts, std::vector<InputComponent>& inputs,
+                        const std::vector<QString>& pressed, const std::vector<QString>& released, const QPoint& point,
+                        unsigned int worker, unsigned int workerCount);
 
     /**
-     * @brief Called on all script components with an input released function and if any input is registered as released this frame.
+     * @brief Called on all script components with a hit event function and if there is any collisions associated with the respective component.
      */
-    void runKeyReleasedEvent(std::vector<ScriptComponent>& scripts, std::vector<InputComponent>& inputs, const std::vector<QString>& keys);
+    void runHitEvents(std::vector<ScriptComponent>& comps, const std::vector<HitInfo>& hitInfos, unsigned int worker, unsigned int workerCount);
 
     /**
-     * @brief Called on all script components with a mouse moved function and if the offset is greater than zero.
+     * @brief Releases everything the component holds in its engine, so it's loaded again by the next beginPlay.
+     * Must be called on the thread of the engine, or while the script workers are idle.
      */
-    void runMouseOffsetEvent(std::vector<ScriptComponent>& scripts, std::vector<InputComponent>& inputs, const QPoint& point);
+    void detach(ScriptComponent& comp);
 
     /**
-     * @brief Called on all script components with a hit event function and if there is any collisions associated with the respective component.
+     * @brief Rebuilds the subscriber lists from the callbacks the loaded scripts define.
      */
-    void runHitEvents(std::vector<ScriptComponent>& comps, std::vector<HitInfo> hitInfos);
-
+    void updateSubscribers(const std::vector<ScriptComponent>& comps);
     /**
-     * @brief Updates all JS Components for a given JS engine from the respective CPP components. Called after ticking scripts.
-     * @param Script component to update
+     * @brief Moves it forward to the script component of entity. Returns nullptr if the entity has no running script.
+     * Subscribers are sorted by entity id like the components, so it only ever has to move forward.
+     */
+    ScriptComponent* findScript(std::vector<ScriptComponent>::iterator& it, std::vector<ScriptComponent>::iterator end, unsigned int entity);
+
+    /** Entity ids of the scripts defining the event functions, sorted.
+     * Rebuilt whenever a script is loaded, so entities without a handler are skipped without calling into JS.
      */
-    void updateJSComponent(ScriptComponent& comp);
+    std::vector<unsigned int> mTickSubscribers;
+    //! Scripts defining inputPressed, inputReleased or mouseMoved.
+    std::vector<unsigned int> mInputSubscribers;
+    std::atomic<bool> mSubscribersDirty{false};
+
+    //! getDeferredComponent without locking.
+    Component* findDeferredComponent(unsigned entity, ComponentType type);
 
     /**
-     * @brief Updates all CPP components based on the ones used in JS. Called at the before ticking scripts.
+     * @brief Returns a proxy for the component, reusing the one given to the current script earlier if JS still has it.
      */
-    void updateCPPComponent(ScriptComponent& comp, std::vector<QJsonObject>& deferredSpawning);
+    QJSValue getComponentProxy(unsigned entity, ComponentType type);
 
     /**
      * @brief Sets up the global variables for a given script component.
      */
     void initializeJSEntity(ScriptComponent &comp);
 
+
+    //! A new engine with the console and the 'engine' global set up.
+    QJSEngine* createEngine();
+
+    //! The engine and compiled script shared by all components running a file.
+    struct SharedScript
+    {
+        std::unique_ptr<QJSEngine> engine;
+        //! Function creating the script's functions and variables in the context object it's given.
+        //! Undefined until compiled, and cleared again when the file or the helper functions change.
+        QJSValue factory;
+        //! Whether the helper functions have been evaluated in the engine's global scope.
+        bool helperFuncsLoaded{false};
+    };
+    /**
+     * @brief Returns the shared engine for the file, compiling the script if it's new or has changed. The factory is undefined if it fails to compile.
+     */
+    SharedScript& getSharedScript(const QString& path);
+    std::map<std::string, SharedScript> mSharedScripts;
+
+    /**
+     * @brief Gets the contents of a script file, reading it only if it isn't cached. Returns false if it can't be read.
+     */
+    bool getSource(const QString& path, QString& contents);
+    //! Contents of the script files read, by path. Guarded by mMutex.
+    std::map<std::string, QString> mSources;
+
+    //! Starts watching a file for changes. Main thread only.
+    void watch(const QString& path);
+    /**
+     * @brief Called by the watcher when a script or helper file changes. Drops the cached source and compiled scripts
+     * of the file and queues the running scripts using it to be reloaded.
+     */
+    void fileChanged(const QString& path);
+    /**
+     * @brief Reloads the running scripts whose files changed since the last frame.
+     */
+    void reloadChangedScripts(std::vector<ScriptComponent>& comps);
+    /**
+     * @brief Runs the current version of the script in the context the component already has. Returns true if successful.
+     */
+    bool reload(ScriptComponent& comp);
+    std::unique_ptr<QFileSystemWatcher> mWatcher;
+    //! Files read on script threads, to be watched once back on the main thread. Guarded by mMutex.
+    QStringList mUnwatchedFiles;
+    //! Files changed since the last frame.
+    std::set<std::string> mChangedFiles;
+    bool mHelperFuncsChanged{false};
+
+    //! A thread running scripts, with its own shared engines and queue of changes to apply on the main thread.
+    struct ScriptWorker
+    {
+        std::map<std::string, SharedScript> sharedScripts;
+        std::vector<std::function<void()>> commands;
+        ThreadPool pool{1};
+        unsigned int index{0};
+        //! Entities spawned this frame, and the id the first of them got when they were created.
+        unsigned int spawnCount{0};
+        unsigned int firstSpawnedId{0};
+        //! Wrappers and proxies given out for the spawned entities, to be given their real ids.
+        std::vector<QPointer<QEntity>> spawnedWrappers;
+        std::vector<QPointer<ComponentProxy>> spawnedProxies;
+
+        ~ScriptWorker()
+        {
+            // The engines belong to the worker's thread, so they're deleted there before it's joined
+            pool.submit([this](){ sharedScripts.clear(); }).get();
+        }
+    };
+    /**
+     * @brief Runs job once on every active worker, or once on this thread if there are none, waits for them
+     * and applies the queued commands. The job is given the index of the worker and the number of workers.
+     */
+    void runOnWorkers(const std::function<void(unsigned int worker, unsigned int workerCount)>& job);
+    //! Creates the entities spawned by the workers, then runs their commands in worker order.
+    void applyCommands();
+    //! Returns a placeholder id for an entity spawned from a worker. The entity is created when the commands are applied.
+    unsigned int reserveEntity();
+    static constexpr unsigned int placeholderBit{0x80000000u};
+    //! Workers are kept between plays, and only the ones above scriptThreads are destroyed when play stops.
+    std::vector<std::unique_ptr<ScriptWorker>> mWorkers;
+    unsigned int mActiveWorkers{0};
+    bool mPlaying{false};
+    //! Guards the deferred components and the script sources against the workers.
+    std::mutex mMutex;
+    static thread_local ScriptWorker* currentWorker;
+
+    /**
+     * @brief Looks up a function or variable in the script of a component, whether it has an engine of its own or a shared one.
+     */
+    QJSValue getScriptValue(ScriptComponent& comp, const QString& name);
+
+    /**
+     * @brief Returns the cached callback if name is one of the event functions, else looks the function up in the script.
+     */
+    QJSValue getFunction(ScriptComponent& comp, const std::string& name);
+    /**
+     * @brief Looks up the event functions of a freshly loaded script.
+     */
+    void cacheCallbacks(ScriptComponent& comp);
+    /**
+     * @brief Calls function with comp as the current component. Does nothing if function isn't callable.
+     */
+    QJSValue callFunction(ScriptComponent& comp, QJSValue function, const QJSValueList& params = QJSValueList{});
+
     /**
      * @brief Cache the code in JSHelperFuncs.js and JSMath.js in mHelperFuncs. This string is added to the top of all script files.
+     * Read when the system is created and whenever one of the files changes.
      */
     void initializeHelperFuncs();
     QString mHelperFuncs;
-
-    // Cached
-    ScriptComponent* currentComp;
-    QString currentFileName{};
+    //! The helper functions as they're evaluated once in the global scope of every shared engine.
+    QString mSharedHelperFuncs;
+
+    // Cached, per thread as the script workers run at the same time
+    static thread_local ScriptComponent* currentComp;
+    static thread_local QString currentFileName;
+    //! Points currentComp at a script for the rest of the scope, and clears it and currentFileName again on every way out.
+    struct CurrentScript
+    {
+        explicit CurrentScript(ScriptComponent& comp, const QString& fileName = QString{})
+        {
+            currentComp = &comp;
+            currentFileName = fileName;
+        }
+        ~CurrentScript()
+        {
+            currentComp = nullptr;
+            currentFileName = "";
+        }
+    };
     float mDeltaTime{0};
-    std::map<unsigned int, std::vector<QString>> globalVariables{};
+    //! The script component collectGarbage continues from.
+    std::size_t mGarbageCursor{0};
+    //! Components added through JS, waiting to be added to the entity manager.
+    std::vector<std::unique_ptr<Component>> mDeferredComponents;
 };
 
 
@@ -335,6 +459,12 @@ public slots:
      */
     QObject* spawnEntity(){ return mPtr->spawnEntity(); }
 
+    /**
+     * @brief Returns the entity of the script currently running. The helper functions use this in shared engines,
+     * where only the script itself knows its 'me'.
+     */
+    QObject* currentEntity(){ return mPtr->currentEntity(); }
+
     /**
      * @brief Returns an array of all entity IDs that has the given component.
      * Example: let entityIDs = engine.getAllEntityIDsByComponent("mesh");
@@ -358,6 +488,18 @@ public slots:
      */
     void destroyEntity(unsigned entity){ return mPtr->destroyEntity(entity); }
 
+    /**
+     * @brief Returns the components of all entities having all of the given components, as typed arrays. See ScriptQuery.
+     * Example: let q = engine.query(["transform", "physics"]);
+     */
+    QJSValue query(const QStringList& components){ return mPtr->query(components); }
+
+    /**
+     * @brief Writes the changes to the arrays of a query result back to the components.
+     * Example: engine.commit(q);
+     */
+    void commit(const QJSValue& result){ mPtr->commit(result); }
+
 };
 
 #endif // SCRIPTSYSTEM_H
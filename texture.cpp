@@ -5,6 +5,7 @@
 #include <cstring>
 
 #include "texture.h"
+#include "uploadmanager.h"
 
 Texture::Texture(GLuint textureUnit) : QOpenGLFunctions_4_1_Core()
 {
@@ -32,75 +33,116 @@ Texture::Texture(GLuint textureUnit) : QOpenGLFunctions_4_1_Core()
     setTexture(textureUnit);
 }
 
-Texture::Texture(const std::string &filename, GLenum type, GLuint textureUnit)
+Texture::Texture(const std::string &filename, GLenum type, GLuint textureUnit, const TextureImage::Settings& settings)
 {
     initializeOpenGLFunctions();
 
     mType = type;
 
-    readBitmap(filename);
+    loadImage(filename, settings);
+    upload(textureUnit);
+}
+
+Texture::Texture(PlaceholderTag, GLenum type, GLuint textureUnit)
+{
+    initializeOpenGLFunctions();
+
+    mType = type;
+    for (int i{0}; i < 16; ++i)
+        pixels[i] = 255;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    switch (type)
+    glGenTextures(1, &mId);
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(type, mId);
+    if (type == GL_TEXTURE_CUBE_MAP)
     {
-        case GL_TEXTURE_1D:
-            // Idk how to do that yet
-            break;
-        case GL_TEXTURE_2D:
-            setTexture(textureUnit);
-            break;
-        case GL_TEXTURE_CUBE_MAP:
-            initCubeMap(textureUnit);
-            break;
+        for (unsigned int i{0}; i < 6; ++i)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
     }
+    else
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    }
+    glTexParameteri(type, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 }
 
-/**
-    \brief Texture::id() Return the id of a previously generated texture object
-    \return The id of a previously generated texture object
- */
-GLuint Texture::id() const
+std::shared_ptr<Texture> Texture::placeholder(GLenum type, GLuint textureUnit)
 {
-    return mId;
+    return std::shared_ptr<Texture>(new Texture{PlaceholderTag{}, type, textureUnit});
 }
 
-void Texture::readBitmap(const std::string &filename)
+bool Texture::loadImage(const std::string &filename, const TextureImage::Settings& settings)
 {
-    OBITMAPFILEHEADER bmFileHeader;
-    OBITMAPINFOHEADER bmInfoHeader;
+    auto image = std::make_unique<TextureImage>();
+    if (!image->load(gsl::assetFilePath + "Textures/" + filename, mType, settings))
+        return false;
 
-    std::string fileWithPath =  gsl::assetFilePath + "Textures/" + filename;
+    mImage = std::move(image);
+    return true;
+}
 
-    std::ifstream file;
-    file.open (fileWithPath.c_str(), std::ifstream::in | std::ifstream::binary);
-    if (file.is_open())
+void Texture::upload(GLuint textureUnit, UploadManager *uploads)
+{
+    if (!mImage)
+        return;
+
+    switch (mType)
     {
-        file.read((char *) &bmFileHeader, 14);
+        case GL_TEXTURE_2D:
+            setTexture(textureUnit, uploads);
+            break;
+        case GL_TEXTURE_CUBE_MAP:
+            initCubeMap(textureUnit, uploads);
+            break;
+    }
 
-        file.read((char *) &bmInfoHeader, sizeof(OBITMAPINFOHEADER));
-        mColumns = bmInfoHeader.biWidth;
-        mRows = bmInfoHeader.biHeight;
-        mnByte = bmInfoHeader.biBitCount / 8;
+    // The pixels live on the GPU now
+    mMemoryUsage = mImage->byteSize();
+    mImage.reset();
+}
+
+void Texture::destroy()
+{
+    if (mId)
+        glDeleteTextures(1, &mId);
+    mId = 0;
+    mMemoryUsage = 0;
+}
 
-        mBitmap = new unsigned char[mColumns * mRows * mnByte];
-        file.read((char *) mBitmap, mColumns * mRows * mnByte);
-        file.close();
+void Texture::texImage(GLenum target, GLint level, const TextureImage::Level& image, UploadManager *uploads)
+{
+    if (mImage->isCompressed())
+    {
+        if (uploads)
+            uploads->compressedTexImage2D(target, level, mImage->format, image.width, image.height, image.data.data(), image.data.size());
+        else
+            glCompressedTexImage2D(target, level, mImage->format, image.width, image.height, 0, static_cast<GLsizei>(image.data.size()), image.data.data());
     }
     else
     {
-        qDebug() << "Can not read " << QString(fileWithPath.c_str());
-    }
-    unsigned char tmp;
-    // switch red and blue
-    for (int k = 0; k < mColumns * mRows * mnByte; k += mnByte) {
-        tmp = mBitmap[k];
-        mBitmap[k] = mBitmap[k + 2];
-        mBitmap[k + 2] = tmp;
+        if (uploads)
+            uploads->texImage2D(target, level, GL_RGBA8, image.width, image.height, GL_RGBA, GL_UNSIGNED_BYTE, image.data.data(), image.data.size());
+        else
+            glTexImage2D(target, level, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data.data());
     }
 }
 
-void Texture::setTexture(GLuint textureUnit)
+/**
+    \brief Texture::id() Return the id of a previously generated texture object
+    \return The id of a previously generated texture object
+ */
+GLuint Texture::id() const
 {
-    glGenTextures(1, &mId);
+    return mId;
+}
+
+void Texture::setTexture(GLuint textureUnit, UploadManager *uploads)
+{
+    if (!mId)
+        glGenTextures(1, &mId);
     // activate the texture unit first before binding texture
     glActiveTexture(GL_TEXTURE0 + textureUnit);
     glBindTexture(GL_TEXTURE_2D, mId);
@@ -108,22 +150,23 @@ void Texture::setTexture(GLuint textureUnit)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(
-                GL_TEXTURE_2D,
-                0,
-                GL_RGB,
-                mColumns,
-                mRows,
-                0,
-                GL_RGB,
-                GL_UNSIGNED_BYTE,
-                mBitmap);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    if (!mImage || mImage->faces.empty())
+        return;
+
+    const auto& levels = mImage->faces.front();
+    for (unsigned int level{0}; level < levels.size(); ++level)
+        texImage(GL_TEXTURE_2D, static_cast<GLint>(level), levels[level], uploads);
+
+    // Mip chain is made when loading
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size()) - 1);
+    if (levels.size() > 1)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 }
 
-void Texture::initCubeMap(GLuint textureUnit)
+void Texture::initCubeMap(GLuint textureUnit, UploadManager *uploads)
 {
-    glGenTextures(1, &mId);
+    if (!mId)
+        glGenTextures(1, &mId);
     // activate the texture unit first before binding texture
     glActiveTexture(GL_TEXTURE0 + textureUnit);
     glBindTexture(GL_TEXTURE_CUBE_MAP, mId);
@@ -133,52 +176,18 @@ void Texture::initCubeMap(GLuint textureUnit)
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
-
-    const gsl::ivec2 skyboxSampleOrder[]
-    {
-        // Right, left, top, bottom, back, front
-        {0, 1}, {2, 1}, {1, 0}, {1, 2}, {3, 1}, {1, 1}
-    };
-
-    // Cubemap file should be 4 in width and 3 in height
-    if (mRows < 1 || mColumns < 1 || mnByte < 1)
+    // Faces are split out of the 4x3 cross when loading
+    if (!mImage || mImage->faces.size() != 6 || mImage->faces.front().front().data.empty())
         return;
-    unsigned int faceWidth{static_cast<unsigned int>(mColumns / 4)},
-    faceHeight{static_cast<unsigned int>(mRows / 3)},
-    byteSize{static_cast<unsigned int>(mnByte)};
-
-    // Create a buffer to copy subimage to.
-    unsigned char *buffer = new unsigned char[faceWidth * faceHeight * byteSize]{};
 
     for (unsigned int i{0}; i < 6; ++i)
     {
-        auto coords = skyboxSampleOrder[i];
-
-        // Copy each line of the subimage into the buffer
-        for (unsigned int j{0}; j < faceHeight; ++j)
-        {
-            std::memcpy(
-                    (buffer + j * faceWidth * byteSize),
-                    (mBitmap // Start
-                     + j * static_cast<unsigned int>(mColumns) * byteSize // entire line offset
-                     + static_cast<unsigned int>(coords.x) * faceWidth * byteSize // x offset
-                     + static_cast<unsigned int>(coords.y) * faceHeight * static_cast<unsigned int>(mColumns) * byteSize), // y offset
-                    faceWidth * byteSize
-                );
-        }
-
-        // Copy subimage from buffer to texture
-        glTexImage2D(
-                    GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                    0,
-                    GL_RGB,
-                    static_cast<int>(faceWidth),
-                    static_cast<int>(faceHeight),
-                    0,
-                    GL_RGB,
-                    GL_UNSIGNED_BYTE,
-                    buffer);
+        const auto& levels = mImage->faces[i];
+        for (unsigned int level{0}; level < levels.size(); ++level)
+            texImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, static_cast<GLint>(level), levels[level], uploads);
     }
 
-    // glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mImage->levelCount()) - 1);
+    if (mImage->levelCount() > 1)
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 }
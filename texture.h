@@ -2,9 +2,14 @@
 #define TEXTURE_H
 
 #include <QOpenGLFunctions_4_1_Core>
+#include <memory>
+#include "textureimage.h"
+#include "resourcepool.h"
+
+class UploadManager;
 
 /**
-    \brief Simple class for creating textures from a bitmap file.
+    \brief Simple class for creating textures from an image file.
     \author Dag Nylund
     \date 16/02/05
  */
@@ -13,54 +18,47 @@ class Texture : protected QOpenGLFunctions_4_1_Core
 private:
     GLubyte pixels[16];
     GLuint mId{0};
-    unsigned char *mBitmap;
-    // NB: Columns are actually width because idk...
-    int mColumns;
-    int mRows;
-    int mnByte;
-    void readBitmap(const std::string& filename);
-    void setTexture(GLuint textureUnit);
-    void initCubeMap(GLuint textureUnit = 0);
+    //! Pixels waiting to be uploaded. Released after upload.
+    std::unique_ptr<TextureImage> mImage;
+    std::size_t mMemoryUsage{0};
+    void setTexture(GLuint textureUnit, UploadManager* uploads = nullptr);
+    void initCubeMap(GLuint textureUnit = 0, UploadManager* uploads = nullptr);
+    //! glTexImage2D or glCompressedTexImage2D of one level, through the staging ring if there is one.
+    void texImage(GLenum target, GLint level, const TextureImage::Level& image, UploadManager* uploads);
+    struct PlaceholderTag {};
+    Texture(PlaceholderTag, GLenum type, GLuint textureUnit);
 public:
     Texture(GLuint textureUnit = 0);  //basic texture from code
     // More general constructor
-    Texture(const std::string& filename, GLenum type, GLuint textureUnit = 0);
+    Texture(const std::string& filename, GLenum type, GLuint textureUnit = 0, const TextureImage::Settings& settings = TextureImage::Settings{});
     GLuint id() const;
 
     GLenum mType;
     static Texture cubeMap(const std::string &filename, GLuint textureUnit = 0);
 
-private:
-    //this is put inside this class to avoid spamming the main namespace
-    //with stuff that only is used inside this class
-
-    //Quick fix to get rid of windows.h which contains
-    //BITMAPINFOHEADER and BITMAPFILEHEADER.
-    typedef unsigned short int OWORD;    //should be 16 bit
-    typedef unsigned int ODWORD;         //should be 32 bit
-    typedef int OLONG;                   //should be 32 bit
+    /**
+     * @brief Creates a texture with a single white pixel (per face for cube maps) to use until the real image is uploaded.
+     * The id stays the same after upload, so materials can keep it.
+     */
+    static std::shared_ptr<Texture> placeholder(GLenum type, GLuint textureUnit = 0);
+    /**
+     * @brief Reads and processes the image without touching OpenGL, so it can be called from any thread.
+     * @return False if the file couldn't be read.
+     */
+    bool loadImage(const std::string& filename, const TextureImage::Settings& settings = TextureImage::Settings{});
+    /**
+     * @brief Uploads the image read by loadImage into this texture and frees the pixels. Must be called with the context current.
+     * @param uploads - streams the image through the upload manager's staging ring instead of straight from memory.
+     */
+    void upload(GLuint textureUnit = 0, UploadManager* uploads = nullptr);
 
-    struct OBITMAPINFOHEADER {
-        ODWORD biSize;
-        OLONG  biWidth;
-        OLONG  biHeight;
-        OWORD  biPlanes;
-        OWORD  biBitCount;
-        ODWORD biCompression;
-        ODWORD biSizeImage;
-        OLONG  biXPelsPerMeter;
-        OLONG  biYPelsPerMeter;
-        ODWORD biClrUsed;
-        ODWORD biClrImportant;
-    };
+    //! Bytes used on the GPU by all faces and mip levels, 0 until uploaded.
+    std::size_t memoryUsage() const { return mMemoryUsage; }
 
-    struct OBITMAPFILEHEADER {
-        OWORD  bfType;
-        ODWORD bfSize;
-        OWORD  bfReserved1;
-        OWORD  bfReserved2;
-        ODWORD bfOffBits;
-    };
+    //! Deletes the OpenGL texture. Must be called with the context current.
+    void destroy();
 };
 
+using TextureRef = ResourceRef<Texture>;
+
 #endif // TEXTURE_H
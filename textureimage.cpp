@@ -0,0 +1,595 @@
+#include "textureimage.h"
+#include <QImage>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDebug>
+#include <fstream>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTUREIMAGE_SSE2
+#endif
+
+namespace
+{
+const char fileMagic[4] = {'I', 'N', 'N', 'T'};
+const std::uint32_t fileVersion{1};
+// Larger than any texture GL_MAX_TEXTURE_SIZE allows, so it's only hit by broken files
+const std::int32_t maxCookedSize{1 << 16};
+
+struct FileHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::int64_t sourceModified;
+    std::int64_t sourceSize;
+    std::uint32_t settings;
+    std::uint32_t format;
+    std::uint32_t hasAlpha;
+    std::uint32_t faceCount;
+    std::uint32_t levelCount;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(FileHeader) == 48, "Cooked texture header layout changed");
+
+struct LevelEntry
+{
+    std::int32_t width;
+    std::int32_t height;
+    std::uint64_t size;
+};
+
+// Bytes a level of the given format and size takes, 0 if the format isn't one we write
+std::uint64_t levelSize(std::uint32_t format, std::int32_t width, std::int32_t height)
+{
+    const auto w = static_cast<std::uint64_t>(width), h = static_cast<std::uint64_t>(height);
+    switch (format)
+    {
+    case GL_RGBA8:
+        return w * h * 4;
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        return ((w + 3) / 4) * ((h + 3) / 4) * 8;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        return ((w + 3) / 4) * ((h + 3) / 4) * 16;
+    default:
+        return 0;
+    }
+}
+
+inline const unsigned char* pixelAt(const TextureImage::Level& level, int x, int y)
+{
+    x = std::min(x, level.width - 1);
+    y = std::min(y, level.height - 1);
+    return level.data.data() + (static_cast<std::size_t>(y) * static_cast<std::size_t>(level.width) + static_cast<std::size_t>(x)) * 4;
+}
+
+inline std::uint16_t to565(const int* colour)
+{
+    return static_cast<std::uint16_t>(((colour[0] * 31 + 127) / 255) << 11 | ((colour[1] * 63 + 127) / 255) << 5 | ((colour[2] * 31 + 127) / 255));
+}
+
+inline void from565(std::uint16_t packed, int* colour)
+{
+    const int r{(packed >> 11) & 31}, g{(packed >> 5) & 63}, b{packed & 31};
+    colour[0] = (r << 3) | (r >> 2);
+    colour[1] = (g << 2) | (g >> 4);
+    colour[2] = (b << 3) | (b >> 2);
+}
+
+inline void writeLittleEndian(unsigned char* out, std::uint64_t value, int bytes)
+{
+    for (int i{0}; i < bytes; ++i)
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+// Colour part of a BC1/BC3 block: bounding box endpoints inset a little, then nearest of the four palette colours
+void compressColourBlock(const unsigned char block[16][4], unsigned char* out)
+{
+    int minColour[3]{255, 255, 255}, maxColour[3]{0, 0, 0};
+    for (unsigned int i{0}; i < 16; ++i)
+    {
+        for (unsigned int c{0}; c < 3; ++c)
+        {
+            minColour[c] = std::min<int>(minColour[c], block[i][c]);
+            maxColour[c] = std::max<int>(maxColour[c], block[i][c]);
+        }
+    }
+    for (unsigned int c{0}; c < 3; ++c)
+    {
+        const int inset{(maxColour[c] - minColour[c]) / 16};
+        minColour[c] += inset;
+        maxColour[c] -= inset;
+    }
+
+    // Pick the diagonal of the box that follows the colours: flip channels that go against the widest one
+    unsigned int widest{0};
+    for (unsigned int c{1}; c < 3; ++c)
+        if (maxColour[c] - minColour[c] > maxColour[widest] - minColour[widest])
+            widest = c;
+
+    int mean[3]{0, 0, 0};
+    for (unsigned int i{0}; i < 16; ++i)
+        for (unsigned int c{0}; c < 3; ++c)
+            mean[c] += block[i][c];
+    for (unsigned int c{0}; c < 3; ++c)
+        mean[c] /= 16;
+
+    for (unsigned int c{0}; c < 3; ++c)
+    {
+        int covariance{0};
+        for (unsigned int i{0}; i < 16; ++i)
+            covariance += (block[i][c] - mean[c]) * (block[i][widest] - mean[widest]);
+        if (covariance < 0)
+            std::swap(minColour[c], maxColour[c]);
+    }
+
+    auto colour0 = to565(maxColour);
+    auto colour1 = to565(minColour);
+    // colour0 > colour1 selects the four colour mode in BC1
+    if (colour0 < colour1)
+        std::swap(colour0, colour1);
+
+    std::uint32_t indices{0};
+    if (colour0 != colour1)
+    {
+        int palette[4][3];
+        from565(colour0, palette[0]);
+        from565(colour1, palette[1]);
+        for (unsigned int c{0}; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (unsigned int i{0}; i < 16; ++i)
+        {
+            unsigned int best{0};
+            int bestDistance{std::numeric_limits<int>::max()};
+            for (unsigned int p{0}; p < 4; ++p)
+            {
+                int distance{0};
+                for (unsigned int c{0}; c < 3; ++c)
+                {
+                    const int d{block[i][c] - palette[p][c]};
+                    distance += d * d;
+                }
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= best << (2 * i);
+        }
+    }
+
+    writeLittleEndian(out, colour0, 2);
+    writeLittleEndian(out + 2, colour1, 2);
+    writeLittleEndian(out + 4, indices, 4);
+}
+
+// Alpha part of a BC3 block, eight alpha mode
+void compressAlphaBlock(const unsigned char block[16][4], unsigned char* out)
+{
+    int minAlpha{255}, maxAlpha{0};
+    for (unsigned int i{0}; i < 16; ++i)
+    {
+        minAlpha = std::min<int>(minAlpha, block[i][3]);
+        maxAlpha = std::max<int>(maxAlpha, block[i][3]);
+    }
+
+    std::uint64_t indices{0};
+    if (maxAlpha != minAlpha)
+    {
+        int palette[8]{maxAlpha, minAlpha};
+        for (int p{1}; p < 7; ++p)
+            palette[p + 1] = ((7 - p) * maxAlpha + p * minAlpha) / 7;
+
+        for (unsigned int i{0}; i < 16; ++i)
+        {
+            std::uint64_t best{0};
+            int bestDistance{256};
+            for (unsigned int p{0}; p < 8; ++p)
+            {
+                const int distance{std::abs(block[i][3] - palette[p])};
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= best << (3 * i);
+        }
+    }
+
+    out[0] = static_cast<unsigned char>(maxAlpha);
+    out[1] = static_cast<unsigned char>(minAlpha);
+    writeLittleEndian(out + 2, indices, 6);
+}
+}
+
+bool TextureImage::load(const std::string &path, GLenum type, const Settings &settings)
+{
+    const QFileInfo fileInfo{QString::fromStdString(path)};
+    if (!fileInfo.exists())
+    {
+        qDebug() << "Error TextureImage: Can not read" << QString::fromStdString(path);
+        return false;
+    }
+
+    const auto cookedPath = path + ".cooked";
+    const std::int64_t sourceModified{fileInfo.lastModified().toMSecsSinceEpoch()};
+    const std::int64_t sourceSize{fileInfo.size()};
+    const auto hash = settingsHash(type, settings);
+    if (settings.cook && readCooked(cookedPath, sourceModified, sourceSize, hash))
+        return true;
+
+    if (!readImage(path))
+    {
+        qDebug() << "Error TextureImage: Can not read" << QString::fromStdString(path);
+        return false;
+    }
+
+    if (type == GL_TEXTURE_CUBE_MAP)
+        splitCubeFaces();
+    if (settings.mipmaps)
+        generateMips();
+    if (settings.compress)
+        compressAll();
+
+    if (settings.cook && !writeCooked(cookedPath, sourceModified, sourceSize, hash))
+        qDebug() << "TextureImage: Failed to write cooked texture" << QString::fromStdString(cookedPath);
+
+    return true;
+}
+
+std::size_t TextureImage::byteSize() const
+{
+    std::size_t size{0};
+    for (const auto& face : faces)
+        for (const auto& level : face)
+            size += level.data.size();
+    return size;
+}
+
+TextureImage::Level TextureImage::downsample(const Level &source)
+{
+    Level result;
+    result.width = std::max(source.width / 2, 1);
+    result.height = std::max(source.height / 2, 1);
+    result.data.resize(static_cast<std::size_t>(result.width) * static_cast<std::size_t>(result.height) * 4);
+
+    for (int y{0}; y < result.height; ++y)
+    {
+        const auto row0 = pixelAt(source, 0, 2 * y);
+        const auto row1 = pixelAt(source, 0, 2 * y + 1);
+        auto out = result.data.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(result.width) * 4;
+
+        int x{0};
+#ifdef TEXTUREIMAGE_SSE2
+        // Two output pixels from four source pixels of each row at a time
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi16(2);
+        for (; 2 * x + 4 <= source.width && x + 2 <= result.width; x += 2)
+        {
+            const __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 8 * x));
+            const __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 8 * x));
+
+            // Pixels 0 and 1 in the low half, 2 and 3 in the high half, as 16 bit
+            const __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+            const __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+
+            // Add each pair of horizontal neighbours
+            const __m128i lowSum = _mm_add_epi16(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(1, 0, 3, 2)));
+            const __m128i highSum = _mm_add_epi16(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(1, 0, 3, 2)));
+
+            __m128i sum = _mm_unpacklo_epi64(lowSum, highSum);
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 4 * x), _mm_packus_epi16(sum, zero));
+        }
+#endif
+        for (; x < result.width; ++x)
+        {
+            const auto a = pixelAt(source, 2 * x, 2 * y);
+            const auto b = pixelAt(source, 2 * x + 1, 2 * y);
+            const auto c = pixelAt(source, 2 * x, 2 * y + 1);
+            const auto d = pixelAt(source, 2 * x + 1, 2 * y + 1);
+            for (unsigned int channel{0}; channel < 4; ++channel)
+                out[4 * x + channel] = static_cast<unsigned char>((a[channel] + b[channel] + c[channel] + d[channel] + 2) / 4);
+        }
+    }
+
+    return result;
+}
+
+TextureImage::Level TextureImage::compress(const Level &source, bool alpha)
+{
+    const int blocksX{(source.width + 3) / 4}, blocksY{(source.height + 3) / 4};
+    const std::size_t blockSize{alpha ? 16u : 8u};
+
+    Level result;
+    result.width = source.width;
+    result.height = source.height;
+    result.data.resize(static_cast<std::size_t>(blocksX) * static_cast<std::size_t>(blocksY) * blockSize);
+
+    unsigned char block[16][4];
+    auto out = result.data.data();
+    for (int blockY{0}; blockY < blocksY; ++blockY)
+    {
+        for (int blockX{0}; blockX < blocksX; ++blockX)
+        {
+            // Edge blocks repeat the last row and column
+            for (int i{0}; i < 16; ++i)
+                std::memcpy(block[i], pixelAt(source, blockX * 4 + i % 4, blockY * 4 + i / 4), 4);
+
+            if (alpha)
+            {
+                compressAlphaBlock(block, out);
+                out += 8;
+            }
+            compressColourBlock(block, out);
+            out += 8;
+        }
+    }
+
+    return result;
+}
+
+bool TextureImage::readImage(const std::string &path)
+{
+    QImage image{QString::fromStdString(path)};
+    if (image.isNull())
+        return QFileInfo{QString::fromStdString(path)}.suffix().toLower() == "tga" && readTGA(path);
+
+    hasAlpha = image.hasAlphaChannel();
+    // OpenGL wants the bottom row first
+    image = image.convertToFormat(QImage::Format_RGBA8888).mirrored();
+
+    Level level;
+    level.width = image.width();
+    level.height = image.height();
+    level.data.resize(static_cast<std::size_t>(level.width) * static_cast<std::size_t>(level.height) * 4);
+    for (int y{0}; y < level.height; ++y)
+        std::memcpy(level.data.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(level.width) * 4, image.constScanLine(y), static_cast<std::size_t>(level.width) * 4);
+
+    format = GL_RGBA8;
+    faces.assign(1, std::vector<Level>{});
+    faces.front().push_back(std::move(level));
+    return true;
+}
+
+bool TextureImage::readTGA(const std::string &path)
+{
+    QFile file{QString::fromStdString(path)};
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const auto bytes = file.readAll();
+    const auto data = reinterpret_cast<const unsigned char*>(bytes.constData());
+    const auto size = static_cast<std::size_t>(bytes.size());
+    if (size < 18)
+        return false;
+
+    const unsigned char idLength{data[0]}, colourMapType{data[1]}, imageType{data[2]};
+    const int width{data[12] | data[13] << 8}, height{data[14] | data[15] << 8};
+    const unsigned int bytesPerPixel{data[16] / 8u};
+    const bool topFirst{(data[17] & 0x20) != 0};
+
+    // Only uncompressed (2) and run length encoded (10) true colour images
+    if (colourMapType != 0 || (imageType != 2 && imageType != 10) || (bytesPerPixel != 3 && bytesPerPixel != 4) || width <= 0 || height <= 0)
+    {
+        qDebug() << "Error TextureImage: Unsupported TGA" << QString::fromStdString(path);
+        return false;
+    }
+
+    Level level;
+    level.width = width;
+    level.height = height;
+    const auto pixelCount = static_cast<std::size_t>(width) * static_cast<std::size_t>(height);
+    level.data.resize(pixelCount * 4);
+
+    std::size_t position{18u + idLength};
+    const auto readPixel = [&](unsigned char* out){
+        if (position + bytesPerPixel > size)
+            return false;
+        // Stored as BGR(A)
+        out[0] = data[position + 2];
+        out[1] = data[position + 1];
+        out[2] = data[position];
+        out[3] = (bytesPerPixel == 4) ? data[position + 3] : 255;
+        position += bytesPerPixel;
+        return true;
+    };
+
+    for (std::size_t i{0}; i < pixelCount;)
+    {
+        std::size_t count{1};
+        bool repeat{false};
+        if (imageType == 10)
+        {
+            if (position >= size)
+                return false;
+            const unsigned char packet{data[position++]};
+            count = (packet & 0x7f) + 1u;
+            repeat = (packet & 0x80) != 0;
+        }
+
+        for (std::size_t j{0}; j < count && i < pixelCount; ++j, ++i)
+        {
+            auto out = level.data.data() + i * 4;
+            if (repeat && j > 0)
+                std::memcpy(out, out - 4, 4);
+            else if (!readPixel(out))
+                return false;
+        }
+    }
+
+    // OpenGL wants the bottom row first
+    if (topFirst)
+    {
+        const auto rowSize = static_cast<std::size_t>(width) * 4;
+        for (int y{0}; y < height / 2; ++y)
+            std::swap_ranges(level.data.begin() + static_cast<std::ptrdiff_t>(y * rowSize),
+                             level.data.begin() + static_cast<std::ptrdiff_t>((y + 1) * rowSize),
+                             level.data.begin() + static_cast<std::ptrdiff_t>((height - 1 - y) * rowSize));
+    }
+
+    hasAlpha = (bytesPerPixel == 4);
+    format = GL_RGBA8;
+    faces.assign(1, std::vector<Level>{});
+    faces.front().push_back(std::move(level));
+    return true;
+}
+
+void TextureImage::splitCubeFaces()
+{
+    // Right, left, top, bottom, back, front
+    const int sampleOrder[6][2]{{0, 1}, {2, 1}, {1, 0}, {1, 2}, {3, 1}, {1, 1}};
+
+    // Cubemap file should be 4 in width and 3 in height
+    const auto cross = std::move(faces.front().front());
+    const int faceWidth{cross.width / 4}, faceHeight{cross.height / 3};
+    faces.assign(6, std::vector<Level>(1));
+    if (faceWidth < 1 || faceHeight < 1)
+        return;
+
+    const auto rowSize = static_cast<std::size_t>(faceWidth) * 4;
+    for (unsigned int i{0}; i < 6; ++i)
+    {
+        auto& face = faces[i].front();
+        face.width = faceWidth;
+        face.height = faceHeight;
+        face.data.resize(rowSize * static_cast<std::size_t>(faceHeight));
+
+        for (int y{0}; y < faceHeight; ++y)
+            std::memcpy(face.data.data() + static_cast<std::size_t>(y) * rowSize,
+                        pixelAt(cross, sampleOrder[i][0] * faceWidth, sampleOrder[i][1] * faceHeight + y), rowSize);
+    }
+}
+
+void TextureImage::generateMips()
+{
+    for (auto& face : faces)
+    {
+        if (face.empty() || face.front().data.empty())
+            continue;
+
+        face.resize(1);
+        while (face.back().width > 1 || face.back().height > 1)
+            face.push_back(downsample(face.back()));
+    }
+}
+
+void TextureImage::compressAll()
+{
+    for (auto& face : faces)
+        for (auto& level : face)
+            level = compress(level, hasAlpha);
+
+    format = hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
+
+std::uint32_t TextureImage::settingsHash(GLenum type, const Settings &settings)
+{
+    return static_cast<std::uint32_t>(settings.mipmaps) | static_cast<std::uint32_t>(settings.compress) << 1
+            | static_cast<std::uint32_t>(type == GL_TEXTURE_CUBE_MAP) << 2;
+}
+
+bool TextureImage::readCooked(const std::string &path, std::int64_t sourceModified, std::int64_t sourceSize, std::uint32_t settings)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+        return false;
+
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0
+        || header.version != fileVersion || header.sourceModified != sourceModified || header.sourceSize != sourceSize
+        || header.settings != settings || header.faceCount == 0 || header.faceCount > 6 || header.levelCount == 0 || header.levelCount > 32)
+        return false;
+
+    std::vector<LevelEntry> entries(header.faceCount * header.levelCount);
+    if (!file.read(reinterpret_cast<char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(LevelEntry))))
+        return false;
+
+    // Check every level against its format and the file length before allocating anything,
+    // a truncated or corrupt file is cooked again instead
+    const auto dataStart = static_cast<std::uint64_t>(file.tellg());
+    file.seekg(0, std::ios::end);
+    const auto fileSize = static_cast<std::uint64_t>(file.tellg());
+    file.seekg(static_cast<std::streamoff>(dataStart));
+    std::uint64_t remaining{fileSize - dataStart};
+    for (unsigned int i{0}; i < entries.size(); ++i)
+    {
+        const auto& entry = entries[i];
+        // Mips halve the size of the face's first level, like downsample does
+        const auto& first = entries[i - i % header.levelCount];
+        const auto level = i % header.levelCount;
+        const bool mipSizeValid = level == 0 || (entry.width == std::max(first.width >> level, 1) && entry.height == std::max(first.height >> level, 1));
+        const auto expectedSize = levelSize(header.format, entry.width, entry.height);
+
+        if (entry.width <= 0 || entry.height <= 0 || entry.width > maxCookedSize || entry.height > maxCookedSize || !mipSizeValid
+            || expectedSize == 0 || entry.size != expectedSize || entry.size > remaining)
+        {
+            qDebug() << "TextureImage: Broken cooked texture, cooking it again:" << QString::fromStdString(path);
+            return false;
+        }
+        remaining -= entry.size;
+    }
+
+    std::vector<std::vector<Level>> cookedFaces(header.faceCount, std::vector<Level>(header.levelCount));
+    for (unsigned int i{0}; i < entries.size(); ++i)
+    {
+        auto& level = cookedFaces[i / header.levelCount][i % header.levelCount];
+        level.width = entries[i].width;
+        level.height = entries[i].height;
+        level.data.resize(entries[i].size);
+        if (!file.read(reinterpret_cast<char*>(level.data.data()), static_cast<std::streamsize>(level.data.size())))
+            return false;
+    }
+
+    faces = std::move(cookedFaces);
+    format = header.format;
+    hasAlpha = header.hasAlpha != 0;
+    return true;
+}
+
+bool TextureImage::writeCooked(const std::string &path, std::int64_t sourceModified, std::int64_t sourceSize, std::uint32_t settings) const
+{
+    if (faces.empty() || faces.front().empty())
+        return false;
+
+    FileHeader header{};
+    std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+    header.version = fileVersion;
+    header.sourceModified = sourceModified;
+    header.sourceSize = sourceSize;
+    header.settings = settings;
+    header.format = format;
+    header.hasAlpha = hasAlpha;
+    header.faceCount = static_cast<std::uint32_t>(faces.size());
+    header.levelCount = levelCount();
+
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    if (!file)
+        return false;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& face : faces)
+    {
+        for (const auto& level : face)
+        {
+            const LevelEntry entry{level.width, level.height, level.data.size()};
+            file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        }
+    }
+    for (const auto& face : faces)
+        for (const auto& level : face)
+            file.write(reinterpret_cast<const char*>(level.data.data()), static_cast<std::streamsize>(level.data.size()));
+
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,84 @@
+#ifndef TEXTUREIMAGE_H
+#define TEXTUREIMAGE_H
+
+#include <qopengl.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+/** CPU side of a texture: the pixels of every face and mip level, ready to be uploaded.
+ * Images are read with QImage (BMP, PNG, JPG, ...) or the built in TGA reader, and stored
+ * as RGBA8 with the bottom row first, which is what OpenGL expects.
+ * Does no OpenGL calls, so it's safe to use on the loading threads.
+ * @brief CPU side of a texture.
+ */
+class TextureImage
+{
+public:
+    struct Settings
+    {
+        //! Build the mip chain on the CPU.
+        bool mipmaps{true};
+        //! Block compress to BC1, or BC3 if the image has alpha.
+        bool compress{false};
+        //! Read and write the processed image to a .cooked file next to the source.
+        bool cook{true};
+    };
+
+    struct Level
+    {
+        int width{0};
+        int height{0};
+        std::vector<unsigned char> data;
+    };
+
+    //! Faces[face][level]. Six faces for cube maps, one otherwise.
+    std::vector<std::vector<Level>> faces;
+    //! GL_RGBA8 or one of the compressed formats.
+    GLenum format{GL_RGBA8};
+    bool hasAlpha{false};
+
+    /**
+     * @brief Loads the image at path and processes it for the given texture type,
+     * using the cooked file if it's up to date. Returns false if the image couldn't be read.
+     */
+    bool load(const std::string& path, GLenum type, const Settings& settings);
+
+    bool isCompressed() const { return format != GL_RGBA8; }
+    unsigned int levelCount() const { return faces.empty() ? 0 : static_cast<unsigned int>(faces.front().size()); }
+    //! Size of all faces and levels, which is also what they use on the GPU.
+    std::size_t byteSize() const;
+
+    /**
+     * @brief Halves the image with a 2x2 box filter. Uses SSE2 where available.
+     */
+    static Level downsample(const Level& source);
+
+    /**
+     * @brief Compresses RGBA8 pixels to BC1 (8 bytes per 4x4 block) or BC3 (16 bytes per block).
+     */
+    static Level compress(const Level& source, bool alpha);
+
+private:
+    bool readImage(const std::string& path);
+    bool readTGA(const std::string& path);
+    //! Splits a 4x3 cross into the six cube map faces.
+    void splitCubeFaces();
+    void generateMips();
+    void compressAll();
+
+    //! Hash of everything that changes the output, stored in the cooked file.
+    static std::uint32_t settingsHash(GLenum type, const Settings& settings);
+    bool readCooked(const std::string& path, std::int64_t sourceModified, std::int64_t sourceSize, std::uint32_t settings);
+    bool writeCooked(const std::string& path, std::int64_t sourceModified, std::int64_t sourceSize, std::uint32_t settings) const;
+};
+
+#endif // TEXTUREIMAGE_H
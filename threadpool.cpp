@@ -0,0 +1,43 @@
+#include "threadpool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (!threadCount)
+        threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    mThreads.reserve(threadCount);
+    for (unsigned int i{0}; i < threadCount; ++i)
+        mThreads.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        mStopping = true;
+        mJobs.clear();
+    }
+    mCondition.notify_all();
+
+    for (auto& thread : mThreads)
+        thread.join();
+}
+
+void ThreadPool::work()
+{
+    for (;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock{mMutex};
+            mCondition.wait(lock, [this](){ return mStopping || !mJobs.empty(); });
+            if (mStopping)
+                return;
+
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+        }
+        job();
+    }
+}
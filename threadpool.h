@@ -0,0 +1,60 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+/** Fixed number of worker threads running queued jobs in order.
+ * Jobs still in the queue when the pool is destroyed are dropped,
+ * their futures will throw std::future_error (broken promise).
+ * @brief Fixed size thread pool.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @param threadCount - number of workers. 0 uses the number of hardware threads minus one for the main thread.
+     */
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator= (const ThreadPool&) = delete;
+
+    /**
+     * @brief Queues a job.
+     * @return Future for the result of the job.
+     */
+    template<typename Func>
+    auto submit(Func func) -> std::future<decltype(func())>
+    {
+        using Result = decltype(func());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(func));
+        auto future = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock{mMutex};
+            mJobs.emplace_back([task](){ (*task)(); });
+        }
+        mCondition.notify_one();
+        return future;
+    }
+
+    unsigned int threadCount() const { return static_cast<unsigned int>(mThreads.size()); }
+
+private:
+    void work();
+
+    std::vector<std::thread> mThreads;
+    std::deque<std::function<void()>> mJobs;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mStopping{false};
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,339 @@
+#include "uploadmanager.h"
+#include <QOpenGLContext>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+// Keeps staged blocks aligned for any vertex, index or pixel data
+const std::size_t stagingAlignment{16};
+
+inline std::size_t alignUp(std::size_t value)
+{
+    return (value + stagingAlignment - 1) & ~(stagingAlignment - 1);
+}
+}
+
+UploadManager::RangeAllocator::RangeAllocator(unsigned int capacity)
+    : mCapacity{capacity}
+{
+    if (capacity)
+        mFree[0] = capacity;
+}
+
+bool UploadManager::RangeAllocator::allocate(unsigned int count, unsigned int &offset)
+{
+    for (auto it = mFree.begin(); it != mFree.end(); ++it)
+    {
+        if (it->second < count)
+            continue;
+
+        offset = it->first;
+        const auto remaining = it->second - count;
+        mFree.erase(it);
+        if (remaining)
+            mFree[offset + count] = remaining;
+        mUsed += count;
+        return true;
+    }
+    return false;
+}
+
+void UploadManager::RangeAllocator::release(unsigned int offset, unsigned int count)
+{
+    if (!count)
+        return;
+
+    mUsed -= count;
+    auto it = mFree.emplace(offset, count).first;
+
+    // Merge with the next block
+    auto next = std::next(it);
+    if (next != mFree.end() && it->first + it->second == next->first)
+    {
+        it->second += next->second;
+        mFree.erase(next);
+    }
+
+    // Merge with the previous block
+    if (it != mFree.begin())
+    {
+        auto previous = std::prev(it);
+        if (previous->first + previous->second == it->first)
+        {
+            previous->second += it->second;
+            mFree.erase(it);
+        }
+    }
+}
+
+UploadManager::UploadManager(std::size_t stagingSize, unsigned int arenaVertices, unsigned int arenaIndices)
+    : mStagingSize{stagingSize}, mArenaVertices{arenaVertices}, mArenaIndices{arenaIndices}
+{
+    initializeOpenGLFunctions();
+
+    glGenBuffers(1, &mStagingBuffer);
+    glBindBuffer(GL_COPY_READ_BUFFER, mStagingBuffer);
+    glBufferData(GL_COPY_READ_BUFFER, static_cast<GLsizeiptr>(mStagingSize), nullptr, GL_STREAM_COPY);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+UploadManager::~UploadManager()
+{
+    // Nothing to clean up with if the context is already gone
+    if (!QOpenGLContext::currentContext())
+        return;
+
+    for (auto& batch : mBatches)
+        glDeleteSync(batch.fence);
+
+    for (auto& arena : mArenas)
+    {
+        glDeleteVertexArrays(1, &arena.vao);
+        glDeleteBuffers(1, &arena.vertexBuffer);
+        glDeleteBuffers(1, &arena.indexBuffer);
+    }
+    glDeleteBuffers(1, &mStagingBuffer);
+}
+
+UploadManager::MeshAllocation UploadManager::uploadMesh(const Vertex *vertices, unsigned int vertexCount, const GLuint *indices, unsigned int indexCount)
+{
+    MeshAllocation allocation;
+    allocation.vertexCount = vertexCount;
+    allocation.indexCount = indexCount;
+
+    // Find an arena with room for both the vertices and the indices
+    Arena* arena{nullptr};
+    unsigned int vertexOffset{0}, indexOffset{0};
+    for (auto& candidate : mArenas)
+    {
+        if (!candidate.vertices.allocate(vertexCount, vertexOffset))
+            continue;
+        if (indexCount && !candidate.indices.allocate(indexCount, indexOffset))
+        {
+            candidate.vertices.release(vertexOffset, vertexCount);
+            continue;
+        }
+        arena = &candidate;
+        break;
+    }
+
+    if (!arena)
+    {
+        arena = &createArena(std::max(vertexCount, mArenaVertices), std::max(indexCount, mArenaIndices));
+        arena->vertices.allocate(vertexCount, vertexOffset);
+        if (indexCount)
+            arena->indices.allocate(indexCount, indexOffset);
+    }
+
+    allocation.vao = arena->vao;
+    allocation.baseVertex = static_cast<int>(vertexOffset);
+    allocation.firstIndex = indexOffset;
+
+    copyToBuffer(arena->vertexBuffer, vertexOffset * sizeof(Vertex), vertices, vertexCount * sizeof(Vertex));
+    if (indexCount)
+        copyToBuffer(arena->indexBuffer, indexOffset * sizeof(GLuint), indices, indexCount * sizeof(GLuint));
+
+    return allocation;
+}
+
+void UploadManager::releaseMesh(const MeshAllocation &allocation)
+{
+    auto arena = std::find_if(mArenas.begin(), mArenas.end(), [&allocation](const Arena& arena){ return arena.vao == allocation.vao; });
+    if (arena == mArenas.end())
+        return;
+
+    arena->vertices.release(static_cast<unsigned int>(allocation.baseVertex), allocation.vertexCount);
+    if (allocation.indexCount)
+        arena->indices.release(allocation.firstIndex, allocation.indexCount);
+}
+
+void UploadManager::texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+                               GLenum format, GLenum type, const void *pixels, std::size_t size)
+{
+    const auto offset = (pixels && size) ? stage(pixels, size) : npos;
+    if (offset == npos)
+    {
+        glTexImage2D(target, level, internalFormat, width, height, 0, format, type, pixels);
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mStagingBuffer);
+    glTexImage2D(target, level, internalFormat, width, height, 0, format, type, reinterpret_cast<const GLvoid*>(offset));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void UploadManager::compressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                                         const void *data, std::size_t size)
+{
+    const auto offset = (data && size) ? stage(data, size) : npos;
+    if (offset == npos)
+    {
+        glCompressedTexImage2D(target, level, internalFormat, width, height, 0, static_cast<GLsizei>(size), data);
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mStagingBuffer);
+    glCompressedTexImage2D(target, level, internalFormat, width, height, 0, static_cast<GLsizei>(size), reinterpret_cast<const GLvoid*>(offset));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void UploadManager::flush()
+{
+    if (mStagingHead == mBatchBegin)
+        return;
+
+    if (!mCopies.empty())
+    {
+        // Group the copies by buffer to save binds
+        std::stable_sort(mCopies.begin(), mCopies.end(), [](const Copy& a, const Copy& b){ return a.buffer < b.buffer; });
+
+        glBindBuffer(GL_COPY_READ_BUFFER, mStagingBuffer);
+        GLuint boundBuffer{0};
+        for (const auto& copy : mCopies)
+        {
+            if (copy.buffer != boundBuffer)
+            {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, copy.buffer);
+                boundBuffer = copy.buffer;
+            }
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(copy.source),
+                                static_cast<GLintptr>(copy.destination), static_cast<GLsizeiptr>(copy.size));
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        mCopies.clear();
+    }
+
+    mBatches.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), mBatchBegin, mStagingHead});
+    mBatchBegin = mStagingHead;
+}
+
+std::size_t UploadManager::allocatedBytes() const
+{
+    std::size_t bytes{0};
+    for (const auto& arena : mArenas)
+        bytes += arena.vertices.used() * sizeof(Vertex) + arena.indices.used() * sizeof(GLuint);
+    return bytes;
+}
+
+UploadManager::Arena &UploadManager::createArena(unsigned int vertexCount, unsigned int indexCount)
+{
+    Arena arena;
+    arena.vertices = RangeAllocator{vertexCount};
+    arena.indices = RangeAllocator{indexCount};
+
+    glGenVertexArrays(1, &arena.vao);
+    glBindVertexArray(arena.vao);
+
+    glGenBuffers(1, &arena.vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, arena.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertexCount * sizeof(Vertex)), nullptr, GL_STATIC_DRAW);
+
+    // 1rst attribute buffer : vertices
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(0));
+    glEnableVertexAttribArray(0);
+
+    // 2nd attribute buffer : normals
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(1);
+
+    // 3rd attribute buffer : uvs
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(6 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(2);
+
+    glGenBuffers(1, &arena.indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indexCount * sizeof(GLuint)), nullptr, GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    mArenas.push_back(std::move(arena));
+    qDebug() << "UploadManager: Created mesh arena" << mArenas.size() << "with room for" << vertexCount << "vertices and" << indexCount << "indices";
+    return mArenas.back();
+}
+
+std::size_t UploadManager::stage(const void *data, std::size_t size)
+{
+    const auto alignedSize = alignUp(size);
+    if (alignedSize > mStagingSize)
+        return npos;
+
+    // Batches never wrap around the end of the ring
+    if (mStagingHead + alignedSize > mStagingSize)
+    {
+        flush();
+        mStagingHead = mBatchBegin = 0;
+    }
+
+    waitForRange(mStagingHead, mStagingHead + alignedSize);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, mStagingBuffer);
+    // Unsynchronized, the fences already make sure the GPU isn't reading this part
+    auto destination = glMapBufferRange(GL_COPY_READ_BUFFER, static_cast<GLintptr>(mStagingHead), static_cast<GLsizeiptr>(size),
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!destination)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        return npos;
+    }
+    std::memcpy(destination, data, size);
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    const auto offset = mStagingHead;
+    mStagingHead += alignedSize;
+    return offset;
+}
+
+void UploadManager::copyToBuffer(GLuint buffer, std::size_t offset, const void *data, std::size_t size)
+{
+    if (!size)
+        return;
+
+    const auto source = stage(data, size);
+    if (source != npos)
+    {
+        mCopies.push_back({buffer, source, offset, size});
+        return;
+    }
+
+    // Too large for the ring
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void UploadManager::waitForRange(std::size_t begin, std::size_t end)
+{
+    // Batches are retired oldest first, and the oldest are the ones ahead of the head
+    while (!mBatches.empty())
+    {
+        auto& batch = mBatches.front();
+        const bool overlaps = batch.begin < end && begin < batch.end;
+        const auto timeout = overlaps ? GLuint64{1000000000} : GLuint64{0};
+
+        auto status = glClientWaitSync(batch.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        while (overlaps && status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(batch.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+
+        if (status == GL_WAIT_FAILED)
+        {
+            // Can't tell if the GPU is done with the ring, so wait for everything before it's written to again
+            qDebug() << "UploadManager: Waiting for an upload fence failed with" << glGetError() << ", finishing all uploads";
+            glFinish();
+            for (auto& finished : mBatches)
+                glDeleteSync(finished.fence);
+            mBatches.clear();
+            break;
+        }
+
+        if (status == GL_TIMEOUT_EXPIRED)
+            break;
+
+        glDeleteSync(batch.fence);
+        mBatches.pop_front();
+    }
+}
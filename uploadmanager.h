@@ -0,0 +1,141 @@
+#ifndef UPLOADMANAGER_H
+#define UPLOADMANAGER_H
+
+#include <QOpenGLFunctions_4_1_Core>
+#include <vector>
+#include <deque>
+#include <map>
+#include <cstddef>
+#include "vertex.h"
+
+/** Streams mesh and texture data to the GPU through a staging ring buffer.
+ * Data is copied into the ring right away, and the copies into the destination buffers
+ * are batched up and issued in flush(). Each flushed batch is fenced, and a part of the ring
+ * is only written to again once the GPU is done with the batch that used it.
+ *
+ * Meshes aren't given buffers of their own, but are sub-allocated from large shared vertex and
+ * index buffers (arenas) with one VAO each. Indices are stored relative to the mesh, so meshes
+ * must be drawn with their base vertex and first index, see MeshData.
+ * @brief Streams mesh and texture data to the GPU through a staging ring buffer.
+ */
+class UploadManager : protected QOpenGLFunctions_4_1_Core
+{
+public:
+    //! Where a mesh ended up in the arenas.
+    struct MeshAllocation
+    {
+        GLuint vao{0};
+        int baseVertex{0};
+        unsigned int vertexCount{0};
+        unsigned int firstIndex{0};
+        unsigned int indexCount{0};
+    };
+
+    /**
+     * Must be created with the context current.
+     * @param stagingSize - size of the staging ring in bytes.
+     * @param arenaVertices - vertices in each vertex arena. Meshes that are larger get an arena of their own.
+     * @param arenaIndices - indices in each index arena.
+     */
+    explicit UploadManager(std::size_t stagingSize = 8 << 20, unsigned int arenaVertices = 1 << 19, unsigned int arenaIndices = 3 << 19);
+    ~UploadManager();
+
+    UploadManager(const UploadManager&) = delete;
+    UploadManager& operator= (const UploadManager&) = delete;
+
+    /**
+     * @brief Allocates room for the mesh in an arena and stages its data. The mesh can be drawn after the next flush().
+     */
+    MeshAllocation uploadMesh(const Vertex* vertices, unsigned int vertexCount, const GLuint* indices, unsigned int indexCount);
+
+    /**
+     * @brief Gives the mesh's part of the arena back. The caller must make sure it's no longer drawn.
+     */
+    void releaseMesh(const MeshAllocation& allocation);
+
+    /**
+     * @brief glTexImage2D through the staging ring, for the texture currently bound to target's binding point.
+     */
+    void texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+                    GLenum format, GLenum type, const void* pixels, std::size_t size);
+    //! glCompressedTexImage2D through the staging ring.
+    void compressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                              const void* data, std::size_t size);
+
+    /**
+     * @brief Issues all staged copies and fences the part of the ring they used.
+     */
+    void flush();
+
+    unsigned int arenaCount() const { return static_cast<unsigned int>(mArenas.size()); }
+    //! Bytes of vertex and index data currently allocated in the arenas.
+    std::size_t allocatedBytes() const;
+
+private:
+    /** First fit allocator over a range of elements, merging neighbouring free blocks.
+     * @brief First fit allocator over a range of elements.
+     */
+    class RangeAllocator
+    {
+    public:
+        explicit RangeAllocator(unsigned int capacity = 0);
+        //! Returns false if there is no free block large enough.
+        bool allocate(unsigned int count, unsigned int& offset);
+        void release(unsigned int offset, unsigned int count);
+        unsigned int capacity() const { return mCapacity; }
+        unsigned int used() const { return mUsed; }
+
+    private:
+        // Offset -> size of each free block
+        std::map<unsigned int, unsigned int> mFree;
+        unsigned int mCapacity;
+        unsigned int mUsed{0};
+    };
+
+    struct Arena
+    {
+        GLuint vao{0};
+        GLuint vertexBuffer{0};
+        GLuint indexBuffer{0};
+        RangeAllocator vertices;
+        RangeAllocator indices;
+    };
+
+    struct Copy
+    {
+        GLuint buffer;
+        std::size_t source;
+        std::size_t destination;
+        std::size_t size;
+    };
+
+    struct Batch
+    {
+        GLsync fence;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    static const std::size_t npos{static_cast<std::size_t>(-1)};
+
+    Arena& createArena(unsigned int vertexCount, unsigned int indexCount);
+    //! Copies data into the ring and returns the offset, or npos if it doesn't fit.
+    std::size_t stage(const void* data, std::size_t size);
+    //! Stages data for buffer, or writes it directly if it's larger than the ring.
+    void copyToBuffer(GLuint buffer, std::size_t offset, const void* data, std::size_t size);
+    //! Waits for batches using [begin, end) of the ring and retires any that are done. Falls back to glFinish if a wait fails.
+    void waitForRange(std::size_t begin, std::size_t end);
+
+    GLuint mStagingBuffer{0};
+    std::size_t mStagingSize;
+    std::size_t mStagingHead{0};
+    std::size_t mBatchBegin{0};
+    std::vector<Copy> mCopies;
+    std::deque<Batch> mBatches;
+
+    unsigned int mArenaVertices;
+    unsigned int mArenaIndices;
+    std::vector<Arena> mArenas;
+};
+
+#endif // UPLOADMANAGER_H
@@ -1,8 +1,11 @@
 #include "world.h"
 #include "resourcemanager.h"
 #include "entitymanager.h"
+#include "entitysnapshot.h"
 #include <cassert>
+#include <chrono>
 #include <QFileInfo>
+#include <QDebug>
 
 World* World::mWorldInstance{nullptr};
 
@@ -21,6 +24,10 @@ World::World()
     ResourceManager::instance().addShader("directionalLight",   std::make_shared<Shader>("/Deferred/light.vert", "/Deferred/directionallight.frag", ShaderType::Light));
     ResourceManager::instance().addShader("pointLight",         std::make_shared<Shader>("/Deferred/light.vert", "/Deferred/pointlight.frag", ShaderType::Light));
     ResourceManager::instance().addShader("spotLight",          std::make_shared<Shader>("/Deferred/light.vert", "/Deferred/spotlight.frag", ShaderType::Light));
+    ResourceManager::instance().addShader("clusteredLight",     std::make_shared<Shader>("/Deferred/light.vert", "/Deferred/clusteredlight.frag", ShaderType::Light));
+    ResourceManager::instance().addShader("pointLightVolume",   std::make_shared<Shader>("/Deferred/lightvolume.vert", "/Deferred/pointlight.frag", ShaderType::Light));
+    ResourceManager::instance().addShader("spotLightVolume",    std::make_shared<Shader>("/Deferred/lightvolume.vert", "/Deferred/spotlight.frag", ShaderType::Light));
+    ResourceManager::instance().addShader("lightStencil",       std::make_shared<Shader>("/Deferred/lightvolume.vert", "/Deferred/lightstencil.frag", ShaderType::Light));
 
     // Post prosessing
     ResourceManager::instance().addShader("passthrough",        std::make_shared<Shader>("pass.vert", "pass.frag", ShaderType::PostProcessing));
@@ -40,23 +47,27 @@ World::World()
     // This function is troublesome...
     // ResourceManager::instance().LoadAssetFiles();
 
-    ResourceManager::instance().addMesh("skybox", "skybox.txt");
-    ResourceManager::instance().addMesh("box2", "box2.txt");
-    ResourceManager::instance().addMesh("axis", "axis.txt");
-    ResourceManager::instance().addMesh("suzanne", "monkey.obj");
+    // Loaded in the background, placeholders are used until they're uploaded.
+    ResourceManager::instance().addMeshAsync("skybox", "skybox.txt");
+    ResourceManager::instance().addMeshAsync("box2", "box2.txt");
+    ResourceManager::instance().addMeshAsync("axis", "axis.txt", GL_LINES);
+    // Suzanne is detailed enough to keep the full mesh a bit longer than the defaults
+    ResourceManager::instance().setLODScreenSizes("suzanne", {0.25f, 0.1f});
+    ResourceManager::instance().addMeshAsync("suzanne", "monkey.obj");
+    ResourceManager::instance().addMeshAsync("camera", "camera.obj");
+    // setupLOD needs the meshes to be uploaded
     auto ball = ResourceManager::instance().addMesh("ball", "octoball_L-1.txt");
     ResourceManager::instance().setupLOD(ball, ResourceManager::instance().addMesh("ball_l2", "octoball_L01.txt"), 2);
     ResourceManager::instance().setupLOD(ball, ResourceManager::instance().addMesh("ball_l1", "octoball.txt"), 1);
-    ResourceManager::instance().addMesh("camera", "camera.obj");
 
 
-    ResourceManager::instance().loadWav("Caravan_mono", std::string{gsl::soundsFilePath}.append("Caravan_mono.wav"));
-    ResourceManager::instance().loadWav("explosion", std::string{gsl::soundsFilePath}.append("explosion.wav"));
-    ResourceManager::instance().loadWav("laser", std::string{gsl::soundsFilePath}.append("laser.wav"));
-    ResourceManager::instance().loadWav("stereo", std::string{gsl::soundsFilePath}.append("stereo.wav"));
+    ResourceManager::instance().loadWavAsync("Caravan_mono", std::string{gsl::soundsFilePath}.append("Caravan_mono.wav"));
+    ResourceManager::instance().loadWavAsync("explosion", std::string{gsl::soundsFilePath}.append("explosion.wav"));
+    ResourceManager::instance().loadWavAsync("laser", std::string{gsl::soundsFilePath}.append("laser.wav"));
+    ResourceManager::instance().loadWavAsync("stereo", std::string{gsl::soundsFilePath}.append("stereo.wav"));
 
-    ResourceManager::instance().addTexture("skybox", "skyboxSpaceBoring.bmp", GL_TEXTURE_CUBE_MAP);
-    ResourceManager::instance().addTexture("cow", "cow.bmp", GL_TEXTURE_2D);
+    ResourceManager::instance().addTextureAsync("skybox", "skyboxSpaceBoring.bmp", GL_TEXTURE_CUBE_MAP);
+    ResourceManager::instance().addTextureAsync("cow", "cow.bmp", GL_TEXTURE_2D);
 
     entityManager = std::make_shared<EntityManager>();
 }
@@ -134,6 +145,26 @@ void World::newScene()
     initBlankScene();
 }
 
+void World::newLightBenchmarkScene()
+{
+    entityManager->clear();
+    mCurrentScene = std::make_unique<LightBenchmarkScene>(this);
+
+    mCurrentScene->initBlankScene();
+    mCurrentScene->initCustomObjects();
+    updateSceneName(mCurrentScene->name);
+}
+
+void World::newScriptBenchmarkScene()
+{
+    entityManager->clear();
+    mCurrentScene = std::make_unique<ScriptBenchmarkScene>(this);
+
+    mCurrentScene->initBlankScene();
+    mCurrentScene->initCustomObjects();
+    updateSceneName(mCurrentScene->name);
+}
+
 void World::clearEntities()
 {
     entityManager->clear();
@@ -141,14 +172,13 @@ void World::clearEntities()
 
 void World::loadTemp()
 {
-    if(mCurrentScene)
+    if(mPlaySnapshot)
     {
-        auto name = mCurrentScene->name;
-        mCurrentScene.reset();
-        mCurrentScene = std::make_unique<Scene>(this);
-        mCurrentScene->LoadFromFile("temp" + name + ".json");
-
-        updateSceneName(mCurrentScene->name);
+        const auto start = std::chrono::steady_clock::now();
+        mPlaySnapshot->restore(*entityManager);
+        const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        qDebug() << "World: Restored" << mPlaySnapshot->entityCount() << "entities in" << elapsed << "ms";
+        mPlaySnapshot.reset();
     }
 }
 
@@ -156,7 +186,10 @@ void World::saveTemp()
 {
     if(mCurrentScene)
     {
-        mCurrentScene->SaveToFile("temp" + mCurrentScene->name + ".json");
+        const auto start = std::chrono::steady_clock::now();
+        mPlaySnapshot = std::make_unique<EntitySnapshot>(*entityManager);
+        const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        qDebug() << "World: Snapshot of" << mPlaySnapshot->entityCount() << "entities took" << elapsed << "ms";
     }
 }
 
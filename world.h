@@ -4,6 +4,7 @@
 #include <QObject>
 #include <memory>
 #include "scene.h"
+#include "entitysnapshot.h"
 
 class EntityManager;
 class CameraComponent;
@@ -47,12 +48,12 @@ public:
     void clearEntities();
 
     /**
-     * @brief Called right after the game is stopped.
+     * @brief Called right after the game is stopped. Restores the entities from the snapshot taken by saveTemp.
      */
     void loadTemp();
 
     /**
-     * @brief Called right before the game is started.
+     * @brief Called right before the game is started. Takes an in-memory snapshot of all entities.
      */
     void saveTemp();
 
@@ -69,6 +70,16 @@ public:
 
     void newScene();
 
+    /**
+     * @brief Clears the current scene and replaces it with a LightBenchmarkScene.
+     */
+    void newLightBenchmarkScene();
+
+    /**
+     * @brief Clears the current scene and replaces it with a ScriptBenchmarkScene.
+     */
+    void newScriptBenchmarkScene();
+
     ~World();
 
 signals:
@@ -82,6 +93,9 @@ private:
     std::optional<std::string> sceneFileName;
 
     std::shared_ptr<EntityManager> entityManager;
+
+    //! Entities as they were when play mode started.
+    std::unique_ptr<EntitySnapshot> mPlaySnapshot;
 };
 
 #endif // WORLD_H